@@ -43,6 +43,7 @@
  * AES cipher for ARMv8 with Crypto Extensions
  */
 
+#include <crypto/crypto.h>
 #include <crypto/crypto_accel.h>
 #include <kernel/thread.h>
 #include <string.h>
@@ -138,6 +139,10 @@ TEE_Result crypto_accel_aes_expand_keys(const void *key, size_t key_len,
 	if (expanded_key_len < (num_rounds + 1) * sizeof(struct aes_block))
 		return TEE_ERROR_BAD_PARAMETERS;
 
+	if (crypto_aes_key_cache_get(key, key_len, enc_key, dec_key,
+				     expanded_key_len, round_count))
+		return TEE_SUCCESS;
+
 	*round_count = num_rounds;
 	memset(enc_key, 0, expanded_key_len);
 	memcpy(enc_key, key, key_len);
@@ -150,6 +155,8 @@ TEE_Result crypto_accel_aes_expand_keys(const void *key, size_t key_len,
 
 	thread_kernel_disable_vfp(vfp_state);
 
+	crypto_aes_key_cache_put(key, key_len, enc_key, dec_key, num_rounds);
+
 	return TEE_SUCCESS;
 }
 
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <assert.h>
+#include <crypto/crypto_accel.h>
+#include <kernel/thread.h>
+
+#define CHACHA20_BLOCK_SIZE	64
+#define CHACHA20_NEON_BLOCKS	4
+
+/* Prototype for assembly function */
+void chacha20_neon_4block(uint8_t *dst, const uint8_t *src,
+			  const uint32_t input[16]);
+
+void crypto_accel_chacha20_xor(uint32_t input[16], void *out, const void *in,
+			       unsigned int block_count)
+{
+	const size_t len = CHACHA20_NEON_BLOCKS * CHACHA20_BLOCK_SIZE;
+	uint32_t vfp_state = 0;
+	const uint8_t *src = in;
+	uint8_t *dst = out;
+
+	assert(!(block_count % CHACHA20_NEON_BLOCKS));
+
+	vfp_state = thread_kernel_enable_vfp();
+	while (block_count) {
+		chacha20_neon_4block(dst, src, input);
+		input[12] += CHACHA20_NEON_BLOCKS;
+		block_count -= CHACHA20_NEON_BLOCKS;
+		dst += len;
+		src += len;
+	}
+	thread_kernel_disable_vfp(vfp_state);
+}
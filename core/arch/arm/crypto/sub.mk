@@ -38,6 +38,11 @@ srcs-y += sm3_armv8a_ce.c
 srcs-$(CFG_ARM64_core) += sm3_armv8a_ce_a64.S
 endif
 
+ifeq ($(CFG_CRYPTO_CHACHA20_ARM_NEON),y)
+srcs-y += chacha20_armv8a_neon.c
+srcs-y += chacha20_armv8a_neon_a64.S
+endif
+
 ifeq ($(CFG_CRYPTO_SM4_ARM_CE),y)
 srcs-$(CFG_ARM64_core) += sm4_armv8a_ce.c
 srcs-$(CFG_ARM64_core) += sm4_armv8a_ce_a64.S
@@ -318,6 +318,8 @@
 #define OPTEE_SMC_SEC_CAP_RPC_ARG		BIT(6)
 /* Secure world supports probing for RPMB device if needed */
 #define OPTEE_SMC_SEC_CAP_RPMB_PROBE		BIT(7)
+/* Secure world supports OPTEE_SMC_GET_ASYNC_NOTIF_VALUES */
+#define OPTEE_SMC_SEC_CAP_ASYNC_NOTIF_VALUES	BIT(8)
 
 #define OPTEE_SMC_FUNCID_EXCHANGE_CAPABILITIES	U(9)
 #define OPTEE_SMC_EXCHANGE_CAPABILITIES \
@@ -561,6 +563,41 @@
 /* See OPTEE_SMC_CALL_WITH_REGD_ARG above */
 #define OPTEE_SMC_FUNCID_CALL_WITH_REGD_ARG	U(19)
 
+/*
+ * Retrieve all values of notifications pending since the last call of
+ * this function or OPTEE_SMC_GET_ASYNC_NOTIF_VALUE.
+ *
+ * This is a batched version of OPTEE_SMC_GET_ASYNC_NOTIF_VALUE. All
+ * asynchronous notification values are <= 63 so the complete set of
+ * pending values fits in a 64-bit bitmap which is returned and cleared
+ * in secure world in one go. Normal world can then handle all pending
+ * values with a single call instead of one call per value.
+ *
+ * While values are pending secure world doesn't raise another interrupt
+ * when a new value is posted, normal world is expected to call this
+ * function (or OPTEE_SMC_GET_ASYNC_NOTIF_VALUE) until no values are
+ * pending.
+ *
+ * Call requests usage:
+ * a0	SMC Function ID, OPTEE_SMC_GET_ASYNC_NOTIF_VALUES
+ * a1-6	Not used
+ * a7	Hypervisor Client ID register
+ *
+ * Normal return register usage:
+ * a0	OPTEE_SMC_RETURN_OK
+ * a1	Bitmap of pending values, bit n set means value n is pending,
+ *	values 0..31
+ * a2	Bitmap of pending values, values 32..63
+ * a3-7	Preserved
+ *
+ * Not supported return register usage:
+ * a0	OPTEE_SMC_RETURN_UNKNOWN_FUNCTION
+ * a1-7	Preserved
+ */
+#define OPTEE_SMC_FUNCID_GET_ASYNC_NOTIF_VALUES	U(20)
+#define OPTEE_SMC_GET_ASYNC_NOTIF_VALUES \
+	OPTEE_SMC_FAST_CALL_VAL(OPTEE_SMC_FUNCID_GET_ASYNC_NOTIF_VALUES)
+
 /*
  * Resume from RPC (for example after processing a foreign interrupt)
  *
@@ -37,6 +37,7 @@
 #include <mm/tee_mm.h>
 #include <mm/tee_pager.h>
 #include <sm/psci.h>
+#include <string_ext.h>
 #include <trace.h>
 #include <utee_defines.h>
 #include <util.h>
@@ -498,9 +499,55 @@ static struct fobj *ro_paged_alloc(tee_mm_entry_t *mm, void *hashes,
 #endif
 }
 
+#define PAGER_HASH_BATCH	8
+
+/*
+ * The pages are independent messages, they're hashed a batch at a time
+ * to let crypto_hash_mb() interleave them.
+ */
+static void check_pageable_hashes(const uint8_t *hashes,
+				  const uint8_t *paged_store,
+				  size_t num_pages)
+{
+	uint8_t digests[PAGER_HASH_BATCH][TEE_SHA256_HASH_SIZE] = { };
+	struct crypto_hash_mb_msg msgs[PAGER_HASH_BATCH] = { };
+	const uint8_t *hash = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t count = 0;
+	size_t n = 0;
+	size_t m = 0;
+
+	for (n = 0; n < num_pages; n += count) {
+		count = MIN(num_pages - n, (size_t)PAGER_HASH_BATCH);
+		for (m = 0; m < count; m++) {
+			msgs[m].data = paged_store + (n + m) * SMALL_PAGE_SIZE;
+			msgs[m].len = SMALL_PAGE_SIZE;
+			msgs[m].digest = digests[m];
+		}
+
+		res = crypto_hash_mb(TEE_ALG_SHA256, msgs, count);
+		if (res != TEE_SUCCESS) {
+			EMSG("Hash failed for pages %zu-%zu: res 0x%x",
+			     n, n + count - 1, res);
+			panic();
+		}
+
+		for (m = 0; m < count; m++) {
+			hash = hashes + (n + m) * TEE_SHA256_HASH_SIZE;
+			DMSG("hash pg_idx %zu hash %p page %p", n + m, hash,
+			     msgs[m].data);
+			if (consttime_memcmp(digests[m], hash,
+					     TEE_SHA256_HASH_SIZE)) {
+				EMSG("Hash failed for page %zu at %p",
+				     n + m, msgs[m].data);
+				panic();
+			}
+		}
+	}
+}
+
 static void init_pager_runtime(unsigned long pageable_part)
 {
-	size_t n;
 	size_t init_size = (size_t)(__init_end - __init_start);
 	size_t pageable_start = (size_t)__pageable_start;
 	size_t pageable_end = (size_t)__pageable_end;
@@ -567,19 +614,8 @@ static void init_pager_runtime(unsigned long pageable_part)
 
 	/* Check that hashes of what's in pageable area is OK */
 	DMSG("Checking hashes of pageable area");
-	for (n = 0; (n * SMALL_PAGE_SIZE) < pageable_size; n++) {
-		const uint8_t *hash = hashes + n * TEE_SHA256_HASH_SIZE;
-		const uint8_t *page = paged_store + n * SMALL_PAGE_SIZE;
-		TEE_Result res;
-
-		DMSG("hash pg_idx %zu hash %p page %p", n, hash, page);
-		res = hash_sha256_check(hash, page, SMALL_PAGE_SIZE);
-		if (res != TEE_SUCCESS) {
-			EMSG("Hash failed for page %zu at %p: res 0x%x",
-			     n, (void *)page, res);
-			panic();
-		}
-	}
+	check_pageable_hashes(hashes, paged_store,
+			      pageable_size / SMALL_PAGE_SIZE);
 
 	/*
 	 * Assert prepaged init sections are page aligned so that nothing
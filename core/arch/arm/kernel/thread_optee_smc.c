@@ -7,6 +7,7 @@
 #include <compiler.h>
 #include <config.h>
 #include <io.h>
+#include <kernel/latency_stats.h>
 #include <kernel/misc.h>
 #include <kernel/msg_param.h>
 #include <kernel/notif.h>
@@ -167,7 +168,9 @@ static uint32_t call_entry_std(struct optee_msg_arg *arg, size_t num_params,
 	else
 		rv = OPTEE_SMC_RETURN_OK;
 
-	thread_rpc_shm_cache_clear(&thr->shm_cache);
+	thread_rpc_shm_cache_trim(&thr->shm_cache,
+				  IS_ENABLED(CFG_PREALLOC_RPC_CACHE) &&
+				  thread_prealloc_rpc_cache);
 	if (rpc_arg)
 		thr->rpc_arg = NULL;
 
@@ -328,6 +331,12 @@ bool thread_disable_prealloc_rpc_cache(uint64_t *cookie)
 				goto out;
 			}
 		}
+		for (n = 0; n < CFG_NUM_THREADS; n++) {
+			*cookie = thread_rpc_shm_cache_pop_cookie(
+						&threads[n].shm_cache);
+			if (*cookie)
+				goto out;
+		}
 	}
 
 	*cookie = 0;
@@ -564,6 +573,7 @@ uint32_t thread_rpc_cmd(uint32_t cmd, size_t num_params,
 	uint32_t rpc_args[THREAD_RPC_NUM_ARGS] = { OPTEE_SMC_RETURN_RPC_CMD };
 	void *arg = NULL;
 	uint64_t carg = 0;
+	uint64_t start = 0;
 	uint32_t ret = 0;
 
 	/* The source CRYPTO_RNG_SRC_JITTER_RPC is safe to use here */
@@ -575,7 +585,9 @@ uint32_t thread_rpc_cmd(uint32_t cmd, size_t num_params,
 		return ret;
 
 	reg_pair_from_64(carg, rpc_args + 1, rpc_args + 2);
+	start = latency_stats_now();
 	thread_rpc(rpc_args);
+	latency_stats_record(LATENCY_STATS_RPC, cmd, start);
 
 	return get_rpc_arg_res(arg, num_params, params);
 }
@@ -594,6 +606,7 @@ static void thread_rpc_free(unsigned int bt, uint64_t cookie, struct mobj *mobj)
 	uint32_t rpc_args[THREAD_RPC_NUM_ARGS] = { OPTEE_SMC_RETURN_RPC_CMD };
 	void *arg = NULL;
 	uint64_t carg = 0;
+	uint64_t start = 0;
 	struct thread_param param = THREAD_PARAM_VALUE(IN, bt, cookie, 0);
 	uint32_t ret = get_rpc_arg(OPTEE_RPC_CMD_SHM_FREE, 1, &param,
 				   &arg, &carg);
@@ -602,7 +615,10 @@ static void thread_rpc_free(unsigned int bt, uint64_t cookie, struct mobj *mobj)
 
 	if (!ret) {
 		reg_pair_from_64(carg, rpc_args + 1, rpc_args + 2);
+		start = latency_stats_now();
 		thread_rpc(rpc_args);
+		latency_stats_record(LATENCY_STATS_RPC, OPTEE_RPC_CMD_SHM_FREE,
+				     start);
 	}
 }
 
@@ -660,6 +676,7 @@ static struct mobj *thread_rpc_alloc(size_t size, size_t align, unsigned int bt)
 	uint32_t rpc_args[THREAD_RPC_NUM_ARGS] = { OPTEE_SMC_RETURN_RPC_CMD };
 	void *arg = NULL;
 	uint64_t carg = 0;
+	uint64_t start = 0;
 	struct thread_param param = THREAD_PARAM_VALUE(IN, bt, size, align);
 	uint32_t ret = get_rpc_arg(OPTEE_RPC_CMD_SHM_ALLOC, 1, &param,
 				   &arg, &carg);
@@ -668,7 +685,9 @@ static struct mobj *thread_rpc_alloc(size_t size, size_t align, unsigned int bt)
 		return NULL;
 
 	reg_pair_from_64(carg, rpc_args + 1, rpc_args + 2);
+	start = latency_stats_now();
 	thread_rpc(rpc_args);
+	latency_stats_record(LATENCY_STATS_RPC, OPTEE_RPC_CMD_SHM_ALLOC, start);
 
 	return get_rpc_alloc_res(arg, bt, size);
 }
@@ -10,6 +10,7 @@
 #include <io.h>
 #include <kernel/dt.h>
 #include <kernel/interrupt.h>
+#include <kernel/latency_stats.h>
 #include <kernel/notif.h>
 #include <kernel/panic.h>
 #include <kernel/secure_partition.h>
@@ -2187,13 +2188,16 @@ uint32_t thread_rpc_cmd(uint32_t cmd, size_t num_params,
 		},
 	};
 	struct optee_msg_arg *arg = NULL;
+	uint64_t start = 0;
 	uint32_t ret = 0;
 
 	ret = get_rpc_arg(cmd, num_params, params, &arg);
 	if (ret)
 		return ret;
 
+	start = latency_stats_now();
 	thread_rpc(&rpc_arg);
+	latency_stats_record(LATENCY_STATS_RPC, cmd, start);
 
 	return get_rpc_arg_res(arg, num_params, params);
 }
@@ -2206,6 +2210,7 @@ static void thread_rpc_free(unsigned int bt, uint64_t cookie, struct mobj *mobj)
 		},
 	};
 	struct thread_param param = THREAD_PARAM_VALUE(IN, bt, cookie, 0);
+	uint64_t start = 0;
 	uint32_t res2 = 0;
 	uint32_t res = 0;
 
@@ -2218,8 +2223,12 @@ static void thread_rpc_free(unsigned int bt, uint64_t cookie, struct mobj *mobj)
 	if (res2)
 		DMSG("mobj_ffa_unregister_by_cookie(%#"PRIx64"): %#"PRIx32,
 		     cookie, res2);
-	if (!res)
+	if (!res) {
+		start = latency_stats_now();
 		thread_rpc(&rpc_arg);
+		latency_stats_record(LATENCY_STATS_RPC, OPTEE_RPC_CMD_SHM_FREE,
+				     start);
+	}
 }
 
 static struct mobj *thread_rpc_alloc(size_t size, size_t align, unsigned int bt)
@@ -2234,11 +2243,14 @@ static struct mobj *thread_rpc_alloc(size_t size, size_t align, unsigned int bt)
 	unsigned int internal_offset = 0;
 	struct mobj *mobj = NULL;
 	uint64_t cookie = 0;
+	uint64_t start = 0;
 
 	if (get_rpc_arg(OPTEE_RPC_CMD_SHM_ALLOC, 1, &param, &arg))
 		return NULL;
 
+	start = latency_stats_now();
 	thread_rpc(&rpc_arg);
+	latency_stats_record(LATENCY_STATS_RPC, OPTEE_RPC_CMD_SHM_ALLOC, start);
 
 	if (arg->num_params != 1 ||
 	    arg->params->attr != OPTEE_MSG_ATTR_TYPE_FMEM_OUTPUT)
@@ -13,6 +13,7 @@
 #include <kernel/notif.h>
 #include <kernel/panic.h>
 #include <kernel/refcount.h>
+#include <kernel/rwlock.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread_spmc.h>
 #include <kernel/virtualization.h>
@@ -28,7 +29,7 @@
 
 LIST_HEAD(prtn_list_head, guest_partition);
 
-static unsigned int prtn_list_lock __nex_data = SPINLOCK_UNLOCK;
+static unsigned int prtn_list_lock __nex_data = RWLOCK_UNLOCK;
 
 static struct prtn_list_head prtn_list __nex_data =
 	LIST_HEAD_INITIALIZER(prtn_list);
@@ -332,9 +333,9 @@ TEE_Result virt_guest_created(uint16_t guest_id)
 	/* Do the preinitcalls */
 	call_preinitcalls();
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 	LIST_INSERT_HEAD(&prtn_list, prtn, link);
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	IMSG("Added guest %d", guest_id);
 
@@ -394,7 +395,7 @@ struct guest_partition *virt_next_guest(struct guest_partition *prtn)
 	struct guest_partition *ret = NULL;
 	uint32_t exceptions = 0;
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 	if (prtn)
 		ret = LIST_NEXT(prtn, link);
 	else
@@ -404,7 +405,7 @@ struct guest_partition *virt_next_guest(struct guest_partition *prtn)
 		ret = LIST_NEXT(prtn, link);
 	if (ret)
 		get_prtn(ret);
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	virt_put_guest(prtn);
 
@@ -425,11 +426,11 @@ struct guest_partition *virt_get_guest(uint16_t guest_id)
 	struct guest_partition *prtn = NULL;
 	uint32_t exceptions = 0;
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_read_lock_xsave(&prtn_list_lock);
 	prtn = find_guest_by_id_unlocked(guest_id);
 	if (prtn)
 		get_prtn(prtn);
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_read_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	return prtn;
 }
@@ -442,7 +443,7 @@ void virt_put_guest(struct guest_partition *prtn)
 
 		assert(prtn->shutting_down);
 
-		exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+		exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 		LIST_REMOVE(prtn, link);
 		if (prtn_have_remaining_resources(prtn)) {
 			LIST_INSERT_HEAD(&prtn_destroy_list, prtn, link);
@@ -453,7 +454,7 @@ void virt_put_guest(struct guest_partition *prtn)
 			 */
 			do_free = false;
 		}
-		cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+		cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 		destroy_gsd(prtn, false /*!free_only*/);
 		tee_mm_free(prtn->tee_ram);
@@ -478,7 +479,7 @@ TEE_Result virt_guest_destroyed(uint16_t guest_id)
 
 	IMSG("Removing guest %"PRId16, guest_id);
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 
 	prtn = find_guest_by_id_unlocked(guest_id);
 	if (prtn && !prtn->got_guest_destroyed)
@@ -486,14 +487,14 @@ TEE_Result virt_guest_destroyed(uint16_t guest_id)
 	else
 		prtn = NULL;
 
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	if (prtn) {
 		notif_deliver_atomic_event(NOTIF_EVENT_SHUTDOWN, prtn->id);
 
-		exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+		exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 		prtn->shutting_down = true;
-		cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+		cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 		virt_put_guest(prtn);
 	} else {
@@ -598,7 +599,7 @@ TEE_Result virt_add_cookie_to_current_guest(uint64_t cookie)
 	struct guest_partition *prtn = NULL;
 	uint32_t exceptions = 0;
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 	if (find_prtn_cookie(cookie, NULL))
 		goto out;
 
@@ -609,7 +610,7 @@ TEE_Result virt_add_cookie_to_current_guest(uint64_t cookie)
 		res = TEE_SUCCESS;
 	}
 out:
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	return res;
 }
@@ -620,14 +621,14 @@ void virt_remove_cookie(uint64_t cookie)
 	uint32_t exceptions = 0;
 	int i = 0;
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 	prtn = find_prtn_cookie(cookie, &i);
 	if (prtn) {
 		memmove(prtn->cookies + i, prtn->cookies + i + 1,
 			sizeof(uint64_t) * (prtn->cookie_count - i - 1));
 		prtn->cookie_count--;
 	}
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 }
 
 uint16_t virt_find_guest_by_cookie(uint64_t cookie)
@@ -636,12 +637,12 @@ uint16_t virt_find_guest_by_cookie(uint64_t cookie)
 	uint32_t exceptions = 0;
 	uint16_t ret = 0;
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 	prtn = find_prtn_cookie(cookie, NULL);
 	if (prtn)
 		ret = prtn->id;
 
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	return ret;
 }
@@ -690,7 +691,7 @@ TEE_Result virt_reclaim_cookie_from_destroyed_guest(uint16_t guest_id,
 	TEE_Result res = TEE_ERROR_ITEM_NOT_FOUND;
 	uint32_t exceptions = 0;
 
-	exceptions = cpu_spin_lock_xsave(&prtn_list_lock);
+	exceptions = cpu_write_lock_xsave(&prtn_list_lock);
 	LIST_FOREACH(prtn, &prtn_destroy_list, link) {
 		if (prtn->id == guest_id) {
 			res = reclaim_cookie(prtn, cookie);
@@ -701,7 +702,7 @@ TEE_Result virt_reclaim_cookie_from_destroyed_guest(uint16_t guest_id,
 			break;
 		}
 	}
-	cpu_spin_unlock_xrestore(&prtn_list_lock, exceptions);
+	cpu_write_unlock_xrestore(&prtn_list_lock, exceptions);
 
 	nex_free(prtn);
 
@@ -110,6 +110,7 @@ static void tee_entry_exchange_capabilities(struct thread_smc_args *args)
 
 	if (IS_ENABLED(CFG_CORE_ASYNC_NOTIF)) {
 		args->a1 |= OPTEE_SMC_SEC_CAP_ASYNC_NOTIF;
+		args->a1 |= OPTEE_SMC_SEC_CAP_ASYNC_NOTIF_VALUES;
 		args->a2 = NOTIF_VALUE_MAX;
 	}
 	IMSG("Asynchronous notifications are %sabled",
@@ -221,6 +222,15 @@ static void get_async_notif_value(struct thread_smc_args *args)
 		args->a2 |= OPTEE_SMC_ASYNC_NOTIF_PENDING;
 }
 
+static void get_async_notif_values(struct thread_smc_args *args)
+{
+	uint64_t values = notif_get_values();
+
+	args->a0 = OPTEE_SMC_RETURN_OK;
+	args->a1 = (uint32_t)values;
+	args->a2 = (uint32_t)(values >> 32);
+}
+
 static void tee_entry_watchdog(struct thread_smc_args *args)
 {
 #if defined(CFG_WDT_SM_HANDLER)
@@ -309,6 +319,12 @@ void __tee_entry_fast(struct thread_smc_args *args)
 		else
 			args->a0 = OPTEE_SMC_RETURN_UNKNOWN_FUNCTION;
 		break;
+	case OPTEE_SMC_GET_ASYNC_NOTIF_VALUES:
+		if (IS_ENABLED(CFG_CORE_ASYNC_NOTIF))
+			get_async_notif_values(args);
+		else
+			args->a0 = OPTEE_SMC_RETURN_UNKNOWN_FUNCTION;
+		break;
 
 	/* Watchdog entry if handler ID is defined in TOS range */
 	case CFG_WDT_SM_HANDLER_ID:
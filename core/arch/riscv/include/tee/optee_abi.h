@@ -312,6 +312,8 @@
 #define OPTEE_ABI_SEC_CAP_ASYNC_NOTIF		BIT(5)
 /* Secure world supports pre-allocating RPC arg struct */
 #define OPTEE_ABI_SEC_CAP_RPC_ARG		BIT(6)
+/* Secure world supports OPTEE_ABI_GET_ASYNC_NOTIF_VALUES */
+#define OPTEE_ABI_SEC_CAP_ASYNC_NOTIF_VALUES	BIT(8)
 
 #define OPTEE_ABI_FUNCID_EXCHANGE_CAPABILITIES	U(9)
 #define OPTEE_ABI_EXCHANGE_CAPABILITIES \
@@ -555,6 +557,41 @@
 /* See OPTEE_ABI_CALL_WITH_REGD_ARG above */
 #define OPTEE_ABI_FUNCID_CALL_WITH_REGD_ARG	U(19)
 
+/*
+ * Retrieve all values of notifications pending since the last call of
+ * this function or OPTEE_ABI_GET_ASYNC_NOTIF_VALUE.
+ *
+ * This is a batched version of OPTEE_ABI_GET_ASYNC_NOTIF_VALUE. All
+ * asynchronous notification values are <= 63 so the complete set of
+ * pending values fits in a 64-bit bitmap which is returned and cleared
+ * in secure world in one go. Normal world can then handle all pending
+ * values with a single call instead of one call per value.
+ *
+ * While values are pending secure world doesn't raise another interrupt
+ * when a new value is posted, normal world is expected to call this
+ * function (or OPTEE_ABI_GET_ASYNC_NOTIF_VALUE) until no values are
+ * pending.
+ *
+ * Call requests usage:
+ * a0	ABI Function ID, OPTEE_ABI_GET_ASYNC_NOTIF_VALUES
+ * a1-6	Not used
+ * a7	Hypervisor Client ID register
+ *
+ * Normal return register usage:
+ * a0	OPTEE_ABI_RETURN_OK
+ * a1	Bitmap of pending values, bit n set means value n is pending,
+ *	values 0..31
+ * a2	Bitmap of pending values, values 32..63
+ * a3-7	Preserved
+ *
+ * Not supported return register usage:
+ * a0	OPTEE_ABI_RETURN_UNKNOWN_FUNCTION
+ * a1-7	Preserved
+ */
+#define OPTEE_ABI_FUNCID_GET_ASYNC_NOTIF_VALUES	U(20)
+#define OPTEE_ABI_GET_ASYNC_NOTIF_VALUES \
+	OPTEE_ABI_FAST_CALL_VAL(OPTEE_ABI_FUNCID_GET_ASYNC_NOTIF_VALUES)
+
 /*
  * Resume from RPC (for example after processing a foreign interrupt)
  *
@@ -79,6 +79,7 @@ static void tee_entry_exchange_capabilities(struct thread_abi_args *args)
 
 	if (IS_ENABLED(CFG_CORE_ASYNC_NOTIF)) {
 		args->a1 |= OPTEE_ABI_SEC_CAP_ASYNC_NOTIF;
+		args->a1 |= OPTEE_ABI_SEC_CAP_ASYNC_NOTIF_VALUES;
 		args->a2 = NOTIF_VALUE_MAX;
 	}
 	IMSG("Asynchronous notifications are %sabled",
@@ -187,6 +188,15 @@ static void get_async_notif_value(struct thread_abi_args *args)
 		args->a2 |= OPTEE_ABI_ASYNC_NOTIF_PENDING;
 }
 
+static void get_async_notif_values(struct thread_abi_args *args)
+{
+	uint64_t values = notif_get_values();
+
+	args->a0 = OPTEE_ABI_RETURN_OK;
+	args->a1 = (uint32_t)values;
+	args->a2 = (uint32_t)(values >> 32);
+}
+
 /*
  * If tee_entry_fast() is overridden, it's still supposed to call this
  * function.
@@ -259,6 +269,12 @@ void __tee_entry_fast(struct thread_abi_args *args)
 		else
 			args->a0 = OPTEE_ABI_RETURN_UNKNOWN_FUNCTION;
 		break;
+	case OPTEE_ABI_GET_ASYNC_NOTIF_VALUES:
+		if (IS_ENABLED(CFG_CORE_ASYNC_NOTIF))
+			get_async_notif_values(args);
+		else
+			args->a0 = OPTEE_ABI_RETURN_UNKNOWN_FUNCTION;
+		break;
 
 	default:
 		args->a0 = OPTEE_ABI_RETURN_UNKNOWN_FUNCTION;
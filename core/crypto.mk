@@ -13,10 +13,20 @@ ifeq (y,$(CFG_CRYPTO))
 CRYPTO_MAKEFILES := $(sort $(wildcard core/drivers/crypto/*/crypto.mk))
 include $(CRYPTO_MAKEFILES)
 
+# Handle the messages shorter than a size calibrated at boot for each
+# algorithm with the software implementation rather than with the crypto
+# driver, see STATS_CMD_CRYPTO_DISPATCH_STATS of the stats pseudo TA. Not
+# for drivers using keys which are only available to the hardware.
+CFG_CRYPTO_DRV_DISPATCH ?= n
+$(eval $(call cfg-depends-all,CFG_CRYPTO_DRV_DISPATCH,CFG_CRYPTO_DRIVER CFG_CORE_HAS_GENERIC_TIMER))
+
 # Ciphers
 CFG_CRYPTO_AES ?= y
 CFG_CRYPTO_DES ?= y
 CFG_CRYPTO_SM4 ?= y
+# Keep the AES key schedules expanded for the keys of TA objects so that
+# reinitializing an operation with an unchanged key skips the key expansion
+CFG_CRYPTO_AES_KEY_CACHE ?= y
 
 # Cipher block modes
 CFG_CRYPTO_ECB ?= y
@@ -59,6 +69,9 @@ CFG_CRYPTO_RSA ?= y
 CFG_CRYPTO_DH ?= y
 # ECC includes ECDSA and ECDH
 CFG_CRYPTO_ECC ?= y
+# Compute k*G for the NIST P-256 and P-384 generators with fixed-base comb
+# tables generated at build time (LibTomCrypt only, mbedtls has its own)
+CFG_CRYPTO_ECC_COMB ?= y
 CFG_CRYPTO_SM2_PKE ?= y
 CFG_CRYPTO_SM2_DSA ?= y
 CFG_CRYPTO_SM2_KEP ?= y
@@ -70,6 +83,8 @@ CFG_CRYPTO_CCM ?= y
 CFG_CRYPTO_GCM ?= y
 # Default uses the OP-TEE internal AES-GCM implementation
 CFG_CRYPTO_AES_GCM_FROM_CRYPTOLIB ?= n
+# ChaCha20-Poly1305 (RFC 8439), exposed to TAs as TEE_ALG_CHACHA20_POLY1305
+CFG_CRYPTO_CHACHA20_POLY1305 ?= y
 
 endif
 
@@ -138,6 +153,18 @@ CFG_AES_GCM_TABLE_BASED ?= y
 
 endif #!CFG_CRYPTO_WITH_CE
 
+# NEON is always present on Arm64, ChaCha20 uses it even without the
+# Cryptographic Extensions
+ifeq ($(CFG_ARM64_core),y)
+CFG_CRYPTO_CHACHA20_ARM_NEON ?= $(CFG_CRYPTO_CHACHA20_POLY1305)
+CFG_CORE_CRYPTO_CHACHA20_ACCEL ?= $(CFG_CRYPTO_CHACHA20_ARM_NEON)
+endif
+
+# CFG_CRYPTO_SM4_BITSLICE defines whether the software SM4 encrypts several
+# blocks at once with a bitsliced S-box instead of table lookups, in ECB,
+# CBC decryption, CTR and XTS. Not used when SM4 is accelerated.
+CFG_CRYPTO_SM4_BITSLICE ?= $(CFG_CRYPTO_SM4)
+
 
 # Cryptographic extensions can only be used safely when OP-TEE knows how to
 # preserve the VFP context
@@ -156,6 +183,9 @@ endif
 ifeq ($(CFG_CORE_CRYPTO_SM4_ACCEL),y)
 $(call force,CFG_WITH_VFP,y,required by CFG_CORE_CRYPTO_SM4_ACCEL)
 endif
+ifeq ($(CFG_CRYPTO_CHACHA20_ARM_NEON),y)
+$(call force,CFG_WITH_VFP,y,required by CFG_CRYPTO_CHACHA20_ARM_NEON)
+endif
 cryp-enable-all-depends = $(call cfg-enable-all-depends,$(strip $(1)),$(foreach v,$(2),CFG_CRYPTO_$(v)))
 $(eval $(call cryp-enable-all-depends,CFG_REE_FS, AES ECB CTR HMAC SHA256 GCM))
 $(eval $(call cryp-enable-all-depends,CFG_RPMB_FS, AES ECB CTR HMAC SHA256 GCM))
@@ -179,12 +209,17 @@ $(eval $(call cryp-dep-one, CCM, AES))
 $(eval $(call cryp-dep-one, GCM, AES))
 # If no AES cipher mode is left, disable AES
 $(eval $(call cryp-dep-one, AES, ECB CBC CTR CTS XTS))
+$(eval $(call cryp-dep-one, AES_KEY_CACHE, AES))
 # If no DES cipher mode is left, disable DES
 $(eval $(call cryp-dep-one, DES, ECB CBC))
 # SM2 is Elliptic Curve Cryptography, it uses some generic ECC functions
 $(eval $(call cryp-dep-one, SM2_PKE, ECC))
 $(eval $(call cryp-dep-one, SM2_DSA, ECC))
 $(eval $(call cryp-dep-one, SM2_KEP, ECC))
+# Secure storage must not silently change from ChaCha20-Poly1305 to AES-GCM
+ifeq ($(CFG_REE_FS_HTREE_CHACHA20_POLY1305)-$(CFG_CRYPTO_CHACHA20_POLY1305),y-n)
+$(error CFG_REE_FS_HTREE_CHACHA20_POLY1305=y requires CFG_CRYPTO_CHACHA20_POLY1305=y)
+endif
 
 ###############################################################
 # libtomcrypt (LTC) specifics, phase #1
@@ -207,7 +242,7 @@ core-ltc-vars += ECB CBC CTR CTS XTS
 core-ltc-vars += MD5 SHA1 SHA224 SHA256 SHA384 SHA512 SHA512_256
 core-ltc-vars += SHA3_224 SHA3_256 SHA3_384 SHA3_512 SHAKE128 SHAKE256
 core-ltc-vars += HMAC CMAC CBC_MAC
-core-ltc-vars += CCM
+core-ltc-vars += CCM CHACHA20_POLY1305
 ifeq ($(CFG_CRYPTO_AES_GCM_FROM_CRYPTOLIB),y)
 core-ltc-vars += GCM
 endif
@@ -225,6 +260,7 @@ _CFG_CORE_LTC_SHA1_ACCEL := $(CFG_CORE_CRYPTO_SHA1_ACCEL)
 _CFG_CORE_LTC_SHA256_ACCEL := $(CFG_CORE_CRYPTO_SHA256_ACCEL)
 _CFG_CORE_LTC_SHA512_ACCEL := $(CFG_CORE_CRYPTO_SHA512_ACCEL)
 _CFG_CORE_LTC_SHA3_ACCEL := $(CFG_CORE_CRYPTO_SHA3_ACCEL)
+_CFG_CORE_LTC_CHACHA20_ACCEL := $(CFG_CORE_CRYPTO_CHACHA20_ACCEL)
 endif
 
 ###############################################################
@@ -241,6 +277,8 @@ _CFG_CORE_LTC_SHA384_DESC := $(CFG_CRYPTO_DSA)
 _CFG_CORE_LTC_SHA512_DESC := $(CFG_CRYPTO_DSA)
 _CFG_CORE_LTC_XTS := $(CFG_CRYPTO_XTS)
 _CFG_CORE_LTC_CCM := $(CFG_CRYPTO_CCM)
+_CFG_CORE_LTC_CHACHA20_POLY1305 := $(CFG_CRYPTO_CHACHA20_POLY1305)
+_CFG_CORE_LTC_CHACHA20_ACCEL := $(CFG_CORE_CRYPTO_CHACHA20_ACCEL)
 _CFG_CORE_LTC_AES := $(call cfg-one-enabled, CFG_CRYPTO_XTS CFG_CRYPTO_CCM \
 					     CFG_CRYPTO_AES)
 _CFG_CORE_LTC_AES_ACCEL := $(CFG_CORE_CRYPTO_AES_ACCEL)
@@ -306,6 +344,8 @@ endif
 
 _CFG_CORE_LTC_CBC := $(call ltc-one-enabled, CBC CBC_MAC)
 _CFG_CORE_LTC_ASN1 := $(call ltc-one-enabled, RSA DSA ECC)
+_CFG_CORE_LTC_ECC_COMB := $(call cfg-all-enabled, _CFG_CORE_LTC_ECC \
+						  CFG_CRYPTO_ECC_COMB)
 _CFG_CORE_LTC_EC25519 := $(call ltc-one-enabled, ED25519 X25519)
 
 # Enable TEE_ALG_RSASSA_PKCS1_V1_5 algorithm for signing with PKCS#1 v1.5 EMSA
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <crypto/crypto.h>
+#include <kernel/thread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string_ext.h>
+#include <utee_defines.h>
+#include <util.h>
+
+#define AES_KEY_CACHE_MAX_KEY	32
+#define AES_KEY_CACHE_SCHED_LEN	(15 * TEE_AES_BLOCK_SIZE)
+
+/*
+ * Only the key of the owner of the cache is stored, other keys expanded
+ * while the cache is entered, such as the second key of AES-XTS, belong
+ * to other key objects.
+ */
+struct crypto_aes_key_cache {
+	uint8_t key[AES_KEY_CACHE_MAX_KEY];
+	size_t key_len;
+	uint64_t enc_key[AES_KEY_CACHE_SCHED_LEN / sizeof(uint64_t)];
+	uint64_t dec_key[AES_KEY_CACHE_SCHED_LEN / sizeof(uint64_t)];
+	unsigned int rounds;
+	bool have_dec_key;
+};
+
+/* Returns the entered cache if @key is the key of its owner */
+static struct crypto_aes_key_cache **get_cache_ref(const void *key,
+						   size_t key_len)
+{
+	struct thread_specific_data *tsd = NULL;
+
+	if (thread_get_id_may_fail() < 0)
+		return NULL;
+
+	tsd = thread_get_tsd();
+	if (!tsd->aes_key_cache || tsd->aes_key_cache_key_len != key_len ||
+	    consttime_memcmp(tsd->aes_key_cache_key, key, key_len))
+		return NULL;
+
+	return tsd->aes_key_cache;
+}
+
+static size_t sched_len(unsigned int rounds)
+{
+	return (rounds + 1) * TEE_AES_BLOCK_SIZE;
+}
+
+static bool match_key(struct crypto_aes_key_cache *cache, const void *key,
+		      size_t key_len)
+{
+	return cache->key_len == key_len &&
+	       !consttime_memcmp(cache->key, key, key_len);
+}
+
+void crypto_aes_key_cache_enter(struct crypto_aes_key_cache **cache,
+				const void *key, size_t key_len)
+{
+	struct thread_specific_data *tsd = thread_get_tsd();
+
+	tsd->aes_key_cache = cache;
+	tsd->aes_key_cache_key = key;
+	tsd->aes_key_cache_key_len = key_len;
+}
+
+void crypto_aes_key_cache_exit(void)
+{
+	struct thread_specific_data *tsd = thread_get_tsd();
+
+	tsd->aes_key_cache = NULL;
+	tsd->aes_key_cache_key = NULL;
+	tsd->aes_key_cache_key_len = 0;
+}
+
+bool crypto_aes_key_cache_get(const void *key, size_t key_len, void *enc_key,
+			      void *dec_key, size_t expanded_key_len,
+			      unsigned int *rounds)
+{
+	struct crypto_aes_key_cache **cache = get_cache_ref(key, key_len);
+	struct crypto_aes_key_cache *e = NULL;
+
+	if (!cache || !*cache)
+		return false;
+
+	e = *cache;
+	if (!match_key(e, key, key_len) || (dec_key && !e->have_dec_key) ||
+	    expanded_key_len < sched_len(e->rounds))
+		return false;
+
+	memset(enc_key, 0, expanded_key_len);
+	memcpy(enc_key, e->enc_key, sched_len(e->rounds));
+	if (dec_key)
+		memcpy(dec_key, e->dec_key, sched_len(e->rounds));
+	*rounds = e->rounds;
+
+	return true;
+}
+
+void crypto_aes_key_cache_put(const void *key, size_t key_len,
+			      const void *enc_key, const void *dec_key,
+			      unsigned int rounds)
+{
+	struct crypto_aes_key_cache **cache = get_cache_ref(key, key_len);
+	struct crypto_aes_key_cache *e = NULL;
+
+	if (!cache || key_len > AES_KEY_CACHE_MAX_KEY ||
+	    sched_len(rounds) > AES_KEY_CACHE_SCHED_LEN)
+		return;
+
+	if (!*cache) {
+		*cache = calloc(1, sizeof(**cache));
+		/* The cache is only an optimization, carry on without */
+		if (!*cache)
+			return;
+	}
+
+	e = *cache;
+	if (!match_key(e, key, key_len)) {
+		memzero_explicit(e, sizeof(*e));
+		memcpy(e->key, key, key_len);
+		e->key_len = key_len;
+	}
+
+	memcpy(e->enc_key, enc_key, sched_len(rounds));
+	if (dec_key) {
+		memcpy(e->dec_key, dec_key, sched_len(rounds));
+		e->have_dec_key = true;
+	}
+	e->rounds = rounds;
+}
+
+void crypto_aes_key_cache_free(struct crypto_aes_key_cache **cache)
+{
+	if (*cache) {
+		memzero_explicit(*cache, sizeof(**cache));
+		free(*cache);
+		*cache = NULL;
+	}
+}
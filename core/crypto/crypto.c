@@ -13,6 +13,58 @@
 #include <stdlib.h>
 #include <utee_defines.h>
 
+TEE_Result crypto_sw_hash_alloc_ctx(struct crypto_hash_ctx **ctx,
+				    uint32_t algo)
+{
+	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
+
+	switch (algo) {
+	case TEE_ALG_MD5:
+		res = crypto_md5_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA1:
+		res = crypto_sha1_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA224:
+		res = crypto_sha224_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA256:
+		res = crypto_sha256_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA384:
+		res = crypto_sha384_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA512:
+		res = crypto_sha512_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA3_224:
+		res = crypto_sha3_224_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA3_256:
+		res = crypto_sha3_256_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA3_384:
+		res = crypto_sha3_384_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHA3_512:
+		res = crypto_sha3_512_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHAKE128:
+		res = crypto_shake128_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SHAKE256:
+		res = crypto_shake256_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SM3:
+		res = crypto_sm3_alloc_ctx(ctx);
+		break;
+	default:
+		break;
+	}
+
+	return res;
+}
+
 TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo)
 {
 	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
@@ -24,51 +76,8 @@ TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo)
 	 */
 	res = drvcrypt_hash_alloc_ctx(&c, algo);
 
-	if (res == TEE_ERROR_NOT_IMPLEMENTED) {
-		switch (algo) {
-		case TEE_ALG_MD5:
-			res = crypto_md5_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA1:
-			res = crypto_sha1_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA224:
-			res = crypto_sha224_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA256:
-			res = crypto_sha256_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA384:
-			res = crypto_sha384_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA512:
-			res = crypto_sha512_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA3_224:
-			res = crypto_sha3_224_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA3_256:
-			res = crypto_sha3_256_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA3_384:
-			res = crypto_sha3_384_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHA3_512:
-			res = crypto_sha3_512_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHAKE128:
-			res = crypto_shake128_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SHAKE256:
-			res = crypto_shake256_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SM3:
-			res = crypto_sm3_alloc_ctx(&c);
-			break;
-		default:
-			break;
-		}
-	}
+	if (res == TEE_ERROR_NOT_IMPLEMENTED)
+		res = crypto_sw_hash_alloc_ctx(&c, algo);
 
 	if (!res)
 		*ctx = c;
@@ -111,6 +120,58 @@ TEE_Result crypto_hash_final(void *ctx, uint8_t *digest, size_t len)
 	return hash_ops(ctx)->final(ctx, digest, len);
 }
 
+TEE_Result crypto_sw_cipher_alloc_ctx(struct crypto_cipher_ctx **ctx,
+				      uint32_t algo)
+{
+	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
+
+	switch (algo) {
+	case TEE_ALG_AES_ECB_NOPAD:
+		res = crypto_aes_ecb_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_AES_CBC_NOPAD:
+		res = crypto_aes_cbc_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_AES_CTR:
+		res = crypto_aes_ctr_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_AES_CTS:
+		res = crypto_aes_cts_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_AES_XTS:
+		res = crypto_aes_xts_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_DES_ECB_NOPAD:
+		res = crypto_des_ecb_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_DES3_ECB_NOPAD:
+		res = crypto_des3_ecb_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_DES_CBC_NOPAD:
+		res = crypto_des_cbc_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_DES3_CBC_NOPAD:
+		res = crypto_des3_cbc_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SM4_ECB_NOPAD:
+		res = crypto_sm4_ecb_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SM4_CBC_NOPAD:
+		res = crypto_sm4_cbc_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SM4_CTR:
+		res = crypto_sm4_ctr_alloc_ctx(ctx);
+		break;
+	case TEE_ALG_SM4_XTS:
+		res = crypto_sm4_xts_alloc_ctx(ctx);
+		break;
+	default:
+		break;
+	}
+
+	return res;
+}
+
 TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo)
 {
 	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
@@ -122,51 +183,8 @@ TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo)
 	 */
 	res = drvcrypt_cipher_alloc_ctx(&c, algo);
 
-	if (res == TEE_ERROR_NOT_IMPLEMENTED) {
-		switch (algo) {
-		case TEE_ALG_AES_ECB_NOPAD:
-			res = crypto_aes_ecb_alloc_ctx(&c);
-			break;
-		case TEE_ALG_AES_CBC_NOPAD:
-			res = crypto_aes_cbc_alloc_ctx(&c);
-			break;
-		case TEE_ALG_AES_CTR:
-			res = crypto_aes_ctr_alloc_ctx(&c);
-			break;
-		case TEE_ALG_AES_CTS:
-			res = crypto_aes_cts_alloc_ctx(&c);
-			break;
-		case TEE_ALG_AES_XTS:
-			res = crypto_aes_xts_alloc_ctx(&c);
-			break;
-		case TEE_ALG_DES_ECB_NOPAD:
-			res = crypto_des_ecb_alloc_ctx(&c);
-			break;
-		case TEE_ALG_DES3_ECB_NOPAD:
-			res = crypto_des3_ecb_alloc_ctx(&c);
-			break;
-		case TEE_ALG_DES_CBC_NOPAD:
-			res = crypto_des_cbc_alloc_ctx(&c);
-			break;
-		case TEE_ALG_DES3_CBC_NOPAD:
-			res = crypto_des3_cbc_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SM4_ECB_NOPAD:
-			res = crypto_sm4_ecb_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SM4_CBC_NOPAD:
-			res = crypto_sm4_cbc_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SM4_CTR:
-			res = crypto_sm4_ctr_alloc_ctx(&c);
-			break;
-		case TEE_ALG_SM4_XTS:
-			res = crypto_sm4_xts_alloc_ctx(&c);
-			break;
-		default:
-			return TEE_ERROR_NOT_IMPLEMENTED;
-		}
-	}
+	if (res == TEE_ERROR_NOT_IMPLEMENTED)
+		res = crypto_sw_cipher_alloc_ctx(&c, algo);
 
 	if (!res)
 		*ctx = c;
@@ -383,6 +401,11 @@ TEE_Result crypto_authenc_alloc_ctx(void **ctx, uint32_t algo)
 		case TEE_ALG_AES_GCM:
 			res = crypto_aes_gcm_alloc_ctx(&c);
 			break;
+#endif
+#if defined(CFG_CRYPTO_CHACHA20_POLY1305)
+		case TEE_ALG_CHACHA20_POLY1305:
+			res = crypto_chacha20_poly1305_alloc_ctx(&c);
+			break;
 #endif
 		default:
 			break;
@@ -547,6 +570,41 @@ int32_t crypto_bignum_compare(struct bignum *a __unused,
 }
 #endif
 
+static void free_rsa_precomp(struct rsa_precomp *pc)
+{
+	crypto_bignum_free(&pc->rr_n);
+	crypto_bignum_free(&pc->rr_p);
+	crypto_bignum_free(&pc->rr_q);
+	free(pc);
+}
+
+struct rsa_precomp *
+crypto_acipher_publish_rsa_precomp(struct rsa_keypair *key,
+				   struct rsa_precomp *pc)
+{
+	struct rsa_precomp *old = NULL;
+
+	/*
+	 * Keys shared between threads, like the ones of pseudo TAs, may
+	 * have the values computed by several operations at once, the
+	 * first to finish wins.
+	 */
+	if (__atomic_compare_exchange_n(&key->precomp, &old, pc, false,
+					__ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+		return pc;
+
+	free_rsa_precomp(pc);
+	return old;
+}
+
+void crypto_acipher_free_rsa_precomp(struct rsa_keypair *key)
+{
+	if (key && key->precomp) {
+		free_rsa_precomp(key->precomp);
+		key->precomp = NULL;
+	}
+}
+
 #if !defined(CFG_CRYPTO_RSA)
 TEE_Result crypto_acipher_alloc_rsa_keypair(struct rsa_keypair *s __unused,
 					    size_t key_size_bits __unused)
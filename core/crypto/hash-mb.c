@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <crypto/crypto.h>
+#include <crypto/crypto_accel.h>
+#include <io.h>
+#include <string.h>
+#include <string_ext.h>
+#include <types_ext.h>
+#include <utee_defines.h>
+#include <util.h>
+
+#if defined(CFG_CRYPTO_SHA256_ARM_CE) && defined(ARM64)
+#define SHA256_BLOCK_SIZE	64
+
+static const uint32_t sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/*
+ * struct sha256_mb_stream - state of one message
+ * @state:	SHA-256 state
+ * @tail:	last bytes of the message followed by the padding
+ * @tail_blocks: number of blocks in @tail, 1 or 2
+ * @msg:	the message
+ */
+struct sha256_mb_stream {
+	uint32_t state[8];
+	uint8_t tail[2 * SHA256_BLOCK_SIZE];
+	unsigned int tail_blocks;
+	const struct crypto_hash_mb_msg *msg;
+};
+
+static void sha256_mb_start(struct sha256_mb_stream *s,
+			    const struct crypto_hash_mb_msg *msg)
+{
+	size_t tail_len = msg->len % SHA256_BLOCK_SIZE;
+
+	memcpy(s->state, sha256_iv, sizeof(s->state));
+	memset(s->tail, 0, sizeof(s->tail));
+	if (tail_len)
+		memcpy(s->tail,
+		       (const uint8_t *)msg->data + msg->len - tail_len,
+		       tail_len);
+	s->tail[tail_len] = 0x80;
+	/* The padding needs 9 bytes: 0x80 and the length in bits */
+	if (tail_len + 9 > SHA256_BLOCK_SIZE)
+		s->tail_blocks = 2;
+	else
+		s->tail_blocks = 1;
+	put_unaligned_be64(s->tail + s->tail_blocks * SHA256_BLOCK_SIZE - 8,
+			   (uint64_t)msg->len * 8);
+	s->msg = msg;
+}
+
+static void sha256_mb_finish(struct sha256_mb_stream *s)
+{
+	size_t n = 0;
+
+	for (n = 0; n < ARRAY_SIZE(s->state); n++)
+		put_unaligned_be32(s->msg->digest + n * sizeof(uint32_t),
+				   s->state[n]);
+	memzero_explicit(s, sizeof(*s));
+}
+
+static void sha256_mb_one(const struct crypto_hash_mb_msg *msg)
+{
+	struct sha256_mb_stream s = { };
+	size_t blocks = msg->len / SHA256_BLOCK_SIZE;
+
+	sha256_mb_start(&s, msg);
+	if (blocks)
+		crypto_accel_sha256_compress(s.state, msg->data, blocks);
+	crypto_accel_sha256_compress(s.state, s.tail, s.tail_blocks);
+	sha256_mb_finish(&s);
+}
+
+static void sha256_mb_two(const struct crypto_hash_mb_msg *msg0,
+			  const struct crypto_hash_mb_msg *msg1)
+{
+	struct sha256_mb_stream s[2] = { };
+	size_t blocks0 = msg0->len / SHA256_BLOCK_SIZE;
+	size_t blocks1 = msg1->len / SHA256_BLOCK_SIZE;
+	size_t common = MIN(blocks0, blocks1);
+	const uint8_t *d0 = msg0->data;
+	const uint8_t *d1 = msg1->data;
+
+	sha256_mb_start(s, msg0);
+	sha256_mb_start(s + 1, msg1);
+
+	if (common)
+		crypto_accel_sha256_compress_x2(s[0].state, d0, s[1].state, d1,
+						common);
+	d0 += common * SHA256_BLOCK_SIZE;
+	d1 += common * SHA256_BLOCK_SIZE;
+	if (blocks0 > common)
+		crypto_accel_sha256_compress(s[0].state, d0, blocks0 - common);
+	if (blocks1 > common)
+		crypto_accel_sha256_compress(s[1].state, d1, blocks1 - common);
+
+	if (s[0].tail_blocks == s[1].tail_blocks) {
+		crypto_accel_sha256_compress_x2(s[0].state, s[0].tail,
+						s[1].state, s[1].tail,
+						s[0].tail_blocks);
+	} else {
+		crypto_accel_sha256_compress(s[0].state, s[0].tail,
+					     s[0].tail_blocks);
+		crypto_accel_sha256_compress(s[1].state, s[1].tail,
+					     s[1].tail_blocks);
+	}
+
+	sha256_mb_finish(s);
+	sha256_mb_finish(s + 1);
+}
+
+static TEE_Result sha256_mb(const struct crypto_hash_mb_msg *msgs,
+			    size_t count)
+{
+	size_t n = 0;
+
+	for (n = 0; n + 1 < count; n += 2)
+		sha256_mb_two(msgs + n, msgs + n + 1);
+	if (n < count)
+		sha256_mb_one(msgs + n);
+
+	return TEE_SUCCESS;
+}
+#elif defined(CFG_CRYPTO_SHA256)
+static TEE_Result sha256_mb(const struct crypto_hash_mb_msg *msgs,
+			    size_t count)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	for (n = 0; n < count; n++) {
+		res = hash_sha256_compute(msgs[n].digest, msgs[n].data,
+					  msgs[n].len);
+		if (res)
+			return res;
+	}
+
+	return TEE_SUCCESS;
+}
+#else
+static TEE_Result sha256_mb(const struct crypto_hash_mb_msg *msgs __unused,
+			    size_t count __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
+#endif
+
+static TEE_Result hash_mb(uint32_t algo, const struct crypto_hash_mb_msg *msgs,
+			  size_t count)
+{
+	size_t digest_len = TEE_ALG_GET_DIGEST_SIZE(algo);
+	TEE_Result res = TEE_SUCCESS;
+	void *ctx = NULL;
+	size_t n = 0;
+
+	res = crypto_hash_alloc_ctx(&ctx, algo);
+	if (res)
+		return res;
+
+	for (n = 0; n < count; n++) {
+		res = crypto_hash_init(ctx);
+		if (res)
+			break;
+		res = crypto_hash_update(ctx, msgs[n].data, msgs[n].len);
+		if (res)
+			break;
+		res = crypto_hash_final(ctx, msgs[n].digest, digest_len);
+		if (res)
+			break;
+	}
+
+	crypto_hash_free_ctx(ctx);
+	return res;
+}
+
+TEE_Result crypto_hash_mb(uint32_t algo, const struct crypto_hash_mb_msg *msgs,
+			  size_t count)
+{
+	if (count && !msgs)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	switch (algo) {
+	case TEE_ALG_SHA256:
+		return sha256_mb(msgs, count);
+	case TEE_ALG_SHA512:
+		return hash_mb(algo, msgs, count);
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+}
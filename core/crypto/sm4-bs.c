@@ -0,0 +1,281 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Bitsliced SM4, SM4_BS_BLOCKS blocks at once without table lookups.
+ *
+ * Each 32-bit word of the state of the blocks is held in 8 slices of a
+ * register each, bit SM4_BS_BLOCKS * k + b of slice j is bit j of byte k
+ * of the word of block b. The S-box is then computed for the 4 bytes of
+ * all the blocks by a boolean circuit on the slices, and the rotations of
+ * the linear transform are permutations of the slices and rotations of
+ * the slices by multiples of SM4_BS_BLOCKS bits.
+ *
+ * The SM4 S-box is S(x) = A * I(A * x + 0xd3) + 0xd3 where I is the
+ * inversion in GF(2^8) modulo x^8 + x^7 + x^6 + x^5 + x^4 + x^2 + 1 and A
+ * a circulant matrix. The inversion is computed in the isomorphic tower
+ * field GF((2^4)^2), GF(2^4) modulo z^4 + z + 1 and GF((2^4)^2) modulo
+ * y^2 + y + z^3. The change of basis is merged with A on input and
+ * output.
+ */
+
+#include <string.h>
+
+#include "sm4.h"
+
+#define GET_UINT32_BE(n, b, i)				\
+	do {						\
+		(n) = ((uint32_t)(b)[(i)] << 24)     |	\
+		      ((uint32_t)(b)[(i) + 1] << 16) |	\
+		      ((uint32_t)(b)[(i) + 2] <<  8) |	\
+		      ((uint32_t)(b)[(i) + 3]);		\
+	} while (0)
+
+#define PUT_UINT32_BE(n, b, i)				\
+	do {						\
+		(b)[(i)] = (uint8_t)((n) >> 24);	\
+		(b)[(i) + 1] = (uint8_t)((n) >> 16);	\
+		(b)[(i) + 2] = (uint8_t)((n) >>  8);	\
+		(b)[(i) + 3] = (uint8_t)((n));		\
+	} while (0)
+
+/* Rotation of the slices by @n bytes of the words */
+static sm4_bs_word rol_bytes(sm4_bs_word x, unsigned int n)
+{
+	unsigned int bits = n * SM4_BS_BLOCKS;
+
+	return (x << bits) | (x >> (4 * SM4_BS_BLOCKS - bits));
+}
+
+/* Round key @rk with its byte k in the bits of byte k of the slices */
+static sm4_bs_word key_lanes(uint32_t rk)
+{
+	sm4_bs_word v = rk;
+
+#if __SIZEOF_LONG__ == 8
+	v = (v | (v << 16)) & 0x0000ffff0000ffffUL;
+	v = (v | (v << 8)) & 0x00ff00ff00ff00ffUL;
+#endif
+
+	return v;
+}
+
+/* Slice j of the round key, bit j of each of its bytes broadcast */
+static sm4_bs_word key_slice(sm4_bs_word lanes, unsigned int j)
+{
+	sm4_bs_word mask = ((sm4_bs_word)1 << SM4_BS_BLOCKS) - 1;
+
+	return ((lanes >> j) & ((sm4_bs_word)-1 / mask)) * mask;
+}
+
+/* Transpose the 8x8 bit matrix with row i in byte i of @x */
+static uint64_t transpose8(uint64_t x)
+{
+	uint64_t t = 0;
+
+	t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+/* Slice the words @w of the blocks into @s, 8 blocks at a time */
+static void to_slices(const uint32_t w[SM4_BS_BLOCKS], sm4_bs_word s[8])
+{
+	unsigned int pos = 0;
+	uint64_t m = 0;
+	unsigned int b = 0;
+	unsigned int g = 0;
+	unsigned int j = 0;
+	unsigned int k = 0;
+
+	memset(s, 0, 8 * sizeof(*s));
+
+	for (k = 0; k < 4; k++) {
+		for (g = 0; g < SM4_BS_BLOCKS; g += 8) {
+			m = 0;
+			for (b = 0; b < 8; b++)
+				m |= (uint64_t)((w[g + b] >> (8 * k)) & 0xff) <<
+				     (8 * b);
+			m = transpose8(m);
+			pos = SM4_BS_BLOCKS * k + g;
+			for (j = 0; j < 8; j++)
+				s[j] |= (sm4_bs_word)((m >> (8 * j)) & 0xff) <<
+					pos;
+		}
+	}
+}
+
+/* Inverse of to_slices() */
+static void from_slices(const sm4_bs_word s[8], uint32_t w[SM4_BS_BLOCKS])
+{
+	unsigned int pos = 0;
+	uint64_t m = 0;
+	unsigned int b = 0;
+	unsigned int g = 0;
+	unsigned int j = 0;
+	unsigned int k = 0;
+
+	memset(w, 0, SM4_BS_BLOCKS * sizeof(*w));
+
+	for (k = 0; k < 4; k++) {
+		for (g = 0; g < SM4_BS_BLOCKS; g += 8) {
+			m = 0;
+			pos = SM4_BS_BLOCKS * k + g;
+			for (j = 0; j < 8; j++)
+				m |= (uint64_t)((s[j] >> pos) & 0xff) <<
+				     (8 * j);
+			m = transpose8(m);
+			for (b = 0; b < 8; b++)
+				w[g + b] |= (uint32_t)((m >> (8 * b)) & 0xff) <<
+					    (8 * k);
+		}
+	}
+}
+
+/* Multiplication in GF(2^4) modulo z^4 + z + 1 */
+static void gf16_mul(sm4_bs_word r[4], const sm4_bs_word a[4],
+		     const sm4_bs_word b[4])
+{
+	sm4_bs_word c0 = a[0] & b[0];
+	sm4_bs_word c1 = (a[0] & b[1]) ^ (a[1] & b[0]);
+	sm4_bs_word c2 = (a[0] & b[2]) ^ (a[1] & b[1]) ^ (a[2] & b[0]);
+	sm4_bs_word c3 = (a[0] & b[3]) ^ (a[1] & b[2]) ^ (a[2] & b[1]) ^
+			 (a[3] & b[0]);
+	sm4_bs_word c4 = (a[1] & b[3]) ^ (a[2] & b[2]) ^ (a[3] & b[1]);
+	sm4_bs_word c5 = (a[2] & b[3]) ^ (a[3] & b[2]);
+	sm4_bs_word c6 = a[3] & b[3];
+
+	r[0] = c0 ^ c4;
+	r[1] = c1 ^ c4 ^ c5;
+	r[2] = c2 ^ c5 ^ c6;
+	r[3] = c3 ^ c6;
+}
+
+/* Inversion in GF(2^4) modulo z^4 + z + 1, 0 is mapped to 0 */
+static void gf16_inv(sm4_bs_word r[4], const sm4_bs_word d[4])
+{
+	sm4_bs_word d01 = d[0] & d[1];
+	sm4_bs_word d02 = d[0] & d[2];
+	sm4_bs_word d03 = d[0] & d[3];
+	sm4_bs_word d12 = d[1] & d[2];
+	sm4_bs_word d13 = d[1] & d[3];
+	sm4_bs_word d23 = d[2] & d[3];
+	sm4_bs_word d123 = d12 & d[3];
+
+	r[0] = d[0] ^ d[1] ^ d[2] ^ d[3] ^ d02 ^ d12 ^ (d01 & d[2]) ^ d123;
+	r[1] = d01 ^ d02 ^ d12 ^ d[3] ^ d13 ^ (d01 & d[3]);
+	r[2] = d01 ^ d[2] ^ d02 ^ d[3] ^ d03 ^ (d02 & d[3]);
+	r[3] = d[1] ^ d[2] ^ d[3] ^ d03 ^ d13 ^ d23 ^ d123;
+}
+
+/* SM4 S-box on the slices @x of bytes */
+static void sbox(sm4_bs_word x[8])
+{
+	sm4_bs_word a0[4] = { };
+	sm4_bs_word a1[4] = { };
+	sm4_bs_word a01[4] = { };
+	sm4_bs_word d[4] = { };
+	sm4_bs_word di[4] = { };
+	sm4_bs_word m[4] = { };
+	sm4_bs_word b0[4] = { };
+	sm4_bs_word b1[4] = { };
+
+	/* Into the tower field a1 * y + a0, after the affine transform */
+	a0[0] = x[3] ^ x[4] ^ x[6] ^ x[7];
+	a0[1] = x[0] ^ x[2] ^ x[5] ^ x[6];
+	a0[2] = ~(x[1] ^ x[2] ^ x[3] ^ x[4] ^ x[5] ^ x[7]);
+	a0[3] = ~(x[0] ^ x[1] ^ x[5] ^ x[6] ^ x[7]);
+	a1[0] = x[0] ^ x[1] ^ x[4] ^ x[7];
+	a1[1] = ~x[6];
+	a1[2] = x[2] ^ x[6] ^ x[7];
+	a1[3] = ~(x[0] ^ x[1] ^ x[2] ^ x[3] ^ x[4] ^ x[5] ^ x[6]);
+
+	/*
+	 * (a1 * y + a0)^-1 = (a1 * y + a0 + a1) * d^-1 with
+	 * d = a1^2 * z^3 + a1 * a0 + a0^2, the squares are linear
+	 */
+	gf16_mul(m, a1, a0);
+	d[0] = m[0] ^ a1[2] ^ a0[0] ^ a0[2];
+	d[1] = m[1] ^ a1[1] ^ a1[2] ^ a1[3] ^ a0[2];
+	d[2] = m[2] ^ a1[1] ^ a0[1] ^ a0[3];
+	d[3] = m[3] ^ a1[0] ^ a1[2] ^ a1[3] ^ a0[3];
+	gf16_inv(di, d);
+
+	a01[0] = a0[0] ^ a1[0];
+	a01[1] = a0[1] ^ a1[1];
+	a01[2] = a0[2] ^ a1[2];
+	a01[3] = a0[3] ^ a1[3];
+	gf16_mul(b1, a1, di);
+	gf16_mul(b0, a01, di);
+
+	/* Back from the tower field, with the affine transform */
+	x[0] = ~(b0[0] ^ b0[1] ^ b1[0] ^ b1[3]);
+	x[1] = ~(b0[0] ^ b0[2] ^ b1[2]);
+	x[2] = b0[2] ^ b1[1] ^ b1[2] ^ b1[3];
+	x[3] = b0[0] ^ b0[2] ^ b1[0] ^ b1[3];
+	x[4] = ~(b0[1] ^ b0[3] ^ b1[0]);
+	x[5] = b0[1] ^ b0[3] ^ b1[0] ^ b1[1] ^ b1[3];
+	x[6] = ~(b0[0] ^ b0[1] ^ b0[2] ^ b1[0] ^ b1[2]);
+	x[7] = ~(b0[0] ^ b0[3] ^ b1[0]);
+}
+
+/*
+ * One round, x0 ^= L(S(x1 ^ x2 ^ x3 ^ rk)) with
+ * L(b) = b ^ (b <<< 2) ^ (b <<< 10) ^ (b <<< 18) ^ (b <<< 24)
+ */
+static void bs_round(sm4_bs_word x0[8], const sm4_bs_word x1[8],
+		     const sm4_bs_word x2[8], const sm4_bs_word x3[8],
+		     uint32_t rk)
+{
+	sm4_bs_word lanes = key_lanes(rk);
+	sm4_bs_word b[8] = { };
+	sm4_bs_word t[8] = { };
+	unsigned int j = 0;
+
+	for (j = 0; j < 8; j++)
+		b[j] = x1[j] ^ x2[j] ^ x3[j] ^ key_slice(lanes, j);
+
+	sbox(b);
+
+	/* t = b <<< 2 */
+	for (j = 0; j < 6; j++)
+		t[j + 2] = b[j];
+	t[0] = rol_bytes(b[6], 1);
+	t[1] = rol_bytes(b[7], 1);
+
+	for (j = 0; j < 8; j++)
+		x0[j] ^= b[j] ^ t[j] ^ rol_bytes(t[j], 1) ^
+			 rol_bytes(t[j], 2) ^ rol_bytes(b[j], 3);
+}
+
+void sm4_bs_crypt_blocks(const uint32_t sk[32], const uint8_t *input,
+			 uint8_t *output)
+{
+	uint32_t w[SM4_BS_BLOCKS] = { };
+	sm4_bs_word x[4][8] = { };
+	unsigned int b = 0;
+	unsigned int i = 0;
+
+	for (i = 0; i < 4; i++) {
+		for (b = 0; b < SM4_BS_BLOCKS; b++)
+			GET_UINT32_BE(w[b], input, 16 * b + 4 * i);
+		to_slices(w, x[i]);
+	}
+
+	for (i = 0; i < 32; i += 4) {
+		bs_round(x[0], x[1], x[2], x[3], sk[i]);
+		bs_round(x[1], x[2], x[3], x[0], sk[i + 1]);
+		bs_round(x[2], x[3], x[0], x[1], sk[i + 2]);
+		bs_round(x[3], x[0], x[1], x[2], sk[i + 3]);
+	}
+
+	/* The output is the last four words in reverse order */
+	for (i = 0; i < 4; i++) {
+		from_slices(x[3 - i], w);
+		for (b = 0; b < SM4_BS_BLOCKS; b++)
+			PUT_UINT32_BE(w[b], output, 16 * b + 4 * i);
+	}
+}
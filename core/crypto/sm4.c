@@ -14,6 +14,7 @@
 
 #include "sm4.h"
 #include <assert.h>
+#include <config.h>
 #include <string.h>
 
 #define GET_UINT32_BE(n, b, i)				\
@@ -37,6 +38,9 @@
 
 #define SWAP(a, b)	{ uint32_t t = a; a = b; b = t; t = 0; }
 
+/* Bytes processed by one call to sm4_bs_crypt_blocks() */
+#define SM4_BS_BYTES	(SM4_BS_BLOCKS * 16)
+
 /*
  * Expanded SM4 S-boxes
  */
@@ -205,6 +209,13 @@ void sm4_crypt_ecb(struct sm4_context *ctx, size_t length, const uint8_t *input,
 {
 	assert(!(length % 16));
 
+	while (IS_ENABLED(CFG_CRYPTO_SM4_BITSLICE) && length >= SM4_BS_BYTES) {
+		sm4_bs_crypt_blocks(ctx->sk, input, output);
+		input  += SM4_BS_BYTES;
+		output += SM4_BS_BYTES;
+		length -= SM4_BS_BYTES;
+	}
+
 	while (length > 0) {
 		sm4_one_round(ctx->sk, input, output);
 		input  += 16;
@@ -213,6 +224,25 @@ void sm4_crypt_ecb(struct sm4_context *ctx, size_t length, const uint8_t *input,
 	}
 }
 
+/*
+ * CBC decryption of SM4_BS_BYTES bytes, the ciphertext is saved first as
+ * @input and @output may be the same buffer
+ */
+static void sm4_bs_decrypt_cbc(struct sm4_context *ctx, uint8_t iv[16],
+			       const uint8_t *input, uint8_t *output)
+{
+	uint8_t temp[SM4_BS_BYTES];
+	size_t i;
+
+	memcpy(temp, input, SM4_BS_BYTES);
+	sm4_bs_crypt_blocks(ctx->sk, temp, output);
+	for (i = 0; i < 16; i++)
+		output[i] ^= iv[i];
+	for (i = 16; i < SM4_BS_BYTES; i++)
+		output[i] ^= temp[i - 16];
+	memcpy(iv, temp + SM4_BS_BYTES - 16, 16);
+}
+
 void sm4_crypt_cbc(struct sm4_context *ctx, size_t length, uint8_t iv[16],
 		   const uint8_t *input, uint8_t *output)
 {
@@ -233,6 +263,14 @@ void sm4_crypt_cbc(struct sm4_context *ctx, size_t length, uint8_t iv[16],
 		}
 	} else {
 		/* SM4_DECRYPT */
+		while (IS_ENABLED(CFG_CRYPTO_SM4_BITSLICE) &&
+		       length >= SM4_BS_BYTES) {
+			sm4_bs_decrypt_cbc(ctx, iv, input, output);
+			input  += SM4_BS_BYTES;
+			output += SM4_BS_BYTES;
+			length -= SM4_BS_BYTES;
+		}
+
 		while (length > 0) {
 			memcpy(temp, input, 16);
 			sm4_one_round(ctx->sk, input, output);
@@ -246,6 +284,32 @@ void sm4_crypt_cbc(struct sm4_context *ctx, size_t length, uint8_t iv[16],
 	}
 }
 
+/* Increment the 128-bit big endian counter @ctr */
+static void ctr_inc(uint8_t ctr[16])
+{
+	int i;
+
+	for (i = 16; i > 0; i--)
+		if (++ctr[i - 1])
+			break;
+}
+
+/* CTR encryption of SM4_BS_BYTES bytes, the counters are encrypted at once */
+static void sm4_bs_crypt_ctr(struct sm4_context *ctx, uint8_t ctr[16],
+			     const uint8_t *input, uint8_t *output)
+{
+	uint8_t temp[SM4_BS_BYTES];
+	size_t i;
+
+	for (i = 0; i < SM4_BS_BYTES; i += 16) {
+		memcpy(temp + i, ctr, 16);
+		ctr_inc(ctr);
+	}
+	sm4_bs_crypt_blocks(ctx->sk, temp, temp);
+	for (i = 0; i < SM4_BS_BYTES; i++)
+		output[i] = input[i] ^ temp[i];
+}
+
 void sm4_crypt_ctr(struct sm4_context *ctx, size_t length, uint8_t ctr[16],
 		   const uint8_t *input, uint8_t *output)
 {
@@ -254,15 +318,20 @@ void sm4_crypt_ctr(struct sm4_context *ctx, size_t length, uint8_t ctr[16],
 
 	assert(!(length % 16));
 
+	while (IS_ENABLED(CFG_CRYPTO_SM4_BITSLICE) && length >= SM4_BS_BYTES) {
+		sm4_bs_crypt_ctr(ctx, ctr, input, output);
+		input  += SM4_BS_BYTES;
+		output += SM4_BS_BYTES;
+		length -= SM4_BS_BYTES;
+	}
+
 	while (length > 0) {
 		memcpy(temp, ctr, 16);
 		sm4_one_round(ctx->sk, ctr, ctr);
 		for (i = 0; i < 16; i++)
 			output[i] = (uint8_t)(input[i] ^ ctr[i]);
 		memcpy(ctr, temp, 16);
-		for (i = 16; i > 0; i--)
-			if (++ctr[i - 1])
-				break;
+		ctr_inc(ctr);
 		input  += 16;
 		output += 16;
 		length -= 16;
@@ -292,6 +361,27 @@ static void xor_128(const uint8_t a[16], const uint8_t b[16], uint8_t c[16])
 		c[i] = a[i] ^ b[i];
 }
 
+/*
+ * XTS encryption or decryption of SM4_BS_BYTES bytes, the tweaks are
+ * computed first and @tweak is advanced past them
+ */
+static void sm4_bs_crypt_xts(struct sm4_context *ctx, uint8_t tweak[16],
+			     const uint8_t *input, uint8_t *output)
+{
+	uint8_t tweaks[SM4_BS_BYTES];
+	size_t i;
+
+	for (i = 0; i < SM4_BS_BYTES; i += 16) {
+		memcpy(tweaks + i, tweak, 16);
+		xts_multi(tweak, tweak);
+	}
+	for (i = 0; i < SM4_BS_BYTES; i++)
+		output[i] = input[i] ^ tweaks[i];
+	sm4_bs_crypt_blocks(ctx->sk, output, output);
+	for (i = 0; i < SM4_BS_BYTES; i++)
+		output[i] ^= tweaks[i];
+}
+
 void sm4_crypt_xts(struct sm4_context *ctx, struct sm4_context *ctx_ek,
 		   struct sm4_context *ctx_dk, size_t len, uint8_t *iv,
 		   const uint8_t *input, uint8_t *output)
@@ -308,6 +398,17 @@ void sm4_crypt_xts(struct sm4_context *ctx, struct sm4_context *ctx_ek,
 	if (ctx->mode == SM4_DECRYPT && (len % 16))
 		len -= 16;
 
+	while (IS_ENABLED(CFG_CRYPTO_SM4_BITSLICE) && len >= SM4_BS_BYTES) {
+		sm4_bs_crypt_xts(ctx, tweak, input, output);
+		len -= SM4_BS_BYTES;
+		if (len == 0) {
+			sm4_one_round(ctx_dk->sk, tweak, iv);
+			return;
+		}
+		input += SM4_BS_BYTES;
+		output += SM4_BS_BYTES;
+	}
+
 	while (len >= 16) {
 		xor_128(input, tweak, ct);
 		sm4_one_round(ctx->sk, ct, ct);
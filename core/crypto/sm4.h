@@ -5,6 +5,7 @@
 #ifndef CORE_CRYPTO_SM4_H
 #define CORE_CRYPTO_SM4_H
 
+#include <compiler.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -28,4 +29,26 @@ void sm4_crypt_xts(struct sm4_context *ctx, struct sm4_context *ctx_ek,
 		   struct sm4_context *ctx_dk, size_t length, uint8_t *iv,
 		   const uint8_t *input, uint8_t *output);
 
+/*
+ * Number of blocks processed at once by sm4_bs_crypt_blocks(), 8 per 32
+ * bits of a register
+ */
+typedef unsigned long sm4_bs_word;
+#define SM4_BS_BLOCKS	(sizeof(sm4_bs_word) * 2)
+
+#ifdef CFG_CRYPTO_SM4_BITSLICE
+/*
+ * Encrypt or decrypt SM4_BS_BLOCKS blocks with the subkeys @sk in constant
+ * time, @input and @output may overlap
+ */
+void sm4_bs_crypt_blocks(const uint32_t sk[32], const uint8_t *input,
+			 uint8_t *output);
+#else
+static inline void sm4_bs_crypt_blocks(const uint32_t sk[32] __unused,
+				       const uint8_t *input __unused,
+				       uint8_t *output __unused)
+{
+}
+#endif
+
 #endif /* CORE_CRYPTO_SM4_H */
@@ -1,4 +1,6 @@
 srcs-y += crypto.c
+srcs-y += hash-mb.c
+srcs-$(CFG_CRYPTO_AES_KEY_CACHE) += aes-key-cache.c
 
 ifeq (y-y,$(CFG_CRYPTO_AES)-$(CFG_CRYPTO_GCM))
 srcs-y += aes-gcm.c
@@ -37,6 +39,7 @@ ifeq ($(CFG_CORE_CRYPTO_SM4_ACCEL)-$(CFG_ARM64_core),y-y)
 srcs-$(CFG_ARM64_core) += sm4_accel.c
 else
 srcs-y += sm4.c
+srcs-$(CFG_CRYPTO_SM4_BITSLICE) += sm4-bs.c
 endif
 srcs-$(CFG_CRYPTO_ECB) += sm4-ecb.c
 srcs-$(CFG_CRYPTO_CBC) += sm4-cbc.c
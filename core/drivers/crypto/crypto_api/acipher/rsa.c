@@ -75,6 +75,9 @@ void crypto_acipher_free_rsa_keypair(struct rsa_keypair *key)
 	struct drvcrypt_rsa *rsa = NULL;
 
 	if (key) {
+		/* Set if a software fallback made a private operation */
+		crypto_acipher_free_rsa_precomp(key);
+
 		rsa = drvcrypt_get_ops(CRYPTO_RSA);
 		if (rsa) {
 			CRYPTO_TRACE("RSA Keypair free");
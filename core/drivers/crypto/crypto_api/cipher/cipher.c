@@ -9,9 +9,17 @@
 #include <crypto/crypto_impl.h>
 #include <drvcrypt.h>
 #include <drvcrypt_cipher.h>
+#include <drvcrypt_dispatch.h>
 #include <malloc.h>
 #include <util.h>
 
+/*
+ * Updates of at least two chunks are split and submitted asynchronously to
+ * drivers supporting it, with up to CIPHER_ASYNC_MAX_JOBS chunks in flight.
+ */
+#define CIPHER_ASYNC_CHUNK_SIZE	4096
+#define CIPHER_ASYNC_MAX_JOBS	4
+
 static const struct crypto_cipher_ops cipher_ops;
 
 /*
@@ -38,6 +46,7 @@ static void cipher_free_ctx(struct crypto_cipher_ctx *ctx)
 	if (cipher->op && cipher->op->free_ctx)
 		cipher->op->free_ctx(cipher->ctx);
 
+	crypto_cipher_free_ctx(cipher->sw_ctx);
 	free(cipher);
 }
 
@@ -55,6 +64,15 @@ static void cipher_copy_state(struct crypto_cipher_ctx *dst_ctx,
 
 	if (cipher_src->op && cipher_src->op->copy_state)
 		cipher_src->op->copy_state(cipher_dst->ctx, cipher_src->ctx);
+
+	/* Both are allocated with the same threshold */
+	assert(!cipher_src->sw_ctx == !cipher_dst->sw_ctx);
+
+	if (cipher_src->sw_ctx) {
+		crypto_cipher_copy_state(cipher_dst->sw_ctx, cipher_src->sw_ctx);
+		cipher_dst->dispatched = cipher_src->dispatched;
+		cipher_dst->use_sw = cipher_src->use_sw;
+	}
 }
 
 /*
@@ -100,10 +118,87 @@ static TEE_Result cipher_init(struct crypto_cipher_ctx *ctx,
 		ret = cipher->op->init(&dinit);
 	}
 
+	/* Both are ready, the first update selects one for the operation */
+	if (ret == TEE_SUCCESS && cipher->sw_ctx) {
+		ret = crypto_cipher_init(cipher->sw_ctx, mode, key1, key1_len,
+					 key2, key2_len, iv, iv_len);
+		cipher->dispatched = false;
+	}
+
 	CRYPTO_TRACE("cipher ret 0x%" PRIX32, ret);
 	return ret;
 }
 
+/*
+ * Update of the cipher operation with asynchronous jobs, the driver
+ * processes one chunk while the next ones are prepared and submitted.
+ * The last chunk takes the remainder so it's never shorter than
+ * CIPHER_ASYNC_CHUNK_SIZE, the cipher modes ending with stealing need it.
+ *
+ * @cipher     Cipher context
+ * @last_block True if last block to handle
+ * @data       Data to encrypt/decrypt
+ * @len        Length of the input data and output result
+ * @dst        [out] Output data of the operation
+ */
+static TEE_Result cipher_update_async(struct crypto_cipher *cipher,
+				      bool last_block, const uint8_t *data,
+				      size_t len, uint8_t *dst)
+{
+	struct drvcrypt_async_job jobs[CIPHER_ASYNC_MAX_JOBS] = { };
+	struct drvcrypt_cipher_update dupdate = { };
+	struct drvcrypt_async_job *job = NULL;
+	TEE_Result ret = TEE_SUCCESS;
+	TEE_Result res = TEE_SUCCESS;
+	size_t submitted = 0;
+	size_t completed = 0;
+	size_t chunk = 0;
+	size_t offs = 0;
+
+	while (offs < len) {
+		if (submitted - completed == CIPHER_ASYNC_MAX_JOBS) {
+			ret = drvcrypt_async_wait(jobs + completed %
+						  CIPHER_ASYNC_MAX_JOBS);
+			completed++;
+			if (ret != TEE_SUCCESS)
+				break;
+		}
+
+		chunk = CIPHER_ASYNC_CHUNK_SIZE;
+		if (len - offs < 2 * CIPHER_ASYNC_CHUNK_SIZE)
+			chunk = len - offs;
+
+		dupdate = (struct drvcrypt_cipher_update){
+			.ctx = cipher->ctx,
+			.last = last_block && offs + chunk == len,
+			.src.data = (uint8_t *)data + offs,
+			.src.length = chunk,
+			.dst.data = dst + offs,
+			.dst.length = chunk,
+		};
+
+		job = jobs + submitted % CIPHER_ASYNC_MAX_JOBS;
+		drvcrypt_async_init(job, NULL, NULL);
+		ret = cipher->op->update_async(&dupdate, job);
+		if (ret != TEE_SUCCESS)
+			break;
+
+		submitted++;
+		offs += chunk;
+	}
+
+	/* The driver uses the buffers until all the submitted jobs are done */
+	while (completed < submitted) {
+		res = drvcrypt_async_wait(jobs + completed %
+					  CIPHER_ASYNC_MAX_JOBS);
+		if (ret == TEE_SUCCESS)
+			ret = res;
+		completed++;
+	}
+
+	return ret;
+}
+
 /*
  * Update of the cipher operation
  *
@@ -129,7 +224,19 @@ static TEE_Result cipher_update(struct crypto_cipher_ctx *ctx, bool last_block,
 		return TEE_ERROR_BAD_PARAMETERS;
 	}
 
-	if (cipher->op && cipher->op->update) {
+	if (cipher->sw_ctx && !cipher->dispatched) {
+		cipher->use_sw = len < cipher->threshold;
+		cipher->dispatched = true;
+		drvcrypt_dispatch_account(cipher->algo, cipher->use_sw);
+	}
+
+	if (cipher->sw_ctx && cipher->use_sw) {
+		ret = cipher->sw_ctx->ops->update(cipher->sw_ctx, last_block,
+						  data, len, dst);
+	} else if (cipher->op && cipher->op->update_async &&
+		   len >= 2 * CIPHER_ASYNC_CHUNK_SIZE) {
+		ret = cipher_update_async(cipher, last_block, data, len, dst);
+	} else if (cipher->op && cipher->op->update) {
 		struct drvcrypt_cipher_update dupdate = {
 			.ctx = cipher->ctx,
 			.last = last_block,
@@ -157,6 +264,9 @@ static void cipher_final(struct crypto_cipher_ctx *ctx)
 
 	if (cipher->op && cipher->op->final)
 		cipher->op->final(cipher->ctx);
+
+	if (cipher->sw_ctx)
+		crypto_cipher_final(cipher->sw_ctx);
 }
 
 static const struct crypto_cipher_ops cipher_ops = {
@@ -187,11 +297,29 @@ TEE_Result drvcrypt_cipher_alloc_ctx(struct crypto_cipher_ctx **ctx,
 
 	if (ret != TEE_SUCCESS) {
 		free(cipher);
-	} else {
-		cipher->cipher_ctx.ops = &cipher_ops;
-		*ctx = &cipher->cipher_ctx;
+		goto out;
+	}
+
+	/*
+	 * Short messages are handled by the software implementation. All
+	 * contexts of a dispatched algorithm have one, or the state couldn't
+	 * be copied between them.
+	 */
+	cipher->algo = algo;
+	cipher->threshold = drvcrypt_dispatch_threshold(algo);
+	if (cipher->threshold) {
+		ret = crypto_sw_cipher_alloc_ctx(&cipher->sw_ctx, algo);
+		if (ret != TEE_SUCCESS) {
+			if (cipher->op->free_ctx)
+				cipher->op->free_ctx(cipher->ctx);
+			free(cipher);
+			goto out;
+		}
 	}
 
+	cipher->cipher_ctx.ops = &cipher_ops;
+	*ctx = &cipher->cipher_ctx;
+out:
 	CRYPTO_TRACE("Cipher alloc_ctx ret 0x%" PRIX32, ret);
 
 	return ret;
@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Brief   Asynchronous job submission to the crypto drivers.
+ */
+#include <assert.h>
+#include <drvcrypt.h>
+#include <drvcrypt_async.h>
+
+void drvcrypt_async_init(struct drvcrypt_async_job *job,
+			 void (*callback)(struct drvcrypt_async_job *job),
+			 void *cb_data)
+{
+	*job = (struct drvcrypt_async_job){
+		.callback = callback,
+		.cb_data = cb_data,
+		.result = TEE_ERROR_BAD_STATE,
+	};
+}
+
+void drvcrypt_async_complete(struct drvcrypt_async_job *job,
+			     TEE_Result result)
+{
+	assert(!job->completed);
+
+	CRYPTO_TRACE("Job @%p completed ret 0x%" PRIX32, job, result);
+
+	job->result = result;
+	job->completed = true;
+
+	if (job->callback)
+		job->callback(job);
+}
+
+TEE_Result drvcrypt_async_wait(struct drvcrypt_async_job *job)
+{
+	if (!job->completed) {
+		assert(job->wait);
+		job->wait(job);
+	}
+
+	assert(job->completed);
+
+	return job->result;
+}
@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Brief   Dispatch between the crypto driver and the software
+ *         implementation on message size.
+ *
+ * Setting up a crypto engine (descriptors, DMA mapping and cache
+ * maintenance) costs more than the CPU needs to process a short message.
+ * The size from which the driver is faster is measured at boot for each
+ * algorithm supported by both, shorter messages are then handled by the
+ * software implementation.
+ */
+#include <atomic.h>
+#include <crypto/crypto.h>
+#include <crypto/crypto_impl.h>
+#include <drvcrypt.h>
+#include <drvcrypt_dispatch.h>
+#include <initcall.h>
+#include <kernel/delay.h>
+#include <stdlib.h>
+#include <string.h>
+#include <trace.h>
+#include <utee_defines.h>
+#include <util.h>
+
+/* Repetitions of each measurement */
+#define CALIB_ROUNDS	8
+
+/*
+ * Dispatch state of an algorithm
+ *
+ * @algo        TEE_ALG_* identifier
+ * @calibrated  Both the driver and the software implementation support it
+ * @threshold   Size from which the driver handles the messages
+ * @sw_count    Operations handled by the software implementation
+ * @drv_count   Operations handled by the driver
+ */
+struct dispatch_algo {
+	uint32_t algo;
+	bool calibrated;
+	size_t threshold;
+	uint32_t sw_count;
+	uint32_t drv_count;
+};
+
+static struct dispatch_algo dispatch_algos[] = {
+#ifdef CFG_CRYPTO_DRV_CIPHER
+	{ .algo = TEE_ALG_AES_ECB_NOPAD },
+	{ .algo = TEE_ALG_AES_CBC_NOPAD },
+	{ .algo = TEE_ALG_AES_CTR },
+#endif
+#ifdef CFG_CRYPTO_DRV_HASH
+	{ .algo = TEE_ALG_SHA1 },
+	{ .algo = TEE_ALG_SHA224 },
+	{ .algo = TEE_ALG_SHA256 },
+	{ .algo = TEE_ALG_SHA384 },
+	{ .algo = TEE_ALG_SHA512 },
+#endif
+};
+
+/* Message sizes measured, the threshold is one of them */
+static const size_t calib_sizes[] = {
+	16, 64, 256, 1024, DRVCRYPT_DISPATCH_MAX_THRESHOLD
+};
+
+static struct dispatch_algo *find_algo(uint32_t algo)
+{
+	size_t n = 0;
+
+	for (n = 0; n < ARRAY_SIZE(dispatch_algos); n++)
+		if (dispatch_algos[n].algo == algo)
+			return dispatch_algos + n;
+
+	return NULL;
+}
+
+size_t drvcrypt_dispatch_threshold(uint32_t algo)
+{
+	struct dispatch_algo *d = find_algo(algo);
+
+	if (!d)
+		return 0;
+
+	return d->threshold;
+}
+
+void drvcrypt_dispatch_account(uint32_t algo, bool sw)
+{
+	struct dispatch_algo *d = find_algo(algo);
+
+	if (!d)
+		return;
+
+	if (sw)
+		atomic_inc32(&d->sw_count);
+	else
+		atomic_inc32(&d->drv_count);
+}
+
+size_t drvcrypt_dispatch_get_stats(struct drvcrypt_dispatch_stat *stats,
+				   size_t count)
+{
+	size_t num = 0;
+	size_t n = 0;
+
+	for (n = 0; n < ARRAY_SIZE(dispatch_algos); n++) {
+		struct dispatch_algo *d = dispatch_algos + n;
+
+		if (!d->calibrated)
+			continue;
+
+		if (num < count)
+			stats[num] = (struct drvcrypt_dispatch_stat){
+				.algo = d->algo,
+				.threshold = d->threshold,
+				.sw_count = atomic_load_u32(&d->sw_count),
+				.drv_count = atomic_load_u32(&d->drv_count),
+			};
+		num++;
+	}
+
+	return num;
+}
+
+static bool is_hash(uint32_t algo)
+{
+	return TEE_ALG_GET_CLASS(algo) == TEE_OPERATION_DIGEST;
+}
+
+/*
+ * Measure CALIB_ROUNDS one-shot operations of @algo on @len bytes with the
+ * context @ctx, either a hash or a cipher context
+ */
+static TEE_Result measure(uint32_t algo, void *ctx, const uint8_t *src,
+			  uint8_t *dst, size_t len, uint64_t *ticks)
+{
+	static const uint8_t key[TEE_AES_BLOCK_SIZE];
+	static const uint8_t iv[TEE_AES_BLOCK_SIZE];
+	size_t iv_len = sizeof(iv);
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t start = 0;
+	unsigned int n = 0;
+
+	if (algo == TEE_ALG_AES_ECB_NOPAD)
+		iv_len = 0;
+
+	start = delay_cnt_read();
+	for (n = 0; n < CALIB_ROUNDS; n++) {
+		if (is_hash(algo)) {
+			res = crypto_hash_init(ctx);
+			if (!res)
+				res = crypto_hash_update(ctx, src, len);
+			if (!res)
+				res = crypto_hash_final(ctx, dst,
+						TEE_ALG_GET_DIGEST_SIZE(algo));
+		} else {
+			res = crypto_cipher_init(ctx, TEE_MODE_ENCRYPT, key,
+						 sizeof(key), NULL, 0, iv,
+						 iv_len);
+			if (!res)
+				res = crypto_cipher_update(ctx,
+							   TEE_MODE_ENCRYPT,
+							   true, src, len,
+							   dst);
+			crypto_cipher_final(ctx);
+		}
+		if (res)
+			return res;
+	}
+	*ticks = delay_cnt_read() - start;
+
+	return TEE_SUCCESS;
+}
+
+static void free_ctx(uint32_t algo, void *ctx)
+{
+	if (is_hash(algo))
+		crypto_hash_free_ctx(ctx);
+	else
+		crypto_cipher_free_ctx(ctx);
+}
+
+/*
+ * Find the smallest measured size for which the driver is at least as fast
+ * as the software implementation. The thresholds are all 0 until the
+ * calibration is done so the drvcrypt contexts are the driver ones.
+ */
+static void calibrate(struct dispatch_algo *d, const uint8_t *src,
+		      uint8_t *dst)
+{
+	struct crypto_cipher_ctx *cipher_ctx = NULL;
+	struct crypto_hash_ctx *hash_ctx = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t drv_ticks = 0;
+	uint64_t sw_ticks = 0;
+	void *drv_ctx = NULL;
+	void *sw_ctx = NULL;
+	size_t n = 0;
+
+	if (is_hash(d->algo)) {
+		if (drvcrypt_hash_alloc_ctx(&hash_ctx, d->algo))
+			return;
+		drv_ctx = hash_ctx;
+		hash_ctx = NULL;
+		res = crypto_sw_hash_alloc_ctx(&hash_ctx, d->algo);
+		sw_ctx = hash_ctx;
+	} else {
+		if (drvcrypt_cipher_alloc_ctx(&cipher_ctx, d->algo))
+			return;
+		drv_ctx = cipher_ctx;
+		cipher_ctx = NULL;
+		res = crypto_sw_cipher_alloc_ctx(&cipher_ctx, d->algo);
+		sw_ctx = cipher_ctx;
+	}
+	if (res)
+		goto out;
+
+	for (n = 0; n < ARRAY_SIZE(calib_sizes); n++) {
+		res = measure(d->algo, sw_ctx, src, dst, calib_sizes[n],
+			      &sw_ticks);
+		if (!res)
+			res = measure(d->algo, drv_ctx, src, dst,
+				      calib_sizes[n], &drv_ticks);
+		if (res)
+			goto out;
+
+		if (drv_ticks <= sw_ticks)
+			break;
+	}
+
+	if (n == ARRAY_SIZE(calib_sizes))
+		d->threshold = DRVCRYPT_DISPATCH_MAX_THRESHOLD;
+	else if (n)
+		d->threshold = calib_sizes[n];
+	d->calibrated = true;
+
+	DMSG("drvcrypt: algo %#"PRIx32" handled by the driver from %zu bytes",
+	     d->algo, d->threshold);
+out:
+	free_ctx(d->algo, drv_ctx);
+	if (sw_ctx)
+		free_ctx(d->algo, sw_ctx);
+}
+
+static TEE_Result drvcrypt_dispatch_calibrate(void)
+{
+	size_t len = DRVCRYPT_DISPATCH_MAX_THRESHOLD;
+	uint8_t *src = NULL;
+	uint8_t *dst = NULL;
+	size_t n = 0;
+
+	src = calloc(1, len);
+	dst = calloc(1, len);
+	if (!src || !dst)
+		goto out;
+
+	for (n = 0; n < ARRAY_SIZE(dispatch_algos); n++)
+		calibrate(dispatch_algos + n, src, dst);
+out:
+	free(src);
+	free(dst);
+
+	/* Without calibration all the operations go to the driver */
+	return TEE_SUCCESS;
+}
+driver_init_late(drvcrypt_dispatch_calibrate);
@@ -6,13 +6,186 @@
  */
 #include <assert.h>
 #include <drvcrypt.h>
+#include <drvcrypt_dispatch.h>
 #include <drvcrypt_hash.h>
+#include <malloc.h>
+#include <string.h>
+#include <string_ext.h>
 #include <util.h>
 
+/*
+ * Hash context dispatching on message size. The message is buffered until
+ * it reaches the threshold, shorter messages are hashed by the software
+ * implementation at final, longer ones are handed over to the driver.
+ */
+struct hash_dispatch {
+	struct crypto_hash_ctx hash_ctx;  /* Crypto hash API context */
+	struct crypto_hash_ctx *drv_ctx;  /* Driver context */
+	struct crypto_hash_ctx *sw_ctx;   /* Software context */
+	uint32_t algo;                    /* Hash algorithm */
+	bool use_drv;                     /* Message handed over to driver */
+	size_t threshold;                 /* Size of @buf */
+	size_t buf_len;                   /* Bytes of the message in @buf */
+	uint8_t buf[];                    /* Start of the message */
+};
+
+static const struct crypto_hash_ops hash_dispatch_ops;
+
+/*
+ * Returns the reference to the dispatch context
+ *
+ * @ctx    Reference the API context pointer
+ */
+static struct hash_dispatch *to_hash_dispatch(struct crypto_hash_ctx *ctx)
+{
+	assert(ctx && ctx->ops == &hash_dispatch_ops);
+
+	return container_of(ctx, struct hash_dispatch, hash_ctx);
+}
+
+static TEE_Result hash_dispatch_init(struct crypto_hash_ctx *ctx)
+{
+	struct hash_dispatch *hd = to_hash_dispatch(ctx);
+
+	/* The driver is only initialized if the message gets long enough */
+	hd->use_drv = false;
+	hd->buf_len = 0;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result hash_dispatch_update(struct crypto_hash_ctx *ctx,
+				       const uint8_t *data, size_t len)
+{
+	struct hash_dispatch *hd = to_hash_dispatch(ctx);
+	TEE_Result ret = TEE_SUCCESS;
+
+	if (!hd->use_drv) {
+		if (len < hd->threshold - hd->buf_len) {
+			memcpy(hd->buf + hd->buf_len, data, len);
+			hd->buf_len += len;
+			return TEE_SUCCESS;
+		}
+
+		drvcrypt_dispatch_account(hd->algo, false);
+		hd->use_drv = true;
+
+		ret = hd->drv_ctx->ops->init(hd->drv_ctx);
+		if (!ret && hd->buf_len)
+			ret = hd->drv_ctx->ops->update(hd->drv_ctx, hd->buf,
+						       hd->buf_len);
+		memzero_explicit(hd->buf, hd->buf_len);
+		hd->buf_len = 0;
+		if (ret)
+			return ret;
+	}
+
+	return hd->drv_ctx->ops->update(hd->drv_ctx, data, len);
+}
+
+static TEE_Result hash_dispatch_final(struct crypto_hash_ctx *ctx,
+				      uint8_t *digest, size_t len)
+{
+	struct hash_dispatch *hd = to_hash_dispatch(ctx);
+	TEE_Result ret = TEE_SUCCESS;
+
+	if (hd->use_drv)
+		return hd->drv_ctx->ops->final(hd->drv_ctx, digest, len);
+
+	drvcrypt_dispatch_account(hd->algo, true);
+
+	ret = hd->sw_ctx->ops->init(hd->sw_ctx);
+	if (!ret)
+		ret = hd->sw_ctx->ops->update(hd->sw_ctx, hd->buf, hd->buf_len);
+	if (!ret)
+		ret = hd->sw_ctx->ops->final(hd->sw_ctx, digest, len);
+
+	memzero_explicit(hd->buf, hd->buf_len);
+	hd->buf_len = 0;
+
+	return ret;
+}
+
+static void hash_dispatch_free_ctx(struct crypto_hash_ctx *ctx)
+{
+	struct hash_dispatch *hd = to_hash_dispatch(ctx);
+
+	hd->drv_ctx->ops->free_ctx(hd->drv_ctx);
+	hd->sw_ctx->ops->free_ctx(hd->sw_ctx);
+	memzero_explicit(hd->buf, hd->buf_len);
+	free(hd);
+}
+
+static void hash_dispatch_copy_state(struct crypto_hash_ctx *dst_ctx,
+				     struct crypto_hash_ctx *src_ctx)
+{
+	struct hash_dispatch *dst = to_hash_dispatch(dst_ctx);
+	struct hash_dispatch *src = to_hash_dispatch(src_ctx);
+
+	assert(dst->threshold == src->threshold);
+
+	if (src->use_drv)
+		dst->drv_ctx->ops->copy_state(dst->drv_ctx, src->drv_ctx);
+	memcpy(dst->buf, src->buf, src->buf_len);
+	dst->buf_len = src->buf_len;
+	dst->use_drv = src->use_drv;
+}
+
+static const struct crypto_hash_ops hash_dispatch_ops = {
+	.init = hash_dispatch_init,
+	.update = hash_dispatch_update,
+	.final = hash_dispatch_final,
+	.free_ctx = hash_dispatch_free_ctx,
+	.copy_state = hash_dispatch_copy_state,
+};
+
+/*
+ * Wrap the driver context @drv_ctx in a context dispatching on message
+ * size if a threshold is calibrated for @algo. All contexts of a
+ * dispatched algorithm are wrapped, or the state couldn't be copied
+ * between them.
+ *
+ * @ctx      [out] Wrapping context, @drv_ctx if @algo isn't dispatched
+ * @drv_ctx  Driver context
+ * @algo     Hash algorithm
+ */
+static TEE_Result hash_dispatch_alloc_ctx(struct crypto_hash_ctx **ctx,
+					  struct crypto_hash_ctx *drv_ctx,
+					  uint32_t algo)
+{
+	size_t threshold = drvcrypt_dispatch_threshold(algo);
+	struct hash_dispatch *hd = NULL;
+	TEE_Result ret = TEE_SUCCESS;
+
+	if (!threshold) {
+		*ctx = drv_ctx;
+		return TEE_SUCCESS;
+	}
+
+	hd = calloc(1, sizeof(*hd) + threshold);
+	if (!hd)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	ret = crypto_sw_hash_alloc_ctx(&hd->sw_ctx, algo);
+	if (ret != TEE_SUCCESS) {
+		free(hd);
+		return ret;
+	}
+
+	hd->hash_ctx.ops = &hash_dispatch_ops;
+	hd->drv_ctx = drv_ctx;
+	hd->algo = algo;
+	hd->threshold = threshold;
+	*ctx = &hd->hash_ctx;
+
+	return TEE_SUCCESS;
+}
+
 TEE_Result drvcrypt_hash_alloc_ctx(struct crypto_hash_ctx **ctx, uint32_t algo)
 {
 	TEE_Result ret = TEE_ERROR_NOT_IMPLEMENTED;
 	hw_hash_allocate hash_alloc = NULL;
+	struct crypto_hash_ctx *drv_ctx = NULL;
 
 	CRYPTO_TRACE("hash alloc_ctx algo 0x%" PRIX32, algo);
 
@@ -21,7 +194,13 @@ TEE_Result drvcrypt_hash_alloc_ctx(struct crypto_hash_ctx **ctx, uint32_t algo)
 	hash_alloc = drvcrypt_get_ops(CRYPTO_HASH);
 
 	if (hash_alloc)
-		ret = hash_alloc(ctx, algo);
+		ret = hash_alloc(&drv_ctx, algo);
+
+	if (ret == TEE_SUCCESS) {
+		ret = hash_dispatch_alloc_ctx(ctx, drv_ctx, algo);
+		if (ret != TEE_SUCCESS)
+			drv_ctx->ops->free_ctx(drv_ctx);
+	}
 
 	CRYPTO_TRACE("hash alloc_ctx ret 0x%" PRIX32, ret);
 
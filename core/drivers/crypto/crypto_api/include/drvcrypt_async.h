@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Brief   Asynchronous job submission to the crypto drivers.
+ */
+#ifndef __DRVCRYPT_ASYNC_H__
+#define __DRVCRYPT_ASYNC_H__
+
+#include <stdbool.h>
+#include <tee_api_types.h>
+
+/*
+ * Asynchronous job
+ *
+ * The caller initializes the job with drvcrypt_async_init() and gives it
+ * to a driver submission function. On success the driver owns the job
+ * and the buffers it refers to until the job is completed. The driver
+ * completes the job with drvcrypt_async_complete(), the caller gets the
+ * job result with drvcrypt_async_wait().
+ *
+ * Jobs submitted on the same driver context are processed in submission
+ * order.
+ */
+struct drvcrypt_async_job {
+	/*
+	 * Completion callback, may be NULL. Called in the context completing
+	 * the job, it must not submit jobs.
+	 */
+	void (*callback)(struct drvcrypt_async_job *job);
+	void *cb_data;		/* Caller data for the callback */
+	/* Set by the driver on submission, returns once the job completed */
+	void (*wait)(struct drvcrypt_async_job *job);
+	void *drv_data;		/* Driver data */
+	TEE_Result result;	/* Result of the completed job */
+	bool completed;		/* Job completion flag */
+};
+
+/*
+ * Initialize a job before its submission
+ *
+ * @job       Job to initialize
+ * @callback  Completion callback or NULL
+ * @cb_data   Caller data for @callback
+ */
+void drvcrypt_async_init(struct drvcrypt_async_job *job,
+			 void (*callback)(struct drvcrypt_async_job *job),
+			 void *cb_data);
+
+/*
+ * Called by the driver when a submitted job is completed
+ *
+ * @job     Completed job
+ * @result  Result of the job
+ */
+void drvcrypt_async_complete(struct drvcrypt_async_job *job,
+			     TEE_Result result);
+
+/*
+ * Wait for the completion of a submitted job and return its result
+ *
+ * @job  Submitted job
+ */
+TEE_Result drvcrypt_async_wait(struct drvcrypt_async_job *job);
+
+#endif /* __DRVCRYPT_ASYNC_H__ */
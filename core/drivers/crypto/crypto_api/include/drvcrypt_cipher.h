@@ -8,6 +8,7 @@
 #define __DRVCRYPT_CIPHER_H__
 
 #include <crypto/crypto_impl.h>
+#include <drvcrypt_async.h>
 #include <tee_api_types.h>
 
 /*
@@ -17,6 +18,12 @@ struct crypto_cipher {
 	struct crypto_cipher_ctx cipher_ctx; /* Crypto cipher API context */
 	void *ctx;                           /* Cipher context */
 	struct drvcrypt_cipher *op;          /* Reference to the operation */
+	uint32_t algo;                       /* Cipher algorithm */
+	/* Software context used for messages shorter than @threshold */
+	struct crypto_cipher_ctx *sw_ctx;
+	size_t threshold;                    /* See drvcrypt_dispatch.h */
+	bool dispatched;                     /* @use_sw set for the operation */
+	bool use_sw;                         /* Operation handled by @sw_ctx */
 };
 
 /*
@@ -53,6 +60,12 @@ struct drvcrypt_cipher {
 	TEE_Result (*init)(struct drvcrypt_cipher_init *dinit);
 	/* Update the cipher operation */
 	TEE_Result (*update)(struct drvcrypt_cipher_update *dupdate);
+	/*
+	 * Submit an update of the cipher operation, optional. @dupdate is
+	 * only used during the call, its buffers until @job is completed.
+	 */
+	TEE_Result (*update_async)(struct drvcrypt_cipher_update *dupdate,
+				   struct drvcrypt_async_job *job);
 	/* Finalize the cipher operation */
 	void (*final)(void *ctx);
 	/* Copy cipher context */
@@ -0,0 +1,45 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/*
+ * Brief   Dispatch between the crypto driver and the software
+ *         implementation on message size.
+ */
+#ifndef __DRVCRYPT_DISPATCH_H__
+#define __DRVCRYPT_DISPATCH_H__
+
+#include <compiler.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest threshold, the messages of this size always go to the driver */
+#define DRVCRYPT_DISPATCH_MAX_THRESHOLD	4096
+
+#ifdef CFG_CRYPTO_DRV_DISPATCH
+/*
+ * Return the message size under which operations of @algo are handled by
+ * the software implementation, 0 if they're always handled by the driver.
+ *
+ * @algo  TEE_ALG_* identifier
+ */
+size_t drvcrypt_dispatch_threshold(uint32_t algo);
+
+/*
+ * Account for an operation of @algo
+ *
+ * @algo  TEE_ALG_* identifier
+ * @sw    True if handled by the software implementation
+ */
+void drvcrypt_dispatch_account(uint32_t algo, bool sw);
+#else
+static inline size_t drvcrypt_dispatch_threshold(uint32_t algo __unused)
+{
+	return 0;
+}
+
+static inline void drvcrypt_dispatch_account(uint32_t algo __unused,
+					     bool sw __unused)
+{
+}
+#endif /* CFG_CRYPTO_DRV_DISPATCH */
+
+#endif /* __DRVCRYPT_DISPATCH_H__ */
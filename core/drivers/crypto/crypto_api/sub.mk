@@ -1,4 +1,6 @@
 srcs-y += drvcrypt.c
+srcs-y += drvcrypt_async.c
+srcs-$(CFG_CRYPTO_DRV_DISPATCH) += drvcrypt_dispatch.c
 
 subdirs-y += math
 
@@ -13,3 +13,5 @@ subdirs-$(CFG_ASPEED_CRYPTO_DRIVER) += aspeed
 subdirs-$(CFG_VERSAL_CRYPTO_DRIVER) += versal
 
 subdirs-$(CFG_HISILICON_CRYPTO_DRIVER) += hisilicon
+
+subdirs-$(CFG_CRYPTO_SW_ENGINE) += sw_engine
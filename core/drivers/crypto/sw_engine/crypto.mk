@@ -0,0 +1,17 @@
+# CFG_CRYPTO_SW_ENGINE, when enabled, registers a cipher driver running
+# the software implementation behind the asynchronous drvcrypt job API.
+# It's a reference for drivers of crypto engines and a way to exercise the
+# asynchronous path on platforms without one, such as QEMU.
+# CFG_CRYPTO_SW_ENGINE_JOBS is the number of jobs that can be in flight.
+CFG_CRYPTO_SW_ENGINE ?= n
+
+ifeq ($(CFG_CRYPTO_SW_ENGINE),y)
+
+$(call force,CFG_CRYPTO_DRIVER,y)
+CFG_CRYPTO_DRIVER_DEBUG ?= 0
+
+$(call force,CFG_CRYPTO_DRV_CIPHER,y,Mandated by CFG_CRYPTO_SW_ENGINE)
+
+CFG_CRYPTO_SW_ENGINE_JOBS ?= 4
+
+endif # CFG_CRYPTO_SW_ENGINE
@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Software crypto engine, reference backend of the asynchronous drvcrypt
+ * job API. Jobs are queued in a ring of CFG_CRYPTO_SW_ENGINE_JOBS entries
+ * and processed in order by the software implementation when the ring is
+ * full or when a job is waited for, like a hardware job ring would.
+ *
+ * Each context has its own ring: the buffers of a job may be user memory
+ * of the TA that submitted it, so a thread must only run the jobs it
+ * submitted itself. A context is only used by one thread at a time.
+ */
+#include <assert.h>
+#include <crypto/crypto.h>
+#include <crypto/crypto_impl.h>
+#include <drvcrypt.h>
+#include <drvcrypt_async.h>
+#include <drvcrypt_cipher.h>
+#include <initcall.h>
+#include <stdlib.h>
+#include <tee_api_types.h>
+#include <trace.h>
+#include <util.h>
+
+/*
+ * Queued cipher update
+ *
+ * @last    Last block to handle
+ * @src     Source buffer
+ * @dst     Destination buffer
+ * @job     Job completed once the update is done
+ */
+struct sw_engine_job {
+	bool last;
+	struct drvcrypt_buf src;
+	struct drvcrypt_buf dst;
+	struct drvcrypt_async_job *job;
+};
+
+/*
+ * Cipher context
+ *
+ * @ctx         Software implementation context
+ * @mode        Encrypt or decrypt
+ * @ring        Jobs submitted on the context
+ * @ring_head   Index of the oldest job in @ring
+ * @ring_count  Number of jobs in @ring
+ */
+struct sw_engine_cipher {
+	struct crypto_cipher_ctx *ctx;
+	TEE_OperationMode mode;
+	struct sw_engine_job ring[CFG_CRYPTO_SW_ENGINE_JOBS];
+	size_t ring_head;
+	size_t ring_count;
+};
+
+static TEE_Result do_update(struct sw_engine_cipher *cipher, bool last,
+			    const struct drvcrypt_buf *src,
+			    struct drvcrypt_buf *dst)
+{
+	if (dst->length < src->length)
+		return TEE_ERROR_SHORT_BUFFER;
+
+	return crypto_cipher_update(cipher->ctx, cipher->mode, last, src->data,
+				    src->length, dst->data);
+}
+
+/* Process the oldest job of the ring of @cipher */
+static void run_oldest_job(struct sw_engine_cipher *cipher)
+{
+	struct sw_engine_job *j = cipher->ring + cipher->ring_head;
+	TEE_Result res = TEE_SUCCESS;
+
+	assert(cipher->ring_count);
+
+	res = do_update(cipher, j->last, &j->src, &j->dst);
+
+	cipher->ring_head = (cipher->ring_head + 1) % ARRAY_SIZE(cipher->ring);
+	cipher->ring_count--;
+	drvcrypt_async_complete(j->job, res);
+}
+
+static void sw_engine_wait(struct drvcrypt_async_job *job)
+{
+	struct sw_engine_cipher *cipher = job->drv_data;
+
+	while (!job->completed)
+		run_oldest_job(cipher);
+}
+
+static TEE_Result sw_engine_alloc_ctx(void **ctx, uint32_t algo)
+{
+	struct sw_engine_cipher *cipher = NULL;
+	TEE_Result res = TEE_ERROR_NOT_IMPLEMENTED;
+
+	cipher = calloc(1, sizeof(*cipher));
+	if (!cipher)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	switch (algo) {
+	case TEE_ALG_AES_ECB_NOPAD:
+		res = crypto_aes_ecb_alloc_ctx(&cipher->ctx);
+		break;
+	case TEE_ALG_AES_CBC_NOPAD:
+		res = crypto_aes_cbc_alloc_ctx(&cipher->ctx);
+		break;
+	case TEE_ALG_AES_CTR:
+		res = crypto_aes_ctr_alloc_ctx(&cipher->ctx);
+		break;
+	case TEE_ALG_AES_XTS:
+		res = crypto_aes_xts_alloc_ctx(&cipher->ctx);
+		break;
+	default:
+		break;
+	}
+
+	if (res) {
+		free(cipher);
+		return res;
+	}
+
+	*ctx = cipher;
+	return TEE_SUCCESS;
+}
+
+static void sw_engine_free_ctx(void *ctx)
+{
+	struct sw_engine_cipher *cipher = ctx;
+
+	if (cipher) {
+		assert(!cipher->ring_count);
+		crypto_cipher_free_ctx(cipher->ctx);
+		free(cipher);
+	}
+}
+
+static TEE_Result sw_engine_init(struct drvcrypt_cipher_init *dinit)
+{
+	struct sw_engine_cipher *cipher = dinit->ctx;
+
+	cipher->mode = dinit->encrypt ? TEE_MODE_ENCRYPT : TEE_MODE_DECRYPT;
+
+	return crypto_cipher_init(cipher->ctx, cipher->mode, dinit->key1.data,
+				  dinit->key1.length, dinit->key2.data,
+				  dinit->key2.length, dinit->iv.data,
+				  dinit->iv.length);
+}
+
+static TEE_Result sw_engine_update(struct drvcrypt_cipher_update *dupdate)
+{
+	return do_update(dupdate->ctx, dupdate->last, &dupdate->src,
+			 &dupdate->dst);
+}
+
+static TEE_Result sw_engine_update_async(struct drvcrypt_cipher_update *dupdate,
+					 struct drvcrypt_async_job *job)
+{
+	struct sw_engine_cipher *cipher = dupdate->ctx;
+	size_t idx = 0;
+
+	/* A full ring makes room by completing its oldest job */
+	if (cipher->ring_count == ARRAY_SIZE(cipher->ring))
+		run_oldest_job(cipher);
+
+	idx = (cipher->ring_head + cipher->ring_count) %
+	      ARRAY_SIZE(cipher->ring);
+	cipher->ring[idx] = (struct sw_engine_job){
+		.last = dupdate->last,
+		.src = dupdate->src,
+		.dst = dupdate->dst,
+		.job = job,
+	};
+	job->wait = sw_engine_wait;
+	job->drv_data = cipher;
+	cipher->ring_count++;
+
+	return TEE_SUCCESS;
+}
+
+static void sw_engine_final(void *ctx)
+{
+	struct sw_engine_cipher *cipher = ctx;
+
+	crypto_cipher_final(cipher->ctx);
+}
+
+static void sw_engine_copy_state(void *dst_ctx, void *src_ctx)
+{
+	struct sw_engine_cipher *dst = dst_ctx;
+	struct sw_engine_cipher *src = src_ctx;
+
+	dst->mode = src->mode;
+	crypto_cipher_copy_state(dst->ctx, src->ctx);
+}
+
+static struct drvcrypt_cipher driver_cipher = {
+	.alloc_ctx = sw_engine_alloc_ctx,
+	.free_ctx = sw_engine_free_ctx,
+	.init = sw_engine_init,
+	.update = sw_engine_update,
+	.update_async = sw_engine_update_async,
+	.final = sw_engine_final,
+	.copy_state = sw_engine_copy_state,
+};
+
+static TEE_Result sw_engine_cipher_init(void)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	res = drvcrypt_register_cipher(&driver_cipher);
+	if (res)
+		EMSG("Software engine cipher register failed ret=%#"PRIx32,
+		     res);
+
+	return res;
+}
+driver_init(sw_engine_cipher_init);
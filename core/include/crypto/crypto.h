@@ -35,6 +35,32 @@ TEE_Result crypto_hash_final(void *ctx, uint8_t *digest, size_t len);
 void crypto_hash_free_ctx(void *ctx);
 void crypto_hash_copy_state(void *dst_ctx, void *src_ctx);
 
+/*
+ * struct crypto_hash_mb_msg - one message of a multi-buffer hash
+ * @data:	message
+ * @len:	size of @data in bytes
+ * @digest:	receives the digest, the digest size of the algorithm
+ */
+struct crypto_hash_mb_msg {
+	const void *data;
+	size_t len;
+	uint8_t *digest;
+};
+
+/*
+ * crypto_hash_mb() - Hash several independent messages
+ * @algo:	hash algorithm, TEE_ALG_SHA256 or TEE_ALG_SHA512
+ * @msgs:	messages to hash
+ * @count:	number of messages in @msgs
+ *
+ * When supported by the CPU the messages are hashed two at a time with
+ * their rounds interleaved, this is most efficient with messages of equal
+ * lengths. TEE_ALG_SHA256 has the same constraints as hash_sha256_check()
+ * and doesn't require crypto_init() to be called in advance.
+ */
+TEE_Result crypto_hash_mb(uint32_t algo, const struct crypto_hash_mb_msg *msgs,
+			  size_t count);
+
 /* Symmetric ciphers */
 TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo);
 TEE_Result crypto_cipher_init(void *ctx, TEE_OperationMode mode,
@@ -117,6 +143,31 @@ struct rsa_keypair {
 	struct bignum *qp;	/* 1/q mod p */
 	struct bignum *dp;	/* d mod (p-1) */
 	struct bignum *dq;	/* d mod (q-1) */
+
+	/*
+	 * Values derived from the key by the first private operation, see
+	 * struct rsa_precomp. NULL until then and freed by
+	 * crypto_acipher_free_rsa_precomp() when the key is changed.
+	 */
+	struct rsa_precomp *precomp;
+};
+
+/*
+ * struct rsa_precomp - Montgomery parameters of an RSA private key
+ * @rr_n:	R^2 mod n
+ * @rr_p:	R^2 mod p, NULL if not used by the implementation
+ * @rr_q:	R^2 mod q, NULL if not used by the implementation
+ *
+ * Computing R^2 mod m takes a long division of the size of the key, with
+ * CRT that's three of them for each private operation. The values don't
+ * depend on the exponents or the data so they're computed once and kept
+ * with the key. Once attached to a key the values are only read, which
+ * allows the key to be used by several threads at once.
+ */
+struct rsa_precomp {
+	struct bignum *rr_n;
+	struct bignum *rr_p;
+	struct bignum *rr_q;
 };
 
 struct rsa_public_key {
@@ -195,6 +246,22 @@ TEE_Result crypto_acipher_alloc_rsa_public_key(struct rsa_public_key *s,
 				   size_t key_size_bits);
 void crypto_acipher_free_rsa_public_key(struct rsa_public_key *s);
 void crypto_acipher_free_rsa_keypair(struct rsa_keypair *s);
+
+/*
+ * crypto_acipher_publish_rsa_precomp() - Attach precomputed values to a key
+ * @key:	RSA key the values were computed from
+ * @pc:		values to attach, all bignums allocated with
+ *		crypto_bignum_allocate()
+ *
+ * Returns the values now attached to @key, that is @pc unless another
+ * operation attached its values first in which case @pc is freed.
+ */
+struct rsa_precomp *
+crypto_acipher_publish_rsa_precomp(struct rsa_keypair *key,
+				   struct rsa_precomp *pc);
+
+/* Free the precomputed values of @key, needed when the key is changed */
+void crypto_acipher_free_rsa_precomp(struct rsa_keypair *key);
 TEE_Result crypto_acipher_alloc_dsa_keypair(struct dsa_keypair *s,
 				size_t key_size_bits);
 TEE_Result crypto_acipher_alloc_dsa_public_key(struct dsa_public_key *s,
@@ -341,6 +408,13 @@ TEE_Result crypto_acipher_sm2_kep_derive(struct ecc_keypair *my_key,
 TEE_Result hash_sha256_check(const uint8_t *hash, const uint8_t *data,
 		size_t data_size);
 
+/*
+ * Computes a SHA-256 hash, with the same constraints as
+ * hash_sha256_check().
+ */
+TEE_Result hash_sha256_compute(uint8_t *digest, const uint8_t *data,
+		size_t data_size);
+
 /*
  * Computes a SHA-512/256 hash, vetted conditioner as per NIST.SP.800-90B.
  * It doesn't require crypto_init() to be called in advance and has as few
@@ -424,4 +498,99 @@ TEE_Result crypto_aes_expand_enc_key(const void *key, size_t key_len,
 void crypto_aes_enc_block(const void *enc_key, size_t enc_keylen,
 			  unsigned int rounds, const void *src, void *dst);
 
+/*
+ * AES key schedules cached with a key object
+ *
+ * While a cache is entered by the current thread the AES key expansion
+ * functions look up the key in the cache before expanding it and store
+ * the result there afterwards. Callers enter the cache of a key object
+ * around the initialization of an operation so that reinitializing an
+ * operation with an unchanged key skips the key expansion.
+ *
+ * A cache holds the expanded keys of one implementation only, the one
+ * doing the expansion. It's allocated on first use and must be freed with
+ * crypto_aes_key_cache_free() when the key is changed or freed. The cache
+ * isn't protected by a lock, the owner of the key must serialize its use.
+ */
+struct crypto_aes_key_cache;
+
+#ifdef CFG_CRYPTO_AES_KEY_CACHE
+/*
+ * crypto_aes_key_cache_enter() - Use a cache for the current thread
+ * @cache:	Reference to the cache, *@cache may be NULL
+ * @key:	Key of the owner of the cache, the only one cached
+ * @key_len:	Size of @key in bytes
+ */
+void crypto_aes_key_cache_enter(struct crypto_aes_key_cache **cache,
+				const void *key, size_t key_len);
+
+/* crypto_aes_key_cache_exit() - Stop using the cache of the current thread */
+void crypto_aes_key_cache_exit(void);
+
+/*
+ * crypto_aes_key_cache_get() - Get expanded keys from the entered cache
+ * @key:		AES key buffer
+ * @key_len:		Size of the @key buffer in bytes
+ * @enc_key:		Expanded AES encryption key buffer
+ * @dec_key:		Expanded AES decryption key buffer or NULL
+ * @expanded_key_len:	Size of the @enc_key and @dec_key buffers in bytes
+ * @rounds:		Number of rounds of the expanded keys
+ *
+ * Returns true if the keys were found and copied, false otherwise.
+ */
+bool crypto_aes_key_cache_get(const void *key, size_t key_len, void *enc_key,
+			      void *dec_key, size_t expanded_key_len,
+			      unsigned int *rounds);
+
+/*
+ * crypto_aes_key_cache_put() - Store expanded keys in the entered cache
+ * @key:	AES key buffer
+ * @key_len:	Size of the @key buffer in bytes
+ * @enc_key:	Expanded AES encryption key
+ * @dec_key:	Expanded AES decryption key or NULL
+ * @rounds:	Number of rounds of the expanded keys
+ */
+void crypto_aes_key_cache_put(const void *key, size_t key_len,
+			      const void *enc_key, const void *dec_key,
+			      unsigned int rounds);
+
+/*
+ * crypto_aes_key_cache_free() - Free a cache
+ * @cache:	Reference to the cache, set to NULL on return
+ */
+void crypto_aes_key_cache_free(struct crypto_aes_key_cache **cache);
+#else
+static inline void
+crypto_aes_key_cache_enter(struct crypto_aes_key_cache **cache __unused,
+			   const void *key __unused, size_t key_len __unused)
+{
+}
+
+static inline void crypto_aes_key_cache_exit(void)
+{
+}
+
+static inline bool
+crypto_aes_key_cache_get(const void *key __unused, size_t key_len __unused,
+			 void *enc_key __unused, void *dec_key __unused,
+			 size_t expanded_key_len __unused,
+			 unsigned int *rounds __unused)
+{
+	return false;
+}
+
+static inline void
+crypto_aes_key_cache_put(const void *key __unused, size_t key_len __unused,
+			 const void *enc_key __unused,
+			 const void *dec_key __unused,
+			 unsigned int rounds __unused)
+{
+}
+
+static inline void
+crypto_aes_key_cache_free(struct crypto_aes_key_cache **cache __unused)
+{
+}
+#endif
+
 #endif /* __CRYPTO_CRYPTO_H */
@@ -44,6 +44,10 @@ void crypto_accel_sha1_compress(uint32_t state[5], const void *src,
 				unsigned int block_count);
 void crypto_accel_sha256_compress(uint32_t state[8], const void *src,
 				  unsigned int block_count);
+/* Updates two independent states with @block_count blocks each */
+void crypto_accel_sha256_compress_x2(uint32_t state0[8], const void *src0,
+				     uint32_t state1[8], const void *src1,
+				     unsigned int block_count);
 void crypto_accel_sha512_compress(uint64_t state[8], const void *src,
 				  unsigned int block_count);
 void crypto_accel_sha3_compress(uint64_t state[25], const void *src,
@@ -52,6 +56,14 @@ void crypto_accel_sha3_compress(uint64_t state[25], const void *src,
 void crypto_accel_sm3_compress(uint32_t state[8], const void *src,
 			       unsigned int block_count);
 
+/*
+ * Encrypts or decrypts @block_count blocks of 64 bytes with the ChaCha20
+ * input words @input, the block counter input[12] is updated. @block_count
+ * is a multiple of 4 and the caller makes sure that the counter doesn't wrap.
+ */
+void crypto_accel_chacha20_xor(uint32_t input[16], void *out, const void *in,
+			       unsigned int block_count);
+
 void crypto_accel_sm4_setkey_enc(uint32_t sk[32], const uint8_t key[16]);
 void crypto_accel_sm4_setkey_dec(uint32_t sk[32], const uint8_t key[16]);
 void crypto_accel_sm4_ecb_enc(void *out, const void *in, const void *key,
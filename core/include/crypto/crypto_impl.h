@@ -352,6 +352,8 @@ struct crypto_authenc_ops {
 
 TEE_Result crypto_aes_ccm_alloc_ctx(struct crypto_authenc_ctx **ctx);
 TEE_Result crypto_aes_gcm_alloc_ctx(struct crypto_authenc_ctx **ctx);
+TEE_Result
+crypto_chacha20_poly1305_alloc_ctx(struct crypto_authenc_ctx **ctx);
 
 #ifdef CFG_CRYPTO_DRV_HASH
 TEE_Result drvcrypt_hash_alloc_ctx(struct crypto_hash_ctx **ctx, uint32_t algo);
@@ -400,6 +402,46 @@ drvcrypt_authenc_alloc_ctx(struct crypto_authenc_ctx **ctx __unused,
 	return TEE_ERROR_NOT_IMPLEMENTED;
 }
 #endif /* CFG_CRYPTO_DRV_AUTHENC */
+
+/*
+ * Allocate a context of the software implementation of a hash or cipher
+ * algorithm, the crypto drivers aren't considered
+ */
+TEE_Result crypto_sw_hash_alloc_ctx(struct crypto_hash_ctx **ctx,
+				    uint32_t algo);
+TEE_Result crypto_sw_cipher_alloc_ctx(struct crypto_cipher_ctx **ctx,
+				      uint32_t algo);
+
+/*
+ * struct drvcrypt_dispatch_stat - dispatch of an algorithm on message size
+ * @algo:	TEE_ALG_* identifier
+ * @threshold:	shorter messages are handled by the software implementation,
+ *		longer ones by the crypto driver
+ * @sw_count:	operations handled by the software implementation
+ * @drv_count:	operations handled by the crypto driver
+ */
+struct drvcrypt_dispatch_stat {
+	uint32_t algo;
+	uint32_t threshold;
+	uint32_t sw_count;
+	uint32_t drv_count;
+};
+
+#ifdef CFG_CRYPTO_DRV_DISPATCH
+/*
+ * Copy the dispatch statistics of up to @count algorithms to @stats and
+ * return the number of algorithms dispatched on message size
+ */
+size_t drvcrypt_dispatch_get_stats(struct drvcrypt_dispatch_stat *stats,
+				   size_t count);
+#else
+static inline size_t
+drvcrypt_dispatch_get_stats(struct drvcrypt_dispatch_stat *stats __unused,
+			    size_t count __unused)
+{
+	return 0;
+}
+#endif /* CFG_CRYPTO_DRV_DISPATCH */
 /*
  * The ECC public key operations used by the crypto_acipher_ecc_*() and
  * crypto_acipher_free_ecc_*() functions.
@@ -0,0 +1,87 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef __KERNEL_LATENCY_STATS_H
+#define __KERNEL_LATENCY_STATS_H
+
+#include <compiler.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tee_api_types.h>
+
+/*
+ * Latency histograms
+ *
+ * With CFG_LATENCY_STATS=y the time spent in yielding calls per
+ * OPTEE_MSG_CMD_*, in RPCs to normal world per OPTEE_RPC_CMD_*, and in
+ * invoke commands and user mode per TA UUID is recorded in log2 scale
+ * histograms of counter ticks. Each CPU has its own counters so recording
+ * only masks foreign interrupts while updating a few words.
+ *
+ * Up to CFG_LATENCY_STATS_TA_SLOTS different TAs are tracked, the
+ * latencies of TAs seen after that are not recorded.
+ */
+
+enum latency_stats_type {
+	LATENCY_STATS_STD_CALL,
+	LATENCY_STATS_RPC,
+	LATENCY_STATS_TA_INVOKE,
+	LATENCY_STATS_TA_ENTER,
+};
+
+#ifdef CFG_LATENCY_STATS
+#include <kernel/delay_arch.h>
+
+static inline uint64_t latency_stats_now(void)
+{
+	return delay_cnt_read();
+}
+
+/*
+ * latency_stats_record() - Record the latency of an operation
+ * @type:	LATENCY_STATS_STD_CALL or LATENCY_STATS_RPC
+ * @id:		OPTEE_MSG_CMD_* or OPTEE_RPC_CMD_* respectively
+ * @start:	value of latency_stats_now() when the operation started
+ */
+void latency_stats_record(enum latency_stats_type type, uint32_t id,
+			  uint64_t start);
+
+/*
+ * latency_stats_record_ta() - Record the latency of a TA operation
+ * @type:	LATENCY_STATS_TA_INVOKE or LATENCY_STATS_TA_ENTER
+ * @uuid:	UUID of the TA
+ * @start:	value of latency_stats_now() when the operation started
+ */
+void latency_stats_record_ta(enum latency_stats_type type,
+			     const TEE_UUID *uuid, uint64_t start);
+
+/*
+ * latency_stats_get() - Get all non-empty histograms
+ * @buf:	array of struct pta_stats_latency
+ * @buf_size:	in: size of @buf, out: size needed or used
+ *
+ * Returns TEE_ERROR_SHORT_BUFFER if @buf is too small
+ */
+TEE_Result latency_stats_get(void *buf, size_t *buf_size);
+
+/* latency_stats_reset() - Clear all histograms */
+void latency_stats_reset(void);
+#else
+static inline uint64_t latency_stats_now(void)
+{
+	return 0;
+}
+
+static inline void latency_stats_record(enum latency_stats_type type __unused,
+					uint32_t id __unused,
+					uint64_t start __unused)
+{
+}
+
+static inline void
+latency_stats_record_ta(enum latency_stats_type type __unused,
+			const TEE_UUID *uuid __unused, uint64_t start __unused)
+{
+}
+#endif
+
+#endif /*__KERNEL_LATENCY_STATS_H*/
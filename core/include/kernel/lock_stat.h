@@ -0,0 +1,111 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef __KERNEL_LOCK_STAT_H
+#define __KERNEL_LOCK_STAT_H
+
+#include <compiler.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <types_ext.h>
+
+/*
+ * Lock contention profiler
+ *
+ * With CFG_LOCK_STAT=y each acquisition of a mutex, a condvar or a
+ * spinlock is accounted to a lock site, that is, the pair of the address
+ * of the lock and the address of the code acquiring it. Per lock site are
+ * counted the number of acquisitions, how many of those had to wait, and
+ * the maximum and total time spent waiting in ticks of the counter
+ * returned by delay_cnt_read().
+ *
+ * For spinlocks the code address is the return address of the function
+ * taking the spinlock since cpu_spin_lock() and friends are inlined.
+ *
+ * Each CPU records in its own table so the recording itself doesn't
+ * introduce contention between CPUs. Lock sites that don't fit in the
+ * table of a CPU are counted as dropped.
+ */
+
+enum lock_stat_type {
+	LOCK_STAT_MUTEX,
+	LOCK_STAT_CONDVAR,
+	LOCK_STAT_SPINLOCK,
+};
+
+/*
+ * struct lock_stat - statistics of one lock site
+ * @lock:	address of the lock
+ * @site:	address of the code acquiring the lock
+ * @type:	type of lock, enum lock_stat_type
+ * @acquired:	number of acquisitions
+ * @contended:	number of acquisitions which had to wait
+ * @max_wait:	longest wait, in counter ticks
+ * @total_wait:	sum of all waits, in counter ticks
+ */
+struct lock_stat {
+	vaddr_t lock;
+	vaddr_t site;
+	enum lock_stat_type type;
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t max_wait;
+	uint64_t total_wait;
+};
+
+#ifdef CFG_LOCK_STAT
+#include <kernel/delay_arch.h>
+
+static inline uint64_t lock_stat_now(void)
+{
+	return delay_cnt_read();
+}
+
+/*
+ * lock_stat_record() - Account an acquisition of a lock
+ * @type:	type of lock
+ * @lock:	address of the lock
+ * @site:	address of the code acquiring the lock
+ * @contended:	true if the acquisition had to wait
+ * @wait:	time spent waiting, in counter ticks
+ *
+ * May be called with spinlocks held and from interrupt context.
+ */
+void lock_stat_record(enum lock_stat_type type, const void *lock,
+		      vaddr_t site, bool contended, uint64_t wait);
+
+/*
+ * lock_stat_get() - Get the statistics of all lock sites
+ * @stats:	array of at least lock_stat_max_count() elements to fill in
+ * @dropped:	out: number of acquisitions which couldn't be recorded
+ *
+ * Lock sites recorded by several CPUs are merged and the result is sorted
+ * on descending total wait time. The statistics of other CPUs are read
+ * while they may be updated so they're only approximate unless the system
+ * is idle.
+ *
+ * Returns the number of lock sites filled in
+ */
+size_t lock_stat_get(struct lock_stat *stats, uint64_t *dropped);
+
+/* lock_stat_reset() - Clear the statistics of all lock sites */
+void lock_stat_reset(void);
+
+/* lock_stat_max_count() - Return the maximum number of lock sites */
+size_t lock_stat_max_count(void);
+#else
+static inline uint64_t lock_stat_now(void)
+{
+	return 0;
+}
+
+static inline void lock_stat_record(enum lock_stat_type type __unused,
+				    const void *lock __unused,
+				    vaddr_t site __unused,
+				    bool contended __unused,
+				    uint64_t wait __unused)
+{
+}
+#endif
+
+#endif /*__KERNEL_LOCK_STAT_H*/
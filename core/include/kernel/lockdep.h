@@ -133,6 +133,13 @@ void lockdep_lock_destroy(struct lockdep_node_head *graph, uintptr_t id);
 /* Initialize lockdep for mutex objects (kernel/mutex.h) */
 void mutex_lockdep_init(void);
 
+/*
+ * Lockdep for reader-writer spinlocks (kernel/rwlock.h). Owned locks are
+ * tracked per CPU since the locks are held with exceptions masked.
+ */
+void rwlock_lock_check(unsigned int *lock);
+void rwlock_unlock_check(unsigned int *lock);
+
 #else /* CFG_LOCKDEP */
 
 static inline void lockdep_lock_acquire(struct lockdep_node_head *g __unused,
@@ -152,6 +159,12 @@ lockdep_lock_destroy(struct lockdep_node_head *graph __unused,
 static inline void mutex_lockdep_init(void)
 {}
 
+static inline void rwlock_lock_check(unsigned int *lock __unused)
+{}
+
+static inline void rwlock_unlock_check(unsigned int *lock __unused)
+{}
+
 #endif /* !CFG_LOCKDEP */
 
 #endif /* !__KERNEL_LOCKDEP_H */
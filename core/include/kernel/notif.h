@@ -153,9 +153,14 @@ static inline void notif_unregister_driver(struct notif_driver *ndrv __unused)
 }
 #endif
 
-/* This is called from a fast call */
+/* These are called from a fast call */
 #if defined(CFG_CORE_ASYNC_NOTIF)
 uint32_t notif_get_value(bool *value_valid, bool *value_pending);
+/*
+ * Returns a bitmap of all pending asynchronous values, bit n set means
+ * that value n was pending. The pending values are cleared.
+ */
+uint64_t notif_get_values(void);
 #else
 static inline uint32_t notif_get_value(bool *value_valid, bool *value_pending)
 {
@@ -163,6 +168,11 @@ static inline uint32_t notif_get_value(bool *value_valid, bool *value_pending)
 	*value_pending = false;
 	return UINT32_MAX;
 }
+
+static inline uint64_t notif_get_values(void)
+{
+	return 0;
+}
 #endif
 
 #if defined(CFG_CORE_ASYNC_NOTIF)
@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef __KERNEL_RCU_H
+#define __KERNEL_RCU_H
+
+#include <compiler.h>
+#include <stdint.h>
+#include <sys/queue.h>
+
+/*
+ * Epoch based read-copy-update
+ *
+ * Readers traverse a data structure inside rcu_read_lock() and
+ * rcu_read_unlock() without taking any lock. A read section masks foreign
+ * interrupts so it must be short and must not sleep. Read sections may
+ * nest.
+ *
+ * Writers still serialize with each other using a lock, unlink elements
+ * with a single pointer store, and defer freeing unlinked elements with
+ * call_rcu() until all read sections that may still reference them have
+ * ended. Deferred callbacks are executed by rcu_reclaim() which is called
+ * each time a yielding call is about to return to normal world.
+ *
+ * Pointers that are read locklessly must be published with
+ * rcu_assign_pointer() and read with rcu_dereference().
+ */
+
+/*
+ * struct rcu_head - deferred callback
+ * @func:	function to call once the grace period has elapsed
+ * @epoch:	epoch that must be reached by all CPUs before calling @func
+ * @link:	linked list element
+ */
+struct rcu_head {
+	void (*func)(struct rcu_head *head);
+	uint32_t epoch;
+	SLIST_ENTRY(rcu_head) link;
+};
+
+#define rcu_assign_pointer(p, v) \
+	__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+#define rcu_dereference(p)	__atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+
+/* Same as SLIST_INSERT_HEAD() but safe against concurrent RCU readers */
+#define SLIST_INSERT_HEAD_RCU(head, elm, field) do {			\
+	(elm)->field.sle_next = (head)->slh_first;			\
+	rcu_assign_pointer((head)->slh_first, (elm));			\
+} while (0)
+
+/* Same as SLIST_FOREACH() but for use inside a read section */
+#define SLIST_FOREACH_RCU(var, head, field)				\
+	for ((var) = rcu_dereference((head)->slh_first);		\
+	     (var);							\
+	     (var) = rcu_dereference((var)->field.sle_next))
+
+/*
+ * rcu_read_lock() - Enter a read section
+ *
+ * Returns the exception mask to pass to rcu_read_unlock()
+ */
+uint32_t __must_check rcu_read_lock(void);
+
+/*
+ * rcu_read_unlock() - Leave a read section
+ * @exceptions:	value returned by the matching rcu_read_lock()
+ */
+void rcu_read_unlock(uint32_t exceptions);
+
+/*
+ * call_rcu() - Defer a callback until current readers are done
+ * @head:	callback reference, usually embedded in the unlinked element
+ * @func:	function to call with @head as argument
+ *
+ * May be called with spinlocks held. @func is called from a thread
+ * context without any locks held.
+ */
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head));
+
+/*
+ * rcu_reclaim() - Call deferred callbacks for which the grace period has
+ * elapsed
+ */
+void rcu_reclaim(void);
+
+#endif /*__KERNEL_RCU_H*/
@@ -0,0 +1,34 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef __KERNEL_RWLOCK_H
+#define __KERNEL_RWLOCK_H
+
+#include <compiler.h>
+#include <stdint.h>
+
+/*
+ * Reader-writer spinlock
+ *
+ * A reader-writer spinlock is an unsigned int initialized to
+ * RWLOCK_UNLOCK. Any number of readers can hold the lock at the same
+ * time while a writer has exclusive access. A writer waiting for the
+ * lock blocks new readers from acquiring it so writers can't be starved
+ * by a continuous stream of readers. A consequence of this is that a
+ * reader must not try to acquire the same lock recursively.
+ *
+ * As with cpu_spin_lock_xsave() all exceptions are masked while the lock
+ * is held, so the lock can be shared with interrupt handlers. The
+ * critical sections must be short and must not sleep.
+ *
+ * With CFG_LOCKDEP=y acquisitions are tracked by lockdep, per CPU.
+ */
+
+#define RWLOCK_UNLOCK		0
+
+uint32_t __must_check cpu_read_lock_xsave(unsigned int *lock);
+void cpu_read_unlock_xrestore(unsigned int *lock, uint32_t exceptions);
+
+uint32_t __must_check cpu_write_lock_xsave(unsigned int *lock);
+void cpu_write_unlock_xrestore(unsigned int *lock, uint32_t exceptions);
+
+#endif /*__KERNEL_RWLOCK_H*/
@@ -13,6 +13,7 @@
 #ifndef __ASSEMBLER__
 #include <assert.h>
 #include <compiler.h>
+#include <kernel/lock_stat.h>
 #include <kernel/thread.h>
 #include <stdbool.h>
 
@@ -37,8 +38,24 @@ unsigned int __cpu_spin_trylock(unsigned int *lock);
 
 static inline void cpu_spin_lock_no_dldetect(unsigned int *lock)
 {
+#ifdef CFG_LOCK_STAT
+	uint64_t wait = 0;
+	bool contended = false;
+#endif
+
 	assert(thread_foreign_intr_disabled());
+#ifdef CFG_LOCK_STAT
+	contended = __cpu_spin_trylock(lock);
+	if (contended) {
+		wait = lock_stat_now();
+		__cpu_spin_lock(lock);
+		wait = lock_stat_now() - wait;
+	}
+	lock_stat_record(LOCK_STAT_SPINLOCK, lock,
+			 (vaddr_t)__builtin_return_address(0), contended, wait);
+#else
 	__cpu_spin_lock(lock);
+#endif
 	spinlock_count_incr();
 }
 
@@ -73,10 +90,13 @@ static inline void cpu_spin_lock_dldetect(const char *func, const int line,
 {
 	unsigned int retries = 0;
 	unsigned int reminder = 0;
+	uint64_t wait = 0;
 
 	assert(thread_foreign_intr_disabled());
 
 	while (__cpu_spin_trylock(lock)) {
+		if (!wait)
+			wait = lock_stat_now();
 		retries++;
 		if (!retries) {
 			/* wrapped, time to report */
@@ -88,6 +108,12 @@ static inline void cpu_spin_lock_dldetect(const char *func, const int line,
 		}
 	}
 
+	if (wait)
+		wait = lock_stat_now() - wait;
+	lock_stat_record(LOCK_STAT_SPINLOCK, lock,
+			 (vaddr_t)__builtin_return_address(0), retries || reminder,
+			 wait);
+
 	spinlock_count_incr();
 }
 #else
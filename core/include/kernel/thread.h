@@ -46,6 +46,11 @@ struct thread_specific_data {
 #ifdef CFG_FAULT_MITIGATION
 	struct ftmn_func_arg *ftmn_arg;
 #endif
+#ifdef CFG_CRYPTO_AES_KEY_CACHE
+	struct crypto_aes_key_cache **aes_key_cache;
+	const void *aes_key_cache_key;
+	size_t aes_key_cache_key_len;
+#endif
 };
 
 void thread_init_canaries(void);
@@ -389,11 +394,37 @@ enum thread_shm_cache_user {
  * Returns a pointer to the cached RPC memory. Each thread and @user tuple
  * has a unique cache. The pointer is guaranteed to point to a large enough
  * area or to be NULL.
+ *
+ * Buffers are taken from a per thread pool where sizes are rounded up to
+ * a power of two number of pages. A buffer previously used by one user
+ * may be handed out to another user once the first user has moved on to
+ * another buffer. The pool is bounded by CFG_THREAD_SHM_CACHE_BUDGET
+ * bytes, kernel private buffers may be kept across yielding calls.
  */
 void *thread_rpc_shm_cache_alloc(enum thread_shm_cache_user user,
 				 enum thread_shm_type shm_type,
 				 size_t size, struct mobj **mobj);
 
+/*
+ * struct thread_shm_cache_stats - RPC shared memory cache statistics
+ * @hits:	allocations served from the cache, each one an avoided
+ *		OPTEE_RPC_CMD_SHM_ALLOC
+ * @rpc_allocs:	allocations that required an OPTEE_RPC_CMD_SHM_ALLOC
+ * @rpc_frees:	buffers freed with an OPTEE_RPC_CMD_SHM_FREE
+ * @bytes_held:	bytes of shared memory currently held by the caches
+ */
+struct thread_shm_cache_stats {
+	uint64_t hits;
+	uint64_t rpc_allocs;
+	uint64_t rpc_frees;
+	size_t bytes_held;
+};
+
+/*
+ * Sums the statistics of the RPC shared memory caches of all threads
+ */
+void thread_rpc_shm_cache_get_stats(struct thread_shm_cache_stats *stats);
+
 #endif /*__ASSEMBLER__*/
 
 #endif /*__KERNEL_THREAD_H*/
@@ -22,15 +22,37 @@ enum thread_state {
 	THREAD_STATE_ACTIVE,
 };
 
+/*
+ * struct thread_shm_cache_entry - cached RPC shared memory buffer
+ * @mobj:	buffer
+ * @size:	size of the buffer, always a power of two number of pages
+ * @type:	type of shared memory
+ * @user:	user currently owning the buffer, only valid if @owned
+ * @owned:	true if the buffer was last returned to @user
+ * @epoch:	value of the idle epoch when the buffer was last used
+ * @link:	linked list element
+ */
 struct thread_shm_cache_entry {
 	struct mobj *mobj;
 	size_t size;
 	enum thread_shm_type type;
 	enum thread_shm_cache_user user;
+	bool owned;
+	uint32_t epoch;
 	SLIST_ENTRY(thread_shm_cache_entry) link;
 };
 
-SLIST_HEAD(thread_shm_cache, thread_shm_cache_entry);
+/*
+ * struct thread_shm_cache - per thread pool of RPC shared memory buffers
+ * @entries:	cached buffers
+ * @bytes_held:	sum of the size of all cached buffers
+ * @stats:	usage counters of this cache
+ */
+struct thread_shm_cache {
+	SLIST_HEAD(, thread_shm_cache_entry) entries;
+	size_t bytes_held;
+	struct thread_shm_cache_stats stats;
+};
 
 struct thread_ctx {
 	struct thread_ctx_regs regs;
@@ -89,5 +111,20 @@ void thread_unlock_global(void);
 
 /* Frees the cache of allocated FS RPC memory */
 void thread_rpc_shm_cache_clear(struct thread_shm_cache *cache);
+
+/*
+ * Called at the end of a yielding call to release cached RPC memory. If
+ * @keep is true kernel private buffers that are within budget and have
+ * been used recently are kept for the next call, everything else is
+ * freed. The idle buffers kept by free threads are freed too.
+ */
+void thread_rpc_shm_cache_trim(struct thread_shm_cache *cache, bool keep);
+
+/*
+ * Removes one kept kernel private buffer from the cache without freeing
+ * it with an RPC. Returns the cookie of the buffer so normal world can
+ * free it, or 0 if the cache is empty.
+ */
+uint64_t thread_rpc_shm_cache_pop_cookie(struct thread_shm_cache *cache);
 #endif /*__ASSEMBLER__*/
 #endif /*__KERNEL_THREAD_PRIVATE_H*/
@@ -20,6 +20,7 @@
 TAILQ_HEAD(tee_cryp_state_head, tee_cryp_state);
 TAILQ_HEAD(tee_obj_head, tee_obj);
 TAILQ_HEAD(tee_storage_enum_head, tee_storage_enum);
+TAILQ_HEAD(tee_storage_batch_head, tee_storage_batch);
 SLIST_HEAD(load_seg_head, load_seg);
 
 /*
@@ -28,6 +29,7 @@ SLIST_HEAD(load_seg_head, load_seg);
  * @cryp_states:	List of cryp states created by this TA
  * @objects:		List of storage objects opened by this TA
  * @storage_enums:	List of storage enumerators opened by this TA
+ * @storage_batches:	List of storage batches begun by this TA
  * @uctx:		Generic user mode context
  * @ctx:		Generic TA context
  */
@@ -36,6 +38,7 @@ struct user_ta_ctx {
 	struct tee_cryp_state_head cryp_states;
 	struct tee_obj_head objects;
 	struct tee_storage_enum_head storage_enums;
+	struct tee_storage_batch_head storage_batches;
 	struct user_mode_ctx uctx;
 	struct tee_ta_ctx ta_ctx;
 };
@@ -25,6 +25,16 @@
 #define TEE_FS_HTREE_FEK_SIZE		U(16)
 #define TEE_FS_HTREE_TAG_SIZE		U(16)
 
+/* Binary tree over data blocks of struct tee_fs_htree_storage.block_size */
+#define TEE_FS_HTREE_FORMAT_V1		U(1)
+/* Tree with configurable fan-out over data blocks of configurable size */
+#define TEE_FS_HTREE_FORMAT_V2		U(2)
+
+/* Limited by the number of HTREE_NODE_COMMITTED_CHILD() flags in a node */
+#define TEE_FS_HTREE_MAX_FANOUT		U(8)
+#define TEE_FS_HTREE_MIN_BLOCK_SHIFT	U(12)
+#define TEE_FS_HTREE_MAX_BLOCK_SHIFT	U(16)
+
 /* Internal struct provided to let the rpc callbacks know the size if needed */
 struct tee_fs_htree_node_image {
 	/* Note that calc_node_hash() depends on hash first in struct */
@@ -42,10 +52,34 @@ struct tee_fs_htree_meta {
 	uint64_t length;
 };
 
-/* Internal struct needed by struct tee_fs_htree_image */
+/*
+ * Internal struct needed by struct tee_fs_htree_image
+ *
+ * @format, @fanout and @block_shift occupy what used to be padding and
+ * are all zero in files of format TEE_FS_HTREE_FORMAT_V1.
+ */
 struct tee_fs_htree_imeta {
 	struct tee_fs_htree_meta meta;
 	uint32_t max_node_id;
+	uint8_t format;
+	uint8_t fanout;
+	uint8_t block_shift;
+	uint8_t reserved;
+};
+
+/**
+ * struct tee_fs_htree_format - on-disk format of a hash tree
+ * @version:	TEE_FS_HTREE_FORMAT_V1 or TEE_FS_HTREE_FORMAT_V2
+ * @fanout:	number of children of each node, always 2 with
+ *		TEE_FS_HTREE_FORMAT_V1
+ * @block_shift: log2 of the size of the data blocks, with
+ *		TEE_FS_HTREE_FORMAT_V1 the size is given by
+ *		struct tee_fs_htree_storage.block_size
+ */
+struct tee_fs_htree_format {
+	uint8_t version;
+	uint8_t fanout;
+	uint8_t block_shift;
 };
 
 /* Internal struct provided to let the rpc callbacks know the size if needed */
@@ -74,11 +108,19 @@ struct tee_fs_rpc_operation;
 /**
  * struct tee_fs_htree_storage - storage description supplied by user of
  * this interface
- * @block_size:		size of data blocks
+ * @block_size:		size of data blocks with TEE_FS_HTREE_FORMAT_V1
  * @rpc_read_init:	initialize a struct tee_fs_rpc_operation for an RPC read
  *			operation
  * @rpc_write_init:	initialize a struct tee_fs_rpc_operation for an RPC
  *			write operation
+ * @rpc_read_span_init:	optional, initialize a struct tee_fs_rpc_operation
+ *			for an RPC read of both versions of up to *@count
+ *			consecutive nodes or data blocks starting at @idx.
+ *			*@count is updated with the number of elements
+ *			covered, which are returned one after another,
+ *			version 0 first. Returns TEE_ERROR_NOT_SUPPORTED if
+ *			the element at @idx must be read with
+ *			@rpc_read_init.
  *
  * The @idx arguments starts counting from 0. The @vers arguments are either
  * 0 or 1. The @data arguments is a pointer to a buffer in non-secure shared
@@ -95,26 +137,39 @@ struct tee_fs_htree_storage {
 				     enum tee_fs_htree_type type, size_t idx,
 				     uint8_t vers, void **data);
 	TEE_Result (*rpc_write_final)(struct tee_fs_rpc_operation *op);
+	TEE_Result (*rpc_read_span_init)(void *aux,
+					 struct tee_fs_rpc_operation *op,
+					 enum tee_fs_htree_type type,
+					 size_t idx, size_t *count,
+					 void **data);
 };
 
 struct tee_fs_htree;
 
 /**
  * tee_fs_htree_open() - opens/creates a hash tree
- * @create:	true if a new hash tree is to be created, else the hash tree
- *		is read in and verified
+ * @create:	true if a new hash tree is to be created, else the head and
+ *		the root node of the hash tree are read in and verified.
+ *		The other nodes are read in and verified when first needed
+ *		by a function below.
  * @hash:	hash of root node, ignored if NULL
  * @min_counter: the smallest accepted value in struct htree_image.counter
  * @uuid:	uuid of requesting TA, may be NULL if not from a TA
  * @stor:	storage description
  * @stor_aux:	auxilary pointer supplied to callbacks in struct
  *		tee_fs_htree_storage
+ * @fmt:	if @create, the format of the new hash tree, else updated
+ *		with the format of the hash tree read in. The format is
+ *		updated as soon as the root node is verified, before any
+ *		other node or data block is accessed, so the callbacks in
+ *		struct tee_fs_htree_storage may use it to locate those.
  * @ht:		returned hash tree on success
  */
 TEE_Result tee_fs_htree_open(bool create, uint8_t *hash, uint32_t min_counter,
 			     const TEE_UUID *uuid,
 			     const struct tee_fs_htree_storage *stor,
-			     void *stor_aux, struct tee_fs_htree **ht);
+			     void *stor_aux, struct tee_fs_htree_format *fmt,
+			     struct tee_fs_htree **ht);
 /**
  * tee_fs_htree_close() - close a hash tree
  * @ht:		hash tree
@@ -157,7 +212,8 @@ TEE_Result tee_fs_htree_truncate(struct tee_fs_htree **ht, size_t block_num);
  * tee_fs_htree_write_block() - encrypt and write a data block to storage
  * @ht:		hash tree
  * @block_num:	block number
- * @block:	pointer to a block of stor->block_size size
+ * @block:	pointer to a block of the size of data blocks in the format
+ *		of the hash tree
  *
  * Frees the hash tree and sets *ht to NULL on failure and returns an error code
  */
@@ -167,11 +223,38 @@ TEE_Result tee_fs_htree_write_block(struct tee_fs_htree **ht, size_t block_num,
  * tee_fs_htree_write_block() - read and decrypt a data block from storage
  * @ht:		hash tree
  * @block_num:	block number
- * @block:	pointer to a block of stor->block_size size
+ * @block:	pointer to a block of the size of data blocks in the format
+ *		of the hash tree
  *
  * Frees the hash tree and sets *ht to NULL on failure and returns an error code
  */
 TEE_Result tee_fs_htree_read_block(struct tee_fs_htree **ht, size_t block_num,
 				   void *block);
 
+/**
+ * tee_fs_htree_read_blocks() - read and decrypt consecutive data blocks
+ * from storage
+ * @ht:		hash tree
+ * @block_num:	number of the first block
+ * @count:	number of blocks
+ * @block:	pointer to a block of the size of data blocks in the format
+ *		of the hash tree, receives each block in turn
+ * @cb:		called with @cb_arg and @block as each block has been
+ *		decrypted and verified, in order of block number
+ * @cb_arg:	argument to @cb
+ *
+ * Unlike with tee_fs_htree_read_block() several blocks are read with each
+ * RPC if the storage provides rpc_read_span_init().
+ *
+ * Frees the hash tree and sets *ht to NULL on failure and returns an error
+ * code. An error returned by @cb is returned as is and leaves the hash
+ * tree open.
+ */
+TEE_Result tee_fs_htree_read_blocks(struct tee_fs_htree **ht,
+				    size_t block_num, size_t count,
+				    void *block,
+				    TEE_Result (*cb)(void *arg,
+						     const void *block),
+				    void *cb_arg);
+
 #endif /*__TEE_FS_HTREE_H*/
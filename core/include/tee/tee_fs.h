@@ -29,6 +29,13 @@ struct tee_pobj;
 
 /*
  * tee_fs implements a POSIX like secure file system with GP extension
+ *
+ * begin_batch() and end_batch() are optional. Between them the updates
+ * done on behalf of the TA identified by the UUID may be committed
+ * together by end_batch() instead of by each operation. end_batch()
+ * returns TEE_ERROR_BAD_STATE if no batch was begun or if the updates
+ * were discarded due to a failure in the meantime. Batches begun several
+ * times are ended as many times and all of them report the discard.
  */
 struct tee_file_operations {
 	TEE_Result (*open)(struct tee_pobj *po, size_t *size,
@@ -52,6 +59,9 @@ struct tee_file_operations {
 	TEE_Result (*opendir)(const TEE_UUID *uuid, struct tee_fs_dir **d);
 	TEE_Result (*readdir)(struct tee_fs_dir *d, struct tee_fs_dirent **ent);
 	void (*closedir)(struct tee_fs_dir *d);
+
+	TEE_Result (*begin_batch)(const TEE_UUID *uuid);
+	TEE_Result (*end_batch)(const TEE_UUID *uuid);
 };
 
 #ifdef CFG_REE_FS
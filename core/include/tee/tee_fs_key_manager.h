@@ -23,6 +23,25 @@ TEE_Result tee_fs_crypt_block(const TEE_UUID *uuid, uint8_t *out,
 			      uint16_t blk_idx, const uint8_t *encrypted_fek,
 			      TEE_OperationMode mode);
 
+/*
+ * struct tee_fs_crypt_ctx - context to encrypt or decrypt several blocks
+ * of a file with tee_fs_crypt_ctx_block(), equivalent to calling
+ * tee_fs_crypt_block() for each block but the FEK is decrypted only once.
+ */
+struct tee_fs_crypt_ctx {
+	uint8_t fek[TEE_FS_KM_FEK_SIZE];
+	void *essiv_ctx;
+	void *ctx;
+};
+
+TEE_Result tee_fs_crypt_ctx_init(struct tee_fs_crypt_ctx *c,
+				 const TEE_UUID *uuid,
+				 const uint8_t *encrypted_fek);
+TEE_Result tee_fs_crypt_ctx_block(struct tee_fs_crypt_ctx *c, uint8_t *out,
+				  const uint8_t *in, size_t size,
+				  uint16_t blk_idx, TEE_OperationMode mode);
+void tee_fs_crypt_ctx_final(struct tee_fs_crypt_ctx *c);
+
 TEE_Result tee_fs_fek_crypt(const TEE_UUID *uuid, TEE_OperationMode mode,
 			    const uint8_t *in_key, size_t size,
 			    uint8_t *out_key);
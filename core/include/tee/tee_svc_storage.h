@@ -45,6 +45,11 @@ TEE_Result syscall_storage_next_enum(unsigned long obj_enum,
 				     struct utee_object_info *info,
 				     void *obj_id, uint64_t *len);
 
+TEE_Result syscall_storage_next_enum_ids(unsigned long obj_enum,
+					 struct utee_object_id *ids,
+					 unsigned long max_count,
+					 uint64_t *count);
+
 /*
  * Data Stream Access Functions
  */
@@ -59,9 +64,26 @@ TEE_Result syscall_storage_obj_trunc(unsigned long obj, size_t len);
 TEE_Result syscall_storage_obj_seek(unsigned long obj, int32_t offset,
 				    unsigned long whence);
 
+/*
+ * Batch Functions
+ */
+
+TEE_Result syscall_storage_begin_batch(unsigned long storage_id);
+TEE_Result syscall_storage_end_batch(unsigned long storage_id);
+
 void tee_svc_storage_close_all_enum(struct user_ta_ctx *utc);
+void tee_svc_storage_end_all_batches(struct user_ta_ctx *utc);
 TEE_Result tee_svc_storage_write_usage(struct tee_obj *o, uint32_t usage);
 
+/*
+ * Drops the cached head of @po, called when the object is changed or its
+ * last handle is closed
+ */
+void tee_svc_storage_invalidate_head(struct tee_pobj *po);
+
+/* Drops the cached heads of all objects in @fops */
+void tee_svc_storage_flush_heads(const struct tee_file_operations *fops);
+
 void tee_svc_storage_init(void);
 
 #endif /* __TEE_TEE_SVC_STORAGE_H */
@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <assert.h>
+#include <atomic.h>
+#include <kernel/latency_stats.h>
+#include <kernel/misc.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <optee_msg.h>
+#include <optee_rpc_cmd.h>
+#include <pta_stats.h>
+#include <string.h>
+#include <util.h>
+
+#define STD_CALL_IDS	(OPTEE_MSG_CMD_STOP_ASYNC_NOTIF + 1)
+#define RPC_IDS		(OPTEE_RPC_CMD_RPMB_FRAMES + 1)
+
+struct latency_hist {
+	uint64_t count;
+	uint64_t total;
+	uint64_t max;
+	uint32_t buckets[STATS_LATENCY_NUM_BUCKETS];
+};
+
+/*
+ * struct latency_core - histograms updated by a CPU
+ * @reset:	set by latency_stats_reset(), the histograms are cleared by
+ *		their CPU before the next record
+ *
+ * Only updated by the CPU owning the histograms with foreign interrupts
+ * masked.
+ */
+struct latency_core {
+	struct latency_hist std_call[STD_CALL_IDS];
+	struct latency_hist rpc[RPC_IDS];
+	struct latency_hist ta_invoke[CFG_LATENCY_STATS_TA_SLOTS];
+	struct latency_hist ta_enter[CFG_LATENCY_STATS_TA_SLOTS];
+	unsigned int reset;
+};
+
+/* Updated from nexus context, shared by all partitions */
+static struct latency_core latency_core[CFG_TEE_CORE_NB_CORE] __nex_bss;
+
+/* Assigned once, the first @ta_slot_count entries are read locklessly */
+static TEE_UUID ta_uuids[CFG_LATENCY_STATS_TA_SLOTS] __nex_bss;
+static unsigned int ta_slot_count __nex_bss;
+static unsigned int ta_slot_lock __nex_data = SPINLOCK_UNLOCK;
+
+static void hist_add(struct latency_hist *h, uint64_t lat)
+{
+	size_t n = 0;
+
+	if (lat)
+		n = MIN(63 - __builtin_clzll(lat),
+			STATS_LATENCY_NUM_BUCKETS - 1);
+
+	h->buckets[n]++;
+	h->count++;
+	h->total += lat;
+	if (lat > h->max)
+		h->max = lat;
+}
+
+static struct latency_hist *get_hist(struct latency_core *lc,
+				     enum latency_stats_type type, size_t idx)
+{
+	switch (type) {
+	case LATENCY_STATS_STD_CALL:
+		if (idx < STD_CALL_IDS)
+			return lc->std_call + idx;
+		return NULL;
+	case LATENCY_STATS_RPC:
+		if (idx < RPC_IDS)
+			return lc->rpc + idx;
+		return NULL;
+	case LATENCY_STATS_TA_INVOKE:
+		return lc->ta_invoke + idx;
+	case LATENCY_STATS_TA_ENTER:
+		return lc->ta_enter + idx;
+	default:
+		return NULL;
+	}
+}
+
+static void record(enum latency_stats_type type, size_t idx, uint64_t start)
+{
+	uint64_t lat = latency_stats_now() - start;
+	uint32_t exceptions = thread_mask_exceptions(THREAD_EXCP_FOREIGN_INTR);
+	struct latency_core *lc = latency_core + get_core_pos();
+	struct latency_hist *h = NULL;
+
+	if (atomic_load_uint(&lc->reset)) {
+		memset(lc, 0, sizeof(*lc));
+		atomic_store_uint(&lc->reset, 0);
+	}
+
+	h = get_hist(lc, type, idx);
+	if (h)
+		hist_add(h, lat);
+
+	thread_unmask_exceptions(exceptions);
+}
+
+void latency_stats_record(enum latency_stats_type type, uint32_t id,
+			  uint64_t start)
+{
+	assert(type == LATENCY_STATS_STD_CALL || type == LATENCY_STATS_RPC);
+	record(type, id, start);
+}
+
+static size_t find_ta_slot(const TEE_UUID *uuid, size_t first, size_t count)
+{
+	size_t n = 0;
+
+	for (n = first; n < count; n++)
+		if (!memcmp(ta_uuids + n, uuid, sizeof(*uuid)))
+			return n;
+
+	return SIZE_MAX;
+}
+
+static size_t get_ta_slot(const TEE_UUID *uuid)
+{
+	unsigned int count = __atomic_load_n(&ta_slot_count, __ATOMIC_ACQUIRE);
+	uint32_t exceptions = 0;
+	size_t slot = 0;
+
+	slot = find_ta_slot(uuid, 0, count);
+	if (slot != SIZE_MAX || count == CFG_LATENCY_STATS_TA_SLOTS)
+		return slot;
+
+	exceptions = cpu_spin_lock_xsave(&ta_slot_lock);
+	/* Only the slots assigned since the lockless search are left */
+	slot = find_ta_slot(uuid, count, ta_slot_count);
+	if (slot == SIZE_MAX && ta_slot_count < CFG_LATENCY_STATS_TA_SLOTS) {
+		slot = ta_slot_count;
+		ta_uuids[slot] = *uuid;
+		__atomic_store_n(&ta_slot_count, slot + 1, __ATOMIC_RELEASE);
+	}
+	cpu_spin_unlock_xrestore(&ta_slot_lock, exceptions);
+
+	return slot;
+}
+
+void latency_stats_record_ta(enum latency_stats_type type,
+			     const TEE_UUID *uuid, uint64_t start)
+{
+	size_t slot = get_ta_slot(uuid);
+
+	assert(type == LATENCY_STATS_TA_INVOKE ||
+	       type == LATENCY_STATS_TA_ENTER);
+	if (slot != SIZE_MAX)
+		record(type, slot, start);
+}
+
+static bool sum_hist(struct latency_hist *sum, enum latency_stats_type type,
+		     size_t idx)
+{
+	struct latency_hist *h = NULL;
+	size_t n = 0;
+	size_t m = 0;
+
+	memset(sum, 0, sizeof(*sum));
+	for (n = 0; n < CFG_TEE_CORE_NB_CORE; n++) {
+		if (atomic_load_uint(&latency_core[n].reset))
+			continue;
+
+		h = get_hist(latency_core + n, type, idx);
+		sum->count += h->count;
+		sum->total += h->total;
+		sum->max = MAX(sum->max, h->max);
+		for (m = 0; m < STATS_LATENCY_NUM_BUCKETS; m++)
+			sum->buckets[m] += h->buckets[m];
+	}
+
+	return sum->count;
+}
+
+TEE_Result latency_stats_get(void *buf, size_t *buf_size)
+{
+	static const struct {
+		enum latency_stats_type type;
+		uint32_t pta_type;
+		size_t count;
+	} sets[] = {
+		{ LATENCY_STATS_STD_CALL, STATS_LATENCY_TYPE_STD_CALL,
+		  STD_CALL_IDS },
+		{ LATENCY_STATS_RPC, STATS_LATENCY_TYPE_RPC, RPC_IDS },
+		{ LATENCY_STATS_TA_INVOKE, STATS_LATENCY_TYPE_TA_INVOKE,
+		  CFG_LATENCY_STATS_TA_SLOTS },
+		{ LATENCY_STATS_TA_ENTER, STATS_LATENCY_TYPE_TA_ENTER,
+		  CFG_LATENCY_STATS_TA_SLOTS },
+	};
+	unsigned int ta_count = __atomic_load_n(&ta_slot_count,
+						__ATOMIC_ACQUIRE);
+	struct pta_stats_latency *out = buf;
+	struct latency_hist sum = { };
+	size_t count = 0;
+	size_t n = 0;
+	size_t m = 0;
+	bool is_ta = false;
+
+	for (n = 0; n < ARRAY_SIZE(sets); n++) {
+		is_ta = sets[n].type == LATENCY_STATS_TA_INVOKE ||
+			sets[n].type == LATENCY_STATS_TA_ENTER;
+		for (m = 0; m < sets[n].count; m++) {
+			if (is_ta && m >= ta_count)
+				break;
+			if (!sum_hist(&sum, sets[n].type, m))
+				continue;
+
+			if ((count + 1) * sizeof(*out) <= *buf_size) {
+				out[count] = (struct pta_stats_latency){
+					.type = sets[n].pta_type,
+					.id = is_ta ? 0 : m,
+					.count = sum.count,
+					.total = sum.total,
+					.max = sum.max,
+				};
+				if (is_ta)
+					out[count].uuid = ta_uuids[m];
+				memcpy(out[count].buckets, sum.buckets,
+				       sizeof(sum.buckets));
+			}
+			count++;
+		}
+	}
+
+	if (count * sizeof(*out) > *buf_size) {
+		*buf_size = count * sizeof(*out);
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+	*buf_size = count * sizeof(*out);
+
+	return TEE_SUCCESS;
+}
+
+void latency_stats_reset(void)
+{
+	size_t n = 0;
+
+	for (n = 0; n < CFG_TEE_CORE_NB_CORE; n++)
+		atomic_store_uint(&latency_core[n].reset, 1);
+}
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <assert.h>
+#include <atomic.h>
+#include <keep.h>
+#include <kernel/lock_stat.h>
+#include <kernel/misc.h>
+#include <kernel/thread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util.h>
+
+static_assert(IS_POWER_OF_TWO(CFG_LOCK_STAT_ENTRIES));
+
+/*
+ * struct lock_stat_core - lock sites recorded by a CPU
+ * @entries:	open addressed hash table, an entry with @lock 0 is free
+ * @dropped:	number of acquisitions not recorded due to a full table
+ * @reset:	set by lock_stat_reset(), the table is cleared by its CPU
+ *		before the next record
+ *
+ * Only updated by the CPU owning the table with all exceptions masked.
+ */
+struct lock_stat_core {
+	struct lock_stat entries[CFG_LOCK_STAT_ENTRIES];
+	uint64_t dropped;
+	unsigned int reset;
+};
+
+static struct lock_stat_core lock_stat_core[CFG_TEE_CORE_NB_CORE] __nex_bss;
+
+static size_t site_hash(enum lock_stat_type type, vaddr_t lock, vaddr_t site)
+{
+	uint32_t h = (lock >> 2) ^ (site >> 2) ^ type;
+
+	/* Fibonacci hashing, spreads nearby addresses over the table */
+	return (h * 0x9e3779b9U) >> (32 - __builtin_ctz(CFG_LOCK_STAT_ENTRIES));
+}
+
+void lock_stat_record(enum lock_stat_type type, const void *lock,
+		      vaddr_t site, bool contended, uint64_t wait)
+{
+	uint32_t exceptions = thread_mask_exceptions(THREAD_EXCP_ALL);
+	struct lock_stat_core *lsc = lock_stat_core + get_core_pos();
+	struct lock_stat *ls = NULL;
+	size_t idx = 0;
+	size_t n = 0;
+
+	if (atomic_load_uint(&lsc->reset)) {
+		memset(lsc->entries, 0, sizeof(lsc->entries));
+		lsc->dropped = 0;
+		atomic_store_uint(&lsc->reset, 0);
+	}
+
+	idx = site_hash(type, (vaddr_t)lock, site);
+	for (n = 0; n < CFG_LOCK_STAT_ENTRIES; n++) {
+		ls = lsc->entries + ((idx + n) & (CFG_LOCK_STAT_ENTRIES - 1));
+		if (!ls->lock) {
+			ls->lock = (vaddr_t)lock;
+			ls->site = site;
+			ls->type = type;
+			break;
+		}
+		if (ls->lock == (vaddr_t)lock && ls->site == site &&
+		    ls->type == type)
+			break;
+	}
+
+	if (n == CFG_LOCK_STAT_ENTRIES) {
+		lsc->dropped++;
+	} else {
+		ls->acquired++;
+		if (contended) {
+			ls->contended++;
+			ls->total_wait += wait;
+			if (wait > ls->max_wait)
+				ls->max_wait = wait;
+		}
+	}
+
+	thread_unmask_exceptions(exceptions);
+}
+DECLARE_KEEP_PAGER(lock_stat_record);
+
+static int cmp_total_wait(const void *a, const void *b)
+{
+	const struct lock_stat *la = a;
+	const struct lock_stat *lb = b;
+
+	if (la->total_wait != lb->total_wait)
+		return CMP_TRILEAN(lb->total_wait, la->total_wait);
+	if (la->contended != lb->contended)
+		return CMP_TRILEAN(lb->contended, la->contended);
+	return CMP_TRILEAN(lb->acquired, la->acquired);
+}
+
+static void merge_entry(struct lock_stat *stats, size_t *count,
+			const struct lock_stat *ls)
+{
+	struct lock_stat *s = NULL;
+	size_t n = 0;
+
+	for (n = 0; n < *count; n++) {
+		s = stats + n;
+		if (s->lock == ls->lock && s->site == ls->site &&
+		    s->type == ls->type) {
+			s->acquired += ls->acquired;
+			s->contended += ls->contended;
+			s->total_wait += ls->total_wait;
+			s->max_wait = MAX(s->max_wait, ls->max_wait);
+			return;
+		}
+	}
+
+	stats[*count] = *ls;
+	(*count)++;
+}
+
+size_t lock_stat_get(struct lock_stat *stats, uint64_t *dropped)
+{
+	struct lock_stat_core *lsc = NULL;
+	struct lock_stat ls = { };
+	size_t count = 0;
+	size_t n = 0;
+	size_t m = 0;
+
+	*dropped = 0;
+	for (n = 0; n < CFG_TEE_CORE_NB_CORE; n++) {
+		lsc = lock_stat_core + n;
+		if (atomic_load_uint(&lsc->reset))
+			continue;
+
+		*dropped += lsc->dropped;
+		for (m = 0; m < CFG_LOCK_STAT_ENTRIES; m++) {
+			ls = lsc->entries[m];
+			if (ls.lock)
+				merge_entry(stats, &count, &ls);
+		}
+	}
+
+	qsort(stats, count, sizeof(*stats), cmp_total_wait);
+
+	return count;
+}
+
+void lock_stat_reset(void)
+{
+	size_t n = 0;
+
+	for (n = 0; n < CFG_TEE_CORE_NB_CORE; n++)
+		atomic_store_uint(&lock_stat_core[n].reset, 1);
+}
+
+size_t lock_stat_max_count(void)
+{
+	return CFG_TEE_CORE_NB_CORE * CFG_LOCK_STAT_ENTRIES;
+}
@@ -6,7 +6,10 @@
 #include <assert.h>
 #include <config.h>
 #include <kernel/lockdep.h>
+#include <kernel/misc.h>
+#include <kernel/spinlock.h>
 #include <kernel/unwind.h>
+#include <malloc.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/queue.h>
@@ -19,6 +22,62 @@
 /* Flag used during breadth-first search (print shortest cycle) */
 #define LOCKDEP_NODE_BFS_VISITED	BIT(2)
 
+/*
+ * Global graph of all reader-writer spinlocks used in the code, shared by
+ * the partitions since it includes nexus locks
+ */
+static struct lockdep_node_head rwlock_graph __nex_bss;
+
+/*
+ * One queue per CPU, contains the reader-writer spinlocks owned by the
+ * CPU at any point in time (in acquire order)
+ */
+static struct lockdep_lock_head rwlock_owned[CFG_TEE_CORE_NB_CORE] __nex_bss;
+
+/*
+ * The elements of the reader-writer spinlock graph are allocated from the
+ * nexus heap, the @nex arguments below select the heap
+ */
+static bool is_nex_graph(struct lockdep_node_head *graph)
+{
+	return graph == &rwlock_graph;
+}
+
+static bool is_nex_queue(struct lockdep_lock_head *owned)
+{
+	return owned >= rwlock_owned &&
+	       owned < rwlock_owned + ARRAY_SIZE(rwlock_owned);
+}
+
+static void *lockdep_malloc(bool nex, size_t size)
+{
+	if (nex)
+		return nex_malloc(size);
+	return malloc(size);
+}
+
+static void *lockdep_calloc(bool nex, size_t size)
+{
+	if (nex)
+		return nex_calloc(1, size);
+	return calloc(1, size);
+}
+
+static void *lockdep_realloc(bool nex, void *ptr, size_t size)
+{
+	if (nex)
+		return nex_realloc(ptr, size);
+	return realloc(ptr, size);
+}
+
+static void lockdep_free(bool nex, void *ptr)
+{
+	if (nex)
+		nex_free(ptr);
+	else
+		free(ptr);
+}
+
 /* Find node in graph or add it */
 static struct lockdep_node *lockdep_add_to_graph(
 				struct lockdep_node_head *graph,
@@ -31,7 +90,7 @@ static struct lockdep_node *lockdep_add_to_graph(
 		if (node->lock_id == lock_id)
 			return node;
 
-	node = calloc(1, sizeof(*node));
+	node = lockdep_calloc(is_nex_graph(graph), sizeof(*node));
 	if (!node)
 		return NULL;
 
@@ -42,7 +101,7 @@ static struct lockdep_node *lockdep_add_to_graph(
 	return node;
 }
 
-static vaddr_t *dup_call_stack(vaddr_t *stack)
+static vaddr_t *dup_call_stack(vaddr_t *stack, bool nex)
 {
 	vaddr_t *nstack = NULL;
 	int n = 0;
@@ -53,7 +112,7 @@ static vaddr_t *dup_call_stack(vaddr_t *stack)
 	while (stack[n])
 		n++;
 
-	nstack = malloc((n + 1) * sizeof(vaddr_t));
+	nstack = lockdep_malloc(nex, (n + 1) * sizeof(vaddr_t));
 	if (!nstack)
 		return NULL;
 
@@ -78,7 +137,7 @@ static TEE_Result lockdep_add_edge(struct lockdep_node *from,
 				   struct lockdep_node *to,
 				   vaddr_t *call_stack_from,
 				   vaddr_t *call_stack_to,
-				   uintptr_t thread_id)
+				   uintptr_t thread_id, bool nex)
 {
 	struct lockdep_edge *edge = NULL;
 
@@ -86,12 +145,12 @@ static TEE_Result lockdep_add_edge(struct lockdep_node *from,
 		if (edge->to == to)
 			return TEE_SUCCESS;
 
-	edge = calloc(1, sizeof(*edge));
+	edge = lockdep_calloc(nex, sizeof(*edge));
 	if (!edge)
 		return TEE_ERROR_OUT_OF_MEMORY;
 	edge->to = to;
-	edge->call_stack_from = dup_call_stack(call_stack_from);
-	edge->call_stack_to = dup_call_stack(call_stack_to);
+	edge->call_stack_from = dup_call_stack(call_stack_from, nex);
+	edge->call_stack_to = dup_call_stack(call_stack_to, nex);
 	edge->thread_id = thread_id;
 	STAILQ_INSERT_TAIL(&from->edges, edge, link);
 
@@ -107,15 +166,16 @@ struct lockdep_bfs {
 
 TAILQ_HEAD(lockdep_bfs_head, lockdep_bfs);
 
-static void lockdep_bfs_queue_delete(struct lockdep_bfs_head *queue)
+static void lockdep_bfs_queue_delete(struct lockdep_bfs_head *queue,
+				     bool nex)
 {
 	struct lockdep_bfs *cur = NULL;
 	struct lockdep_bfs *next = NULL;
 
 	TAILQ_FOREACH_SAFE(cur, queue, link, next) {
 		TAILQ_REMOVE(queue, cur, link);
-		free(cur->path);
-		free(cur);
+		lockdep_free(nex, cur->path);
+		lockdep_free(nex, cur);
 	}
 }
 
@@ -125,7 +185,8 @@ static void lockdep_bfs_queue_delete(struct lockdep_bfs_head *queue)
  * and stops when it reaches @node again. In each node we're tracking the path
  * from the start node.
  */
-static uintptr_t *lockdep_graph_get_shortest_cycle(struct lockdep_node *node)
+static uintptr_t *lockdep_graph_get_shortest_cycle(struct lockdep_node *node,
+						   bool nex)
 {
 	struct lockdep_bfs_head queue;
 	struct lockdep_bfs *qe = NULL;
@@ -134,11 +195,11 @@ static uintptr_t *lockdep_graph_get_shortest_cycle(struct lockdep_node *node)
 	TAILQ_INIT(&queue);
 	node->flags |= LOCKDEP_NODE_BFS_VISITED;
 
-	qe = calloc(1, sizeof(*qe));
+	qe = lockdep_calloc(nex, sizeof(*qe));
 	if (!qe)
 		goto out;
 	qe->node = node;
-	qe->path = malloc(sizeof(uintptr_t));
+	qe->path = lockdep_malloc(nex, sizeof(uintptr_t));
 	if (!qe->path)
 		goto out;
 	qe->path[0] = node->lock_id;
@@ -162,11 +223,11 @@ static uintptr_t *lockdep_graph_get_shortest_cycle(struct lockdep_node *node)
 				 * Cycle found. Terminate cycle path with NULL
 				 * and return it.
 				 */
-				tmp = realloc(qe->path,
-					      nlen * sizeof(uintptr_t));
+				tmp = lockdep_realloc(nex, qe->path,
+						      nlen * sizeof(uintptr_t));
 				if (!tmp) {
 					EMSG("Out of memory");
-					free(qe->path);
+					lockdep_free(nex, qe->path);
 					ret = NULL;
 					goto out;
 				}
@@ -183,11 +244,12 @@ static uintptr_t *lockdep_graph_get_shortest_cycle(struct lockdep_node *node)
 				e->to->flags |= LOCKDEP_NODE_BFS_VISITED;
 
 				nlen = qe->pathlen + 1;
-				nqe = calloc(1, sizeof(*nqe));
+				nqe = lockdep_calloc(nex, sizeof(*nqe));
 				if (!nqe)
 					goto out;
 				nqe->node = e->to;
-				nqe->path = malloc(nlen * sizeof(uintptr_t));
+				nqe->path = lockdep_malloc(nex, nlen *
+							   sizeof(uintptr_t));
 				if (!nqe->path)
 					goto out;
 				nqe->pathlen = nlen;
@@ -197,14 +259,14 @@ static uintptr_t *lockdep_graph_get_shortest_cycle(struct lockdep_node *node)
 				TAILQ_INSERT_TAIL(&queue, nqe, link);
 			}
 		}
-		free(qe->path);
-		free(qe);
+		lockdep_free(nex, qe->path);
+		lockdep_free(nex, qe);
 		qe = NULL;
 	}
 
 out:
-	free(qe);
-	lockdep_bfs_queue_delete(&queue);
+	lockdep_free(nex, qe);
+	lockdep_bfs_queue_delete(&queue, nex);
 	return ret;
 }
 
@@ -298,7 +360,7 @@ static void lockdep_print_cycle_info(struct lockdep_node_head *graph,
 	uintptr_t from = 0;
 	uintptr_t to = 0;
 
-	cycle = lockdep_graph_get_shortest_cycle(node);
+	cycle = lockdep_graph_get_shortest_cycle(node, is_nex_graph(graph));
 	assert(cycle && cycle[0]);
 	EMSG_RAW("-> Shortest cycle:");
 	for (p = cycle; *p; p++)
@@ -320,15 +382,26 @@ static void lockdep_print_cycle_info(struct lockdep_node_head *graph,
 			lockdep_print_edge_info(from, edge);
 		}
 	}
-	free(cycle);
+	lockdep_free(is_nex_graph(graph), cycle);
 }
 
-static vaddr_t *lockdep_get_kernel_stack(void)
+static vaddr_t *lockdep_get_kernel_stack(bool nex)
 {
-	if (IS_ENABLED(CFG_LOCKDEP_RECORD_STACK))
-		return unw_get_kernel_stack();
+	vaddr_t *stack = NULL;
+	vaddr_t *nstack = NULL;
 
-	return NULL;
+	if (!IS_ENABLED(CFG_LOCKDEP_RECORD_STACK))
+		return NULL;
+
+	stack = unw_get_kernel_stack();
+	if (!nex)
+		return stack;
+
+	/* The unwinder allocates from the heap of the partition */
+	nstack = dup_call_stack(stack, nex);
+	free(stack);
+
+	return nstack;
 }
 
 TEE_Result __lockdep_lock_acquire(struct lockdep_node_head *graph,
@@ -336,6 +409,7 @@ TEE_Result __lockdep_lock_acquire(struct lockdep_node_head *graph,
 				  uintptr_t id)
 {
 	struct lockdep_node *node = lockdep_add_to_graph(graph, id);
+	bool nex = is_nex_graph(graph);
 	struct lockdep_lock *lock = NULL;
 	TEE_Result res = TEE_SUCCESS;
 	vaddr_t *acq_stack = NULL;
@@ -343,11 +417,11 @@ TEE_Result __lockdep_lock_acquire(struct lockdep_node_head *graph,
 	if (!node)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
-	acq_stack = lockdep_get_kernel_stack();
+	acq_stack = lockdep_get_kernel_stack(nex);
 
 	TAILQ_FOREACH(lock, owned, link) {
 		res = lockdep_add_edge(lock->node, node, lock->call_stack,
-				       acq_stack, (uintptr_t)owned);
+				       acq_stack, (uintptr_t)owned, nex);
 		if (res)
 			return res;
 	}
@@ -360,7 +434,7 @@ TEE_Result __lockdep_lock_acquire(struct lockdep_node_head *graph,
 		return res;
 	}
 
-	lock = calloc(1, sizeof(*lock));
+	lock = lockdep_calloc(nex, sizeof(*lock));
 	if (!lock)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
@@ -381,15 +455,16 @@ TEE_Result __lockdep_lock_tryacquire(struct lockdep_node_head *graph,
 				     uintptr_t id)
 {
 	struct lockdep_node *node = lockdep_add_to_graph(graph, id);
+	bool nex = is_nex_graph(graph);
 	struct lockdep_lock *lock = NULL;
 	vaddr_t *acq_stack = NULL;
 
 	if (!node)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
-	acq_stack = lockdep_get_kernel_stack();
+	acq_stack = lockdep_get_kernel_stack(nex);
 
-	lock = calloc(1, sizeof(*lock));
+	lock = lockdep_calloc(nex, sizeof(*lock));
 	if (!lock)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
@@ -407,8 +482,8 @@ TEE_Result __lockdep_lock_release(struct lockdep_lock_head *owned, uintptr_t id)
 	TAILQ_FOREACH_REVERSE(lock, owned, lockdep_lock_head, link) {
 		if (lock->node->lock_id == id) {
 			TAILQ_REMOVE(owned, lock, link);
-			free(lock->call_stack);
-			free(lock);
+			lockdep_free(is_nex_queue(owned), lock->call_stack);
+			lockdep_free(is_nex_queue(owned), lock);
 			return TEE_SUCCESS;
 		}
 	}
@@ -417,22 +492,22 @@ TEE_Result __lockdep_lock_release(struct lockdep_lock_head *owned, uintptr_t id)
 	return TEE_ERROR_ITEM_NOT_FOUND;
 }
 
-static void lockdep_free_edge(struct lockdep_edge *edge)
+static void lockdep_free_edge(struct lockdep_edge *edge, bool nex)
 {
-	free(edge->call_stack_from);
-	free(edge->call_stack_to);
-	free(edge);
+	lockdep_free(nex, edge->call_stack_from);
+	lockdep_free(nex, edge->call_stack_to);
+	lockdep_free(nex, edge);
 }
 
-static void lockdep_node_delete(struct lockdep_node *node)
+static void lockdep_node_delete(struct lockdep_node *node, bool nex)
 {
 	struct lockdep_edge *edge = NULL;
 	struct lockdep_edge *next = NULL;
 
 	STAILQ_FOREACH_SAFE(edge, &node->edges, link, next)
-		lockdep_free_edge(edge);
+		lockdep_free_edge(edge, nex);
 
-	free(node);
+	lockdep_free(nex, node);
 }
 
 void lockdep_graph_delete(struct lockdep_node_head *graph)
@@ -442,7 +517,7 @@ void lockdep_graph_delete(struct lockdep_node_head *graph)
 
 	TAILQ_FOREACH_SAFE(node, graph, link, next) {
 		TAILQ_REMOVE(graph, node, link);
-		lockdep_node_delete(node);
+		lockdep_node_delete(node, is_nex_graph(graph));
 	}
 }
 
@@ -453,13 +528,14 @@ void lockdep_queue_delete(struct lockdep_lock_head *owned)
 
 	TAILQ_FOREACH_SAFE(lock, owned, link, next) {
 		TAILQ_REMOVE(owned, lock, link);
-		free(lock);
+		lockdep_free(is_nex_queue(owned), lock);
 	}
 }
 
 static void lockdep_node_destroy(struct lockdep_node_head *graph,
 				 struct lockdep_node *node)
 {
+	bool nex = is_nex_graph(graph);
 	struct lockdep_edge *edge = NULL;
 	struct lockdep_edge *next = NULL;
 	struct lockdep_node *from = NULL;
@@ -474,7 +550,7 @@ static void lockdep_node_destroy(struct lockdep_node_head *graph,
 		edge = STAILQ_FIRST(&from->edges);
 		while (edge && edge->to == node) {
 			STAILQ_REMOVE_HEAD(&from->edges, link);
-			lockdep_free_edge(edge);
+			lockdep_free_edge(edge, nex);
 			edge = STAILQ_FIRST(&from->edges);
 		}
 
@@ -485,7 +561,7 @@ static void lockdep_node_destroy(struct lockdep_node_head *graph,
 		while (next) {
 			if (next->to == node) {
 				STAILQ_REMOVE_AFTER(&from->edges, edge, link);
-				lockdep_free_edge(next);
+				lockdep_free_edge(next, nex);
 			} else {
 				edge = next;
 			}
@@ -494,9 +570,9 @@ static void lockdep_node_destroy(struct lockdep_node_head *graph,
 	}
 
 	STAILQ_FOREACH_SAFE(edge, &node->edges, link, next)
-		lockdep_free_edge(edge);
+		lockdep_free_edge(edge, nex);
 
-	free(node);
+	lockdep_free(nex, node);
 }
 
 void lockdep_lock_destroy(struct lockdep_node_head *graph, uintptr_t lock_id)
@@ -511,3 +587,39 @@ void lockdep_lock_destroy(struct lockdep_node_head *graph, uintptr_t lock_id)
 		}
 	}
 }
+
+/* Protects @rwlock_graph and @rwlock_owned */
+static unsigned int rwlock_graph_lock __nex_bss = SPINLOCK_UNLOCK;
+
+static struct lockdep_node_head *get_rwlock_graph(void)
+{
+	if (!rwlock_graph.tqh_last)
+		TAILQ_INIT(&rwlock_graph);
+
+	return &rwlock_graph;
+}
+
+static struct lockdep_lock_head *get_rwlock_owned(void)
+{
+	struct lockdep_lock_head *owned = rwlock_owned + get_core_pos();
+
+	if (!owned->tqh_last)
+		TAILQ_INIT(owned);
+
+	return owned;
+}
+
+void rwlock_lock_check(unsigned int *lock)
+{
+	cpu_spin_lock(&rwlock_graph_lock);
+	lockdep_lock_acquire(get_rwlock_graph(), get_rwlock_owned(),
+			     (uintptr_t)lock);
+	cpu_spin_unlock(&rwlock_graph_lock);
+}
+
+void rwlock_unlock_check(unsigned int *lock)
+{
+	cpu_spin_lock(&rwlock_graph_lock);
+	lockdep_lock_release(get_rwlock_owned(), (uintptr_t)lock);
+	cpu_spin_unlock(&rwlock_graph_lock);
+}
@@ -3,6 +3,7 @@
  * Copyright (c) 2015-2017, Linaro Limited
  */
 
+#include <kernel/lock_stat.h>
 #include <kernel/mutex.h>
 #include <kernel/mutex_pm_aware.h>
 #include <kernel/panic.h>
@@ -13,6 +14,9 @@
 
 #include "mutex_lockdep.h"
 
+/* Address of the code calling the public function, for lock_stat_record() */
+#define CALLER_SITE()	((vaddr_t)__builtin_return_address(0))
+
 void mutex_init(struct mutex *m)
 {
 	*m = (struct mutex)MUTEX_INITIALIZER;
@@ -23,8 +27,12 @@ void mutex_init_recursive(struct recursive_mutex *m)
 	*m = (struct recursive_mutex)RECURSIVE_MUTEX_INITIALIZER;
 }
 
-static void __mutex_lock(struct mutex *m, const char *fname, int lineno)
+static void __mutex_lock(struct mutex *m, const char *fname, int lineno,
+			 vaddr_t site)
 {
+	uint64_t wait = 0;
+	bool contended = false;
+
 	assert_have_no_spinlock();
 	assert(thread_get_id_may_fail() != THREAD_ID_INVALID);
 	assert(thread_is_in_normal_mode());
@@ -57,18 +65,27 @@ static void __mutex_lock(struct mutex *m, const char *fname, int lineno)
 		cpu_spin_unlock_xrestore(&m->spin_lock, old_itr_status);
 
 		if (!can_lock) {
+			if (!contended) {
+				contended = true;
+				wait = lock_stat_now();
+			}
 			/*
 			 * Someone else is holding the lock, wait in normal
 			 * world for the lock to become available.
 			 */
 			wq_wait_final(&m->wq, &wqe, 0, m, fname, lineno);
-		} else
+		} else {
+			if (contended)
+				wait = lock_stat_now() - wait;
+			lock_stat_record(LOCK_STAT_MUTEX, m, site, contended,
+					 wait);
 			return;
+		}
 	}
 }
 
 static void __mutex_lock_recursive(struct recursive_mutex *m, const char *fname,
-				   int lineno)
+				   int lineno, vaddr_t site)
 {
 	short int ct = thread_get_id();
 
@@ -81,7 +98,7 @@ static void __mutex_lock_recursive(struct recursive_mutex *m, const char *fname,
 		return;
 	}
 
-	__mutex_lock(&m->m, fname, lineno);
+	__mutex_lock(&m->m, fname, lineno, site);
 
 	assert(m->owner == THREAD_ID_INVALID);
 	atomic_store_short(&m->owner, ct);
@@ -170,8 +187,12 @@ static void __mutex_read_unlock(struct mutex *m, const char *fname, int lineno)
 		wq_wake_next(&m->wq, m, fname, lineno);
 }
 
-static void __mutex_read_lock(struct mutex *m, const char *fname, int lineno)
+static void __mutex_read_lock(struct mutex *m, const char *fname, int lineno,
+			      vaddr_t site)
 {
+	uint64_t wait = 0;
+	bool contended = false;
+
 	assert_have_no_spinlock();
 	assert(thread_get_id_may_fail() != THREAD_ID_INVALID);
 	assert(thread_is_in_normal_mode());
@@ -202,13 +223,22 @@ static void __mutex_read_lock(struct mutex *m, const char *fname, int lineno)
 		cpu_spin_unlock_xrestore(&m->spin_lock, old_itr_status);
 
 		if (!can_lock) {
+			if (!contended) {
+				contended = true;
+				wait = lock_stat_now();
+			}
 			/*
 			 * Someone else is holding the lock, wait in normal
 			 * world for the lock to become available.
 			 */
 			wq_wait_final(&m->wq, &wqe, 0, m, fname, lineno);
-		} else
+		} else {
+			if (contended)
+				wait = lock_stat_now() - wait;
+			lock_stat_record(LOCK_STAT_MUTEX, m, site, contended,
+					 wait);
 			return;
+		}
 	}
 }
 
@@ -241,7 +271,7 @@ void mutex_unlock_debug(struct mutex *m, const char *fname, int lineno)
 
 void mutex_lock_debug(struct mutex *m, const char *fname, int lineno)
 {
-	__mutex_lock(m, fname, lineno);
+	__mutex_lock(m, fname, lineno, CALLER_SITE());
 }
 
 bool mutex_trylock_debug(struct mutex *m, const char *fname, int lineno)
@@ -256,7 +286,7 @@ void mutex_read_unlock_debug(struct mutex *m, const char *fname, int lineno)
 
 void mutex_read_lock_debug(struct mutex *m, const char *fname, int lineno)
 {
-	__mutex_read_lock(m, fname, lineno);
+	__mutex_read_lock(m, fname, lineno, CALLER_SITE());
 }
 
 bool mutex_read_trylock_debug(struct mutex *m, const char *fname, int lineno)
@@ -273,7 +303,7 @@ void mutex_unlock_recursive_debug(struct recursive_mutex *m, const char *fname,
 void mutex_lock_recursive_debug(struct recursive_mutex *m, const char *fname,
 				int lineno)
 {
-	__mutex_lock_recursive(m, fname, lineno);
+	__mutex_lock_recursive(m, fname, lineno, CALLER_SITE());
 }
 #else
 void mutex_unlock(struct mutex *m)
@@ -288,12 +318,12 @@ void mutex_unlock_recursive(struct recursive_mutex *m)
 
 void mutex_lock(struct mutex *m)
 {
-	__mutex_lock(m, NULL, -1);
+	__mutex_lock(m, NULL, -1, CALLER_SITE());
 }
 
 void mutex_lock_recursive(struct recursive_mutex *m)
 {
-	__mutex_lock_recursive(m, NULL, -1);
+	__mutex_lock_recursive(m, NULL, -1, CALLER_SITE());
 }
 
 bool mutex_trylock(struct mutex *m)
@@ -308,7 +338,7 @@ void mutex_read_unlock(struct mutex *m)
 
 void mutex_read_lock(struct mutex *m)
 {
-	__mutex_read_lock(m, NULL, -1);
+	__mutex_read_lock(m, NULL, -1, CALLER_SITE());
 }
 
 bool mutex_read_trylock(struct mutex *m)
@@ -429,10 +459,11 @@ void condvar_broadcast(struct condvar *cv)
 
 static TEE_Result __condvar_wait_timeout(struct condvar *cv, struct mutex *m,
 					 uint32_t timeout_ms, const char *fname,
-					 int lineno)
+					 int lineno, vaddr_t site)
 {
 	TEE_Result res = TEE_SUCCESS;
 	uint32_t old_itr_status = 0;
+	uint64_t wait = 0;
 	struct wait_queue_elem wqe = { };
 	short old_state = 0;
 	short new_state = 0;
@@ -470,12 +501,15 @@ static TEE_Result __condvar_wait_timeout(struct condvar *cv, struct mutex *m,
 	if (!new_state)
 		wq_wake_next(&m->wq, m, fname, lineno);
 
+	wait = lock_stat_now();
 	res = wq_wait_final(&m->wq, &wqe, timeout_ms, m, fname, lineno);
+	lock_stat_record(LOCK_STAT_CONDVAR, cv, site, true,
+			 lock_stat_now() - wait);
 
 	if (old_state > 0)
-		mutex_read_lock(m);
+		__mutex_read_lock(m, fname, lineno, site);
 	else
-		mutex_lock(m);
+		__mutex_lock(m, fname, lineno, site);
 
 	return res;
 }
@@ -484,24 +518,26 @@ static TEE_Result __condvar_wait_timeout(struct condvar *cv, struct mutex *m,
 void condvar_wait_debug(struct condvar *cv, struct mutex *m,
 			const char *fname, int lineno)
 {
-	__condvar_wait_timeout(cv, m, 0, fname, lineno);
+	__condvar_wait_timeout(cv, m, 0, fname, lineno, CALLER_SITE());
 }
 
 TEE_Result condvar_wait_timeout_debug(struct condvar *cv, struct mutex *m,
 				      uint32_t timeout_ms, const char *fname,
 				      int lineno)
 {
-	return __condvar_wait_timeout(cv, m, timeout_ms, fname, lineno);
+	return __condvar_wait_timeout(cv, m, timeout_ms, fname, lineno,
+				      CALLER_SITE());
 }
 #else
 void condvar_wait(struct condvar *cv, struct mutex *m)
 {
-	__condvar_wait_timeout(cv, m, 0, NULL, -1);
+	__condvar_wait_timeout(cv, m, 0, NULL, -1, CALLER_SITE());
 }
 
 TEE_Result condvar_wait_timeout(struct condvar *cv, struct mutex *m,
 				uint32_t timeout_ms)
 {
-	return __condvar_wait_timeout(cv, m, timeout_ms, NULL, -1);
+	return __condvar_wait_timeout(cv, m, timeout_ms, NULL, -1,
+				      CALLER_SITE());
 }
 #endif
@@ -14,6 +14,17 @@
 #include <trace.h>
 #include <types_ext.h>
 
+/*
+ * struct notif_vm_bitmap - Asynchronous notification state of a guest
+ * @alloc_values_inited: true once @alloc_values has been initialized
+ * @values:		 pending values
+ * @alloc_values:	 allocated values
+ *
+ * A value sent again while it's still pending is coalesced into @values
+ * without raising the notification interrupt, normal world retrieves it
+ * with the other pending values. Each newly pending value raises the
+ * interrupt so a raise that was lost is made up for by the next value.
+ */
 struct notif_vm_bitmap {
 	bool alloc_values_inited;
 	bitstr_t bit_decl(values, NOTIF_ASYNC_VALUE_MAX + 1);
@@ -133,6 +144,35 @@ out:
 	return res;
 }
 
+uint64_t notif_get_values(void)
+{
+	struct guest_partition *prtn = NULL;
+	struct notif_vm_bitmap *nvb = NULL;
+	uint32_t old_itr_status = 0;
+	uint64_t res = 0;
+	size_t n = 0;
+
+	static_assert(NOTIF_ASYNC_VALUE_MAX < 64);
+
+	prtn = virt_get_current_guest();
+	nvb = get_notif_vm_bitmap(prtn);
+	if (!nvb)
+		goto out;
+
+	old_itr_status = cpu_spin_lock_xsave(&notif_default_lock);
+
+	for (n = 0; n < bitstr_size(NOTIF_ASYNC_VALUE_MAX + 1); n++) {
+		res |= (uint64_t)nvb->values[n] << (n * 8);
+		nvb->values[n] = 0;
+	}
+
+	cpu_spin_unlock_xrestore(&notif_default_lock, old_itr_status);
+out:
+	virt_put_guest(prtn);
+
+	return res;
+}
+
 void notif_send_async(uint32_t value, uint16_t guest_id)
 {
 	struct guest_partition *prtn = NULL;
@@ -149,8 +189,10 @@ void notif_send_async(uint32_t value, uint16_t guest_id)
 
 	old_itr_status = cpu_spin_lock_xsave(&notif_default_lock);
 
-	bit_set(nvb->values, value);
-	interrupt_raise_pi(itr_chip, CFG_CORE_ASYNC_NOTIF_GIC_INTID);
+	if (!bit_test(nvb->values, value)) {
+		bit_set(nvb->values, value);
+		interrupt_raise_pi(itr_chip, CFG_CORE_ASYNC_NOTIF_GIC_INTID);
+	}
 
 	cpu_spin_unlock_xrestore(&notif_default_lock, old_itr_status);
 out:
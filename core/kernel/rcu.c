@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <assert.h>
+#include <atomic.h>
+#include <kernel/misc.h>
+#include <kernel/rcu.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+
+/*
+ * struct rcu_core - read section state of a CPU
+ * @epoch:	value of @rcu_epoch when the outermost read section was
+ *		entered, 0 when outside of a read section
+ * @nesting:	read section nesting level
+ */
+struct rcu_core {
+	uint32_t epoch;
+	uint32_t nesting;
+};
+
+static struct rcu_core rcu_core[CFG_TEE_CORE_NB_CORE] __nex_bss;
+
+/* Never 0 so it can't be confused with a CPU outside a read section */
+static uint32_t rcu_epoch __nex_data = 1;
+
+static SLIST_HEAD(, rcu_head) rcu_pending __nex_data =
+	SLIST_HEAD_INITIALIZER(rcu_pending);
+static unsigned int rcu_pending_lock __nex_data = SPINLOCK_UNLOCK;
+
+uint32_t rcu_read_lock(void)
+{
+	uint32_t exceptions = thread_mask_exceptions(THREAD_EXCP_FOREIGN_INTR);
+	struct rcu_core *rc = rcu_core + get_core_pos();
+	uint32_t epoch = 0;
+
+	if (!rc->nesting++) {
+		/*
+		 * Announce the epoch and make sure that it's still
+		 * current once the announcement is visible, or a writer
+		 * could have missed it and considered this CPU to be
+		 * outside a read section.
+		 */
+		do {
+			epoch = atomic_load_u32(&rcu_epoch);
+			atomic_store_u32(&rc->epoch, epoch);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		} while (epoch != atomic_load_u32(&rcu_epoch));
+	}
+
+	return exceptions;
+}
+
+void rcu_read_unlock(uint32_t exceptions)
+{
+	struct rcu_core *rc = rcu_core + get_core_pos();
+
+	assert(rc->nesting);
+	if (!--rc->nesting)
+		__atomic_store_n(&rc->epoch, 0, __ATOMIC_RELEASE);
+
+	thread_unmask_exceptions(exceptions);
+}
+
+static bool grace_period_elapsed(uint32_t epoch)
+{
+	uint32_t e = 0;
+	size_t n = 0;
+
+	for (n = 0; n < CFG_TEE_CORE_NB_CORE; n++) {
+		e = __atomic_load_n(&rcu_core[n].epoch, __ATOMIC_ACQUIRE);
+		if (e && (int32_t)(e - epoch) < 0)
+			return false;
+	}
+
+	return true;
+}
+
+static uint32_t start_grace_period(void)
+{
+	/* Order the unlinking of elements before the new epoch */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	return atomic_inc32(&rcu_epoch);
+}
+
+void call_rcu(struct rcu_head *head, void (*func)(struct rcu_head *head))
+{
+	uint32_t exceptions = 0;
+
+	head->func = func;
+	head->epoch = start_grace_period();
+
+	exceptions = cpu_spin_lock_xsave(&rcu_pending_lock);
+	SLIST_INSERT_HEAD(&rcu_pending, head, link);
+	cpu_spin_unlock_xrestore(&rcu_pending_lock, exceptions);
+}
+
+void rcu_reclaim(void)
+{
+	SLIST_HEAD(, rcu_head) done = SLIST_HEAD_INITIALIZER(done);
+	struct rcu_head *head = NULL;
+	struct rcu_head *next = NULL;
+	uint32_t exceptions = 0;
+
+	assert(!thread_foreign_intr_disabled());
+
+	exceptions = cpu_spin_lock_xsave(&rcu_pending_lock);
+	SLIST_FOREACH_SAFE(head, &rcu_pending, link, next) {
+		if (grace_period_elapsed(head->epoch)) {
+			SLIST_REMOVE(&rcu_pending, head, rcu_head, link);
+			SLIST_INSERT_HEAD(&done, head, link);
+		}
+	}
+	cpu_spin_unlock_xrestore(&rcu_pending_lock, exceptions);
+
+	while (!SLIST_EMPTY(&done)) {
+		head = SLIST_FIRST(&done);
+		SLIST_REMOVE_HEAD(&done, link);
+		head->func(head);
+	}
+}
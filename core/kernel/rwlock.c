@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <assert.h>
+#include <atomic.h>
+#include <kernel/lockdep.h>
+#include <kernel/rwlock.h>
+#include <kernel/spinlock.h>
+#include <kernel/thread.h>
+#include <util.h>
+
+/*
+ * Layout of the lock word:
+ * Bit[31]	A writer holds the lock
+ * Bit[30]	A writer is waiting for the lock, new readers back off
+ * Bit[29:0]	Number of readers holding the lock
+ */
+#define RWLOCK_WRITER		BIT(31)
+#define RWLOCK_WRITER_WAITING	BIT(30)
+#define RWLOCK_READERS_MASK	(RWLOCK_WRITER_WAITING - 1)
+
+uint32_t cpu_read_lock_xsave(unsigned int *lock)
+{
+	uint32_t exceptions = thread_mask_exceptions(THREAD_EXCP_ALL);
+	unsigned int v = 0;
+
+	while (true) {
+		v = atomic_load_uint(lock);
+		if (v & (RWLOCK_WRITER | RWLOCK_WRITER_WAITING))
+			continue;
+		assert((v & RWLOCK_READERS_MASK) != RWLOCK_READERS_MASK);
+		if (atomic_cas_uint(lock, &v, v + 1))
+			break;
+	}
+
+	spinlock_count_incr();
+	rwlock_lock_check(lock);
+
+	return exceptions;
+}
+
+void cpu_read_unlock_xrestore(unsigned int *lock, uint32_t exceptions)
+{
+	unsigned int v = 0;
+
+	rwlock_unlock_check(lock);
+	spinlock_count_decr();
+
+	/* Order the critical section before the release of the lock */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	do {
+		v = atomic_load_uint(lock);
+		assert(v & RWLOCK_READERS_MASK);
+	} while (!atomic_cas_uint(lock, &v, v - 1));
+
+	thread_unmask_exceptions(exceptions);
+}
+
+uint32_t cpu_write_lock_xsave(unsigned int *lock)
+{
+	uint32_t exceptions = thread_mask_exceptions(THREAD_EXCP_ALL);
+	unsigned int v = 0;
+
+	while (true) {
+		v = atomic_load_uint(lock);
+		if (!(v & ~RWLOCK_WRITER_WAITING)) {
+			/* Free, take it and clear our waiting mark */
+			if (atomic_cas_uint(lock, &v, RWLOCK_WRITER))
+				break;
+		} else if (!(v & RWLOCK_WRITER_WAITING)) {
+			/* Held, stop new readers from getting in */
+			atomic_cas_uint(lock, &v, v | RWLOCK_WRITER_WAITING);
+		}
+	}
+
+	spinlock_count_incr();
+	rwlock_lock_check(lock);
+
+	return exceptions;
+}
+
+void cpu_write_unlock_xrestore(unsigned int *lock, uint32_t exceptions)
+{
+	unsigned int v = 0;
+
+	rwlock_unlock_check(lock);
+	spinlock_count_decr();
+
+	/* Order the critical section before the release of the lock */
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	do {
+		v = atomic_load_uint(lock);
+		assert(v & RWLOCK_WRITER);
+		/* Keep the waiting mark of another writer, if any */
+	} while (!atomic_cas_uint(lock, &v, v & ~RWLOCK_WRITER));
+
+	thread_unmask_exceptions(exceptions);
+}
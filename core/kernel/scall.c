@@ -117,6 +117,9 @@ static const struct syscall_entry tee_syscall_table[] = {
 	SYSCALL_ENTRY(syscall_not_supported),
 	SYSCALL_ENTRY(syscall_not_supported),
 	SYSCALL_ENTRY(syscall_cache_operation),
+	SYSCALL_ENTRY(syscall_storage_next_enum_ids),
+	SYSCALL_ENTRY(syscall_storage_begin_batch),
+	SYSCALL_ENTRY(syscall_storage_end_batch),
 };
 
 /*
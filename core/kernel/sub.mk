@@ -38,7 +38,11 @@ srcs-$(CFG_CORE_TPM_EVENT_LOG) += tpm.c
 srcs-y += initcall.c
 srcs-$(CFG_WITH_USER_TA) += user_access.c
 srcs-y += mutex.c
+srcs-y += rwlock.c
+srcs-y += rcu.c
 srcs-$(CFG_LOCKDEP) += mutex_lockdep.c
+srcs-$(CFG_LOCK_STAT) += lock_stat.c
+srcs-$(CFG_LATENCY_STATS) += latency_stats.c
 srcs-y += wait_queue.c
 srcs-y += notif.c
 srcs-$(_CFG_CORE_ASYNC_NOTIF_DEFAULT_IMPL) += notif_default.c
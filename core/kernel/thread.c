@@ -5,10 +5,14 @@
  * Copyright (c) 2020-2021, Arm Limited
  */
 
+#include <atomic.h>
 #include <config.h>
 #include <crypto/crypto.h>
+#include <initcall.h>
+#include <keep.h>
 #include <kernel/asan.h>
 #include <kernel/boot.h>
+#include <kernel/callout.h>
 #include <kernel/lockdep.h>
 #include <kernel/misc.h>
 #include <kernel/panic.h>
@@ -16,6 +20,7 @@
 #include <kernel/thread.h>
 #include <kernel/thread_private.h>
 #include <mm/mobj.h>
+#include <string.h>
 
 struct thread_ctx threads[CFG_NUM_THREADS];
 
@@ -671,7 +676,8 @@ static struct mobj *alloc_shm(enum thread_shm_type shm_type, size_t size)
 	}
 }
 
-static void clear_shm_cache_entry(struct thread_shm_cache_entry *ce)
+static void free_shm_cache_entry(struct thread_shm_cache *cache,
+				 struct thread_shm_cache_entry *ce)
 {
 	if (ce->mobj) {
 		switch (ce->type) {
@@ -688,34 +694,153 @@ static void clear_shm_cache_entry(struct thread_shm_cache_entry *ce)
 			assert(0); /* "can't happen" */
 			break;
 		}
+		cache->stats.rpc_frees++;
 	}
-	ce->mobj = NULL;
-	ce->size = 0;
+	cache->bytes_held -= ce->size;
+	SLIST_REMOVE(&cache->entries, ce, thread_shm_cache_entry, link);
+	free(ce);
 }
 
-static struct thread_shm_cache_entry *
-get_shm_cache_entry(enum thread_shm_cache_user user)
+/*
+ * Incremented periodically by a callout, buffers not used during the
+ * last two epochs are considered idle and are released at the end of
+ * the next yielding call, on any thread, instead of being kept.
+ */
+static uint32_t shm_cache_epoch __nex_bss;
+
+static uint32_t get_shm_cache_epoch(void)
 {
-	struct thread_shm_cache *cache = &threads[thread_get_id()].shm_cache;
+	return atomic_load_u32(&shm_cache_epoch);
+}
+
+#if defined(CFG_CALLOUT)
+static struct callout shm_cache_callout __nex_bss;
+
+static bool shm_cache_epoch_cb(struct callout *co __unused)
+{
+	atomic_inc32(&shm_cache_epoch);
+	return true;
+}
+DECLARE_KEEP_PAGER(shm_cache_epoch_cb);
+
+static TEE_Result init_shm_cache_epoch(void)
+{
+	callout_add(&shm_cache_callout, shm_cache_epoch_cb,
+		    CFG_THREAD_SHM_CACHE_IDLE_MS);
+	return TEE_SUCCESS;
+}
+nex_early_init(init_shm_cache_epoch);
+#endif
+
+static bool shm_cache_entry_is_idle(struct thread_shm_cache_entry *ce)
+{
+	return get_shm_cache_epoch() - ce->epoch >= 2;
+}
+
+/* Value of shm_cache_epoch when idle buffers were last collected */
+static uint32_t shm_cache_collect_epoch __nex_bss;
+
+/*
+ * Moves the idle buffers kept by free threads to @cache so they're
+ * released by the calling thread. A thread which isn't used for a while
+ * would otherwise keep its buffers until normal world disables the cache.
+ * Done at most once per epoch.
+ */
+static void collect_idle_shm_cache_entries(struct thread_shm_cache *cache)
+{
+	struct thread_shm_cache_entry *next_ce = NULL;
 	struct thread_shm_cache_entry *ce = NULL;
+	uint32_t epoch = get_shm_cache_epoch();
+	struct thread_shm_cache *c = NULL;
+	uint32_t exceptions = 0;
+	size_t n = 0;
+
+	if (atomic_load_u32(&shm_cache_collect_epoch) == epoch)
+		return;
+	atomic_store_u32(&shm_cache_collect_epoch, epoch);
 
-	SLIST_FOREACH(ce, cache, link)
-		if (ce->user == user)
-			return ce;
+	exceptions = thread_mask_exceptions(THREAD_EXCP_FOREIGN_INTR);
+	/* Free threads can't be started while the lock is held */
+	thread_lock_global();
+	for (n = 0; n < CFG_NUM_THREADS; n++) {
+		if (threads[n].state != THREAD_STATE_FREE)
+			continue;
+		c = &threads[n].shm_cache;
+		SLIST_FOREACH_SAFE(ce, &c->entries, link, next_ce) {
+			if (!shm_cache_entry_is_idle(ce))
+				continue;
+			SLIST_REMOVE(&c->entries, ce, thread_shm_cache_entry,
+				     link);
+			c->bytes_held -= ce->size;
+			SLIST_INSERT_HEAD(&cache->entries, ce, link);
+			cache->bytes_held += ce->size;
+		}
+	}
+	thread_unlock_global();
+	thread_unmask_exceptions(exceptions);
+}
 
-	ce = calloc(1, sizeof(*ce));
-	if (ce) {
-		ce->user = user;
-		SLIST_INSERT_HEAD(cache, ce, link);
+/* Sizes are rounded up to a power of two number of pages */
+static size_t get_shm_cache_size(size_t size)
+{
+	size_t num_pages = ROUNDUP2_DIV(size, SMALL_PAGE_SIZE);
+	size_t sz = SMALL_PAGE_SIZE;
+
+	while (sz / SMALL_PAGE_SIZE < num_pages)
+		sz *= 2;
+
+	return sz;
+}
+
+static struct thread_shm_cache_entry *
+find_shm_cache_entry(struct thread_shm_cache *cache,
+		     enum thread_shm_cache_user user,
+		     enum thread_shm_type shm_type, size_t size)
+{
+	struct thread_shm_cache_entry *owned = NULL;
+	struct thread_shm_cache_entry *best = NULL;
+	struct thread_shm_cache_entry *ce = NULL;
+
+	SLIST_FOREACH(ce, &cache->entries, link) {
+		if (ce->owned && ce->user == user)
+			owned = ce;
+		else if (ce->owned || ce->type != shm_type || ce->size < size)
+			continue;
+		else if (!best || ce->size < best->size)
+			best = ce;
 	}
 
-	return ce;
+	/* The buffer already owned by @user is preferred if it fits */
+	if (owned && owned->type == shm_type && owned->size >= size)
+		return owned;
+
+	/* Hand back the previous buffer of @user to the pool */
+	if (owned)
+		owned->owned = false;
+
+	return best;
+}
+
+/* Frees unowned buffers until @size more bytes fit in the budget */
+static void make_room_in_shm_cache(struct thread_shm_cache *cache,
+				   size_t size)
+{
+	struct thread_shm_cache_entry *ce = NULL;
+	struct thread_shm_cache_entry *next_ce = NULL;
+
+	SLIST_FOREACH_SAFE(ce, &cache->entries, link, next_ce) {
+		if (cache->bytes_held + size <= CFG_THREAD_SHM_CACHE_BUDGET)
+			break;
+		if (!ce->owned)
+			free_shm_cache_entry(cache, ce);
+	}
 }
 
 void *thread_rpc_shm_cache_alloc(enum thread_shm_cache_user user,
 				 enum thread_shm_type shm_type,
 				 size_t size, struct mobj **mobj)
 {
+	struct thread_shm_cache *cache = &threads[thread_get_id()].shm_cache;
 	struct thread_shm_cache_entry *ce = NULL;
 	size_t sz = size;
 	paddr_t p = 0;
@@ -724,22 +849,34 @@ void *thread_rpc_shm_cache_alloc(enum thread_shm_cache_user user,
 	if (!size)
 		return NULL;
 
-	ce = get_shm_cache_entry(user);
-	if (!ce)
-		return NULL;
-
 	/*
 	 * Always allocate in page chunks as normal world allocates payload
 	 * memory as complete pages.
 	 */
 	sz = ROUNDUP(size, SMALL_PAGE_SIZE);
 
-	if (ce->type != shm_type || sz > ce->size) {
-		clear_shm_cache_entry(ce);
+	ce = find_shm_cache_entry(cache, user, shm_type, sz);
+	if (ce) {
+		va = mobj_get_va(ce->mobj, 0, sz);
+		if (!va)
+			goto err;
+		cache->stats.hits++;
+	} else {
+		sz = get_shm_cache_size(sz);
+		make_room_in_shm_cache(cache, sz);
+
+		ce = calloc(1, sizeof(*ce));
+		if (!ce)
+			return NULL;
+		SLIST_INSERT_HEAD(&cache->entries, ce, link);
 
 		ce->mobj = alloc_shm(shm_type, sz);
 		if (!ce->mobj)
-			return NULL;
+			goto err;
+		ce->size = sz;
+		ce->type = shm_type;
+		cache->bytes_held += sz;
+		cache->stats.rpc_allocs++;
 
 		if (mobj_get_pa(ce->mobj, 0, 0, &p))
 			goto err;
@@ -750,31 +887,81 @@ void *thread_rpc_shm_cache_alloc(enum thread_shm_cache_user user,
 		va = mobj_get_va(ce->mobj, 0, sz);
 		if (!va)
 			goto err;
-
-		ce->size = sz;
-		ce->type = shm_type;
-	} else {
-		va = mobj_get_va(ce->mobj, 0, sz);
-		if (!va)
-			goto err;
 	}
+	ce->user = user;
+	ce->owned = true;
+	ce->epoch = get_shm_cache_epoch();
 	*mobj = ce->mobj;
 
 	return va;
 err:
-	clear_shm_cache_entry(ce);
+	free_shm_cache_entry(cache, ce);
 	return NULL;
 }
 
 void thread_rpc_shm_cache_clear(struct thread_shm_cache *cache)
 {
-	while (true) {
-		struct thread_shm_cache_entry *ce = SLIST_FIRST(cache);
+	while (!SLIST_EMPTY(&cache->entries))
+		free_shm_cache_entry(cache, SLIST_FIRST(&cache->entries));
+}
 
-		if (!ce)
-			break;
-		SLIST_REMOVE_HEAD(cache, link);
-		clear_shm_cache_entry(ce);
-		free(ce);
+void thread_rpc_shm_cache_trim(struct thread_shm_cache *cache, bool keep)
+{
+	struct thread_shm_cache_entry *ce = NULL;
+	struct thread_shm_cache_entry *next_ce = NULL;
+	size_t kept_bytes = 0;
+
+	if (!keep) {
+		thread_rpc_shm_cache_clear(cache);
+		return;
+	}
+
+	collect_idle_shm_cache_entries(cache);
+
+	/*
+	 * Only kernel private buffers are kept, normal world can reclaim
+	 * those at any time with OPTEE_SMC_DISABLE_SHM_CACHE while
+	 * application buffers belong to a user space process.
+	 */
+	SLIST_FOREACH_SAFE(ce, &cache->entries, link, next_ce) {
+		if (ce->type != THREAD_SHM_TYPE_KERNEL_PRIVATE ||
+		    shm_cache_entry_is_idle(ce) ||
+		    kept_bytes + ce->size > CFG_THREAD_SHM_CACHE_BUDGET) {
+			free_shm_cache_entry(cache, ce);
+		} else {
+			ce->owned = false;
+			kept_bytes += ce->size;
+		}
+	}
+}
+
+uint64_t thread_rpc_shm_cache_pop_cookie(struct thread_shm_cache *cache)
+{
+	struct thread_shm_cache_entry *ce = SLIST_FIRST(&cache->entries);
+	uint64_t cookie = 0;
+
+	if (!ce)
+		return 0;
+
+	cookie = mobj_get_cookie(ce->mobj);
+	mobj_put(ce->mobj);
+	ce->mobj = NULL;
+	free_shm_cache_entry(cache, ce);
+
+	return cookie;
+}
+
+void thread_rpc_shm_cache_get_stats(struct thread_shm_cache_stats *stats)
+{
+	size_t n = 0;
+
+	memset(stats, 0, sizeof(*stats));
+	for (n = 0; n < CFG_NUM_THREADS; n++) {
+		struct thread_shm_cache_stats *s = &threads[n].shm_cache.stats;
+
+		stats->hits += s->hits;
+		stats->rpc_allocs += s->rpc_allocs;
+		stats->rpc_frees += s->rpc_frees;
+		stats->bytes_held += threads[n].shm_cache.bytes_held;
 	}
 }
@@ -10,6 +10,7 @@
 #include <crypto/crypto.h>
 #include <initcall.h>
 #include <keep.h>
+#include <kernel/latency_stats.h>
 #include <kernel/ldelf_loader.h>
 #include <kernel/linker.h>
 #include <kernel/panic.h>
@@ -154,6 +155,7 @@ static TEE_Result user_ta_enter(struct ts_session *session,
 	struct tee_ta_session *ta_sess = to_ta_session(session);
 	struct ts_session *ts_sess __maybe_unused = NULL;
 	void *param_va[TEE_NUM_PARAMS] = { NULL };
+	uint64_t start = 0;
 
 	if (!inc_recursion()) {
 		/* Using this error code since we've run out of resources. */
@@ -182,11 +184,14 @@ static TEE_Result user_ta_enter(struct ts_session *session,
 	if (res)
 		goto out_pop_session;
 
+	start = latency_stats_now();
 	res = thread_enter_user_mode(func, kaddr_to_uref(session),
 				     (vaddr_t)usr_params, cmd, usr_stack,
 				     utc->uctx.entry_func, utc->uctx.is_32bit,
 				     &utc->ta_ctx.panicked,
 				     &utc->ta_ctx.panic_code);
+	latency_stats_record_ta(LATENCY_STATS_TA_ENTER, &session->ctx->uuid,
+				start);
 
 	thread_user_clear_vfp(&utc->uctx);
 
@@ -384,6 +389,8 @@ static void release_utc_state(struct user_ta_ctx *utc)
 	tee_obj_close_all(utc);
 	/* Free emums created by this TA */
 	tee_svc_storage_close_all_enum(utc);
+	/* Commit batches left open by this TA */
+	tee_svc_storage_end_all_batches(utc);
 }
 
 static void free_utc(struct user_ta_ctx *utc)
@@ -472,6 +479,7 @@ TEE_Result tee_ta_init_user_ta_session(const TEE_UUID *uuid,
 	TAILQ_INIT(&utc->cryp_states);
 	TAILQ_INIT(&utc->objects);
 	TAILQ_INIT(&utc->storage_enums);
+	TAILQ_INIT(&utc->storage_batches);
 	condvar_init(&utc->ta_ctx.busy_cv);
 	utc->ta_ctx.ref_count = 1;
 
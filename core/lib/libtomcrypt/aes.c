@@ -25,11 +25,16 @@ TEE_Result crypto_aes_expand_enc_key(const void *key, size_t key_len,
 	if (enc_keylen < AES_ENC_KEY_LEN)
 		return TEE_ERROR_BAD_PARAMETERS;
 
+	if (crypto_aes_key_cache_get(key, key_len, enc_key, NULL, enc_keylen,
+				     rounds))
+		return TEE_SUCCESS;
+
 	if (aes_setup(key, key_len, 0, &skey))
 		return TEE_ERROR_BAD_PARAMETERS;
 
 	memcpy(enc_key, skey.rijndael.eK, AES_ENC_KEY_LEN);
 	*rounds = skey.rijndael.Nr;
+	crypto_aes_key_cache_put(key, key_len, enc_key, NULL, *rounds);
 #endif
 	return TEE_SUCCESS;
 }
@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <assert.h>
+#include <crypto/crypto.h>
+#include <crypto/crypto_impl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string_ext.h>
+#include <tee_api_types.h>
+#include <tomcrypt_private.h>
+#include <util.h>
+
+#define CHACHAPOLY_KEY_LENGTH		32
+#define CHACHAPOLY_NONCE_LENGTH		12
+#define CHACHAPOLY_TAG_LENGTH		16
+
+struct chachapoly_state {
+	struct crypto_authenc_ctx aectx;
+	chacha20poly1305_state ctx;	/* the state as defined by LTC */
+};
+
+static const struct crypto_authenc_ops chachapoly_ops;
+
+TEE_Result
+crypto_chacha20_poly1305_alloc_ctx(struct crypto_authenc_ctx **ctx_ret)
+{
+	struct chachapoly_state *ctx = calloc(1, sizeof(*ctx));
+
+	if (!ctx)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	ctx->aectx.ops = &chachapoly_ops;
+
+	*ctx_ret = &ctx->aectx;
+	return TEE_SUCCESS;
+}
+
+static struct chachapoly_state *
+to_chachapoly_state(struct crypto_authenc_ctx *aectx)
+{
+	assert(aectx && aectx->ops == &chachapoly_ops);
+
+	return container_of(aectx, struct chachapoly_state, aectx);
+}
+
+static void chachapoly_free_ctx(struct crypto_authenc_ctx *aectx)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+
+	memzero_explicit(st, sizeof(*st));
+	free(st);
+}
+
+static void chachapoly_copy_state(struct crypto_authenc_ctx *dst_aectx,
+				  struct crypto_authenc_ctx *src_aectx)
+{
+	struct chachapoly_state *dst = to_chachapoly_state(dst_aectx);
+	struct chachapoly_state *src = to_chachapoly_state(src_aectx);
+
+	dst->ctx = src->ctx;
+}
+
+static TEE_Result chachapoly_init(struct crypto_authenc_ctx *aectx,
+				  TEE_OperationMode mode __unused,
+				  const uint8_t *key, size_t key_len,
+				  const uint8_t *nonce, size_t nonce_len,
+				  size_t tag_len, size_t aad_len __unused,
+				  size_t payload_len __unused)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+	int ltc_res = 0;
+
+	if (!key || key_len != CHACHAPOLY_KEY_LENGTH)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (nonce_len != CHACHAPOLY_NONCE_LENGTH)
+		return TEE_ERROR_BAD_PARAMETERS;
+	/* RFC 8439 only defines a 128-bit tag */
+	if (tag_len != CHACHAPOLY_TAG_LENGTH)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	memzero_explicit(&st->ctx, sizeof(st->ctx));
+
+	ltc_res = chacha20poly1305_init(&st->ctx, key, key_len);
+	if (ltc_res != CRYPT_OK)
+		return TEE_ERROR_BAD_STATE;
+
+	ltc_res = chacha20poly1305_setiv(&st->ctx, nonce, nonce_len);
+	if (ltc_res != CRYPT_OK)
+		return TEE_ERROR_BAD_STATE;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result chachapoly_update_aad(struct crypto_authenc_ctx *aectx,
+					const uint8_t *data, size_t len)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+
+	if (chacha20poly1305_add_aad(&st->ctx, data, len) != CRYPT_OK)
+		return TEE_ERROR_BAD_STATE;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Also called with @len 0 from the final functions since that pads the
+ * AAD when there was no payload.
+ */
+static TEE_Result chachapoly_update_payload(struct crypto_authenc_ctx *aectx,
+					    TEE_OperationMode mode,
+					    const uint8_t *src_data,
+					    size_t len, uint8_t *dst_data)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+	int ltc_res = 0;
+
+	if (mode == TEE_MODE_ENCRYPT)
+		ltc_res = chacha20poly1305_encrypt(&st->ctx, src_data, len,
+						   dst_data);
+	else
+		ltc_res = chacha20poly1305_decrypt(&st->ctx, src_data, len,
+						   dst_data);
+	if (ltc_res != CRYPT_OK)
+		return TEE_ERROR_BAD_STATE;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result chachapoly_enc_final(struct crypto_authenc_ctx *aectx,
+				       const uint8_t *src_data, size_t len,
+				       uint8_t *dst_data, uint8_t *dst_tag,
+				       size_t *dst_tag_len)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+	unsigned long ltc_tag_len = CHACHAPOLY_TAG_LENGTH;
+	TEE_Result res = TEE_SUCCESS;
+
+	if (*dst_tag_len < CHACHAPOLY_TAG_LENGTH) {
+		*dst_tag_len = CHACHAPOLY_TAG_LENGTH;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	res = chachapoly_update_payload(aectx, TEE_MODE_ENCRYPT, src_data, len,
+					dst_data);
+	if (res)
+		return res;
+
+	if (chacha20poly1305_done(&st->ctx, dst_tag, &ltc_tag_len) != CRYPT_OK)
+		return TEE_ERROR_BAD_STATE;
+	*dst_tag_len = ltc_tag_len;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result chachapoly_dec_final(struct crypto_authenc_ctx *aectx,
+				       const uint8_t *src_data, size_t len,
+				       uint8_t *dst_data, const uint8_t *tag,
+				       size_t tag_len)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+	uint8_t dst_tag[CHACHAPOLY_TAG_LENGTH] = { };
+	unsigned long ltc_tag_len = sizeof(dst_tag);
+	TEE_Result res = TEE_SUCCESS;
+
+	if (tag_len != CHACHAPOLY_TAG_LENGTH)
+		return TEE_ERROR_MAC_INVALID;
+
+	res = chachapoly_update_payload(aectx, TEE_MODE_DECRYPT, src_data, len,
+					dst_data);
+	if (res)
+		return res;
+
+	if (chacha20poly1305_done(&st->ctx, dst_tag, &ltc_tag_len) != CRYPT_OK)
+		return TEE_ERROR_BAD_STATE;
+
+	if (consttime_memcmp(dst_tag, tag, tag_len))
+		res = TEE_ERROR_MAC_INVALID;
+	memzero_explicit(dst_tag, sizeof(dst_tag));
+
+	return res;
+}
+
+static void chachapoly_final(struct crypto_authenc_ctx *aectx)
+{
+	struct chachapoly_state *st = to_chachapoly_state(aectx);
+
+	memzero_explicit(&st->ctx, sizeof(st->ctx));
+}
+
+static const struct crypto_authenc_ops chachapoly_ops = {
+	.init = chachapoly_init,
+	.update_aad = chachapoly_update_aad,
+	.update_payload = chachapoly_update_payload,
+	.enc_final = chachapoly_enc_final,
+	.dec_final = chachapoly_dec_final,
+	.final = chachapoly_final,
+	.free_ctx = chachapoly_free_ctx,
+	.copy_state = chachapoly_copy_state,
+};
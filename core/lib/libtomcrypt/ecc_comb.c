@@ -0,0 +1,195 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <ecc_comb.h>
+#include <stdbool.h>
+#include <string.h>
+#include <tomcrypt_private.h>
+
+static bool mp_equals_bin(void *a, const uint8_t *bin, size_t size)
+{
+	uint8_t buf[ECC_MAXSIZE] = { };
+	unsigned long n = mp_unsigned_bin_size(a);
+
+	if (n > size || size > sizeof(buf))
+		return false;
+	if (mp_to_unsigned_bin(a, buf + size - n) != CRYPT_OK)
+		return false;
+
+	return !memcmp(buf, bin, size);
+}
+
+static const struct ecc_comb_table *find_table(const ecc_point *G,
+					       void *modulus)
+{
+	const struct ecc_comb_table *t = NULL;
+	size_t n = 0;
+
+	if (mp_cmp_d(G->z, 1) != LTC_MP_EQ)
+		return NULL;
+
+	for (n = 0; n < ecc_comb_table_count; n++) {
+		t = ecc_comb_tables + n;
+		if (mp_equals_bin(modulus, t->prime, t->size) &&
+		    mp_equals_bin(G->x, t->gx, t->size) &&
+		    mp_equals_bin(G->y, t->gy, t->size))
+			return t;
+	}
+
+	return NULL;
+}
+
+/* Returns the entry index selected by column @col of the scalar @k */
+static unsigned int get_digit(const struct ecc_comb_table *t,
+			      const uint8_t *k, size_t col)
+{
+	unsigned int digit = 0;
+	size_t bit = 0;
+	size_t n = 0;
+
+	for (n = 0; n < ECC_COMB_TEETH; n++) {
+		bit = n * t->spacing + col;
+		if (bit < t->size * 8)
+			digit |= ((k[t->size - 1 - bit / 8] >> (bit % 8)) &
+				  1) << n;
+	}
+
+	return digit;
+}
+
+static int load_point(ecc_point *P, const uint8_t *bin, size_t size)
+{
+	int err = CRYPT_OK;
+
+	err = mp_read_unsigned_bin(P->x, (uint8_t *)bin, size);
+	if (err)
+		return err;
+	return mp_read_unsigned_bin(P->y, (uint8_t *)bin + size, size);
+}
+
+/*
+ * Loads entry @idx of the table into @P reading all the entries, the
+ * memory accesses don't depend on the secret scalar.
+ */
+static int select_point(const struct ecc_comb_table *t, unsigned int idx,
+			ecc_point *P, uint8_t *buf)
+{
+	size_t len = 2 * t->size;
+	uint8_t mask = 0;
+	size_t n = 0;
+	size_t m = 0;
+
+	memset(buf, 0, len);
+	for (n = 0; n < ECC_COMB_POINTS; n++) {
+		/* 0xff if n == idx, 0 otherwise */
+		mask = ((n ^ idx) - 1) >> 8;
+		for (m = 0; m < len; m++)
+			buf[m] |= t->points[n * len + m] & mask;
+	}
+
+	return load_point(P, buf, t->size);
+}
+
+/*
+ * Both supported curves have a = -3 so the point functions are passed a
+ * NULL ma, as done by ltc_ecc_mulmod() for such curves. Every column costs
+ * one doubling and one addition whatever the value of the scalar.
+ */
+static int comb_mulmod(const struct ecc_comb_table *t, void *k, ecc_point *R,
+		       void *modulus, void *mp, void *mu, int map)
+{
+	uint8_t kbuf[ECC_MAXSIZE] = { };
+	uint8_t pbuf[2 * ECC_MAXSIZE] = { };
+	ecc_point *acc = NULL;
+	ecc_point *tp = NULL;
+	size_t col = 0;
+	int err = CRYPT_MEM;
+
+	acc = ltc_ecc_new_point();
+	tp = ltc_ecc_new_point();
+	if (!acc || !tp)
+		goto out;
+
+	err = mp_to_unsigned_bin(k, kbuf + t->size - mp_unsigned_bin_size(k));
+	if (err)
+		goto out;
+
+	err = load_point(acc, t->init, t->size);
+	if (err)
+		goto out;
+	err = mp_copy(mu, acc->z);
+	if (err)
+		goto out;
+	err = mp_copy(mu, tp->z);
+	if (err)
+		goto out;
+
+	for (col = t->spacing; col > 0; col--) {
+		err = ltc_mp.ecc_ptdbl(acc, acc, NULL, modulus, mp);
+		if (err)
+			goto out;
+		err = select_point(t, get_digit(t, kbuf, col - 1), tp, pbuf);
+		if (err)
+			goto out;
+		err = ltc_mp.ecc_ptadd(acc, tp, acc, NULL, modulus, mp);
+		if (err)
+			goto out;
+	}
+
+	err = load_point(tp, t->fixup, t->size);
+	if (err)
+		goto out;
+	err = ltc_mp.ecc_ptadd(acc, tp, acc, NULL, modulus, mp);
+	if (err)
+		goto out;
+
+	err = ltc_ecc_copy_point(acc, R);
+	if (!err && map)
+		err = ltc_ecc_map(R, modulus, mp);
+out:
+	zeromem(kbuf, sizeof(kbuf));
+	zeromem(pbuf, sizeof(pbuf));
+	ltc_ecc_del_point(acc);
+	ltc_ecc_del_point(tp);
+
+	return err;
+}
+
+int ecc_comb_mulmod(void *k, const ecc_point *G, ecc_point *R, void *a,
+		    void *modulus, int map)
+{
+	const struct ecc_comb_table *t = NULL;
+	void *mp = NULL;
+	void *mu = NULL;
+	int err = CRYPT_OK;
+
+	LTC_ARGCHK(k != NULL);
+	LTC_ARGCHK(G != NULL);
+	LTC_ARGCHK(R != NULL);
+	LTC_ARGCHK(modulus != NULL);
+
+	t = find_table(G, modulus);
+	if (!t || mp_unsigned_bin_size(k) > t->size)
+		return ltc_ecc_mulmod(k, G, R, a, modulus, map);
+
+	err = mp_montgomery_setup(modulus, &mp);
+	if (err)
+		return err;
+	err = mp_init(&mu);
+	if (err)
+		goto out;
+	err = mp_montgomery_normalization(mu, modulus);
+	if (err)
+		goto out;
+
+	/* The tables are in the Montgomery domain of the math descriptor */
+	if (mp_equals_bin(mu, t->r, t->size))
+		err = comb_mulmod(t, k, R, modulus, mp, mu, map);
+	else
+		err = ltc_ecc_mulmod(k, G, R, a, modulus, map);
+out:
+	if (mu)
+		mp_clear(mu);
+	mp_montgomery_free(mp);
+
+	return err;
+}
@@ -169,11 +169,10 @@ TEE_Result crypto_sha512_alloc_ctx(struct crypto_hash_ctx **ctx)
 #endif
 
 #if defined(_CFG_CORE_LTC_SHA256)
-TEE_Result hash_sha256_check(const uint8_t *hash, const uint8_t *data,
+TEE_Result hash_sha256_compute(uint8_t *digest, const uint8_t *data,
 		size_t data_size)
 {
 	hash_state hs;
-	uint8_t digest[TEE_SHA256_HASH_SIZE];
 
 	if (sha256_init(&hs) != CRYPT_OK)
 		return TEE_ERROR_GENERIC;
@@ -181,6 +180,19 @@ TEE_Result hash_sha256_check(const uint8_t *hash, const uint8_t *data,
 		return TEE_ERROR_GENERIC;
 	if (sha256_done(&hs, digest) != CRYPT_OK)
 		return TEE_ERROR_GENERIC;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result hash_sha256_check(const uint8_t *hash, const uint8_t *data,
+		size_t data_size)
+{
+	uint8_t digest[TEE_SHA256_HASH_SIZE];
+	TEE_Result res;
+
+	res = hash_sha256_compute(digest, data, data_size);
+	if (res != TEE_SUCCESS)
+		return res;
 	if (consttime_memcmp(digest, hash, sizeof(digest)) != 0)
 		return TEE_ERROR_SECURITY;
 	return TEE_SUCCESS;
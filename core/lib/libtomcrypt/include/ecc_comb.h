@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef ECC_COMB_H_
+#define ECC_COMB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tomcrypt.h>
+#include <util.h>
+
+#define ECC_COMB_TEETH		5
+#define ECC_COMB_POINTS		BIT(ECC_COMB_TEETH)
+
+/*
+ * struct ecc_comb_table - fixed-base comb table of a curve generator
+ * @size:	size in bytes of the field elements
+ * @spacing:	number of columns of the comb, ceil(bits / ECC_COMB_TEETH)
+ * @prime:	modulus of the field
+ * @gx:		x coordinate of the generator
+ * @gy:		y coordinate of the generator
+ * @r:		Montgomery normalization value 2^(8 * @size) mod @prime
+ * @init:	offset point D, the start of the computation
+ * @fixup:	-(2^(@spacing + 1) - 1) * D, removes the accumulated offset
+ * @points:	ECC_COMB_POINTS entries, the sum of D and of
+ *		2^(j * @spacing) * G for each bit j set in the entry index
+ *
+ * All points are affine, x followed by y, with the coordinates in the
+ * Montgomery domain. The tables are generated by
+ * scripts/gen_ecc_comb_tables.py.
+ */
+struct ecc_comb_table {
+	size_t size;
+	size_t spacing;
+	const uint8_t *prime;
+	const uint8_t *gx;
+	const uint8_t *gy;
+	const uint8_t *r;
+	const uint8_t *init;
+	const uint8_t *fixup;
+	const uint8_t *points;
+};
+
+extern const struct ecc_comb_table ecc_comb_tables[];
+extern const size_t ecc_comb_table_count;
+
+/*
+ * ecc_comb_mulmod() - Computes @R = @k * @G
+ *
+ * Uses the comb tables when @G is the generator of one of the curves in
+ * ecc_comb_tables[], ltc_ecc_mulmod() otherwise. The arguments are those
+ * of ltc_ecc_mulmod().
+ */
+int ecc_comb_mulmod(void *k, const ecc_point *G, ecc_point *R, void *a,
+		    void *modulus, int map);
+
+#endif /* ECC_COMB_H_ */
@@ -8,6 +8,12 @@
 
 #if defined(_CFG_CORE_LTC_ACIPHER)
 void init_mp_tomcrypt(void);
+
+/*
+ * Computes @rr = R^2 mod @m, the Montgomery parameter used by exptmod()
+ * with the modulus @m. Returns a CRYPT_* error code.
+ */
+int mpi_get_mont_rr(void *rr, void *m);
 #else
 static inline void init_mp_tomcrypt(void) { }
 #endif
@@ -18,8 +18,17 @@
 #include <mm/tee_pager.h>
 #endif
 
-/* Size needed for xtest to pass reliably on both ARM32 and ARM64 */
-#define MPI_MEMPOOL_SIZE	(46 * 1024)
+#if defined(_CFG_CORE_LTC_ECC_COMB)
+#include <ecc_comb.h>
+#endif
+
+/*
+ * Size needed for xtest to pass reliably on both ARM32 and ARM64, for each
+ * thread using the pool at the same time, with the MBEDTLS_MPI_WINDOW_SIZE
+ * of the kernel configuration
+ */
+#define MPI_MEMPOOL_SIZE	(50 * 1024)
+#define MPI_MEMPOOL_LEASES	CFG_CORE_MEMPOOL_LEASES
 
 /* From mbedtls/library/bignum.c */
 #define ciL		(sizeof(mbedtls_mpi_uint))	/* chars in limb  */
@@ -33,19 +42,23 @@ static struct mempool *get_mp_scratch_memory_pool(void)
 	size_t size;
 	void *data;
 
-	size = ROUNDUP(MPI_MEMPOOL_SIZE, SMALL_PAGE_SIZE);
+	/* Page aligned leases let each lease release its pages */
+	size = ROUNDUP(MPI_MEMPOOL_SIZE, SMALL_PAGE_SIZE) * MPI_MEMPOOL_LEASES;
 	data = tee_pager_alloc(size);
 	if (!data)
 		panic();
 
-	return mempool_alloc_pool(data, size, tee_pager_release_phys);
+	return mempool_alloc_leased_pool(data, size, MPI_MEMPOOL_LEASES,
+					 tee_pager_release_phys);
 }
 #else /* _CFG_CORE_LTC_PAGER */
 static struct mempool *get_mp_scratch_memory_pool(void)
 {
-	static uint8_t data[MPI_MEMPOOL_SIZE] __aligned(MEMPOOL_ALIGN);
+	static uint8_t data[MPI_MEMPOOL_SIZE * MPI_MEMPOOL_LEASES]
+		__aligned(MEMPOOL_ALIGN);
 
-	return mempool_alloc_pool(data, sizeof(data), NULL);
+	return mempool_alloc_leased_pool(data, sizeof(data), MPI_MEMPOOL_LEASES,
+					 NULL);
 }
 #endif
 
@@ -563,6 +576,38 @@ static void montgomery_deinit(void *a)
 	mempool_free(mbedtls_mpi_mempool, a);
 }
 
+/*
+ * Bignums of keys are often allocated for the largest supported key size,
+ * but the Montgomery multiplications run over all the limbs of the modulus
+ * and the constant time exponentiation over all the limbs of the exponent.
+ * Use views without the leading zero limbs instead.
+ */
+static void mpi_trim_modulus(mbedtls_mpi *v, const mbedtls_mpi *m)
+{
+	*v = *m;
+	v->n = ROUNDUP_DIV(mbedtls_mpi_size(m), ciL);
+}
+
+static void mpi_trim_exponent(mbedtls_mpi *v, const mbedtls_mpi *e,
+			      const mbedtls_mpi *n)
+{
+	mbedtls_mpi_uint hi = 0;
+	size_t i = 0;
+
+	*v = *e;
+	if (e->n <= n->n)
+		return;
+
+	/*
+	 * Only the public length of the modulus decides how many limbs
+	 * are used, an exponent larger than the modulus is kept as is.
+	 */
+	for (i = n->n; i < e->n; i++)
+		hi |= e->p[i];
+	if (!hi)
+		v->n = n->n;
+}
+
 /*
  * This function calculates:
  *  d = a^b mod c
@@ -570,22 +615,36 @@ static void montgomery_deinit(void *a)
  * @a: base
  * @b: exponent
  * @c: modulus
+ * @rr: R^2 mod c from mpi_get_mont_rr() or NULL to compute it
  * @d: destination
  */
-static int exptmod(void *a, void *b, void *c, void *d)
+static int exptmod_rr(void *a, void *b, void *c, void *rr, void *d)
 {
+	mbedtls_mpi *RR = rr;
+	mbedtls_mpi N;
+	mbedtls_mpi E;
 	int res;
 
+	mpi_trim_modulus(&N, c);
+	mpi_trim_exponent(&E, b, &N);
+
+	/*
+	 * @rr may be shared with other threads, mbedtls_mpi_exp_mod() only
+	 * reads it as long as it has as many limbs as the modulus.
+	 */
+	if (RR && RR->n < N.n)
+		RR = NULL;
+
 	if (d == a || d == b || d == c) {
 		mbedtls_mpi dest;
 
 		mbedtls_mpi_init_mempool(&dest);
-		res = mbedtls_mpi_exp_mod(&dest, a, b, c, NULL);
+		res = mbedtls_mpi_exp_mod(&dest, a, &E, &N, RR);
 		if (!res)
 			res = mbedtls_mpi_copy(d, &dest);
 		mbedtls_mpi_free(&dest);
 	} else {
-		res = mbedtls_mpi_exp_mod(d, a, b, c, NULL);
+		res = mbedtls_mpi_exp_mod(d, a, &E, &N, RR);
 	}
 
 	if (res)
@@ -594,6 +653,25 @@ static int exptmod(void *a, void *b, void *c, void *d)
 		return CRYPT_OK;
 }
 
+static int exptmod(void *a, void *b, void *c, void *d)
+{
+	return exptmod_rr(a, b, c, NULL, d);
+}
+
+int mpi_get_mont_rr(void *rr, void *m)
+{
+	mbedtls_mpi N;
+
+	mpi_trim_modulus(&N, m);
+	if (mbedtls_mpi_lset(rr, 1) ||
+	    mbedtls_mpi_shift_l(rr, N.n * 2 * biL) ||
+	    mbedtls_mpi_mod_mpi(rr, rr, &N) ||
+	    mbedtls_mpi_shrink(rr, N.n))
+		return CRYPT_MEM;
+
+	return CRYPT_OK;
+}
+
 static int rng_read(void *ignored __unused, unsigned char *buf, size_t blen)
 {
 	if (crypto_rng_read(buf, blen))
@@ -675,11 +753,14 @@ ltc_math_descriptor ltc_mp = {
 	.montgomery_deinit = montgomery_deinit,
 
 	.exptmod = exptmod,
+	.exptmod_rr = exptmod_rr,
 	.isprime = isprime,
 
 #ifdef LTC_MECC
 #ifdef LTC_MECC_FP
 	.ecc_ptmul = ltc_ecc_fp_mulmod,
+#elif defined(_CFG_CORE_LTC_ECC_COMB)
+	.ecc_ptmul = ecc_comb_mulmod,
 #else
 	.ecc_ptmul = ltc_ecc_mulmod,
 #endif /* LTC_MECC_FP */
@@ -12,6 +12,7 @@
 #include <tee_api_defines_extensions.h>
 #include <tee_api_types.h>
 #include <tee/tee_cryp_utl.h>
+#include <tomcrypt_mp.h>
 #include <trace.h>
 #include <utee_defines.h>
 
@@ -163,6 +164,7 @@ void sw_crypto_acipher_free_rsa_keypair(struct rsa_keypair *s)
 {
 	if (!s)
 		return;
+	crypto_acipher_free_rsa_precomp(s);
 	crypto_bignum_free(&s->e);
 	crypto_bignum_free(&s->d);
 	crypto_bignum_free(&s->n);
@@ -194,6 +196,7 @@ TEE_Result sw_crypto_acipher_gen_rsa_key(struct rsa_keypair *key,
 		res = TEE_ERROR_BAD_PARAMETERS;
 	} else {
 		/* Copy the key */
+		crypto_acipher_free_rsa_precomp(key);
 		ltc_mp.copy(ltc_tmp_key.d,  key->d);
 		ltc_mp.copy(ltc_tmp_key.N,  key->n);
 		ltc_mp.copy(ltc_tmp_key.p,  key->p);
@@ -210,6 +213,68 @@ TEE_Result sw_crypto_acipher_gen_rsa_key(struct rsa_keypair *key,
 	return res;
 }
 
+static bool get_mont_rr(struct bignum **rr, struct bignum *m)
+{
+	return bn_alloc_max(rr) && mpi_get_mont_rr(*rr, m) == CRYPT_OK;
+}
+
+static struct rsa_precomp *get_precomp(struct rsa_keypair *key, bool crt)
+{
+	struct rsa_precomp *pc = __atomic_load_n(&key->precomp,
+						 __ATOMIC_ACQUIRE);
+
+	if (pc)
+		return pc;
+
+	pc = calloc(1, sizeof(*pc));
+	if (!pc)
+		return NULL;
+
+	if (!get_mont_rr(&pc->rr_n, key->n) ||
+	    (crt && (!get_mont_rr(&pc->rr_p, key->p) ||
+		     !get_mont_rr(&pc->rr_q, key->q)))) {
+		crypto_bignum_free(&pc->rr_n);
+		crypto_bignum_free(&pc->rr_p);
+		crypto_bignum_free(&pc->rr_q);
+		free(pc);
+		return NULL;
+	}
+
+	return crypto_acipher_publish_rsa_precomp(key, pc);
+}
+
+/*
+ * The bignums of @key are used as is while the Montgomery parameters are
+ * computed by the first private operation and kept with @key. Running out
+ * of memory for them only means that each exponentiation computes its own.
+ */
+static void populate_ltc_private_key(rsa_key *ltc_key, struct rsa_keypair *key)
+{
+	struct rsa_precomp *pc = NULL;
+	bool crt = key->p && crypto_bignum_num_bytes(key->p);
+
+	ltc_key->type = PK_PRIVATE;
+	ltc_key->e = key->e;
+	ltc_key->N = key->n;
+	ltc_key->d = key->d;
+	if (crt) {
+		ltc_key->p = key->p;
+		ltc_key->q = key->q;
+		ltc_key->qP = key->qp;
+		ltc_key->dP = key->dp;
+		ltc_key->dQ = key->dq;
+	}
+
+	pc = get_precomp(key, crt);
+	if (pc) {
+		ltc_key->RR_N = pc->rr_n;
+		if (crt) {
+			ltc_key->RR_p = pc->rr_p;
+			ltc_key->RR_q = pc->rr_q;
+		}
+	}
+}
+
 static TEE_Result rsadorep(rsa_key *ltc_key, const uint8_t *src,
 			   size_t src_len, uint8_t *dst, size_t *dst_len)
 {
@@ -306,17 +371,7 @@ TEE_Result sw_crypto_acipher_rsanopad_decrypt(struct rsa_keypair *key,
 	TEE_Result res;
 	rsa_key ltc_key = { 0, };
 
-	ltc_key.type = PK_PRIVATE;
-	ltc_key.e = key->e;
-	ltc_key.N = key->n;
-	ltc_key.d = key->d;
-	if (key->p && crypto_bignum_num_bytes(key->p)) {
-		ltc_key.p = key->p;
-		ltc_key.q = key->q;
-		ltc_key.qP = key->qp;
-		ltc_key.dP = key->dp;
-		ltc_key.dQ = key->dq;
-	}
+	populate_ltc_private_key(&ltc_key, key);
 
 	res = rsadorep(&ltc_key, src, src_len, dst, dst_len);
 	return res;
@@ -348,17 +403,7 @@ TEE_Result sw_crypto_acipher_rsaes_decrypt(uint32_t algo,
 	size_t mod_size;
 	rsa_key ltc_key = { 0, };
 
-	ltc_key.type = PK_PRIVATE;
-	ltc_key.e = key->e;
-	ltc_key.d = key->d;
-	ltc_key.N = key->n;
-	if (key->p && crypto_bignum_num_bytes(key->p)) {
-		ltc_key.p = key->p;
-		ltc_key.q = key->q;
-		ltc_key.qP = key->qp;
-		ltc_key.dP = key->dp;
-		ltc_key.dQ = key->dq;
-	}
+	populate_ltc_private_key(&ltc_key, key);
 
 	/* Get the algorithm */
 	res = tee_algo_to_ltc_hashindex(algo, &ltc_hashindex);
@@ -537,17 +582,7 @@ TEE_Result sw_crypto_acipher_rsassa_sign(uint32_t algo, struct rsa_keypair *key,
 	unsigned long ltc_sig_len;
 	rsa_key ltc_key = { 0, };
 
-	ltc_key.type = PK_PRIVATE;
-	ltc_key.e = key->e;
-	ltc_key.N = key->n;
-	ltc_key.d = key->d;
-	if (key->p && crypto_bignum_num_bytes(key->p)) {
-		ltc_key.p = key->p;
-		ltc_key.q = key->q;
-		ltc_key.qP = key->qp;
-		ltc_key.dP = key->dp;
-		ltc_key.dQ = key->dq;
-	}
+	populate_ltc_private_key(&ltc_key, key);
 
 	switch (algo) {
 	case TEE_ALG_RSASSA_PKCS1_V1_5:
@@ -505,6 +505,18 @@ typedef struct {
       @return CRYPT_OK on success
    */
    int (*rand)(void *a, int size);
+
+/* ---- optional ---- */
+
+   /** Modular exponentiation with a precomputed Montgomery parameter
+       @param a    The base integer
+       @param b    The power integer
+       @param c    The modulus integer
+       @param rr   R^2 mod c of the Montgomery representation used
+       @param d    The destination
+       @return CRYPT_OK on success
+   */
+   int (*exptmod_rr)(void *a, void *b, void *c, void *rr, void *d);
 } ltc_math_descriptor;
 
 extern ltc_math_descriptor ltc_mp;
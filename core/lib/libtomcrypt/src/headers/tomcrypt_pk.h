@@ -42,6 +42,12 @@ typedef struct Rsa_key {
     void *dP;
     /** The d mod (q - 1) CRT param */
     void *dQ;
+    /** Optional R^2 mod N Montgomery param, not owned by the key */
+    void *RR_N;
+    /** Optional R^2 mod p Montgomery param, not owned by the key */
+    void *RR_p;
+    /** Optional R^2 mod q Montgomery param, not owned by the key */
+    void *RR_q;
 } rsa_key;
 
 int rsa_make_key(prng_state *prng, int wprng, int size, long e, rsa_key *key);
@@ -79,7 +79,7 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
       }
 
       /* rnd = rnd^e */
-      err = mp_exptmod( rnd, key->e, key->N, rnd);
+      err = mp_exptmod_rr( rnd, key->e, key->N, key->RR_N, rnd);
       if (err != CRYPT_OK) {
              goto error;
       }
@@ -102,13 +102,13 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
           * In case CRT optimization parameters are not provided,
           * the private key is directly used to exptmod it
           */
-         if ((err = mp_exptmod(tmp, key->d, key->N, tmp)) != CRYPT_OK)                              { goto error; }
+         if ((err = mp_exptmod_rr(tmp, key->d, key->N, key->RR_N, tmp)) != CRYPT_OK)                 { goto error; }
       } else {
          /* tmpa = tmp^dP mod p */
-         if ((err = mp_exptmod(tmp, key->dP, key->p, tmpa)) != CRYPT_OK)                            { goto error; }
+         if ((err = mp_exptmod_rr(tmp, key->dP, key->p, key->RR_p, tmpa)) != CRYPT_OK)               { goto error; }
 
          /* tmpb = tmp^dQ mod q */
-         if ((err = mp_exptmod(tmp, key->dQ, key->q, tmpb)) != CRYPT_OK)                            { goto error; }
+         if ((err = mp_exptmod_rr(tmp, key->dQ, key->q, key->RR_q, tmpb)) != CRYPT_OK)               { goto error; }
 
          /* tmp = (tmpa - tmpb) * qInv (mod p) */
          if ((err = mp_sub(tmpa, tmpb, tmp)) != CRYPT_OK)                                           { goto error; }
@@ -129,14 +129,14 @@ int rsa_exptmod(const unsigned char *in,   unsigned long inlen,
 
       #ifdef LTC_RSA_CRT_HARDENING
       if (has_crt_parameters) {
-         if ((err = mp_exptmod(tmp, key->e, key->N, tmpa)) != CRYPT_OK)                              { goto error; }
+         if ((err = mp_exptmod_rr(tmp, key->e, key->N, key->RR_N, tmpa)) != CRYPT_OK)                 { goto error; }
          if ((err = mp_read_unsigned_bin(tmpb, (unsigned char *)in, (int)inlen)) != CRYPT_OK)        { goto error; }
          if (mp_cmp(tmpa, tmpb) != LTC_MP_EQ)                                     { err = CRYPT_ERROR; goto error; }
       }
       #endif
    } else {
       /* exptmod it */
-      if ((err = mp_exptmod(tmp, key->e, key->N, tmp)) != CRYPT_OK)                                { goto error; }
+      if ((err = mp_exptmod_rr(tmp, key->e, key->N, key->RR_N, tmp)) != CRYPT_OK)                   { goto error; }
    }
 
    /* read it back */
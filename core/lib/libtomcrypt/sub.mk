@@ -88,6 +88,28 @@ endif
 srcs-$(_CFG_CORE_LTC_GCM) += src/encauth/gcm/gcm_process.c
 srcs-$(_CFG_CORE_LTC_GCM) += src/encauth/gcm/gcm_reset.c
 
+cppflags-lib-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += -DLTC_CHACHA
+cppflags-lib-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += -DLTC_POLY1305
+cppflags-lib-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += -DLTC_CHACHA20POLY1305_MODE
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += chachapoly.c
+ifeq ($(_CFG_CORE_LTC_CHACHA20_ACCEL),y)
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += chacha_accel.c
+else
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/stream/chacha/chacha_crypt.c
+endif
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/stream/chacha/chacha_done.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/stream/chacha/chacha_ivctr32.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/stream/chacha/chacha_ivctr64.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/stream/chacha/chacha_keystream.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/stream/chacha/chacha_setup.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/mac/poly1305/poly1305.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/encauth/chachapoly/chacha20poly1305_add_aad.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/encauth/chachapoly/chacha20poly1305_decrypt.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/encauth/chachapoly/chacha20poly1305_done.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/encauth/chachapoly/chacha20poly1305_encrypt.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/encauth/chachapoly/chacha20poly1305_init.c
+srcs-$(_CFG_CORE_LTC_CHACHA20_POLY1305) += src/encauth/chachapoly/chacha20poly1305_setiv.c
+
 srcs-$(_CFG_CORE_LTC_HASH) += hash.c
 srcs-$(_CFG_CORE_LTC_HASH) += src/hashes/helper/hash_memory.c
 srcs-$(_CFG_CORE_LTC_HASH) += src/hashes/helper/hash_memory_multi.c
@@ -340,6 +362,15 @@ srcs-$(_CFG_CORE_LTC_ECC) += src/pk/ecc/ltc_ecc_points.c
 srcs-$(_CFG_CORE_LTC_ECC) += src/pk/ecc/ltc_ecc_projective_add_point.c
 srcs-$(_CFG_CORE_LTC_ECC) += src/pk/ecc/ltc_ecc_projective_dbl_point.c
 
+ifeq ($(_CFG_CORE_LTC_ECC_COMB),y)
+srcs-y += ecc_comb.c
+gensrcs-y += ecc_comb_tables
+produce-ecc_comb_tables = ecc_comb_tables.c
+depends-ecc_comb_tables = scripts/gen_ecc_comb_tables.py
+recipe-ecc_comb_tables = $(PYTHON3) scripts/gen_ecc_comb_tables.py \
+			 --out $(sub-dir-out)/ecc_comb_tables.c
+endif
+
 ifneq (,$(filter y,$(_CFG_CORE_LTC_SM2_DSA) $(_CFG_CORE_LTC_SM2_PKE)))
    cppflags-lib-y += -DLTC_ECC_SM2
 endif
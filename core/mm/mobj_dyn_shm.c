@@ -9,6 +9,7 @@
 #include <kernel/linker.h>
 #include <kernel/mutex.h>
 #include <kernel/panic.h>
+#include <kernel/rcu.h>
 #include <kernel/refcount.h>
 #include <kernel/spinlock.h>
 #include <mm/core_mmu.h>
@@ -31,6 +32,7 @@ static size_t shm_release_waiters;
 struct mobj_reg_shm {
 	struct mobj mobj;
 	SLIST_ENTRY(mobj_reg_shm) next;
+	struct rcu_head rcu;
 	uint64_t cookie;
 	tee_mm_entry_t *mm;
 	paddr_t page_offset;
@@ -52,6 +54,10 @@ static size_t mobj_reg_shm_size(size_t nr_pages)
 	return s;
 }
 
+/*
+ * Modifications of reg_shm_list are protected by reg_shm_slist_lock while
+ * lookups by cookie are done locklessly in an RCU read section.
+ */
 static SLIST_HEAD(reg_shm_head, mobj_reg_shm) reg_shm_list =
 	SLIST_HEAD_INITIALIZER(reg_shm_head);
 
@@ -118,6 +124,11 @@ static void reg_shm_unmap_helper(struct mobj_reg_shm *r)
 	r->mm = NULL;
 }
 
+static void reg_shm_free_rcu(struct rcu_head *head)
+{
+	free(container_of(head, struct mobj_reg_shm, rcu));
+}
+
 static void reg_shm_free_helper(struct mobj_reg_shm *mobj_reg_shm)
 {
 	uint32_t exceptions = cpu_spin_lock_xsave(&reg_shm_map_lock);
@@ -128,7 +139,8 @@ static void reg_shm_free_helper(struct mobj_reg_shm *mobj_reg_shm)
 	cpu_spin_unlock_xrestore(&reg_shm_map_lock, exceptions);
 
 	SLIST_REMOVE(&reg_shm_list, mobj_reg_shm, mobj_reg_shm, next);
-	free(mobj_reg_shm);
+	/* Lockless readers may still be looking at the element */
+	call_rcu(&mobj_reg_shm->rcu, reg_shm_free_rcu);
 }
 
 static void mobj_reg_shm_free(struct mobj *mobj)
@@ -336,7 +348,7 @@ struct mobj *mobj_reg_shm_alloc(paddr_t *pages, size_t num_pages,
 	}
 
 	exceptions = cpu_spin_lock_xsave(&reg_shm_slist_lock);
-	SLIST_INSERT_HEAD(&reg_shm_list, mobj_reg_shm, next);
+	SLIST_INSERT_HEAD_RCU(&reg_shm_list, mobj_reg_shm, next);
 	cpu_spin_unlock_xrestore(&reg_shm_slist_lock, exceptions);
 
 	return &mobj_reg_shm->mobj;
@@ -370,11 +382,16 @@ struct mobj *mobj_reg_shm_get_by_cookie(uint64_t cookie)
 	uint32_t exceptions = 0;
 	struct mobj *m = NULL;
 
-	exceptions = cpu_spin_lock_xsave(&reg_shm_slist_lock);
-	r = reg_shm_find_unlocked(cookie);
-	if (r)
-		m = mobj_get(&r->mobj);
-	cpu_spin_unlock_xrestore(&reg_shm_slist_lock, exceptions);
+	exceptions = rcu_read_lock();
+	SLIST_FOREACH_RCU(r, &reg_shm_list, next) {
+		if (r->cookie == cookie) {
+			/* A zero refcount means that r is being freed */
+			if (refcount_inc(&r->mobj.refc))
+				m = &r->mobj;
+			break;
+		}
+	}
+	rcu_read_unlock(exceptions);
 
 	return m;
 }
@@ -3,10 +3,14 @@
  * Copyright (c) 2015, Linaro Limited
  */
 #include <compiler.h>
+#include <crypto/crypto_impl.h>
 #include <drivers/clk.h>
 #include <drivers/regulator.h>
+#include <kernel/latency_stats.h>
+#include <kernel/lock_stat.h>
 #include <kernel/pseudo_ta.h>
 #include <kernel/tee_time.h>
+#include <kernel/thread.h>
 #include <malloc.h>
 #include <mm/phys_mem.h>
 #include <mm/tee_mm.h>
@@ -17,6 +21,7 @@
 #include <tee_api_types.h>
 #include <tee/tee_fs.h>
 #include <trace.h>
+#include <util.h>
 
 static TEE_Result get_alloc_stats(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
 {
@@ -219,6 +224,182 @@ static TEE_Result print_driver_info(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
 	return TEE_SUCCESS;
 }
 
+static TEE_Result get_rpc_shm_cache_stats(uint32_t type,
+					  TEE_Param p[TEE_NUM_PARAMS])
+{
+	struct thread_shm_cache_stats stats = { };
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	thread_rpc_shm_cache_get_stats(&stats);
+	p[0].value.a = stats.hits;
+	p[0].value.b = stats.rpc_allocs;
+	p[1].value.a = stats.rpc_frees;
+	p[1].value.b = stats.bytes_held;
+
+	return TEE_SUCCESS;
+}
+
+#ifdef CFG_LOCK_STAT
+static TEE_Result get_lock_stats(uint32_t type, TEE_Param p[TEE_NUM_PARAMS])
+{
+	struct pta_stats_lock *out = NULL;
+	struct lock_stat *stats = NULL;
+	uint64_t dropped = 0;
+	size_t count = 0;
+	size_t size = 0;
+	size_t n = 0;
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INOUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_NONE) != type)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (p[0].value.a & ~STATS_LOCK_RESET)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	stats = calloc(lock_stat_max_count(), sizeof(*stats));
+	if (!stats)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	count = lock_stat_get(stats, &dropped);
+	size = count * sizeof(*out);
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		free(stats);
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	out = p[1].memref.buffer;
+	for (n = 0; n < count; n++) {
+		out[n] = (struct pta_stats_lock){
+			.lock = stats[n].lock,
+			.site = stats[n].site,
+			.type = stats[n].type,
+			.acquired = stats[n].acquired,
+			.contended = stats[n].contended,
+			.max_wait = stats[n].max_wait,
+			.total_wait = stats[n].total_wait,
+		};
+	}
+	free(stats);
+
+	if (p[0].value.a & STATS_LOCK_RESET)
+		lock_stat_reset();
+
+	p[0].value.a = count;
+	p[0].value.b = delay_cnt_freq();
+	p[1].memref.size = size;
+	p[2].value.a = MIN(dropped, (uint64_t)UINT32_MAX);
+	p[2].value.b = 0;
+
+	return TEE_SUCCESS;
+}
+#else
+static TEE_Result get_lock_stats(uint32_t type __unused,
+				 TEE_Param p[TEE_NUM_PARAMS] __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
+#endif
+
+#ifdef CFG_LATENCY_STATS
+static TEE_Result get_latency_stats(uint32_t type,
+				    TEE_Param p[TEE_NUM_PARAMS])
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t size = 0;
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INOUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (p[0].value.a & ~STATS_LATENCY_RESET)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	size = p[1].memref.size;
+	res = latency_stats_get(p[1].memref.buffer, &size);
+	p[1].memref.size = size;
+	if (res)
+		return res;
+
+	if (p[0].value.a & STATS_LATENCY_RESET)
+		latency_stats_reset();
+
+	p[0].value.a = size / sizeof(struct pta_stats_latency);
+	p[0].value.b = delay_cnt_freq();
+
+	return TEE_SUCCESS;
+}
+#else
+static TEE_Result get_latency_stats(uint32_t type __unused,
+				    TEE_Param p[TEE_NUM_PARAMS] __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
+#endif
+
+#ifdef CFG_CRYPTO_DRV_DISPATCH
+static TEE_Result get_crypto_dispatch_stats(uint32_t type,
+					    TEE_Param p[TEE_NUM_PARAMS])
+{
+	struct pta_stats_crypto_dispatch *out = NULL;
+	struct drvcrypt_dispatch_stat *stats = NULL;
+	size_t count = 0;
+	size_t size = 0;
+	size_t n = 0;
+
+	if (TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_OUTPUT,
+			    TEE_PARAM_TYPE_MEMREF_OUTPUT,
+			    TEE_PARAM_TYPE_NONE,
+			    TEE_PARAM_TYPE_NONE) != type)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	count = drvcrypt_dispatch_get_stats(NULL, 0);
+	size = count * sizeof(*out);
+	if (p[1].memref.size < size) {
+		p[1].memref.size = size;
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+
+	stats = calloc(count, sizeof(*stats));
+	if (count && !stats)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	count = drvcrypt_dispatch_get_stats(stats, count);
+
+	out = p[1].memref.buffer;
+	for (n = 0; n < count; n++) {
+		out[n] = (struct pta_stats_crypto_dispatch){
+			.algo = stats[n].algo,
+			.threshold = stats[n].threshold,
+			.sw_count = stats[n].sw_count,
+			.drv_count = stats[n].drv_count,
+		};
+	}
+	free(stats);
+
+	p[0].value.a = count;
+	p[0].value.b = 0;
+	p[1].memref.size = size;
+
+	return TEE_SUCCESS;
+}
+#else
+static TEE_Result get_crypto_dispatch_stats(uint32_t type __unused,
+					    TEE_Param p[TEE_NUM_PARAMS] __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
+#endif
+
 /*
  * Trusted Application Entry Points
  */
@@ -240,6 +421,14 @@ static TEE_Result invoke_command(void *psess __unused,
 		return get_system_time(ptypes, params);
 	case STATS_CMD_PRINT_DRIVER_INFO:
 		return print_driver_info(ptypes, params);
+	case STATS_CMD_RPC_SHM_CACHE_STATS:
+		return get_rpc_shm_cache_stats(ptypes, params);
+	case STATS_CMD_LOCK_STATS:
+		return get_lock_stats(ptypes, params);
+	case STATS_CMD_LATENCY_STATS:
+		return get_latency_stats(ptypes, params);
+	case STATS_CMD_CRYPTO_DISPATCH_STATS:
+		return get_crypto_dispatch_stats(ptypes, params);
 	default:
 		break;
 	}
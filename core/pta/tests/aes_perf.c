@@ -49,16 +49,42 @@ static void free_ctx(void **ctx, uint32_t algo)
 	*ctx = NULL;
 }
 
-static TEE_Result init_ctx(void **ctx, uint32_t algo, TEE_OperationMode mode,
-			   size_t key_size_bits, size_t payload_len)
+static TEE_Result init_key(void *ctx, uint32_t algo, TEE_OperationMode mode,
+			   size_t key_len, size_t payload_len)
 {
-	TEE_Result res = TEE_SUCCESS;
 	const uint8_t *key2 = NULL;
 	const uint8_t *iv = NULL;
 	size_t key2_len = 0;
-	size_t key_len = 0;
 	size_t iv_len = 0;
 
+	switch (algo) {
+	case TEE_ALG_AES_XTS:
+		key2 = aes_key2;
+		key2_len = key_len;
+		fallthrough;
+	case TEE_ALG_AES_CBC_NOPAD:
+	case TEE_ALG_AES_CTR:
+		iv = aes_iv;
+		iv_len = sizeof(aes_iv);
+		fallthrough;
+	case TEE_ALG_AES_ECB_NOPAD:
+		return crypto_cipher_init(ctx, mode, aes_key, key_len, key2,
+					  key2_len, iv, iv_len);
+	case TEE_ALG_AES_GCM:
+		return crypto_authenc_init(ctx, mode, aes_key, key_len, aes_iv,
+					   sizeof(aes_iv), TEE_AES_BLOCK_SIZE,
+					   0, payload_len);
+	default:
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+}
+
+static TEE_Result init_ctx(void **ctx, uint32_t algo, TEE_OperationMode mode,
+			   size_t key_size_bits, size_t payload_len)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t key_len = 0;
+
 	if (key_size_bits % 8)
 		return TEE_ERROR_BAD_PARAMETERS;
 	key_len = key_size_bits / 8;
@@ -68,9 +94,6 @@ static TEE_Result init_ctx(void **ctx, uint32_t algo, TEE_OperationMode mode,
 	/* Alloc ctx */
 	switch (algo) {
 	case TEE_ALG_AES_XTS:
-		key2_len = key_len;
-		key2 = aes_key2;
-		fallthrough;
 	case TEE_ALG_AES_ECB_NOPAD:
 	case TEE_ALG_AES_CBC_NOPAD:
 	case TEE_ALG_AES_CTR:
@@ -85,27 +108,7 @@ static TEE_Result init_ctx(void **ctx, uint32_t algo, TEE_OperationMode mode,
 	if (res)
 		return res;
 
-	/* Init ctx */
-	switch (algo) {
-	case TEE_ALG_AES_CBC_NOPAD:
-	case TEE_ALG_AES_CTR:
-	case TEE_ALG_AES_XTS:
-		iv = aes_iv;
-		iv_len = sizeof(aes_iv);
-		fallthrough;
-	case TEE_ALG_AES_ECB_NOPAD:
-		res = crypto_cipher_init(*ctx, mode, aes_key, key_len, key2,
-					 key2_len, iv, iv_len);
-		break;
-	case TEE_ALG_AES_GCM:
-		res = crypto_authenc_init(*ctx, mode, aes_key, key_len, aes_iv,
-					  sizeof(aes_iv), TEE_AES_BLOCK_SIZE,
-					  0, payload_len);
-		break;
-	default:
-		return TEE_ERROR_BAD_PARAMETERS;
-	}
-
+	res = init_key(*ctx, algo, mode, key_len, payload_len);
 	if (res)
 		free_ctx(ctx, algo);
 
@@ -157,6 +160,24 @@ static TEE_Result do_update(void *ctx, uint32_t algo, TEE_OperationMode mode,
 	return res;
 }
 
+static uint32_t get_algo(uint32_t aes_mode)
+{
+	switch (aes_mode) {
+	case PTA_INVOKE_TESTS_AES_ECB:
+		return TEE_ALG_AES_ECB_NOPAD;
+	case PTA_INVOKE_TESTS_AES_CBC:
+		return TEE_ALG_AES_CBC_NOPAD;
+	case PTA_INVOKE_TESTS_AES_CTR:
+		return TEE_ALG_AES_CTR;
+	case PTA_INVOKE_TESTS_AES_XTS:
+		return TEE_ALG_AES_XTS;
+	case PTA_INVOKE_TESTS_AES_GCM:
+		return TEE_ALG_AES_GCM;
+	default:
+		return 0;
+	}
+}
+
 TEE_Result core_aes_perf_tests(uint32_t param_types,
 			       TEE_Param params[TEE_NUM_PARAMS])
 {
@@ -175,25 +196,9 @@ TEE_Result core_aes_perf_tests(uint32_t param_types,
 	if (param_types != exp_param_types)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	switch (params[0].value.b) {
-	case PTA_INVOKE_TESTS_AES_ECB:
-		algo = TEE_ALG_AES_ECB_NOPAD;
-		break;
-	case PTA_INVOKE_TESTS_AES_CBC:
-		algo = TEE_ALG_AES_CBC_NOPAD;
-		break;
-	case PTA_INVOKE_TESTS_AES_CTR:
-		algo = TEE_ALG_AES_CTR;
-		break;
-	case PTA_INVOKE_TESTS_AES_XTS:
-		algo = TEE_ALG_AES_XTS;
-		break;
-	case PTA_INVOKE_TESTS_AES_GCM:
-		algo = TEE_ALG_AES_GCM;
-		break;
-	default:
+	algo = get_algo(params[0].value.b);
+	if (!algo)
 		return TEE_ERROR_BAD_PARAMETERS;
-	}
 
 	if (params[0].value.a >> 16)
 		mode = TEE_MODE_DECRYPT;
@@ -219,3 +224,82 @@ TEE_Result core_aes_perf_tests(uint32_t param_types,
 	free_ctx(&ctx, algo);
 	return res;
 }
+
+/*
+ * Each operation initializes the context with the key, processes one
+ * message of AES_INIT_PERF_MSG_LEN bytes and finalizes the context, as
+ * done by a TA handling short messages with the same key object.
+ */
+#define AES_INIT_PERF_MSG_LEN	64
+
+static TEE_Result do_init_perf(void *ctx, uint32_t algo,
+			       TEE_OperationMode mode, size_t key_len,
+			       unsigned int rep_count,
+			       struct crypto_aes_key_cache **cache)
+{
+	uint8_t out[AES_INIT_PERF_MSG_LEN] = { };
+	uint8_t in[AES_INIT_PERF_MSG_LEN] = { };
+	TEE_Result res = TEE_SUCCESS;
+	unsigned int n = 0;
+
+	for (n = 0; n < rep_count; n++) {
+		crypto_aes_key_cache_enter(cache, aes_key, key_len);
+		res = init_key(ctx, algo, mode, key_len, sizeof(in));
+		crypto_aes_key_cache_exit();
+		if (res)
+			return res;
+
+		if (algo == TEE_ALG_AES_GCM) {
+			res = update_ae(ctx, mode, in, sizeof(in), out);
+			crypto_authenc_final(ctx);
+		} else {
+			res = update_cipher(ctx, mode, in, sizeof(in), out);
+			crypto_cipher_final(ctx);
+		}
+		if (res)
+			return res;
+	}
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result core_aes_init_perf_tests(uint32_t param_types,
+				    TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint32_t exp_param_types = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_VALUE_INPUT,
+						   TEE_PARAM_TYPE_NONE,
+						   TEE_PARAM_TYPE_NONE);
+	struct crypto_aes_key_cache *cache = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	TEE_OperationMode mode = 0;
+	size_t key_size_bits = 0;
+	uint32_t algo = 0;
+	void *ctx = NULL;
+
+	if (param_types != exp_param_types)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	algo = get_algo(params[0].value.b);
+	if (!algo)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (params[0].value.a >> 16)
+		mode = TEE_MODE_DECRYPT;
+	else
+		mode = TEE_MODE_ENCRYPT;
+
+	key_size_bits = params[0].value.a & 0xffff;
+
+	res = init_ctx(&ctx, algo, mode, key_size_bits, AES_INIT_PERF_MSG_LEN);
+	if (res)
+		return res;
+
+	res = do_init_perf(ctx, algo, mode, key_size_bits / 8,
+			   params[1].value.a,
+			   params[1].value.b ? NULL : &cache);
+
+	free_ctx(&ctx, algo);
+	crypto_aes_key_cache_free(&cache);
+	return res;
+}
@@ -0,0 +1,638 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <compiler.h>
+#include <config.h>
+#include <crypto/crypto.h>
+#include <crypto/crypto_impl.h>
+#include <kernel/delay.h>
+#include <malloc.h>
+#include <pta_invoke_tests.h>
+#include <string.h>
+#include <tee/tee_cryp_hkdf.h>
+#include <tee/tee_cryp_pbkdf2.h>
+#include <tee_api_defines.h>
+#include <tee_api_defines_extensions.h>
+#include <tee_api_types.h>
+#include <trace.h>
+#include <types_ext.h>
+#include <utee_defines.h>
+#include <util.h>
+
+#include "misc.h"
+#include "perf_key.h"
+
+/* Largest symmetric key, two 256-bit keys for AES XTS */
+#define CRYPTO_PERF_MAX_KEY_SIZE	64
+#define CRYPTO_PERF_NONCE_SIZE		12
+#define CRYPTO_PERF_TAG_SIZE		16
+#define CRYPTO_PERF_MAX_SIG_SIZE	(CFG_CORE_BIGNUM_MAX_BITS / 8)
+
+/*
+ * Parameters of an invocation
+ *
+ * @algo        TEE_ALG_* identifier
+ * @size        Message size, output size for HKDF or iteration count for
+ *              PBKDF2
+ * @count       Number of operations
+ * @key_bits    Key size in bits
+ * @decrypt     Decrypt or verify instead of encrypt or sign
+ * @sw          Bypass the crypto drivers
+ * @src         Message
+ * @dst         Output of the operations, @size bytes
+ * @res         Measurements
+ */
+struct crypto_perf {
+	uint32_t algo;
+	size_t size;
+	unsigned int count;
+	size_t key_bits;
+	bool decrypt;
+	bool sw;
+	uint8_t *src;
+	uint8_t *dst;
+	struct pta_invoke_tests_crypto_perf *res;
+};
+
+static const uint8_t crypto_perf_key_data[CRYPTO_PERF_MAX_KEY_SIZE] = {
+	[0 ... CRYPTO_PERF_MAX_KEY_SIZE - 1] = 0x5a
+};
+static const uint8_t crypto_perf_nonce[CRYPTO_PERF_NONCE_SIZE];
+
+static void account(struct crypto_perf *p, uint64_t start)
+{
+	uint64_t ticks = delay_cnt_read() - start;
+
+	if (!p->res->count || ticks < p->res->min)
+		p->res->min = ticks;
+	if (ticks > p->res->max)
+		p->res->max = ticks;
+	p->res->total += ticks;
+	p->res->count++;
+}
+
+/* Report whether @ops, the ops of the context used, are the driver ones */
+static void check_driver(struct crypto_perf *p, const void *ops,
+			 const void *sw_ops)
+{
+	if (ops != sw_ops)
+		p->res->impl |= PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_DRIVER;
+}
+
+static size_t default_key_bits(uint32_t algo)
+{
+	switch (TEE_ALG_GET_MAIN_ALG(algo)) {
+	case TEE_MAIN_ALGO_DES:
+		return 64;
+	case TEE_MAIN_ALGO_DES3:
+		return 192;
+	case TEE_MAIN_ALGO_RSA:
+		return 2048;
+	case TEE_MAIN_ALGO_AES:
+	case TEE_MAIN_ALGO_SM4:
+		return 128;
+	default:
+		/* HMAC, ChaCha20, EC curves and KDF secrets */
+		return 256;
+	}
+}
+
+static TEE_Result hash_perf(struct crypto_perf *p)
+{
+	size_t digest_len = TEE_ALG_GET_DIGEST_SIZE(p->algo);
+	struct crypto_hash_ctx *sw_ctx = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t start = 0;
+	void *ctx = NULL;
+	unsigned int n = 0;
+
+	/* Extendable-output functions aren't covered */
+	if (!digest_len)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	res = crypto_sw_hash_alloc_ctx(&sw_ctx, p->algo);
+	if (res)
+		return res;
+
+	if (p->sw) {
+		ctx = sw_ctx;
+	} else {
+		res = crypto_hash_alloc_ctx(&ctx, p->algo);
+		if (!res)
+			check_driver(p, ((struct crypto_hash_ctx *)ctx)->ops,
+				     sw_ctx->ops);
+		crypto_hash_free_ctx(sw_ctx);
+		if (res)
+			return res;
+	}
+
+	for (n = 0; n < p->count; n++) {
+		start = delay_cnt_read();
+		res = crypto_hash_init(ctx);
+		if (!res)
+			res = crypto_hash_update(ctx, p->src, p->size);
+		if (!res)
+			res = crypto_hash_final(ctx, p->dst, digest_len);
+		if (res)
+			break;
+		account(p, start);
+	}
+
+	crypto_hash_free_ctx(ctx);
+	return res;
+}
+
+static TEE_Result mac_perf(struct crypto_perf *p)
+{
+	size_t digest_len = TEE_ALG_GET_DIGEST_SIZE(p->algo);
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t start = 0;
+	void *ctx = NULL;
+	unsigned int n = 0;
+
+	if (p->sw || !digest_len)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	res = crypto_mac_alloc_ctx(&ctx, p->algo);
+	if (res)
+		return res;
+
+	for (n = 0; n < p->count; n++) {
+		start = delay_cnt_read();
+		res = crypto_mac_init(ctx, crypto_perf_key_data,
+				      p->key_bits / 8);
+		if (!res)
+			res = crypto_mac_update(ctx, p->src, p->size);
+		if (!res)
+			res = crypto_mac_final(ctx, p->dst, digest_len);
+		if (res)
+			break;
+		account(p, start);
+	}
+
+	crypto_mac_free_ctx(ctx);
+	return res;
+}
+
+static TEE_Result cipher_perf(struct crypto_perf *p)
+{
+	TEE_OperationMode mode = TEE_MODE_ENCRYPT;
+	struct crypto_cipher_ctx *sw_ctx = NULL;
+	uint8_t iv[TEE_AES_BLOCK_SIZE] = { };
+	const uint8_t *key2 = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t key_len = p->key_bits / 8;
+	size_t iv_len = 0;
+	uint64_t start = 0;
+	void *ctx = NULL;
+	unsigned int n = 0;
+
+	if (p->decrypt)
+		mode = TEE_MODE_DECRYPT;
+
+	if (TEE_ALG_GET_CHAIN_MODE(p->algo) != TEE_CHAIN_MODE_ECB_NOPAD) {
+		res = crypto_cipher_get_block_size(p->algo, &iv_len);
+		if (res)
+			return res;
+	}
+	if (p->algo == TEE_ALG_AES_XTS) {
+		if (2 * key_len > sizeof(crypto_perf_key_data))
+			return TEE_ERROR_BAD_PARAMETERS;
+		key2 = crypto_perf_key_data + key_len;
+	}
+
+	res = crypto_sw_cipher_alloc_ctx(&sw_ctx, p->algo);
+	if (res)
+		return res;
+
+	if (p->sw) {
+		ctx = sw_ctx;
+	} else {
+		res = crypto_cipher_alloc_ctx(&ctx, p->algo);
+		if (!res)
+			check_driver(p, ((struct crypto_cipher_ctx *)ctx)->ops,
+				     sw_ctx->ops);
+		crypto_cipher_free_ctx(sw_ctx);
+		if (res)
+			return res;
+	}
+
+	for (n = 0; n < p->count; n++) {
+		start = delay_cnt_read();
+		res = crypto_cipher_init(ctx, mode, crypto_perf_key_data,
+					 key_len, key2, key2 ? key_len : 0, iv,
+					 iv_len);
+		if (!res)
+			res = crypto_cipher_update(ctx, mode, true, p->src,
+						   p->size, p->dst);
+		crypto_cipher_final(ctx);
+		if (res)
+			break;
+		account(p, start);
+	}
+
+	crypto_cipher_free_ctx(ctx);
+	return res;
+}
+
+static TEE_Result authenc_init(struct crypto_perf *p, void *ctx,
+			       TEE_OperationMode mode)
+{
+	return crypto_authenc_init(ctx, mode, crypto_perf_key_data,
+				   p->key_bits / 8, crypto_perf_nonce,
+				   sizeof(crypto_perf_nonce),
+				   CRYPTO_PERF_TAG_SIZE, 0, p->size);
+}
+
+static TEE_Result authenc_perf(struct crypto_perf *p)
+{
+	uint8_t tag[CRYPTO_PERF_TAG_SIZE] = { };
+	size_t tag_len = sizeof(tag);
+	TEE_Result res = TEE_SUCCESS;
+	size_t dst_len = 0;
+	uint64_t start = 0;
+	void *ctx = NULL;
+	unsigned int n = 0;
+
+	if (p->sw)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	res = crypto_authenc_alloc_ctx(&ctx, p->algo);
+	if (res)
+		return res;
+
+	/*
+	 * Decryption needs the tag of the message, the message is replaced
+	 * by its ciphertext.
+	 */
+	if (p->decrypt) {
+		dst_len = p->size;
+		res = authenc_init(p, ctx, TEE_MODE_ENCRYPT);
+		if (!res)
+			res = crypto_authenc_enc_final(ctx, p->src, p->size,
+						       p->src, &dst_len, tag,
+						       &tag_len);
+		crypto_authenc_final(ctx);
+		if (res)
+			goto out;
+	}
+
+	for (n = 0; n < p->count; n++) {
+		dst_len = p->size;
+		start = delay_cnt_read();
+		if (p->decrypt) {
+			res = authenc_init(p, ctx, TEE_MODE_DECRYPT);
+			if (!res)
+				res = crypto_authenc_dec_final(ctx, p->src,
+							       p->size, p->dst,
+							       &dst_len, tag,
+							       tag_len);
+		} else {
+			tag_len = sizeof(tag);
+			res = authenc_init(p, ctx, TEE_MODE_ENCRYPT);
+			if (!res)
+				res = crypto_authenc_enc_final(ctx, p->src,
+							       p->size, p->dst,
+							       &dst_len, tag,
+							       &tag_len);
+		}
+		crypto_authenc_final(ctx);
+		if (res)
+			break;
+		account(p, start);
+	}
+out:
+	crypto_authenc_free_ctx(ctx);
+	return res;
+}
+
+/* Public key of @k, a copy of the public values is needed for the ops */
+static TEE_Result get_ecc_public_key(struct crypto_perf *p,
+				     struct perf_key *k,
+				     struct ecc_public_key *pk)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	res = crypto_acipher_alloc_ecc_public_key(pk,
+						  TEE_ALG_GET_KEY_TYPE(p->algo,
+								       false),
+						  k->key_bits);
+	if (res)
+		return res;
+
+	crypto_bignum_copy(pk->x, k->ecc.x);
+	crypto_bignum_copy(pk->y, k->ecc.y);
+	pk->curve = k->ecc.curve;
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result sign(struct crypto_perf *p, struct perf_key *k,
+		       const uint8_t *msg, size_t msg_len, uint8_t *sig,
+		       size_t *sig_len)
+{
+	switch (TEE_ALG_GET_MAIN_ALG(p->algo)) {
+	case TEE_MAIN_ALGO_RSA:
+		return crypto_acipher_rsassa_sign(p->algo, &k->rsa, -1, msg,
+						  msg_len, sig, sig_len);
+	case TEE_MAIN_ALGO_ED25519:
+		return crypto_acipher_ed25519_sign(&k->ed25519, msg, msg_len,
+						   sig, sig_len);
+	default:
+		return crypto_acipher_ecc_sign(p->algo, &k->ecc, msg, msg_len,
+					       sig, sig_len);
+	}
+}
+
+static TEE_Result verify_perf(struct crypto_perf *p, struct perf_key *k,
+			      const uint8_t *msg, size_t msg_len,
+			      uint8_t *sig, size_t sig_len)
+{
+	uint32_t main_algo = TEE_ALG_GET_MAIN_ALG(p->algo);
+	struct ed25519_public_key ed25519_pk = { };
+	struct rsa_public_key rsa_pk = { };
+	struct ecc_public_key ecc_pk = { };
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t start = 0;
+	unsigned int n = 0;
+
+	/* Only the member of the union matching the algorithm is valid */
+	switch (main_algo) {
+	case TEE_MAIN_ALGO_RSA:
+		rsa_pk.e = k->rsa.e;
+		rsa_pk.n = k->rsa.n;
+		break;
+	case TEE_MAIN_ALGO_ED25519:
+		ed25519_pk.pub = k->ed25519.pub;
+		ed25519_pk.curve = k->ed25519.curve;
+		break;
+	default:
+		res = get_ecc_public_key(p, k, &ecc_pk);
+		if (res)
+			return res;
+		break;
+	}
+
+	for (n = 0; n < p->count; n++) {
+		start = delay_cnt_read();
+		if (main_algo == TEE_MAIN_ALGO_RSA)
+			res = crypto_acipher_rsassa_verify(p->algo, &rsa_pk, -1,
+							   msg, msg_len, sig,
+							   sig_len);
+		else if (main_algo == TEE_MAIN_ALGO_ED25519)
+			res = crypto_acipher_ed25519_verify(&ed25519_pk, msg,
+							    msg_len, sig,
+							    sig_len);
+		else
+			res = crypto_acipher_ecc_verify(p->algo, &ecc_pk, msg,
+							msg_len, sig, sig_len);
+		if (res)
+			break;
+		account(p, start);
+	}
+
+	if (ecc_pk.x)
+		crypto_acipher_free_ecc_public_key(&ecc_pk);
+	return res;
+}
+
+static TEE_Result sign_perf(struct crypto_perf *p)
+{
+	struct perf_key *k = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t msg_len = p->size;
+	uint32_t hash_algo = 0;
+	uint8_t *sig = NULL;
+	size_t sig_len = 0;
+	uint64_t start = 0;
+	unsigned int n = 0;
+
+	if (p->sw)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	/* Everything but EdDSA signs a digest */
+	if (TEE_ALG_GET_MAIN_ALG(p->algo) != TEE_MAIN_ALGO_ED25519) {
+		hash_algo = TEE_DIGEST_HASH_TO_ALGO(p->algo);
+		msg_len = TEE_ALG_GET_DIGEST_SIZE(hash_algo);
+		if (!msg_len)
+			return TEE_ERROR_NOT_SUPPORTED;
+	}
+
+	res = perf_key_get(TEE_ALG_GET_KEY_TYPE(p->algo, true), p->key_bits,
+			   &k);
+	if (res)
+		return res;
+
+	sig = malloc(CRYPTO_PERF_MAX_SIG_SIZE);
+	if (!sig)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	if (p->decrypt) {
+		sig_len = CRYPTO_PERF_MAX_SIG_SIZE;
+		res = sign(p, k, p->src, msg_len, sig, &sig_len);
+		if (!res)
+			res = verify_perf(p, k, p->src, msg_len, sig, sig_len);
+		goto out;
+	}
+
+	for (n = 0; n < p->count; n++) {
+		sig_len = CRYPTO_PERF_MAX_SIG_SIZE;
+		start = delay_cnt_read();
+		res = sign(p, k, p->src, msg_len, sig, &sig_len);
+		if (res)
+			break;
+		account(p, start);
+	}
+out:
+	free(sig);
+	return res;
+}
+
+static TEE_Result shared_secret_perf(struct crypto_perf *p)
+{
+	unsigned long secret_len = 0;
+	struct ecc_public_key pk = { };
+	struct perf_key *k = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t start = 0;
+	unsigned int n = 0;
+
+	res = perf_key_get(TEE_ALG_GET_KEY_TYPE(p->algo, true), p->key_bits,
+			   &k);
+	if (res)
+		return res;
+
+	/* The peer is the key itself, that costs the same */
+	if (p->algo == TEE_ALG_ECDH_DERIVE_SHARED_SECRET) {
+		res = get_ecc_public_key(p, k, &pk);
+		if (res)
+			return res;
+	}
+
+	for (n = 0; n < p->count; n++) {
+		secret_len = CRYPTO_PERF_MAX_SIG_SIZE;
+		start = delay_cnt_read();
+		if (p->algo == TEE_ALG_X25519)
+			res = crypto_acipher_x25519_shared_secret(&k->x25519,
+								  k->x25519.pub,
+								  p->dst,
+								  &secret_len);
+		else
+			res = crypto_acipher_ecc_shared_secret(&k->ecc, &pk,
+							       p->dst,
+							       &secret_len);
+		if (res)
+			break;
+		account(p, start);
+	}
+
+	if (pk.x)
+		crypto_acipher_free_ecc_public_key(&pk);
+	return res;
+}
+
+static TEE_Result kdf_perf(struct crypto_perf *p)
+{
+	TEE_Result res = TEE_ERROR_NOT_SUPPORTED;
+	uint64_t start = 0;
+	unsigned int n = 0;
+
+	for (n = 0; n < p->count; n++) {
+		start = delay_cnt_read();
+		switch (TEE_ALG_GET_MAIN_ALG(p->algo)) {
+#if defined(CFG_CRYPTO_HKDF)
+		case TEE_MAIN_ALGO_HKDF:
+			res = tee_cryp_hkdf(TEE_ALG_GET_DIGEST_HASH(p->algo),
+					    crypto_perf_key_data,
+					    p->key_bits / 8, p->src,
+					    TEE_SHA256_HASH_SIZE, NULL, 0,
+					    p->dst, p->size);
+			break;
+#endif
+#if defined(CFG_CRYPTO_PBKDF2)
+		case TEE_MAIN_ALGO_PBKDF2:
+			res = tee_cryp_pbkdf2(TEE_ALG_GET_DIGEST_HASH(p->algo),
+					      crypto_perf_key_data,
+					      p->key_bits / 8, p->src,
+					      TEE_SHA256_HASH_SIZE, p->size,
+					      p->dst, TEE_SHA256_HASH_SIZE);
+			break;
+#endif
+		default:
+			break;
+		}
+		if (res)
+			break;
+		account(p, start);
+	}
+
+	return res;
+}
+
+static TEE_Result key_derivation_perf(struct crypto_perf *p)
+{
+	if (p->sw)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	switch (TEE_ALG_GET_MAIN_ALG(p->algo)) {
+	case TEE_MAIN_ALGO_ECDH:
+	case TEE_MAIN_ALGO_X25519:
+		return shared_secret_perf(p);
+	case TEE_MAIN_ALGO_HKDF:
+	case TEE_MAIN_ALGO_PBKDF2:
+		/* Secret and salt are taken from the key data and message */
+		if (p->key_bits > 8 * CRYPTO_PERF_MAX_KEY_SIZE)
+			return TEE_ERROR_BAD_PARAMETERS;
+		return kdf_perf(p);
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+}
+
+static TEE_Result run_perf(struct crypto_perf *p)
+{
+	switch (TEE_ALG_GET_CLASS(p->algo)) {
+	case TEE_OPERATION_DIGEST:
+		return hash_perf(p);
+	case TEE_OPERATION_MAC:
+		return mac_perf(p);
+	case TEE_OPERATION_CIPHER:
+		return cipher_perf(p);
+	case TEE_OPERATION_AE:
+		return authenc_perf(p);
+	case TEE_OPERATION_ASYMMETRIC_SIGNATURE:
+		return sign_perf(p);
+	case TEE_OPERATION_KEY_DERIVATION:
+		return key_derivation_perf(p);
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+}
+
+TEE_Result core_crypto_perf_tests(uint32_t param_types,
+				  TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+					  TEE_PARAM_TYPE_VALUE_INPUT,
+					  TEE_PARAM_TYPE_MEMREF_OUTPUT,
+					  TEE_PARAM_TYPE_NONE);
+	struct pta_invoke_tests_crypto_perf res_perf = { };
+	struct crypto_perf p = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t buf_size = CRYPTO_PERF_MAX_SIG_SIZE;
+	uint32_t flags = 0;
+
+	if (param_types != exp_pt)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (params[2].memref.size < sizeof(res_perf)) {
+		params[2].memref.size = sizeof(res_perf);
+		return TEE_ERROR_SHORT_BUFFER;
+	}
+	if (!params[2].memref.buffer)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	flags = params[1].value.b >> 16;
+	p = (struct crypto_perf){
+		.algo = params[0].value.a,
+		.size = params[0].value.b,
+		.count = params[1].value.a,
+		.key_bits = params[1].value.b & 0xffff,
+		.decrypt = flags & PTA_INVOKE_TESTS_CRYPTO_PERF_DECRYPT,
+		.sw = flags & PTA_INVOKE_TESTS_CRYPTO_PERF_SW,
+		.res = &res_perf,
+	};
+	if (!p.key_bits)
+		p.key_bits = default_key_bits(p.algo);
+	if (p.key_bits % 8 && p.key_bits != 521)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (TEE_ALG_GET_CLASS(p.algo) != TEE_OPERATION_ASYMMETRIC_SIGNATURE &&
+	    TEE_ALG_GET_CLASS(p.algo) != TEE_OPERATION_KEY_DERIVATION &&
+	    p.key_bits > 8 * CRYPTO_PERF_MAX_KEY_SIZE)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	/* Fits signatures and shared secrets whatever the message size */
+	if (TEE_ALG_GET_MAIN_ALG(p.algo) != TEE_MAIN_ALGO_PBKDF2)
+		buf_size = MAX(buf_size, p.size);
+	p.src = malloc(buf_size);
+	p.dst = malloc(buf_size);
+	if (!p.src || !p.dst) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+		goto out;
+	}
+	memset(p.src, 0x5a, buf_size);
+
+	if (IS_ENABLED(CFG_CRYPTOLIB_NAME_tomcrypt))
+		res_perf.impl |= PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_TOMCRYPT;
+	if (IS_ENABLED(CFG_CRYPTOLIB_NAME_mbedtls))
+		res_perf.impl |= PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_MBEDTLS;
+	res_perf.freq = delay_cnt_freq();
+
+	res = run_perf(&p);
+	if (!res)
+		memcpy(params[2].memref.buffer, &res_perf, sizeof(res_perf));
+	params[2].memref.size = sizeof(res_perf);
+out:
+	free(p.src);
+	free(p.dst);
+	return res;
+}
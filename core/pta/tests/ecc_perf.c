@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <compiler.h>
+#include <crypto/crypto.h>
+#include <malloc.h>
+#include <pta_invoke_tests.h>
+#include <tee_api_defines.h>
+#include <tee_api_types.h>
+#include <trace.h>
+#include <types_ext.h>
+#include <utee_defines.h>
+#include <util.h>
+
+#include "misc.h"
+#include "perf_key.h"
+
+struct ecc_perf_curve {
+	uint32_t curve;
+	size_t key_size_bits;
+	uint32_t sign_algo;
+	size_t digest_len;
+};
+
+static const struct ecc_perf_curve ecc_perf_curves[] = {
+	{
+		.curve = TEE_ECC_CURVE_NIST_P256,
+		.key_size_bits = 256,
+		.sign_algo = TEE_ALG_ECDSA_SHA256,
+		.digest_len = TEE_SHA256_HASH_SIZE,
+	},
+	{
+		.curve = TEE_ECC_CURVE_NIST_P384,
+		.key_size_bits = 384,
+		.sign_algo = TEE_ALG_ECDSA_SHA384,
+		.digest_len = TEE_SHA384_HASH_SIZE,
+	},
+};
+
+static const struct ecc_perf_curve *find_curve(uint32_t curve)
+{
+	size_t n = 0;
+
+	for (n = 0; n < ARRAY_SIZE(ecc_perf_curves); n++)
+		if (ecc_perf_curves[n].curve == curve)
+			return ecc_perf_curves + n;
+
+	return NULL;
+}
+
+static TEE_Result alloc_key(const struct ecc_perf_curve *c,
+			    struct ecc_keypair *key)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	res = crypto_acipher_alloc_ecc_keypair(key, TEE_TYPE_ECDSA_KEYPAIR,
+					       c->key_size_bits);
+	if (res)
+		return res;
+	key->curve = c->curve;
+
+	return TEE_SUCCESS;
+}
+
+static void free_key(struct ecc_keypair *key)
+{
+	crypto_bignum_free(&key->d);
+	crypto_bignum_free(&key->x);
+	crypto_bignum_free(&key->y);
+}
+
+static TEE_Result sign_perf(const struct ecc_perf_curve *c,
+			    unsigned int rep_count)
+{
+	uint8_t digest[TEE_SHA384_HASH_SIZE] = { };
+	uint8_t sig[2 * TEE_SHA384_HASH_SIZE] = { };
+	struct perf_key *k = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t sig_len = 0;
+	unsigned int n = 0;
+
+	res = perf_key_get(TEE_TYPE_ECDSA_KEYPAIR, c->key_size_bits, &k);
+	if (res)
+		return res;
+
+	for (n = 0; n < rep_count; n++) {
+		digest[0] = n;
+		sig_len = sizeof(sig);
+		res = crypto_acipher_ecc_sign(c->sign_algo, &k->ecc, digest,
+					      c->digest_len, sig, &sig_len);
+		if (res)
+			break;
+	}
+
+	return res;
+}
+
+static TEE_Result keygen_perf(const struct ecc_perf_curve *c,
+			      unsigned int rep_count)
+{
+	struct ecc_keypair key = { };
+	TEE_Result res = TEE_SUCCESS;
+	unsigned int n = 0;
+
+	res = alloc_key(c, &key);
+	if (res)
+		return res;
+
+	for (n = 0; n < rep_count; n++) {
+		res = crypto_acipher_gen_ecc_key(&key, c->key_size_bits);
+		if (res)
+			break;
+	}
+
+	free_key(&key);
+	return res;
+}
+
+TEE_Result core_ecc_perf_tests(uint32_t param_types,
+			       TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+					  TEE_PARAM_TYPE_NONE,
+					  TEE_PARAM_TYPE_NONE,
+					  TEE_PARAM_TYPE_NONE);
+	uint32_t exp_pt_op = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+					     TEE_PARAM_TYPE_VALUE_INPUT,
+					     TEE_PARAM_TYPE_NONE,
+					     TEE_PARAM_TYPE_NONE);
+	const struct ecc_perf_curve *c = NULL;
+	uint32_t op = PTA_INVOKE_TESTS_ECC_PERF_SIGN;
+
+	if (param_types == exp_pt_op)
+		op = params[1].value.a;
+	else if (param_types != exp_pt)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	c = find_curve(params[0].value.a);
+	if (!c)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	switch (op) {
+	case PTA_INVOKE_TESTS_ECC_PERF_SIGN:
+		return sign_perf(c, params[0].value.b);
+	case PTA_INVOKE_TESTS_ECC_PERF_KEYGEN:
+		return keygen_perf(c, params[0].value.b);
+	default:
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+}
@@ -7,7 +7,9 @@
 #include <kernel/ts_manager.h>
 #include <string.h>
 #include <tee/fs_htree.h>
+#include <tee/tee_fs.h>
 #include <tee/tee_fs_rpc.h>
+#include <tee/tee_pobj.h>
 #include <trace.h>
 #include <types_ext.h>
 #include <util.h>
@@ -259,6 +261,7 @@ static TEE_Result htree_test_rewrite(struct test_aux *aux, size_t num_blocks,
 	TEE_Result res = TEE_SUCCESS;
 	struct tee_fs_htree *ht = NULL;
 	size_t salt = 23;
+	struct tee_fs_htree_format fmt = { .version = TEE_FS_HTREE_FORMAT_V1 };
 	uint8_t hash[TEE_FS_HTREE_HASH_SIZE] = { 0 };
 
 	assert((w_unsync_begin + w_unsync_num) <= num_blocks);
@@ -266,7 +269,8 @@ static TEE_Result htree_test_rewrite(struct test_aux *aux, size_t num_blocks,
 	aux->data_len = 0;
 	memset(aux->data, 0xce, aux->data_alloced);
 
-	res = tee_fs_htree_open(true, hash, 0, uuid, &test_htree_ops, aux, &ht);
+	res = tee_fs_htree_open(true, hash, 0, uuid, &test_htree_ops, aux,
+				&fmt, &ht);
 	CHECK_RES(res, goto out);
 
 	/*
@@ -316,7 +320,7 @@ static TEE_Result htree_test_rewrite(struct test_aux *aux, size_t num_blocks,
 	 */
 	tee_fs_htree_close(&ht);
 	res = tee_fs_htree_open(false, hash, 0, uuid, &test_htree_ops, aux,
-				&ht);
+				&fmt, &ht);
 	CHECK_RES(res, goto out);
 
 	/*
@@ -365,7 +369,7 @@ static TEE_Result htree_test_rewrite(struct test_aux *aux, size_t num_blocks,
 	 */
 	tee_fs_htree_close(&ht);
 	res = tee_fs_htree_open(false, hash, 0, uuid, &test_htree_ops, aux,
-				&ht);
+				&fmt, &ht);
 	CHECK_RES(res, goto out);
 
 	res = do_range(read_block, &ht, 0, num_blocks, salt);
@@ -378,7 +382,7 @@ static TEE_Result htree_test_rewrite(struct test_aux *aux, size_t num_blocks,
 	 */
 	tee_fs_htree_close(&ht);
 	res = tee_fs_htree_open(false, NULL, 0, uuid, &test_htree_ops, aux,
-				&ht);
+				&fmt, &ht);
 	CHECK_RES(res, goto out);
 
 	res = do_range(read_block, &ht, 0, num_blocks, salt);
@@ -472,6 +476,7 @@ static TEE_Result test_corrupt_type(const TEE_UUID *uuid, uint8_t *hash,
 {
 	TEE_Result res = TEE_SUCCESS;
 	struct test_aux aux2 = *aux;
+	struct tee_fs_htree_format fmt = { .version = TEE_FS_HTREE_FORMAT_V1 };
 	struct tee_fs_htree *ht = NULL;
 	size_t offs = 0;
 	size_t size = 0;
@@ -502,7 +507,7 @@ static TEE_Result test_corrupt_type(const TEE_UUID *uuid, uint8_t *hash,
 		 * actually read by do_range(read_block)
 		 */
 		res = tee_fs_htree_open(false, hash, 0, uuid, &test_htree_ops,
-					&aux2, &ht);
+					&aux2, &fmt, &ht);
 		if (!res) {
 			res = do_range(read_block, &ht, 0, num_blocks, 1);
 			/*
@@ -563,6 +568,7 @@ static TEE_Result test_corrupt(size_t num_blocks)
 	struct tee_fs_htree *ht = NULL;
 	uint8_t hash[TEE_FS_HTREE_HASH_SIZE] = { 0 };
 	struct test_aux *aux = NULL;
+	struct tee_fs_htree_format fmt = { .version = TEE_FS_HTREE_FORMAT_V1 };
 	size_t n = 0;
 
 	aux = aux_alloc(num_blocks);
@@ -575,7 +581,8 @@ static TEE_Result test_corrupt(size_t num_blocks)
 	memset(aux->data, 0xce, aux->data_alloced);
 
 	/* Write the object and close it */
-	res = tee_fs_htree_open(true, hash, 0, uuid, &test_htree_ops, aux, &ht);
+	res = tee_fs_htree_open(true, hash, 0, uuid, &test_htree_ops, aux,
+				&fmt, &ht);
 	CHECK_RES(res, goto out);
 	res = do_range(write_block, &ht, 0, num_blocks, 1);
 	CHECK_RES(res, goto out);
@@ -585,7 +592,7 @@ static TEE_Result test_corrupt(size_t num_blocks)
 
 	/* Verify that the object can be read correctly */
 	res = tee_fs_htree_open(false, hash, 0, uuid, &test_htree_ops, aux,
-				&ht);
+				&fmt, &ht);
 	CHECK_RES(res, goto out);
 	res = do_range(read_block, &ht, 0, num_blocks, 1);
 	CHECK_RES(res, goto out);
@@ -611,6 +618,90 @@ out:
 	return res;
 }
 
+static TEE_Result expect_res(TEE_Result res, TEE_Result expected)
+{
+	if (res == expected)
+		return TEE_SUCCESS;
+
+	EMSG("error: res = %#" PRIx32 ", expected %#" PRIx32, res, expected);
+	return TEE_ERROR_GENERIC;
+}
+
+/*
+ * Begins a REE FS batch twice and discards its pending updates by failing
+ * a create, both ends of the batch must report the discard. The pending
+ * updates of the batches of other TAs are discarded too.
+ */
+static TEE_Result test_batch_discard(void)
+{
+	static const char obj_id[] = "fs_htree_batch_discard";
+	const struct tee_file_operations *fops = &ree_fs_ops;
+	struct ts_session *sess = ts_get_current_session();
+	struct tee_pobj po = {
+		.uuid = sess->ctx->uuid,
+		.obj_id = (void *)obj_id,
+		.obj_id_len = sizeof(obj_id),
+		.fops = fops,
+	};
+	struct tee_file_handle *fh2 = NULL;
+	struct tee_file_handle *fh = NULL;
+	uint8_t data[16] = { 0 };
+	size_t len = sizeof(data);
+	TEE_Result res = TEE_SUCCESS;
+	size_t batch_refs = 0;
+	size_t size = 0;
+
+	/* May be left by an earlier failed run */
+	fops->remove(&po);
+
+	for (batch_refs = 0; batch_refs < 2; batch_refs++) {
+		res = fops->begin_batch(&po.uuid);
+		CHECK_RES(res, goto out);
+	}
+
+	res = fops->create(&po, false, NULL, 0, NULL, 0, data, NULL,
+			   sizeof(data), &fh);
+	CHECK_RES(res, goto out);
+
+	/* Creating it again fails and discards the pending updates */
+	res = fops->create(&po, false, NULL, 0, NULL, 0, data, NULL,
+			   sizeof(data), &fh2);
+	res = expect_res(res, TEE_ERROR_ACCESS_CONFLICT);
+	CHECK_RES(res, goto out);
+
+	/* The file of the handle was removed with the pending updates */
+	res = fops->read(fh, 0, data, NULL, &len);
+	res = expect_res(res, TEE_ERROR_BAD_STATE);
+	CHECK_RES(res, goto out);
+
+	while (batch_refs) {
+		batch_refs--;
+		res = fops->end_batch(&po.uuid);
+		res = expect_res(res, TEE_ERROR_BAD_STATE);
+		CHECK_RES(res, goto out);
+	}
+
+	/* A new batch doesn't inherit the discard */
+	res = fops->begin_batch(&po.uuid);
+	CHECK_RES(res, goto out);
+	res = fops->end_batch(&po.uuid);
+	CHECK_RES(res, goto out);
+
+	res = fops->open(&po, &size, &fh2);
+	if (!res)
+		fops->close(&fh2);
+	res = expect_res(res, TEE_ERROR_ITEM_NOT_FOUND);
+	CHECK_RES(res, goto out);
+
+out:
+	while (batch_refs) {
+		batch_refs--;
+		fops->end_batch(&po.uuid);
+	}
+	fops->close(&fh);
+	return res;
+}
+
 TEE_Result core_fs_htree_tests(uint32_t nParamTypes,
 			       TEE_Param pParams[TEE_NUM_PARAMS] __unused)
 {
@@ -623,5 +714,9 @@ TEE_Result core_fs_htree_tests(uint32_t nParamTypes,
 	if (res)
 		return res;
 
-	return test_corrupt(5);
+	res = test_corrupt(5);
+	if (res)
+		return res;
+
+	return test_batch_discard();
 }
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <compiler.h>
+#include <crypto/crypto.h>
+#include <malloc.h>
+#include <pta_invoke_tests.h>
+#include <string.h>
+#include <tee_api_defines.h>
+#include <tee_api_types.h>
+#include <trace.h>
+#include <types_ext.h>
+#include <utee_defines.h>
+#include <util.h>
+
+#include "misc.h"
+
+#define HASH_PERF_MAX_BATCH	16
+
+TEE_Result core_hash_mb_perf_tests(uint32_t param_types,
+				   TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+					  TEE_PARAM_TYPE_VALUE_INPUT,
+					  TEE_PARAM_TYPE_NONE,
+					  TEE_PARAM_TYPE_NONE);
+	struct crypto_hash_mb_msg msgs[HASH_PERF_MAX_BATCH] = { };
+	uint8_t digests[HASH_PERF_MAX_BATCH][TEE_SHA512_HASH_SIZE] = { };
+	TEE_Result res = TEE_SUCCESS;
+	unsigned int rep_count = 0;
+	size_t msg_size = 0;
+	size_t batch = 0;
+	uint32_t algo = 0;
+	size_t buf_size = 0;
+	uint8_t *buf = NULL;
+	unsigned int n = 0;
+	size_t m = 0;
+
+	if (param_types != exp_pt)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	algo = params[0].value.a;
+	batch = params[0].value.b;
+	rep_count = params[1].value.a;
+	msg_size = params[1].value.b;
+
+	if (algo != TEE_ALG_SHA256 && algo != TEE_ALG_SHA512)
+		return TEE_ERROR_NOT_SUPPORTED;
+	if (!batch || batch > HASH_PERF_MAX_BATCH || !msg_size ||
+	    MUL_OVERFLOW(batch, msg_size, &buf_size))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	buf = malloc(buf_size);
+	if (!buf)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	memset(buf, 0x5a, buf_size);
+
+	for (m = 0; m < batch; m++) {
+		msgs[m].data = buf + m * msg_size;
+		msgs[m].len = msg_size;
+		msgs[m].digest = digests[m];
+	}
+
+	for (n = 0; n < rep_count; n++) {
+		res = crypto_hash_mb(algo, msgs, batch);
+		if (res)
+			break;
+	}
+
+	free(buf);
+	return res;
+}
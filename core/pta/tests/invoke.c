@@ -433,6 +433,16 @@ static TEE_Result invoke_command(void *pSessionContext __unused,
 		return core_aes_perf_tests(nParamTypes, pParams);
 	case PTA_INVOKE_TESTS_CMD_DT_DRIVER_TESTS:
 		return core_dt_driver_tests(nParamTypes, pParams);
+	case PTA_INVOKE_TESTS_CMD_RSA_PERF:
+		return core_rsa_perf_tests(nParamTypes, pParams);
+	case PTA_INVOKE_TESTS_CMD_ECC_PERF:
+		return core_ecc_perf_tests(nParamTypes, pParams);
+	case PTA_INVOKE_TESTS_CMD_AES_INIT_PERF:
+		return core_aes_init_perf_tests(nParamTypes, pParams);
+	case PTA_INVOKE_TESTS_CMD_HASH_MB_PERF:
+		return core_hash_mb_perf_tests(nParamTypes, pParams);
+	case PTA_INVOKE_TESTS_CMD_CRYPTO_PERF:
+		return core_crypto_perf_tests(nParamTypes, pParams);
 	default:
 		break;
 	}
@@ -5,12 +5,18 @@
  */
 #include <assert.h>
 #include <config.h>
+#include <crypto/crypto.h>
+#include <crypto/crypto_impl.h>
+#ifdef CFG_CRYPTO_DRV_DISPATCH
+#include <drvcrypt_dispatch.h>
+#endif
 #include <kernel/dt_driver.h>
 #include <kernel/linker.h>
 #include <kernel/panic.h>
 #include <malloc.h>
 #include <mm/core_memprot.h>
 #include <stdbool.h>
+#include <string.h>
 #include <trace.h>
 #include <util.h>
 
@@ -657,6 +663,629 @@ static int self_test_va2pa(void)
 	return ret;
 }
 
+#if defined(CFG_CRYPTO_SM4) && defined(CFG_CRYPTO_ECB)
+/*
+ * Test SM4 with the GM/T 0002-2012 example, the key is also the plaintext.
+ * The message is long enough for several multi-block calls with a single
+ * block left over.
+ */
+static int self_test_sm4(void)
+{
+	static const uint8_t key[16] = {
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10,
+	};
+	static const uint8_t ct[16] = {
+		0x68, 0x1e, 0xdf, 0x34, 0xd2, 0x06, 0x96, 0x5e,
+		0x86, 0xb3, 0xe9, 0x4f, 0x53, 0x6e, 0x42, 0x46,
+	};
+	const size_t len = 33 * sizeof(key);
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t *buf = NULL;
+	void *ctx = NULL;
+	int ret = -1;
+	size_t n = 0;
+
+	LOG("SM4 tests:");
+
+	buf = malloc(len);
+	if (!buf)
+		return -1;
+	if (crypto_cipher_alloc_ctx(&ctx, TEE_ALG_SM4_ECB_NOPAD))
+		goto out;
+
+	for (n = 0; n < len; n += sizeof(key))
+		memcpy(buf + n, key, sizeof(key));
+
+	res = crypto_cipher_init(ctx, TEE_MODE_ENCRYPT, key, sizeof(key), NULL,
+				 0, NULL, 0);
+	if (!res)
+		res = crypto_cipher_update(ctx, TEE_MODE_ENCRYPT, true, buf,
+					   len, buf);
+	crypto_cipher_final(ctx);
+	if (res)
+		goto out;
+	for (n = 0; n < len; n += sizeof(ct))
+		if (memcmp(buf + n, ct, sizeof(ct)))
+			goto out;
+	LOG("- encryption ok");
+
+	res = crypto_cipher_init(ctx, TEE_MODE_DECRYPT, key, sizeof(key), NULL,
+				 0, NULL, 0);
+	if (!res)
+		res = crypto_cipher_update(ctx, TEE_MODE_DECRYPT, true, buf,
+					   len, buf);
+	crypto_cipher_final(ctx);
+	if (res)
+		goto out;
+	for (n = 0; n < len; n += sizeof(key))
+		if (memcmp(buf + n, key, sizeof(key)))
+			goto out;
+	LOG("- decryption ok");
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- FAILED !!!");
+	crypto_cipher_free_ctx(ctx);
+	free(buf);
+
+	return ret;
+}
+#else
+static int self_test_sm4(void)
+{
+	return 0;
+}
+#endif
+
+#if defined(CFG_CRYPTO_CHACHA20_POLY1305)
+/*
+ * Encrypt or decrypt @len bytes in updates of at most @chunk bytes. Updates
+ * shorter than four blocks only use the scalar ChaCha20 code.
+ */
+static TEE_Result chachapoly_crypt(TEE_OperationMode mode, const uint8_t *key,
+				   const uint8_t *nonce, const uint8_t *aad,
+				   size_t aad_len, const uint8_t *src,
+				   size_t len, size_t chunk, uint8_t *dst,
+				   uint8_t *tag)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t tag_len = 16;
+	void *ctx = NULL;
+	size_t dlen = 0;
+	size_t n = 0;
+
+	res = crypto_authenc_alloc_ctx(&ctx, TEE_ALG_CHACHA20_POLY1305);
+	if (res)
+		return res;
+
+	res = crypto_authenc_init(ctx, mode, key, 32, nonce, 12, tag_len,
+				  aad_len, len);
+	if (!res)
+		res = crypto_authenc_update_aad(ctx, mode, aad, aad_len);
+	for (n = 0; n < len && !res; n += dlen) {
+		dlen = MIN(chunk, len - n);
+		res = crypto_authenc_update_payload(ctx, mode, src + n, dlen,
+						    dst + n, &dlen);
+	}
+	dlen = 0;
+	if (!res && mode == TEE_MODE_ENCRYPT)
+		res = crypto_authenc_enc_final(ctx, NULL, 0, NULL, &dlen, tag,
+					       &tag_len);
+	else if (!res)
+		res = crypto_authenc_dec_final(ctx, NULL, 0, NULL, &dlen, tag,
+					       tag_len);
+	crypto_authenc_final(ctx);
+	crypto_authenc_free_ctx(ctx);
+
+	return res;
+}
+
+/*
+ * Test ChaCha20-Poly1305 with the AEAD example of RFC 8439 section 2.8.2,
+ * then with a message long enough for the accelerated ChaCha20 which
+ * handles four blocks at a time. The tag of the latter was computed with
+ * an independent implementation of RFC 8439, the message is also
+ * encrypted in short updates and compared.
+ */
+static int self_test_chacha20_poly1305(void)
+{
+	static const uint8_t nonce[12] = {
+		0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43,
+		0x44, 0x45, 0x46, 0x47,
+	};
+	static const uint8_t aad[12] = {
+		0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3,
+		0xc4, 0xc5, 0xc6, 0xc7,
+	};
+	static const char pt[] = "Ladies and Gentlemen of the class of '99: "
+				 "If I could offer you only one tip for the "
+				 "future, sunscreen would be it.";
+	static const uint8_t ct[sizeof(pt) - 1] = {
+		0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb,
+		0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+		0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe,
+		0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+		0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12,
+		0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+		0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29,
+		0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+		0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c,
+		0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+		0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94,
+		0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+		0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d,
+		0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+		0x61, 0x16,
+	};
+	static const uint8_t ct_tag[16] = {
+		0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a,
+		0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91,
+	};
+	/* Tag of the long message buf[n] = n * 11 + 1 */
+	static const uint8_t long_tag[16] = {
+		0xc0, 0x5a, 0xe0, 0xb2, 0xff, 0x0c, 0x52, 0xc4,
+		0x8d, 0x2e, 0xda, 0xea, 0xdd, 0x5d, 0xf3, 0x1b,
+	};
+	const size_t len = 1000;
+	uint8_t key[32] = { };
+	uint8_t tag[16] = { };
+	uint8_t *buf = NULL;
+	uint8_t *out = NULL;
+	uint8_t *ref = NULL;
+	int ret = -1;
+	size_t n = 0;
+
+	LOG("ChaCha20-Poly1305 tests:");
+
+	buf = malloc(3 * len);
+	if (!buf)
+		return -1;
+	out = buf + len;
+	ref = out + len;
+
+	for (n = 0; n < sizeof(key); n++)
+		key[n] = 0x80 + n;
+
+	if (chachapoly_crypt(TEE_MODE_ENCRYPT, key, nonce, aad, sizeof(aad),
+			     (const uint8_t *)pt, sizeof(ct), sizeof(ct), out,
+			     tag) ||
+	    memcmp(out, ct, sizeof(ct)) || memcmp(tag, ct_tag, sizeof(tag))) {
+		LOG("- RFC 8439: bad encryption");
+		goto out;
+	}
+	if (chachapoly_crypt(TEE_MODE_DECRYPT, key, nonce, aad, sizeof(aad),
+			     ct, sizeof(ct), sizeof(ct), out, tag) ||
+	    memcmp(out, pt, sizeof(ct))) {
+		LOG("- RFC 8439: bad decryption");
+		goto out;
+	}
+	tag[0] ^= 1;
+	if (chachapoly_crypt(TEE_MODE_DECRYPT, key, nonce, aad, sizeof(aad),
+			     ct, sizeof(ct), sizeof(ct), out, tag) !=
+	    TEE_ERROR_MAC_INVALID) {
+		LOG("- RFC 8439: bad tag accepted");
+		goto out;
+	}
+	LOG("- RFC 8439 ok");
+
+	for (n = 0; n < len; n++)
+		buf[n] = n * 11 + 1;
+
+	if (chachapoly_crypt(TEE_MODE_ENCRYPT, key, nonce, aad, sizeof(aad),
+			     buf, len, 63, ref, tag) ||
+	    memcmp(tag, long_tag, sizeof(tag))) {
+		LOG("- long message: bad short updates");
+		goto out;
+	}
+	if (chachapoly_crypt(TEE_MODE_ENCRYPT, key, nonce, aad, sizeof(aad),
+			     buf, len, len, out, tag) ||
+	    memcmp(out, ref, len) || memcmp(tag, long_tag, sizeof(tag))) {
+		LOG("- long message: bad encryption");
+		goto out;
+	}
+	if (chachapoly_crypt(TEE_MODE_DECRYPT, key, nonce, aad, sizeof(aad),
+			     ref, len, len, out, tag) ||
+	    memcmp(out, buf, len)) {
+		LOG("- long message: bad decryption");
+		goto out;
+	}
+	LOG("- long message ok");
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- FAILED !!!");
+	free(buf);
+
+	return ret;
+}
+#else
+static int self_test_chacha20_poly1305(void)
+{
+	return 0;
+}
+#endif
+
+#if defined(CFG_CRYPTO_DRV_CIPHER) && defined(CFG_CRYPTO_AES)
+static int cipher_async_crypt(uint32_t algo, TEE_OperationMode mode,
+			      bool sw, const uint8_t *key, const uint8_t *iv,
+			      const uint8_t *src, size_t len, uint8_t *dst)
+{
+	struct crypto_cipher_ctx *sw_ctx = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t iv_len = TEE_AES_BLOCK_SIZE;
+	size_t key2_len = 0;
+	void *ctx = NULL;
+
+	if (sw) {
+		res = crypto_sw_cipher_alloc_ctx(&sw_ctx, algo);
+		ctx = sw_ctx;
+	} else {
+		res = crypto_cipher_alloc_ctx(&ctx, algo);
+	}
+	if (res)
+		return res;
+
+	if (algo == TEE_ALG_AES_ECB_NOPAD)
+		iv_len = 0;
+	if (algo == TEE_ALG_AES_XTS)
+		key2_len = TEE_AES_BLOCK_SIZE;
+
+	res = crypto_cipher_init(ctx, mode, key, TEE_AES_BLOCK_SIZE,
+				 key2_len ? key + TEE_AES_BLOCK_SIZE : NULL,
+				 key2_len, iv_len ? iv : NULL, iv_len);
+	if (!res)
+		res = crypto_cipher_update(ctx, mode, true, src, len, dst);
+	crypto_cipher_final(ctx);
+	crypto_cipher_free_ctx(ctx);
+
+	return res;
+}
+
+/*
+ * Compare the updates of the cipher drivers, split in asynchronous jobs
+ * when supported, with a single synchronous update of the software
+ * implementation. The length leaves a last job longer than the others.
+ */
+static int self_test_cipher_async(void)
+{
+	static const uint32_t algos[] = {
+		TEE_ALG_AES_ECB_NOPAD, TEE_ALG_AES_CBC_NOPAD,
+		TEE_ALG_AES_CTR, TEE_ALG_AES_XTS,
+	};
+	const size_t len = 3 * 4096 + 97 * TEE_AES_BLOCK_SIZE;
+	uint8_t key[2 * TEE_AES_BLOCK_SIZE] = { };
+	uint8_t iv[TEE_AES_BLOCK_SIZE] = { };
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t *buf = NULL;
+	uint8_t *ref = NULL;
+	uint8_t *out = NULL;
+	int ret = -1;
+	size_t n = 0;
+
+	LOG("Cipher driver tests:");
+
+	buf = malloc(3 * len);
+	if (!buf)
+		return -1;
+	ref = buf + len;
+	out = ref + len;
+
+	for (n = 0; n < sizeof(key); n++)
+		key[n] = n + 1;
+	for (n = 0; n < sizeof(iv); n++)
+		iv[n] = 0xf0 - n;
+	for (n = 0; n < len; n++)
+		buf[n] = n * 13 + 5;
+
+	for (n = 0; n < ARRAY_SIZE(algos); n++) {
+		res = cipher_async_crypt(algos[n], TEE_MODE_ENCRYPT, true, key,
+					 iv, buf, len, ref);
+		if (res == TEE_ERROR_NOT_IMPLEMENTED)
+			continue;
+		if (res)
+			goto out;
+
+		if (cipher_async_crypt(algos[n], TEE_MODE_ENCRYPT, false, key,
+				       iv, buf, len, out) ||
+		    memcmp(out, ref, len)) {
+			LOG("- algo %#"PRIx32": bad encryption", algos[n]);
+			goto out;
+		}
+		if (cipher_async_crypt(algos[n], TEE_MODE_DECRYPT, false, key,
+				       iv, ref, len, out) ||
+		    memcmp(out, buf, len)) {
+			LOG("- algo %#"PRIx32": bad decryption", algos[n]);
+			goto out;
+		}
+	}
+	LOG("- AES ECB, CBC, CTR and XTS ok");
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- FAILED !!!");
+	free(buf);
+
+	return ret;
+}
+#else
+static int self_test_cipher_async(void)
+{
+	return 0;
+}
+#endif
+
+#if defined(CFG_CRYPTO_DRV_DISPATCH) && defined(CFG_CRYPTO_DRV_CIPHER) && \
+	defined(CFG_CRYPTO_DRV_HASH) && defined(CFG_CRYPTO_AES) && \
+	defined(CFG_CRYPTO_SHA256)
+/* Returns false if @algo isn't dispatched on message size */
+static bool get_dispatch_stat(uint32_t algo,
+			      struct drvcrypt_dispatch_stat *stat)
+{
+	struct drvcrypt_dispatch_stat stats[16] = { };
+	size_t num = 0;
+	size_t n = 0;
+
+	num = drvcrypt_dispatch_get_stats(stats, ARRAY_SIZE(stats));
+	for (n = 0; n < MIN(num, ARRAY_SIZE(stats)); n++) {
+		if (stats[n].algo == algo) {
+			*stat = stats[n];
+			return stat->threshold != 0;
+		}
+	}
+
+	return false;
+}
+
+/* Returns true if an operation of @algo was handled by the expected side */
+static bool dispatched_to(uint32_t algo,
+			  const struct drvcrypt_dispatch_stat *before, bool sw)
+{
+	struct drvcrypt_dispatch_stat after = { };
+
+	if (!get_dispatch_stat(algo, &after))
+		return false;
+	if (sw)
+		return after.sw_count != before->sw_count;
+	return after.drv_count != before->drv_count;
+}
+
+/*
+ * Hash @len bytes in updates of @chunk bytes, the state is copied to a
+ * second context after the first update and both digests are checked
+ */
+static int dispatch_hash(const uint8_t *buf, size_t len, size_t chunk,
+			 bool sw)
+{
+	struct drvcrypt_dispatch_stat stat = { };
+	uint8_t digest[TEE_SHA256_HASH_SIZE] = { };
+	uint8_t ref[TEE_SHA256_HASH_SIZE] = { };
+	void *ctx2 = NULL;
+	void *ctx = NULL;
+	int ret = -1;
+	size_t n = 0;
+
+	if (hash_sha256_compute(ref, buf, len) ||
+	    !get_dispatch_stat(TEE_ALG_SHA256, &stat) ||
+	    crypto_hash_alloc_ctx(&ctx, TEE_ALG_SHA256) ||
+	    crypto_hash_alloc_ctx(&ctx2, TEE_ALG_SHA256) ||
+	    crypto_hash_init(ctx) || crypto_hash_update(ctx, buf, chunk))
+		goto out;
+
+	crypto_hash_copy_state(ctx2, ctx);
+	for (n = chunk; n < len; n += chunk)
+		if (crypto_hash_update(ctx, buf + n, MIN(chunk, len - n)) ||
+		    crypto_hash_update(ctx2, buf + n, MIN(chunk, len - n)))
+			goto out;
+
+	if (crypto_hash_final(ctx, digest, sizeof(digest)) ||
+	    memcmp(digest, ref, sizeof(ref)) ||
+	    crypto_hash_final(ctx2, digest, sizeof(digest)) ||
+	    memcmp(digest, ref, sizeof(ref)) ||
+	    !dispatched_to(TEE_ALG_SHA256, &stat, sw))
+		goto out;
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- SHA-256 %zu bytes in %zu byte updates failed", len,
+		    chunk);
+	crypto_hash_free_ctx(ctx);
+	crypto_hash_free_ctx(ctx2);
+
+	return ret;
+}
+
+/*
+ * Encrypt @len bytes with AES-CBC in a first update of @chunk bytes and
+ * a second one with the rest, the state is copied to a second context
+ * after the first update and both results are compared with @ref
+ */
+static int dispatch_cipher(const uint8_t *key, const uint8_t *iv,
+			   const uint8_t *buf, const uint8_t *ref, size_t len,
+			   size_t chunk, bool sw, uint8_t *out)
+{
+	const uint32_t algo = TEE_ALG_AES_CBC_NOPAD;
+	struct drvcrypt_dispatch_stat stat = { };
+	void *ctx2 = NULL;
+	void *ctx = NULL;
+	int ret = -1;
+
+	if (!get_dispatch_stat(algo, &stat) ||
+	    crypto_cipher_alloc_ctx(&ctx, algo) ||
+	    crypto_cipher_alloc_ctx(&ctx2, algo) ||
+	    crypto_cipher_init(ctx, TEE_MODE_ENCRYPT, key, TEE_AES_BLOCK_SIZE,
+			       NULL, 0, iv, TEE_AES_BLOCK_SIZE) ||
+	    crypto_cipher_update(ctx, TEE_MODE_ENCRYPT, false, buf, chunk,
+				 out))
+		goto out;
+
+	crypto_cipher_copy_state(ctx2, ctx);
+	if (crypto_cipher_update(ctx, TEE_MODE_ENCRYPT, true, buf + chunk,
+				 len - chunk, out + chunk) ||
+	    memcmp(out, ref, len))
+		goto out;
+	memset(out + chunk, 0, len - chunk);
+	if (crypto_cipher_update(ctx2, TEE_MODE_ENCRYPT, true, buf + chunk,
+				 len - chunk, out + chunk) ||
+	    memcmp(out, ref, len) || !dispatched_to(algo, &stat, sw))
+		goto out;
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- AES-CBC %zu bytes, first update %zu bytes failed", len,
+		    chunk);
+	if (ctx)
+		crypto_cipher_final(ctx);
+	if (ctx2)
+		crypto_cipher_final(ctx2);
+	crypto_cipher_free_ctx(ctx);
+	crypto_cipher_free_ctx(ctx2);
+
+	return ret;
+}
+
+/*
+ * Check the dispatch between the crypto drivers and the software
+ * implementation around the calibrated thresholds. Hash messages are
+ * buffered below the threshold and handed over to the driver once they
+ * reach it, the first cipher update selects the implementation. The state
+ * is copied in both cases.
+ */
+static int self_test_drv_dispatch(void)
+{
+	const size_t len = 2 * DRVCRYPT_DISPATCH_MAX_THRESHOLD;
+	struct drvcrypt_dispatch_stat stat = { };
+	uint8_t key[TEE_AES_BLOCK_SIZE] = { };
+	uint8_t iv[TEE_AES_BLOCK_SIZE] = { };
+	uint8_t *buf = NULL;
+	uint8_t *ref = NULL;
+	uint8_t *out = NULL;
+	size_t t = 0;
+	int ret = -1;
+	size_t n = 0;
+
+	LOG("Crypto driver dispatch tests:");
+
+	buf = malloc(3 * len);
+	if (!buf)
+		return -1;
+	ref = buf + len;
+	out = ref + len;
+
+	for (n = 0; n < sizeof(key); n++)
+		key[n] = n * 3 + 1;
+	for (n = 0; n < len; n++)
+		buf[n] = n * 5 + 7;
+
+	if (get_dispatch_stat(TEE_ALG_SHA256, &stat)) {
+		t = stat.threshold;
+		if (t > 1 && (dispatch_hash(buf, t - 1, t - 1, true) ||
+			      dispatch_hash(buf, t - 1, t / 2, true)))
+			goto out;
+		if (dispatch_hash(buf, t, t, false) ||
+		    dispatch_hash(buf, t + t / 2, MAX(t / 2, 1), false))
+			goto out;
+		LOG("- SHA-256 threshold %zu ok", t);
+	}
+
+	if (get_dispatch_stat(TEE_ALG_AES_CBC_NOPAD, &stat)) {
+		t = stat.threshold;
+		if (cipher_async_crypt(TEE_ALG_AES_CBC_NOPAD, TEE_MODE_ENCRYPT,
+				       true, key, iv, buf, 2 * t, ref))
+			goto out;
+		if (t > TEE_AES_BLOCK_SIZE &&
+		    dispatch_cipher(key, iv, buf, ref, 2 * t,
+				    t - TEE_AES_BLOCK_SIZE, true, out))
+			goto out;
+		if (dispatch_cipher(key, iv, buf, ref, 2 * t, t, false, out))
+			goto out;
+		LOG("- AES-CBC threshold %zu ok", t);
+	}
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- FAILED !!!");
+	free(buf);
+
+	return ret;
+}
+#else
+static int self_test_drv_dispatch(void)
+{
+	return 0;
+}
+#endif
+
+#if defined(CFG_CRYPTO_SHA256)
+/*
+ * Check crypto_hash_mb() against hash_sha256_compute(). Neighbouring
+ * messages are hashed together, the lengths are chosen so that the two
+ * lanes differ in their number of blocks and of padding blocks. The odd
+ * count leaves the last message alone.
+ */
+static int self_test_sha256_mb(void)
+{
+	static const size_t lens[] = {
+		0, 55, 56, 64, 1000, 119, 120, 1000, 64, 0, 1000, 1000, 55,
+	};
+	struct crypto_hash_mb_msg msgs[ARRAY_SIZE(lens)] = { };
+	uint8_t digests[ARRAY_SIZE(lens)][TEE_SHA256_HASH_SIZE] = { };
+	uint8_t digest[TEE_SHA256_HASH_SIZE] = { };
+	const size_t len = 1000 + ARRAY_SIZE(lens);
+	uint8_t *buf = NULL;
+	int ret = -1;
+	size_t n = 0;
+
+	LOG("SHA-256 multi-buffer tests:");
+
+	buf = malloc(len);
+	if (!buf)
+		return -1;
+	for (n = 0; n < len; n++)
+		buf[n] = n * 7 + 3;
+
+	/* Each message starts at a different offset, most are unaligned */
+	for (n = 0; n < ARRAY_SIZE(lens); n++) {
+		msgs[n].data = buf + n;
+		msgs[n].len = lens[n];
+		msgs[n].digest = digests[n];
+	}
+
+	if (crypto_hash_mb(TEE_ALG_SHA256, msgs, ARRAY_SIZE(msgs)))
+		goto out;
+
+	for (n = 0; n < ARRAY_SIZE(lens); n++) {
+		if (hash_sha256_compute(digest, buf + n, lens[n]))
+			goto out;
+		if (memcmp(digest, digests[n], sizeof(digest))) {
+			LOG("- message %zu, length %zu: bad digest", n,
+			    lens[n]);
+			goto out;
+		}
+	}
+	LOG("- digests ok");
+
+	ret = 0;
+out:
+	if (ret)
+		LOG("- FAILED !!!");
+	free(buf);
+
+	return ret;
+}
+#else
+static int self_test_sha256_mb(void)
+{
+	return 0;
+}
+#endif
+
 /* exported entry points for some basic test */
 TEE_Result core_self_tests(uint32_t nParamTypes __unused,
 		TEE_Param pParams[TEE_NUM_PARAMS] __unused)
@@ -664,7 +1293,10 @@ TEE_Result core_self_tests(uint32_t nParamTypes __unused,
 	if (self_test_mul_signed_overflow() || self_test_add_overflow() ||
 	    self_test_sub_overflow() || self_test_mul_unsigned_overflow() ||
 	    self_test_division() || self_test_malloc() ||
-	    self_test_nex_malloc() || self_test_va2pa()) {
+	    self_test_nex_malloc() || self_test_va2pa() ||
+	    self_test_sm4() || self_test_sha256_mb() ||
+	    self_test_cipher_async() || self_test_drv_dispatch() ||
+	    self_test_chacha20_poly1305()) {
 		EMSG("some self_test_xxx failed! you should enable local LOG");
 		return TEE_ERROR_GENERIC;
 	}
@@ -34,6 +34,30 @@ static inline TEE_Result core_lockdep_tests(
 TEE_Result core_aes_perf_tests(uint32_t param_types,
 			       TEE_Param params[TEE_NUM_PARAMS]);
 
+TEE_Result core_aes_init_perf_tests(uint32_t param_types,
+				    TEE_Param params[TEE_NUM_PARAMS]);
+
+TEE_Result core_rsa_perf_tests(uint32_t param_types,
+			       TEE_Param params[TEE_NUM_PARAMS]);
+
+TEE_Result core_ecc_perf_tests(uint32_t param_types,
+			       TEE_Param params[TEE_NUM_PARAMS]);
+
+TEE_Result core_hash_mb_perf_tests(uint32_t param_types,
+				   TEE_Param params[TEE_NUM_PARAMS]);
+
+#ifdef CFG_CORE_HAS_GENERIC_TIMER
+TEE_Result core_crypto_perf_tests(uint32_t param_types,
+				  TEE_Param params[TEE_NUM_PARAMS]);
+#else
+static inline TEE_Result core_crypto_perf_tests(
+		uint32_t param_types __unused,
+		TEE_Param params[TEE_NUM_PARAMS] __unused)
+{
+	return TEE_ERROR_NOT_SUPPORTED;
+}
+#endif
+
 TEE_Result core_dt_driver_tests(uint32_t param_types,
 				TEE_Param params[TEE_NUM_PARAMS]);
 
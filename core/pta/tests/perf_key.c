@@ -0,0 +1,181 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <crypto/crypto.h>
+#include <kernel/mutex.h>
+#include <malloc.h>
+#include <sys/queue.h>
+#include <tee_api_defines.h>
+#include <tee_api_types.h>
+#include <types_ext.h>
+
+#include "perf_key.h"
+
+static SLIST_HEAD(, perf_key) perf_keys = SLIST_HEAD_INITIALIZER(perf_keys);
+static struct mutex perf_keys_mu = MUTEX_INITIALIZER;
+
+static TEE_Result get_curve(uint32_t key_type, size_t key_bits,
+			    uint32_t *curve)
+{
+	if (key_type == TEE_TYPE_SM2_DSA_KEYPAIR) {
+		if (key_bits != 256)
+			return TEE_ERROR_NOT_SUPPORTED;
+		*curve = TEE_ECC_CURVE_SM2;
+		return TEE_SUCCESS;
+	}
+
+	switch (key_bits) {
+	case 192:
+		*curve = TEE_ECC_CURVE_NIST_P192;
+		return TEE_SUCCESS;
+	case 224:
+		*curve = TEE_ECC_CURVE_NIST_P224;
+		return TEE_SUCCESS;
+	case 256:
+		*curve = TEE_ECC_CURVE_NIST_P256;
+		return TEE_SUCCESS;
+	case 384:
+		*curve = TEE_ECC_CURVE_NIST_P384;
+		return TEE_SUCCESS;
+	case 521:
+		*curve = TEE_ECC_CURVE_NIST_P521;
+		return TEE_SUCCESS;
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+}
+
+/*
+ * Keys are cached for each type and size, only the usual sizes are
+ * accepted to bound the number of keys the normal world can have
+ * generated.
+ */
+static TEE_Result check_key_size(uint32_t key_type, size_t key_bits)
+{
+	uint32_t curve = 0;
+
+	switch (key_type) {
+	case TEE_TYPE_RSA_KEYPAIR:
+		if (key_bits > CFG_CORE_BIGNUM_MAX_BITS)
+			return TEE_ERROR_NOT_SUPPORTED;
+		switch (key_bits) {
+		case 1024:
+		case 2048:
+		case 3072:
+		case 4096:
+			return TEE_SUCCESS;
+		default:
+			return TEE_ERROR_NOT_SUPPORTED;
+		}
+	case TEE_TYPE_ECDSA_KEYPAIR:
+	case TEE_TYPE_ECDH_KEYPAIR:
+	case TEE_TYPE_SM2_DSA_KEYPAIR:
+		return get_curve(key_type, key_bits, &curve);
+	case TEE_TYPE_ED25519_KEYPAIR:
+	case TEE_TYPE_X25519_KEYPAIR:
+		if (key_bits != 256)
+			return TEE_ERROR_NOT_SUPPORTED;
+		return TEE_SUCCESS;
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+}
+
+static void free_ecc_key(struct ecc_keypair *key)
+{
+	crypto_bignum_free(&key->d);
+	crypto_bignum_free(&key->x);
+	crypto_bignum_free(&key->y);
+}
+
+static TEE_Result gen_key(struct perf_key *k)
+{
+	TEE_Result res = TEE_SUCCESS;
+
+	switch (k->key_type) {
+	case TEE_TYPE_RSA_KEYPAIR:
+		res = crypto_acipher_alloc_rsa_keypair(&k->rsa, k->key_bits);
+		if (res)
+			return res;
+		res = crypto_acipher_gen_rsa_key(&k->rsa, k->key_bits);
+		if (res)
+			crypto_acipher_free_rsa_keypair(&k->rsa);
+		return res;
+	case TEE_TYPE_ECDSA_KEYPAIR:
+	case TEE_TYPE_ECDH_KEYPAIR:
+	case TEE_TYPE_SM2_DSA_KEYPAIR:
+		res = crypto_acipher_alloc_ecc_keypair(&k->ecc, k->key_type,
+						       k->key_bits);
+		if (res)
+			return res;
+		res = get_curve(k->key_type, k->key_bits, &k->ecc.curve);
+		if (!res)
+			res = crypto_acipher_gen_ecc_key(&k->ecc, k->key_bits);
+		if (res)
+			free_ecc_key(&k->ecc);
+		return res;
+	case TEE_TYPE_ED25519_KEYPAIR:
+		res = crypto_acipher_alloc_ed25519_keypair(&k->ed25519,
+							   k->key_bits);
+		if (res)
+			return res;
+		res = crypto_acipher_gen_ed25519_key(&k->ed25519,
+						     k->key_bits);
+		if (res) {
+			free(k->ed25519.priv);
+			free(k->ed25519.pub);
+		}
+		return res;
+	case TEE_TYPE_X25519_KEYPAIR:
+		res = crypto_acipher_alloc_x25519_keypair(&k->x25519,
+							  k->key_bits);
+		if (res)
+			return res;
+		res = crypto_acipher_gen_x25519_key(&k->x25519, k->key_bits);
+		if (res) {
+			free(k->x25519.priv);
+			free(k->x25519.pub);
+		}
+		return res;
+	default:
+		return TEE_ERROR_NOT_SUPPORTED;
+	}
+}
+
+TEE_Result perf_key_get(uint32_t key_type, size_t key_bits,
+			struct perf_key **key)
+{
+	TEE_Result res = TEE_SUCCESS;
+	struct perf_key *k = NULL;
+
+	res = check_key_size(key_type, key_bits);
+	if (res)
+		return res;
+
+	mutex_lock(&perf_keys_mu);
+
+	SLIST_FOREACH(k, &perf_keys, link)
+		if (k->key_type == key_type && k->key_bits == key_bits)
+			goto out;
+
+	k = calloc(1, sizeof(*k));
+	if (!k) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+		goto out;
+	}
+
+	k->key_type = key_type;
+	k->key_bits = key_bits;
+	res = gen_key(k);
+	if (res) {
+		free(k);
+		goto out;
+	}
+
+	SLIST_INSERT_HEAD(&perf_keys, k, link);
+out:
+	mutex_unlock(&perf_keys_mu);
+	if (!res)
+		*key = k;
+
+	return res;
+}
@@ -0,0 +1,38 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+#ifndef CORE_PTA_TESTS_PERF_KEY_H
+#define CORE_PTA_TESTS_PERF_KEY_H
+
+#include <crypto/crypto.h>
+#include <sys/queue.h>
+#include <tee_api_types.h>
+#include <types_ext.h>
+
+/*
+ * struct perf_key - key pair shared by the performance tests
+ * @key_type:	TEE_TYPE_*_KEYPAIR, selects the member of the union
+ * @key_bits:	key size in bits
+ * @link:	link in the list of generated keys
+ */
+struct perf_key {
+	uint32_t key_type;
+	size_t key_bits;
+	union {
+		struct rsa_keypair rsa;
+		struct ecc_keypair ecc;
+		struct ed25519_keypair ed25519;
+		struct montgomery_keypair x25519;
+	};
+	SLIST_ENTRY(perf_key) link;
+};
+
+/*
+ * Returns in @key the key pair of type @key_type and size @key_bits. Keys
+ * are generated by the first call with a certain type and size and shared
+ * by all later calls, they're never freed. Only RSA keys of 1024, 2048,
+ * 3072 or 4096 bits, the ECC curves of the TEE API and 256-bit Ed25519 and
+ * X25519 keys are supported, which keeps the number of keys bounded.
+ */
+TEE_Result perf_key_get(uint32_t key_type, size_t key_bits,
+			struct perf_key **key);
+
+#endif /*CORE_PTA_TESTS_PERF_KEY_H*/
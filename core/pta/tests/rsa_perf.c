@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <compiler.h>
+#include <crypto/crypto.h>
+#include <malloc.h>
+#include <pta_invoke_tests.h>
+#include <tee_api_defines.h>
+#include <tee_api_types.h>
+#include <trace.h>
+#include <types_ext.h>
+#include <utee_defines.h>
+
+#include "misc.h"
+#include "perf_key.h"
+
+static TEE_Result sign(struct rsa_keypair *key, unsigned int n, uint8_t *sig,
+		       size_t *sig_len)
+{
+	uint8_t digest[TEE_SHA256_HASH_SIZE] = { };
+
+	digest[0] = n;
+	return crypto_acipher_rsassa_sign(TEE_ALG_RSASSA_PKCS1_V1_5_SHA256,
+					  key, -1, digest, sizeof(digest), sig,
+					  sig_len);
+}
+
+static TEE_Result sign_perf(struct rsa_keypair *key, unsigned int rep_count,
+			    bool no_precomp, uint8_t *sig, size_t max_sig_len)
+{
+	struct rsa_keypair k = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t sig_len = 0;
+	unsigned int n = 0;
+
+	/*
+	 * A copy of the key doesn't disturb other threads using the shared
+	 * key when its precomputed values are dropped after each signature.
+	 */
+	if (no_precomp) {
+		k = *key;
+		k.precomp = NULL;
+		key = &k;
+	}
+
+	for (n = 0; n < rep_count; n++) {
+		sig_len = max_sig_len;
+		res = sign(key, n, sig, &sig_len);
+		if (no_precomp)
+			crypto_acipher_free_rsa_precomp(key);
+		if (res)
+			break;
+	}
+
+	return res;
+}
+
+static TEE_Result verify_perf(struct rsa_keypair *key, unsigned int rep_count,
+			      uint8_t *sig, size_t max_sig_len)
+{
+	uint8_t digest[TEE_SHA256_HASH_SIZE] = { };
+	struct rsa_public_key pk = { .e = key->e, .n = key->n };
+	TEE_Result res = TEE_SUCCESS;
+	size_t sig_len = max_sig_len;
+	unsigned int n = 0;
+
+	res = sign(key, 0, sig, &sig_len);
+	if (res)
+		return res;
+
+	for (n = 0; n < rep_count; n++) {
+		res = crypto_acipher_rsassa_verify(TEE_ALG_RSASSA_PKCS1_V1_5_SHA256,
+						   &pk, -1, digest,
+						   sizeof(digest), sig,
+						   sig_len);
+		if (res)
+			break;
+	}
+
+	return res;
+}
+
+TEE_Result core_rsa_perf_tests(uint32_t param_types,
+			       TEE_Param params[TEE_NUM_PARAMS])
+{
+	uint32_t exp_pt = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+					  TEE_PARAM_TYPE_NONE,
+					  TEE_PARAM_TYPE_NONE,
+					  TEE_PARAM_TYPE_NONE);
+	uint32_t exp_pt_op = TEE_PARAM_TYPES(TEE_PARAM_TYPE_VALUE_INPUT,
+					     TEE_PARAM_TYPE_VALUE_INPUT,
+					     TEE_PARAM_TYPE_NONE,
+					     TEE_PARAM_TYPE_NONE);
+	struct rsa_keypair *key = NULL;
+	struct perf_key *k = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t key_size_bits = 0;
+	unsigned int rep_count = 0;
+	uint32_t op = PTA_INVOKE_TESTS_RSA_PERF_SIGN;
+	bool no_precomp = false;
+	uint8_t *sig = NULL;
+
+	if (param_types == exp_pt_op) {
+		op = params[1].value.a;
+		no_precomp = params[1].value.b;
+	} else if (param_types != exp_pt) {
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+
+	key_size_bits = params[0].value.a;
+	rep_count = params[0].value.b;
+	if (key_size_bits < 256 || key_size_bits > CFG_CORE_BIGNUM_MAX_BITS ||
+	    key_size_bits % 8)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (op != PTA_INVOKE_TESTS_RSA_PERF_SIGN &&
+	    op != PTA_INVOKE_TESTS_RSA_PERF_VERIFY)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = perf_key_get(TEE_TYPE_RSA_KEYPAIR, key_size_bits, &k);
+	if (res)
+		return res;
+	key = &k->rsa;
+
+	sig = malloc(key_size_bits / 8);
+	if (!sig)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	if (op == PTA_INVOKE_TESTS_RSA_PERF_SIGN)
+		res = sign_perf(key, rep_count, no_precomp, sig,
+				key_size_bits / 8);
+	else
+		res = verify_perf(key, rep_count, sig, key_size_bits / 8);
+
+	free(sig);
+	return res;
+}
@@ -5,4 +5,9 @@ srcs-y += misc.c
 cflags-misc.c-y += -fno-builtin
 srcs-y += mutex.c
 srcs-y += aes_perf.c
+srcs-y += rsa_perf.c
+srcs-y += ecc_perf.c
+srcs-y += hash_perf.c
+srcs-y += perf_key.c
+srcs-$(CFG_CORE_HAS_GENERIC_TIMER) += crypto_perf.c
 srcs-$(CFG_DT_DRIVER_EMBEDDED_TEST) += dt_driver_test.c
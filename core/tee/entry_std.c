@@ -8,10 +8,12 @@
 #include <compiler.h>
 #include <initcall.h>
 #include <io.h>
+#include <kernel/latency_stats.h>
 #include <kernel/linker.h>
 #include <kernel/msg_param.h>
 #include <kernel/notif.h>
 #include <kernel/panic.h>
+#include <kernel/rcu.h>
 #include <kernel/tee_misc.h>
 #include <mm/core_memprot.h>
 #include <mm/core_mmu.h>
@@ -423,6 +425,7 @@ static void entry_invoke_command(struct optee_msg_arg *arg, uint32_t num_params)
 	struct tee_ta_session *s;
 	struct tee_ta_param param = { 0 };
 	uint64_t saved_attr[TEE_NUM_PARAMS] = { 0 };
+	uint64_t start = 0;
 
 	res = copy_in_params(arg->params, num_params, &param, saved_attr);
 	if (res != TEE_SUCCESS)
@@ -434,8 +437,12 @@ static void entry_invoke_command(struct optee_msg_arg *arg, uint32_t num_params)
 		goto out;
 	}
 
+	start = latency_stats_now();
 	res = tee_ta_invoke_command(&err_orig, s, NSAPP_IDENTITY,
 				    TEE_TIMEOUT_INFINITE, arg->func, &param);
+	if (s->ts_sess.ctx)
+		latency_stats_record_ta(LATENCY_STATS_TA_INVOKE,
+					&s->ts_sess.ctx->uuid, start);
 
 	tee_ta_put_session(s);
 
@@ -532,11 +539,14 @@ TEE_Result __weak tee_entry_std(struct optee_msg_arg *arg, uint32_t num_params)
  */
 TEE_Result __tee_entry_std(struct optee_msg_arg *arg, uint32_t num_params)
 {
+	uint64_t start = latency_stats_now();
+	/* @arg may be in shared memory, read the command only once */
+	uint32_t cmd = READ_ONCE(arg->cmd);
 	TEE_Result res = TEE_SUCCESS;
 
 	/* Enable foreign interrupts for STD calls */
 	thread_set_foreign_intr(true);
-	switch (arg->cmd) {
+	switch (cmd) {
 	case OPTEE_MSG_CMD_OPEN_SESSION:
 		entry_open_session(arg, num_params);
 		break;
@@ -575,10 +585,18 @@ TEE_Result __tee_entry_std(struct optee_msg_arg *arg, uint32_t num_params)
 
 	default:
 err:
-		EMSG("Unknown cmd 0x%x", arg->cmd);
+		EMSG("Unknown cmd 0x%x", cmd);
 		res = TEE_ERROR_NOT_IMPLEMENTED;
 	}
 
+	/*
+	 * This thread is about to leave secure world, a good time to free
+	 * what lockless readers may have been using.
+	 */
+	rcu_reclaim();
+
+	latency_stats_record(LATENCY_STATS_STD_CALL, cmd, start);
+
 	return res;
 }
 
@@ -11,12 +11,24 @@
 #include <tee/fs_dirfile.h>
 #include <types_ext.h>
 
+/* Number of entries read from the dirfile at once */
+#define DENT_CACHE_COUNT	32
+
+/*
+ * struct tee_fs_dirfile_dirh - dirfile handle
+ * @dent_cache:		a window of @dent_cache_count entries starting at
+ *			index @dent_cache_idx, read with a single read of
+ *			the file and kept up to date by write_dent()
+ */
 struct tee_fs_dirfile_dirh {
 	const struct tee_fs_dirfile_operations *fops;
 	struct tee_file_handle *fh;
 	int nbits;
 	bitstr_t *files;
 	size_t ndents;
+	struct dirfile_entry *dent_cache;
+	int dent_cache_idx;
+	int dent_cache_count;
 };
 
 struct dirfile_entry {
@@ -93,32 +105,83 @@ static bool test_file(struct tee_fs_dirfile_dirh *dirh, int idx)
 	return false;
 }
 
-static TEE_Result read_dent(struct tee_fs_dirfile_dirh *dirh, int idx,
-			    struct dirfile_entry *dent)
+static bool dent_is_cached(struct tee_fs_dirfile_dirh *dirh, int idx)
+{
+	return idx >= dirh->dent_cache_idx &&
+	       idx - dirh->dent_cache_idx < dirh->dent_cache_count;
+}
+
+static TEE_Result fill_dent_cache(struct tee_fs_dirfile_dirh *dirh, int idx)
 {
 	TEE_Result res;
 	size_t l;
 
-	l = sizeof(*dent);
+	if (!dirh->dent_cache) {
+		dirh->dent_cache = malloc(sizeof(struct dirfile_entry) *
+					  DENT_CACHE_COUNT);
+		if (!dirh->dent_cache)
+			return TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	l = sizeof(struct dirfile_entry) * DENT_CACHE_COUNT;
 	res = dirh->fops->read(dirh->fh, sizeof(struct dirfile_entry) * idx,
-			       dent, &l);
-	if (!res && l != sizeof(*dent))
-		res = TEE_ERROR_ITEM_NOT_FOUND;
+			       dirh->dent_cache, &l);
+	if (res) {
+		dirh->dent_cache_count = 0;
+		return res;
+	}
 
-	return res;
+	/* A short read means end of file, a partial entry is ignored */
+	dirh->dent_cache_idx = idx;
+	dirh->dent_cache_count = l / sizeof(struct dirfile_entry);
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result read_dent(struct tee_fs_dirfile_dirh *dirh, int idx,
+			    struct dirfile_entry *dent)
+{
+	TEE_Result res;
+
+	if (!dent_is_cached(dirh, idx)) {
+		res = fill_dent_cache(dirh, idx);
+		if (res)
+			return res;
+		if (!dent_is_cached(dirh, idx))
+			return TEE_ERROR_ITEM_NOT_FOUND;
+	}
+
+	*dent = dirh->dent_cache[idx - dirh->dent_cache_idx];
+
+	return TEE_SUCCESS;
 }
 
 static TEE_Result write_dent(struct tee_fs_dirfile_dirh *dirh, size_t n,
 			     struct dirfile_entry *dent)
 {
 	TEE_Result res;
+	int end = dirh->dent_cache_idx + dirh->dent_cache_count;
 
 	res = dirh->fops->write(dirh->fh, sizeof(*dent) * n, dent,
 				sizeof(*dent));
-	if (!res && n >= dirh->ndents)
+	if (res) {
+		dirh->dent_cache_count = 0;
+		return res;
+	}
+
+	if (n >= dirh->ndents)
 		dirh->ndents = n + 1;
 
-	return res;
+	if (dent_is_cached(dirh, n)) {
+		dirh->dent_cache[n - dirh->dent_cache_idx] = *dent;
+	} else if (dirh->dent_cache && (int)n == end &&
+		   dirh->dent_cache_count < DENT_CACHE_COUNT) {
+		/* A short window ends at end of file, extend it */
+		dirh->dent_cache[dirh->dent_cache_count] = *dent;
+		dirh->dent_cache_count++;
+	}
+
+	return TEE_SUCCESS;
 }
 
 TEE_Result tee_fs_dirfile_open(bool create, uint8_t *hash, uint32_t min_counter,
@@ -179,6 +242,7 @@ void tee_fs_dirfile_close(struct tee_fs_dirfile_dirh *dirh)
 	if (dirh) {
 		dirh->fops->close(dirh->fh);
 		free(dirh->files);
+		free(dirh->dent_cache);
 		free(dirh);
 	}
 }
@@ -355,8 +419,10 @@ TEE_Result tee_fs_dirfile_update_hash(struct tee_fs_dirfile_dirh *dirh,
 	res = read_dent(dirh, dfh->idx, &dent);
 	if (res)
 		return res;
-	assert(dent.file_number == dfh->file_number);
-	assert(test_file(dirh, dent.file_number));
+	/* The handle may refer to updates of dirf.db that were discarded */
+	if (dent.file_number != dfh->file_number ||
+	    !test_file(dirh, dent.file_number))
+		return TEE_ERROR_BAD_STATE;
 
 	memcpy(&dent.hash, dfh->hash, sizeof(dent.hash));
 
@@ -4,6 +4,7 @@
  */
 
 #include <assert.h>
+#include <config.h>
 #include <crypto/crypto.h>
 #include <initcall.h>
 #include <kernel/tee_common_otp.h>
@@ -23,18 +24,37 @@
 #define TEE_FS_HTREE_ENC_SIZE		TEE_AES_BLOCK_SIZE
 #define TEE_FS_HTREE_SSK_SIZE		TEE_FS_HTREE_HASH_SIZE
 
+#ifdef CFG_REE_FS_HTREE_CHACHA20_POLY1305
+#define TEE_FS_HTREE_AUTH_ENC_ALG	TEE_ALG_CHACHA20_POLY1305
+/* The key is derived from the FEK and the nonce is the start of the IV */
+#define TEE_FS_HTREE_AUTH_ENC_KEY_SIZE	TEE_SHA256_HASH_SIZE
+#define TEE_FS_HTREE_AUTH_ENC_IV_SIZE	U(12)
+#else
 #define TEE_FS_HTREE_AUTH_ENC_ALG	TEE_ALG_AES_GCM
+#define TEE_FS_HTREE_AUTH_ENC_KEY_SIZE	TEE_FS_HTREE_FEK_SIZE
+#define TEE_FS_HTREE_AUTH_ENC_IV_SIZE	TEE_FS_HTREE_IV_SIZE
+#endif
 #define TEE_FS_HTREE_HMAC_ALG		TEE_ALG_HMAC_SHA256
 
 #define BLOCK_NUM_TO_NODE_ID(num)	((num) + 1)
 
 #define NODE_ID_TO_BLOCK_NUM(id)	((id) - 1)
 
+/* Node ids are 32-bit, with the minimum fan-out of 2 that's 32 levels */
+#define HTREE_MAX_LEVELS		32
+
 /*
- * The hash tree is implemented as a binary tree with the purpose to ensure
+ * The hash tree is implemented as a tree with the purpose to ensure
  * integrity of the data in the nodes. The data in the nodes their turn
  * provides both integrity and confidentiality of the data blocks.
  *
+ * With TEE_FS_HTREE_FORMAT_V1 it's a binary tree, with
+ * TEE_FS_HTREE_FORMAT_V2 each node has up to ht->fanout children. Nodes
+ * are numbered level by level, the children of node n are nodes
+ * ht->fanout * (n - 1) + 2 up to ht->fanout * n + 1. With a fan-out of 2
+ * that's nodes 2n and 2n + 1 as in the binary tree so both formats use
+ * the same numbering code.
+ *
  * The hash tree is saved in a file as:
  * +----------------------------+
  * | htree_image.0		|
@@ -73,16 +93,30 @@
  */
 
 #define HTREE_NODE_COMMITTED_BLOCK	BIT32(0)
-/* n is 0 or 1 */
+/* n is less than TEE_FS_HTREE_MAX_FANOUT */
 #define HTREE_NODE_COMMITTED_CHILD(n)	BIT32(1 + (n))
 
+static_assert(TEE_FS_HTREE_MAX_FANOUT <=
+	      sizeof(((struct tee_fs_htree_node_image *)0)->flags) * 8 - 1);
+static_assert(sizeof(struct tee_fs_htree_imeta) == 16);
+
+/* Max number of data blocks read with a single RPC */
+#define HTREE_READ_SPAN_BLOCKS	16
+
+/*
+ * struct htree_node - a node of the tree read in from storage or added
+ * @verified:	the node has been checked against its hash and all its
+ *		children are read in. Always set on dirty nodes and on
+ *		parents of nodes in memory.
+ */
 struct htree_node {
 	size_t id;
 	bool dirty;
 	bool block_updated;
+	bool verified;
 	struct tee_fs_htree_node_image node;
 	struct htree_node *parent;
-	struct htree_node *child[2];
+	struct htree_node *child[TEE_FS_HTREE_MAX_FANOUT];
 };
 
 struct tee_fs_htree {
@@ -90,6 +124,8 @@ struct tee_fs_htree {
 	struct tee_fs_htree_image head;
 	uint8_t fek[TEE_FS_HTREE_FEK_SIZE];
 	struct tee_fs_htree_imeta imeta;
+	size_t fanout;
+	size_t block_size;
 	bool dirty;
 	const TEE_UUID *uuid;
 	const struct tee_fs_htree_storage *stor;
@@ -143,6 +179,42 @@ static TEE_Result rpc_read_node(struct tee_fs_htree *ht, size_t node_id,
 			node, sizeof(*node));
 }
 
+/*
+ * Reads both versions of up to *count elements starting at idx with a
+ * single RPC. *count is updated with the number of complete elements
+ * read. Returns TEE_ERROR_NOT_SUPPORTED if the element at idx has to be
+ * read with rpc_read() instead.
+ */
+static TEE_Result rpc_read_span(struct tee_fs_htree *ht,
+				enum tee_fs_htree_type type, size_t idx,
+				size_t elem_size, size_t *count, uint8_t **data)
+{
+	TEE_Result res;
+	struct tee_fs_rpc_operation op;
+	size_t bytes;
+	void *p;
+
+	if (!ht->stor->rpc_read_span_init)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	res = ht->stor->rpc_read_span_init(ht->stor_aux, &op, type, idx,
+					   count, &p);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	res = ht->stor->rpc_read_final(&op, &bytes);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	/* The last version 1 may be missing at the end of the file */
+	*count = MIN(*count, bytes / (elem_size * 2));
+	if (!*count)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	*data = p;
+	return TEE_SUCCESS;
+}
+
 static TEE_Result rpc_write(struct tee_fs_htree *ht,
 			    enum tee_fs_htree_type type, size_t idx,
 			    size_t vers, const void *data, size_t dlen)
@@ -178,6 +250,7 @@ static TEE_Result traverse_post_order(struct traverse_arg *targ,
 				      struct htree_node *node)
 {
 	TEE_Result res;
+	size_t n;
 
 	/*
 	 * This function is recursing but not very deep, only with Log(N)
@@ -187,13 +260,11 @@ static TEE_Result traverse_post_order(struct traverse_arg *targ,
 	if (!node)
 		return TEE_SUCCESS;
 
-	res = traverse_post_order(targ, node->child[0]);
-	if (res != TEE_SUCCESS)
-		return res;
-
-	res = traverse_post_order(targ, node->child[1]);
-	if (res != TEE_SUCCESS)
-		return res;
+	for (n = 0; n < targ->ht->fanout; n++) {
+		res = traverse_post_order(targ, node->child[n]);
+		if (res != TEE_SUCCESS)
+			return res;
+	}
 
 	return targ->cb(targ, node);
 }
@@ -206,98 +277,17 @@ static TEE_Result htree_traverse_post_order(struct tee_fs_htree *ht,
 	return traverse_post_order(&targ, &ht->root);
 }
 
-static size_t node_id_to_level(size_t node_id)
+static size_t node_id_to_parent_id(struct tee_fs_htree *ht, size_t node_id)
 {
-	assert(node_id && node_id < UINT_MAX);
-	/* Calculate level of the node, root node (1) has level 1 */
-	return sizeof(unsigned int) * 8 - __builtin_clz(node_id);
+	assert(node_id > 1);
+	return (node_id - 2) / ht->fanout + 1;
 }
 
-static struct htree_node *find_closest_node(struct tee_fs_htree *ht,
-					    size_t node_id)
+/* Returns the index of node_id in the child array of its parent */
+static size_t node_id_to_child_idx(struct tee_fs_htree *ht, size_t node_id)
 {
-	struct htree_node *node = &ht->root;
-	size_t level = node_id_to_level(node_id);
-	size_t n;
-
-	/* n = 1 because root node is level 1 */
-	for (n = 1; n < level; n++) {
-		struct htree_node *child;
-		size_t bit_idx;
-
-		/*
-		 * The difference between levels of the current node and
-		 * the node we're looking for tells which bit decides
-		 * direction in the tree.
-		 *
-		 * As the first bit has index 0 we'll subtract 1
-		 */
-		bit_idx = level - n - 1;
-		child = node->child[((node_id >> bit_idx) & 1)];
-		if (!child)
-			return node;
-		node = child;
-	}
-
-	return node;
-}
-
-static struct htree_node *find_node(struct tee_fs_htree *ht, size_t node_id)
-{
-	struct htree_node *node = find_closest_node(ht, node_id);
-
-	if (node && node->id == node_id)
-		return node;
-	return NULL;
-}
-
-static TEE_Result get_node(struct tee_fs_htree *ht, bool create,
-			   size_t node_id, struct htree_node **node_ret)
-{
-	struct htree_node *node;
-	struct htree_node *nc;
-	size_t n;
-
-	node = find_closest_node(ht, node_id);
-	if (!node)
-		return TEE_ERROR_GENERIC;
-	if (node->id == node_id)
-		goto ret_node;
-
-	/*
-	 * Trying to read beyond end of file should be caught earlier than
-	 * here.
-	 */
-	if (!create)
-		return TEE_ERROR_GENERIC;
-
-	/*
-	 * Add missing nodes, some nodes may already be there. When we've
-	 * processed the range all nodes up to node_id will be in the tree.
-	 */
-	for (n = node->id + 1; n <= node_id; n++) {
-		node = find_closest_node(ht, n);
-		if (node->id == n)
-			continue;
-		/* Node id n should be a child of node */
-		assert((n >> 1) == node->id);
-		assert(!node->child[n & 1]);
-
-		nc = calloc(1, sizeof(*nc));
-		if (!nc)
-			return TEE_ERROR_OUT_OF_MEMORY;
-		nc->id = n;
-		nc->parent = node;
-		node->child[n & 1] = nc;
-		node = nc;
-	}
-
-	if (node->id > ht->imeta.max_node_id)
-		ht->imeta.max_node_id = node->id;
-
-ret_node:
-	*node_ret = node;
-	return TEE_SUCCESS;
+	assert(node_id > 1);
+	return (node_id - 2) % ht->fanout;
 }
 
 static int get_idx_from_counter(uint32_t counter0, uint32_t counter1)
@@ -368,44 +358,15 @@ static TEE_Result init_head_from_data(struct tee_fs_htree *ht,
 	return TEE_SUCCESS;
 }
 
-static TEE_Result init_tree_from_data(struct tee_fs_htree *ht)
-{
-	TEE_Result res;
-	struct tee_fs_htree_node_image node_image;
-	struct htree_node *node;
-	struct htree_node *nc;
-	size_t committed_version;
-	size_t node_id = 2;
-
-	while (node_id <= ht->imeta.max_node_id) {
-		node = find_node(ht, node_id >> 1);
-		if (!node)
-			return TEE_ERROR_GENERIC;
-		committed_version = !!(node->node.flags &
-				    HTREE_NODE_COMMITTED_CHILD(node_id & 1));
-
-		res = rpc_read_node(ht, node_id, committed_version,
-				    &node_image);
-		if (res != TEE_SUCCESS)
-			return res;
-
-		res = get_node(ht, true, node_id, &nc);
-		if (res != TEE_SUCCESS)
-			return res;
-		nc->node = node_image;
-		node_id++;
-	}
-
-	return TEE_SUCCESS;
-}
-
-static TEE_Result calc_node_hash(struct htree_node *node,
+static TEE_Result calc_node_hash(struct tee_fs_htree *ht,
+				 struct htree_node *node,
 				 struct tee_fs_htree_meta *meta, void *ctx,
 				 uint8_t *digest)
 {
 	TEE_Result res;
 	uint8_t *ndata = (uint8_t *)&node->node + sizeof(node->node.hash);
 	size_t nsize = sizeof(node->node) - sizeof(node->node.hash);
+	size_t n;
 
 	res = crypto_hash_init(ctx);
 	if (res != TEE_SUCCESS)
@@ -421,16 +382,12 @@ static TEE_Result calc_node_hash(struct htree_node *node,
 			return res;
 	}
 
-	if (node->child[0]) {
-		res = crypto_hash_update(ctx, node->child[0]->node.hash,
-					 sizeof(node->child[0]->node.hash));
-		if (res != TEE_SUCCESS)
-			return res;
-	}
+	for (n = 0; n < ht->fanout; n++) {
+		if (!node->child[n])
+			continue;
 
-	if (node->child[1]) {
-		res = crypto_hash_update(ctx, node->child[1]->node.hash,
-					 sizeof(node->child[1]->node.hash));
+		res = crypto_hash_update(ctx, node->child[n]->node.hash,
+					 sizeof(node->child[n]->node.hash));
 		if (res != TEE_SUCCESS)
 			return res;
 	}
@@ -445,6 +402,7 @@ static TEE_Result authenc_init(void **ctx_ret, TEE_OperationMode mode,
 {
 	TEE_Result res = TEE_SUCCESS;
 	const uint32_t alg = TEE_FS_HTREE_AUTH_ENC_ALG;
+	uint8_t key[TEE_FS_HTREE_AUTH_ENC_KEY_SIZE] = { };
 	void *ctx;
 	size_t aad_len = TEE_FS_HTREE_FEK_SIZE + TEE_FS_HTREE_IV_SIZE;
 	uint8_t *iv;
@@ -466,9 +424,19 @@ static TEE_Result authenc_init(void **ctx_ret, TEE_OperationMode mode,
 	if (res != TEE_SUCCESS)
 		return res;
 
-	res = crypto_authenc_init(ctx, mode, ht->fek, TEE_FS_HTREE_FEK_SIZE, iv,
-				  TEE_FS_HTREE_IV_SIZE, TEE_FS_HTREE_TAG_SIZE,
-				  aad_len, payload_len);
+	if (IS_ENABLED(CFG_REE_FS_HTREE_CHACHA20_POLY1305)) {
+		/* ChaCha20 takes a 256-bit key, the FEK is 128 bits */
+		res = hash_sha256_compute(key, ht->fek, TEE_FS_HTREE_FEK_SIZE);
+		if (res != TEE_SUCCESS)
+			goto err_free;
+	} else {
+		memcpy(key, ht->fek, TEE_FS_HTREE_FEK_SIZE);
+	}
+
+	res = crypto_authenc_init(ctx, mode, key, sizeof(key), iv,
+				  TEE_FS_HTREE_AUTH_ENC_IV_SIZE,
+				  TEE_FS_HTREE_TAG_SIZE, aad_len, payload_len);
+	memzero_explicit(key, sizeof(key));
 	if (res != TEE_SUCCESS)
 		goto err_free;
 
@@ -562,37 +530,199 @@ static TEE_Result verify_root(struct tee_fs_htree *ht)
 				     sizeof(ht->imeta), &ht->imeta);
 }
 
-static TEE_Result verify_node(struct traverse_arg *targ,
-			      struct htree_node *node)
+/* Reads the committed images of the first count children of a node */
+static TEE_Result read_child_images(struct tee_fs_htree *ht,
+				    struct htree_node *node, size_t count,
+				    struct tee_fs_htree_node_image *images)
 {
-	void *ctx = targ->arg;
+	const size_t isize = sizeof(*images);
+	size_t first_id = ht->fanout * (node->id - 1) + 2;
+	size_t span_count;
+	uint8_t *span;
 	TEE_Result res;
-	uint8_t digest[TEE_FS_HTREE_HASH_SIZE];
+	size_t vers;
+	size_t n = 0;
+	size_t m;
+
+	while (n < count) {
+		span_count = count - n;
+		res = rpc_read_span(ht, TEE_FS_HTREE_TYPE_NODE,
+				    first_id + n - 1, isize, &span_count,
+				    &span);
+		if (res == TEE_ERROR_NOT_SUPPORTED) {
+			vers = !!(node->node.flags &
+				  HTREE_NODE_COMMITTED_CHILD(n));
+			res = rpc_read_node(ht, first_id + n, vers,
+					    images + n);
+			if (res != TEE_SUCCESS)
+				return res;
+			n++;
+			continue;
+		}
+		if (res != TEE_SUCCESS)
+			return res;
 
-	if (node->parent)
-		res = calc_node_hash(node, NULL, ctx, digest);
-	else
-		res = calc_node_hash(node, &targ->ht->imeta.meta, ctx, digest);
-	if (res == TEE_SUCCESS &&
-	    consttime_memcmp(digest, node->node.hash, sizeof(digest)))
-		return TEE_ERROR_CORRUPT_OBJECT;
+		for (m = 0; m < span_count; m++, n++) {
+			vers = !!(node->node.flags &
+				  HTREE_NODE_COMMITTED_CHILD(n));
+			memcpy(images + n, span + (2 * m + vers) * isize,
+			       isize);
+		}
+	}
 
-	return res;
+	return TEE_SUCCESS;
 }
 
-static TEE_Result verify_tree(struct tee_fs_htree *ht)
+/*
+ * Reads in the children of a node, if not already done, and checks the
+ * node against its hash. The hash is trusted since it's covered by the
+ * hash of the already verified parent or, for the root node, by the
+ * head. The hashes of the children are then trusted too while the rest
+ * of a child is verified once the child itself is accessed.
+ */
+static TEE_Result verify_node(struct tee_fs_htree *ht,
+			      struct htree_node *node)
 {
+	struct tee_fs_htree_node_image images[TEE_FS_HTREE_MAX_FANOUT];
+	struct tee_fs_htree_meta *meta = NULL;
+	uint8_t digest[TEE_FS_HTREE_HASH_SIZE];
+	size_t first_id = ht->fanout * (node->id - 1) + 2;
+	size_t count = 0;
+	struct htree_node *nc;
 	TEE_Result res;
 	void *ctx;
+	size_t n;
+
+	if (node->verified)
+		return TEE_SUCCESS;
+
+	if (first_id <= ht->imeta.max_node_id)
+		count = MIN(ht->fanout, ht->imeta.max_node_id - first_id + 1);
+
+	res = read_child_images(ht, node, count, images);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	for (n = 0; n < count; n++) {
+		if (node->child[n])
+			continue;
+
+		nc = calloc(1, sizeof(*nc));
+		if (!nc)
+			return TEE_ERROR_OUT_OF_MEMORY;
+
+		nc->node = images[n];
+		nc->id = first_id + n;
+		nc->parent = node;
+		node->child[n] = nc;
+	}
+
+	if (!node->parent)
+		meta = &ht->imeta.meta;
 
 	res = crypto_hash_alloc_ctx(&ctx, TEE_FS_HTREE_HASH_ALG);
 	if (res != TEE_SUCCESS)
 		return res;
 
-	res = htree_traverse_post_order(ht, verify_node, ctx);
+	res = calc_node_hash(ht, node, meta, ctx, digest);
 	crypto_hash_free_ctx(ctx);
+	if (res != TEE_SUCCESS)
+		return res;
 
-	return res;
+	if (consttime_memcmp(digest, node->node.hash, sizeof(digest)))
+		return TEE_ERROR_CORRUPT_OBJECT;
+
+	node->verified = true;
+
+	return TEE_SUCCESS;
+}
+
+/*
+ * Reads in and verifies the nodes on the path from the root node down to
+ * node_id, which must be present in the tree.
+ */
+static TEE_Result load_node(struct tee_fs_htree *ht, size_t node_id,
+			    struct htree_node **node_ret)
+{
+	struct htree_node *node = &ht->root;
+	uint8_t child_idx[HTREE_MAX_LEVELS];
+	size_t level = 0;
+	TEE_Result res;
+
+	assert(node_id == 1 || node_id <= ht->imeta.max_node_id);
+
+	/* Collect the path from the node up to the root node (1) */
+	while (node_id > 1) {
+		assert(level < ARRAY_SIZE(child_idx));
+		child_idx[level] = node_id_to_child_idx(ht, node_id);
+		node_id = node_id_to_parent_id(ht, node_id);
+		level++;
+	}
+
+	/* Follow the path downwards from the root node */
+	while (true) {
+		res = verify_node(ht, node);
+		if (res != TEE_SUCCESS)
+			return res;
+		if (!level)
+			break;
+
+		level--;
+		node = node->child[child_idx[level]];
+		if (!node)
+			return TEE_ERROR_GENERIC;
+	}
+
+	*node_ret = node;
+	return TEE_SUCCESS;
+}
+
+static TEE_Result get_node(struct tee_fs_htree *ht, bool create,
+			   size_t node_id, struct htree_node **node_ret)
+{
+	TEE_Result res;
+	struct htree_node *node;
+	struct htree_node *nc = NULL;
+	size_t n;
+
+	/* The root node is always there, even in an empty tree */
+	if (node_id == 1 || node_id <= ht->imeta.max_node_id) {
+		res = load_node(ht, node_id, node_ret);
+		if (res == TEE_SUCCESS && node_id > ht->imeta.max_node_id)
+			ht->imeta.max_node_id = node_id;
+		return res;
+	}
+
+	/*
+	 * Trying to read beyond end of file should be caught earlier than
+	 * here.
+	 */
+	if (!create)
+		return TEE_ERROR_GENERIC;
+
+	/*
+	 * Add the missing nodes, the parent of each is either already in
+	 * the tree or added in a previous iteration.
+	 */
+	for (n = MAX(ht->imeta.max_node_id, 1) + 1; n <= node_id; n++) {
+		res = load_node(ht, node_id_to_parent_id(ht, n), &node);
+		if (res != TEE_SUCCESS)
+			return res;
+		assert(!node->child[node_id_to_child_idx(ht, n)]);
+
+		nc = calloc(1, sizeof(*nc));
+		if (!nc)
+			return TEE_ERROR_OUT_OF_MEMORY;
+		nc->id = n;
+		nc->parent = node;
+		/* There's nothing in storage to verify a new node against */
+		nc->verified = true;
+		node->child[node_id_to_child_idx(ht, n)] = nc;
+		ht->imeta.max_node_id = n;
+	}
+
+	*node_ret = nc;
+	return TEE_SUCCESS;
 }
 
 static TEE_Result init_root_node(struct tee_fs_htree *ht)
@@ -606,18 +736,64 @@ static TEE_Result init_root_node(struct tee_fs_htree *ht)
 
 	ht->root.id = 1;
 	ht->root.dirty = true;
+	ht->root.verified = true;
 
-	res = calc_node_hash(&ht->root, &ht->imeta.meta, ctx,
+	res = calc_node_hash(ht, &ht->root, &ht->imeta.meta, ctx,
 			     ht->root.node.hash);
 	crypto_hash_free_ctx(ctx);
 
 	return res;
 }
 
+static bool format_is_valid(const struct tee_fs_htree_format *fmt)
+{
+	if (fmt->version == TEE_FS_HTREE_FORMAT_V1)
+		return true;
+
+	return fmt->version == TEE_FS_HTREE_FORMAT_V2 &&
+	       fmt->fanout >= 2 && fmt->fanout <= TEE_FS_HTREE_MAX_FANOUT &&
+	       fmt->block_shift >= TEE_FS_HTREE_MIN_BLOCK_SHIFT &&
+	       fmt->block_shift <= TEE_FS_HTREE_MAX_BLOCK_SHIFT;
+}
+
+static void init_format(struct tee_fs_htree *ht,
+			struct tee_fs_htree_format *fmt)
+{
+	if (fmt->version == TEE_FS_HTREE_FORMAT_V1) {
+		fmt->fanout = 2;
+		fmt->block_shift = __builtin_ctz(ht->stor->block_size);
+		ht->block_size = ht->stor->block_size;
+	} else {
+		ht->block_size = BIT(fmt->block_shift);
+	}
+	ht->fanout = fmt->fanout;
+}
+
+static TEE_Result init_format_from_data(struct tee_fs_htree *ht,
+					struct tee_fs_htree_format *fmt)
+{
+	/* Files created before the format was recorded have zeroes here */
+	if (!ht->imeta.format) {
+		fmt->version = TEE_FS_HTREE_FORMAT_V1;
+	} else {
+		fmt->version = ht->imeta.format;
+		fmt->fanout = ht->imeta.fanout;
+		fmt->block_shift = ht->imeta.block_shift;
+	}
+
+	if (!format_is_valid(fmt))
+		return TEE_ERROR_CORRUPT_OBJECT;
+
+	init_format(ht, fmt);
+
+	return TEE_SUCCESS;
+}
+
 TEE_Result tee_fs_htree_open(bool create, uint8_t *hash, uint32_t min_counter,
 			     const TEE_UUID *uuid,
 			     const struct tee_fs_htree_storage *stor,
-			     void *stor_aux, struct tee_fs_htree **ht_ret)
+			     void *stor_aux, struct tee_fs_htree_format *fmt,
+			     struct tee_fs_htree **ht_ret)
 {
 	TEE_Result res;
 	struct tee_fs_htree *ht = calloc(1, sizeof(*ht));
@@ -634,6 +810,18 @@ TEE_Result tee_fs_htree_open(bool create, uint8_t *hash, uint32_t min_counter,
 			.counter = min_counter,
 		};
 
+		if (!format_is_valid(fmt)) {
+			res = TEE_ERROR_BAD_PARAMETERS;
+			goto out;
+		}
+		init_format(ht, fmt);
+		/* Format v1 leaves the fields zeroed as it always has */
+		if (fmt->version != TEE_FS_HTREE_FORMAT_V1) {
+			ht->imeta.format = fmt->version;
+			ht->imeta.fanout = fmt->fanout;
+			ht->imeta.block_shift = fmt->block_shift;
+		}
+
 		res = crypto_rng_read(ht->fek, sizeof(ht->fek));
 		if (res != TEE_SUCCESS)
 			goto out;
@@ -661,11 +849,12 @@ TEE_Result tee_fs_htree_open(bool create, uint8_t *hash, uint32_t min_counter,
 		if (res != TEE_SUCCESS)
 			goto out;
 
-		res = init_tree_from_data(ht);
+		res = init_format_from_data(ht, fmt);
 		if (res != TEE_SUCCESS)
 			goto out;
 
-		res = verify_tree(ht);
+		/* Other nodes are verified when first accessed */
+		res = verify_node(ht, &ht->root);
 	}
 out:
 	if (res == TEE_SUCCESS)
@@ -716,12 +905,14 @@ static TEE_Result htree_sync_node_to_storage(struct traverse_arg *targ,
 	 * dirty.
 	 */
 	assert(node->dirty >= node->block_updated);
+	assert(node->verified >= node->dirty);
 
 	if (!node->dirty)
 		return TEE_SUCCESS;
 
 	if (node->parent) {
-		uint32_t f = HTREE_NODE_COMMITTED_CHILD(node->id & 1);
+		uint32_t f = HTREE_NODE_COMMITTED_CHILD(
+				node_id_to_child_idx(targ->ht, node->id));
 
 		node->parent->dirty = true;
 		node->parent->node.flags ^= f;
@@ -735,7 +926,8 @@ static TEE_Result htree_sync_node_to_storage(struct traverse_arg *targ,
 		meta = &targ->ht->imeta.meta;
 	}
 
-	res = calc_node_hash(node, meta, targ->arg, node->node.hash);
+	res = calc_node_hash(targ->ht, node, meta, targ->arg,
+			     node->node.hash);
 	if (res != TEE_SUCCESS)
 		return res;
 
@@ -844,11 +1036,11 @@ TEE_Result tee_fs_htree_write_block(struct tee_fs_htree **ht_arg,
 		goto out;
 
 	res = authenc_init(&ctx, TEE_MODE_ENCRYPT, ht, &node->node,
-			   ht->stor->block_size);
+			   ht->block_size);
 	if (res != TEE_SUCCESS)
 		goto out;
 	res = authenc_encrypt_final(ctx, node->node.tag, block,
-				    ht->stor->block_size, enc_block);
+				    ht->block_size, enc_block);
 	if (res != TEE_SUCCESS)
 		goto out;
 
@@ -865,69 +1057,176 @@ out:
 	return res;
 }
 
-TEE_Result tee_fs_htree_read_block(struct tee_fs_htree **ht_arg,
-				   size_t block_num, void *block)
+static TEE_Result decrypt_block(struct tee_fs_htree *ht,
+				struct htree_node *node, const void *enc_block,
+				void *block)
+{
+	TEE_Result res;
+	void *ctx;
+
+	res = authenc_init(&ctx, TEE_MODE_DECRYPT, ht, &node->node,
+			   ht->block_size);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	return authenc_decrypt_final(ctx, node->node.tag, enc_block,
+				     ht->block_size, block);
+}
+
+static TEE_Result read_block(struct tee_fs_htree *ht, struct htree_node *node,
+			     size_t block_num, void *block)
 {
-	struct tee_fs_htree *ht = *ht_arg;
 	TEE_Result res;
 	struct tee_fs_rpc_operation op;
-	struct htree_node *node;
 	uint8_t block_vers;
 	size_t len;
-	void *ctx;
 	void *enc_block;
 
-	if (!ht)
-		return TEE_ERROR_CORRUPT_OBJECT;
-
-	res = get_block_node(ht, false, block_num, &node);
-	if (res != TEE_SUCCESS)
-		goto out;
-
 	block_vers = !!(node->node.flags & HTREE_NODE_COMMITTED_BLOCK);
 	res = ht->stor->rpc_read_init(ht->stor_aux, &op,
 				      TEE_FS_HTREE_TYPE_BLOCK, block_num,
 				      block_vers, &enc_block);
 	if (res != TEE_SUCCESS)
-		goto out;
+		return res;
 
 	res = ht->stor->rpc_read_final(&op, &len);
 	if (res != TEE_SUCCESS)
-		goto out;
-	if (len != ht->stor->block_size) {
-		res = TEE_ERROR_CORRUPT_OBJECT;
-		goto out;
-	}
+		return res;
+	if (len != ht->block_size)
+		return TEE_ERROR_CORRUPT_OBJECT;
 
-	res = authenc_init(&ctx, TEE_MODE_DECRYPT, ht, &node->node,
-			   ht->stor->block_size);
-	if (res != TEE_SUCCESS)
-		goto out;
+	return decrypt_block(ht, node, enc_block, block);
+}
+
+TEE_Result tee_fs_htree_read_block(struct tee_fs_htree **ht_arg,
+				   size_t block_num, void *block)
+{
+	struct tee_fs_htree *ht = *ht_arg;
+	TEE_Result res;
+	struct htree_node *node;
+
+	if (!ht)
+		return TEE_ERROR_CORRUPT_OBJECT;
+
+	res = get_block_node(ht, false, block_num, &node);
+	if (res == TEE_SUCCESS)
+		res = read_block(ht, node, block_num, block);
 
-	res = authenc_decrypt_final(ctx, node->node.tag, enc_block,
-				    ht->stor->block_size, block);
-out:
 	if (res != TEE_SUCCESS)
 		tee_fs_htree_close(ht_arg);
 	return res;
 }
 
+TEE_Result tee_fs_htree_read_blocks(struct tee_fs_htree **ht_arg,
+				    size_t block_num, size_t count,
+				    void *block,
+				    TEE_Result (*cb)(void *arg,
+						     const void *block),
+				    void *cb_arg)
+{
+	struct htree_node *nodes[HTREE_READ_SPAN_BLOCKS];
+	struct tee_fs_htree *ht = *ht_arg;
+	size_t span_count;
+	uint8_t *span;
+	TEE_Result res;
+	size_t vers;
+	size_t n;
+
+	if (!ht)
+		return TEE_ERROR_CORRUPT_OBJECT;
+
+	while (count) {
+		/*
+		 * The nodes may have to be read in, which must be done
+		 * before the blocks are read into the shared buffer.
+		 */
+		span_count = MIN(count, ARRAY_SIZE(nodes));
+		for (n = 0; n < span_count; n++) {
+			res = get_block_node(ht, false, block_num + n,
+					     nodes + n);
+			if (res != TEE_SUCCESS)
+				goto err;
+		}
+
+		res = rpc_read_span(ht, TEE_FS_HTREE_TYPE_BLOCK, block_num,
+				    ht->block_size, &span_count, &span);
+		if (res == TEE_ERROR_NOT_SUPPORTED) {
+			span = NULL;
+			span_count = 1;
+		} else if (res != TEE_SUCCESS) {
+			goto err;
+		}
+
+		for (n = 0; n < span_count; n++) {
+			if (span) {
+				vers = !!(nodes[n]->node.flags &
+					  HTREE_NODE_COMMITTED_BLOCK);
+				res = decrypt_block(ht, nodes[n],
+						    span + (2 * n + vers) *
+							   ht->block_size,
+						    block);
+			} else {
+				res = read_block(ht, nodes[n], block_num + n,
+						 block);
+			}
+			if (res != TEE_SUCCESS)
+				goto err;
+			res = cb(cb_arg, block);
+			if (res != TEE_SUCCESS)
+				return res;
+		}
+
+		block_num += span_count;
+		count -= span_count;
+	}
+
+	return TEE_SUCCESS;
+err:
+	tee_fs_htree_close(ht_arg);
+	return res;
+}
+
+static bool __maybe_unused node_has_children(struct tee_fs_htree *ht,
+					     struct htree_node *node)
+{
+	size_t n = 0;
+
+	for (n = 0; n < ht->fanout; n++)
+		if (node->child[n])
+			return true;
+
+	return false;
+}
+
 TEE_Result tee_fs_htree_truncate(struct tee_fs_htree **ht_arg, size_t block_num)
 {
 	struct tee_fs_htree *ht = *ht_arg;
 	size_t node_id = BLOCK_NUM_TO_NODE_ID(block_num);
+	struct htree_node *parent;
 	struct htree_node *node;
+	size_t child_idx;
+	TEE_Result res;
 
 	if (!ht)
 		return TEE_ERROR_CORRUPT_OBJECT;
 
 	while (node_id < ht->imeta.max_node_id) {
-		node = find_closest_node(ht, ht->imeta.max_node_id);
+		res = load_node(ht,
+				node_id_to_parent_id(ht, ht->imeta.max_node_id),
+				&parent);
+		if (res != TEE_SUCCESS) {
+			tee_fs_htree_close(ht_arg);
+			return res;
+		}
+		child_idx = node_id_to_child_idx(ht, ht->imeta.max_node_id);
+		node = parent->child[child_idx];
 		assert(node && node->id == ht->imeta.max_node_id);
-		assert(!node->child[0] && !node->child[1]);
-		assert(node->parent);
-		assert(node->parent->child[node->id & 1] == node);
-		node->parent->child[node->id & 1] = NULL;
+		/* The last node can't have any children */
+		assert(!node_has_children(ht, node));
+		assert(node->parent == parent);
+		parent->child[child_idx] = NULL;
+		/* The hash of the parent must not cover the node any longer */
+		parent->dirty = true;
 		free(node);
 		ht->imeta.max_node_id--;
 		ht->dirty = true;
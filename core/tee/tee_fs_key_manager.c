@@ -173,103 +173,110 @@ static TEE_Result sha256(uint8_t *out, size_t out_size, const uint8_t *in,
 				     out, out_size);
 }
 
-static TEE_Result aes_ecb(uint8_t out[TEE_AES_BLOCK_SIZE],
-			  const uint8_t in[TEE_AES_BLOCK_SIZE],
-			  const uint8_t *key, size_t key_size)
+void tee_fs_crypt_ctx_final(struct tee_fs_crypt_ctx *c)
 {
-	TEE_Result res;
-	void *ctx = NULL;
+	crypto_cipher_free_ctx(c->essiv_ctx);
+	crypto_cipher_free_ctx(c->ctx);
+	memzero_explicit(c, sizeof(*c));
+}
+
+/*
+ * Encryption/decryption of RPMB FS file data. This is AES CBC with ESSIV.
+ * The FEK, the ESSIV key and the cipher contexts only depend on the file
+ * so they're set up once for all the blocks of a request.
+ */
+TEE_Result tee_fs_crypt_ctx_init(struct tee_fs_crypt_ctx *c,
+				 const TEE_UUID *uuid,
+				 const uint8_t *encrypted_fek)
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+	uint8_t sha[TEE_SHA256_HASH_SIZE] = { };
+
+	memset(c, 0, sizeof(*c));
 
-	res = crypto_cipher_alloc_ctx(&ctx, TEE_ALG_AES_ECB_NOPAD);
+	/* Decrypt FEK */
+	res = tee_fs_fek_crypt(uuid, TEE_MODE_DECRYPT, encrypted_fek,
+			       TEE_FS_KM_FEK_SIZE, c->fek);
 	if (res != TEE_SUCCESS)
-		return res;
+		goto err;
 
-	res = crypto_cipher_init(ctx, TEE_MODE_ENCRYPT, key,
-				 key_size, NULL, 0, NULL, 0);
+	/* The ESSIV key is the first half of the hash of the FEK */
+	res = sha256(sha, sizeof(sha), c->fek, TEE_FS_KM_FEK_SIZE);
 	if (res != TEE_SUCCESS)
-		goto out;
+		goto err;
 
-	res = crypto_cipher_update(ctx, TEE_MODE_ENCRYPT, true, in,
-				   TEE_AES_BLOCK_SIZE, out);
+	res = crypto_cipher_alloc_ctx(&c->essiv_ctx, TEE_ALG_AES_ECB_NOPAD);
 	if (res != TEE_SUCCESS)
-		goto out;
+		goto err;
 
-	crypto_cipher_final(ctx);
-	res = TEE_SUCCESS;
+	res = crypto_cipher_init(c->essiv_ctx, TEE_MODE_ENCRYPT, sha,
+				 TEE_AES_BLOCK_SIZE, NULL, 0, NULL, 0);
+	if (res != TEE_SUCCESS)
+		goto err;
 
-out:
-	crypto_cipher_free_ctx(ctx);
+	res = crypto_cipher_alloc_ctx(&c->ctx, TEE_ALG_AES_CBC_NOPAD);
+	if (res != TEE_SUCCESS)
+		goto err;
+
+	memzero_explicit(sha, sizeof(sha));
+	return TEE_SUCCESS;
+err:
+	memzero_explicit(sha, sizeof(sha));
+	tee_fs_crypt_ctx_final(c);
 	return res;
 }
 
-static TEE_Result essiv(uint8_t iv[TEE_AES_BLOCK_SIZE],
-			const uint8_t fek[TEE_FS_KM_FEK_SIZE],
-			uint16_t blk_idx)
+TEE_Result tee_fs_crypt_ctx_block(struct tee_fs_crypt_ctx *c, uint8_t *out,
+				  const uint8_t *in, size_t size,
+				  uint16_t blk_idx, TEE_OperationMode mode)
 {
-	TEE_Result res;
-	uint8_t sha[TEE_SHA256_HASH_SIZE];
+	TEE_Result res = TEE_ERROR_GENERIC;
 	uint8_t pad_blkid[TEE_AES_BLOCK_SIZE] = { 0, };
+	uint8_t iv[TEE_AES_BLOCK_SIZE] = { };
 
-	res = sha256(sha, sizeof(sha), fek, TEE_FS_KM_FEK_SIZE);
-	if (res != TEE_SUCCESS)
-		return res;
+	DMSG("%scrypt block #%u", (mode == TEE_MODE_ENCRYPT) ? "En" : "De",
+	     blk_idx);
 
+	/* Compute initialization vector for this block */
 	pad_blkid[0] = (blk_idx & 0xFF);
 	pad_blkid[1] = (blk_idx & 0xFF00) >> 8;
 
-	res = aes_ecb(iv, pad_blkid, sha, 16);
+	res = crypto_cipher_update(c->essiv_ctx, TEE_MODE_ENCRYPT, false,
+				   pad_blkid, TEE_AES_BLOCK_SIZE, iv);
+	if (res != TEE_SUCCESS)
+		goto out;
 
-	memzero_explicit(sha, sizeof(sha));
+	/* Run AES CBC */
+	res = crypto_cipher_init(c->ctx, mode, c->fek, sizeof(c->fek), NULL,
+				 0, iv, TEE_AES_BLOCK_SIZE);
+	if (res != TEE_SUCCESS)
+		goto out;
+	res = crypto_cipher_update(c->ctx, mode, true, in, size, out);
+	if (res != TEE_SUCCESS)
+		goto out;
+
+	crypto_cipher_final(c->ctx);
+
+out:
+	memzero_explicit(iv, sizeof(iv));
 	return res;
 }
 
-/*
- * Encryption/decryption of RPMB FS file data. This is AES CBC with ESSIV.
- */
 TEE_Result tee_fs_crypt_block(const TEE_UUID *uuid, uint8_t *out,
 			      const uint8_t *in, size_t size,
 			      uint16_t blk_idx, const uint8_t *encrypted_fek,
 			      TEE_OperationMode mode)
 {
-	TEE_Result res;
-	uint8_t fek[TEE_FS_KM_FEK_SIZE];
-	uint8_t iv[TEE_AES_BLOCK_SIZE];
-	void *ctx;
-
-	DMSG("%scrypt block #%u", (mode == TEE_MODE_ENCRYPT) ? "En" : "De",
-	     blk_idx);
-
-	/* Decrypt FEK */
-	res = tee_fs_fek_crypt(uuid, TEE_MODE_DECRYPT, encrypted_fek,
-			       TEE_FS_KM_FEK_SIZE, fek);
-	if (res != TEE_SUCCESS)
-		goto wipe;
-
-	/* Compute initialization vector for this block */
-	res = essiv(iv, fek, blk_idx);
-	if (res != TEE_SUCCESS)
-		goto wipe;
+	struct tee_fs_crypt_ctx c = { };
+	TEE_Result res = TEE_ERROR_GENERIC;
 
-	/* Run AES CBC */
-	res = crypto_cipher_alloc_ctx(&ctx, TEE_ALG_AES_CBC_NOPAD);
-	if (res != TEE_SUCCESS)
-		goto wipe;
-
-	res = crypto_cipher_init(ctx, mode, fek, sizeof(fek), NULL,
-				 0, iv, TEE_AES_BLOCK_SIZE);
+	res = tee_fs_crypt_ctx_init(&c, uuid, encrypted_fek);
 	if (res != TEE_SUCCESS)
-		goto exit;
-	res = crypto_cipher_update(ctx, mode, true, in, size, out);
-	if (res != TEE_SUCCESS)
-		goto exit;
+		return res;
 
-	crypto_cipher_final(ctx);
+	res = tee_fs_crypt_ctx_block(&c, out, in, size, blk_idx, mode);
+	tee_fs_crypt_ctx_final(&c);
 
-exit:
-	crypto_cipher_free_ctx(ctx);
-wipe:
-	memzero_explicit(fek, sizeof(fek));
-	memzero_explicit(iv, sizeof(iv));
 	return res;
 }
 
@@ -10,6 +10,7 @@
 #include <tee/tee_obj.h>
 #include <tee/tee_pobj.h>
 #include <tee/tee_svc_cryp.h>
+#include <tee/tee_svc_storage.h>
 #include <trace.h>
 
 void tee_obj_add(struct user_ta_ctx *utc, struct tee_obj *o)
@@ -64,6 +65,7 @@ TEE_Result tee_obj_verify(struct tee_ta_session *sess, struct tee_obj *o)
 	if (res == TEE_ERROR_CORRUPT_OBJECT) {
 		EMSG("Object corrupt");
 		fops->remove(o->pobj);
+		tee_svc_storage_invalidate_head(o->pobj);
 		tee_obj_close(to_user_ta_ctx(sess->ts_sess.ctx), o);
 	}
 
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <tee/tee_pobj.h>
+#include <tee/tee_svc_storage.h>
 
 static TAILQ_HEAD(tee_pobjs, tee_pobj) tee_pobjs =
 		TAILQ_HEAD_INITIALIZER(tee_pobjs);
@@ -166,6 +167,8 @@ TEE_Result tee_pobj_release(struct tee_pobj *obj)
 	mutex_lock(&pobjs_mutex);
 	obj->refcnt--;
 	if (obj->refcnt == 0) {
+		/* Secret attributes aren't kept once the object is closed */
+		tee_svc_storage_invalidate_head(obj);
 		TAILQ_REMOVE(&tee_pobjs, obj, link);
 		free(obj->obj_id);
 		free(obj);
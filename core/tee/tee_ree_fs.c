@@ -15,6 +15,7 @@
 #include <mm/tee_pager.h>
 #include <optee_rpc_cmd.h>
 #include <stdlib.h>
+#include <stdlib_ext.h>
 #include <string.h>
 #include <sys/queue.h>
 #include <tee/fs_dirfile.h>
@@ -22,6 +23,7 @@
 #include <tee/tee_fs.h>
 #include <tee/tee_fs_rpc.h>
 #include <tee/tee_pobj.h>
+#include <tee/tee_svc_storage.h>
 #include <trace.h>
 #include <utee_defines.h>
 #include <util.h>
@@ -30,11 +32,39 @@
 
 #define BLOCK_SIZE	(1 << BLOCK_SHIFT)
 
+/* Max size of a read of several nodes or data blocks with a single RPC */
+#define READ_SPAN_MAX_SIZE	(32 * BLOCK_SIZE)
+
+static_assert(CFG_REE_FS_HTREE_FANOUT >= 2 &&
+	      CFG_REE_FS_HTREE_FANOUT <= TEE_FS_HTREE_MAX_FANOUT);
+static_assert(CFG_REE_FS_BLOCK_SHIFT >= TEE_FS_HTREE_MIN_BLOCK_SHIFT &&
+	      CFG_REE_FS_BLOCK_SHIFT <= TEE_FS_HTREE_MAX_BLOCK_SHIFT);
+
+/*
+ * Format of new files. Files in another format, typically format v1
+ * files created before the configuration was changed, are still read
+ * in place and are migrated to this format when first written, see
+ * migrate_file().
+ * The default configuration gives format v1 which is understood by all
+ * versions of OP-TEE.
+ */
+static const struct tee_fs_htree_format ree_fs_format = {
+	.version = (CFG_REE_FS_HTREE_FANOUT == 2 &&
+		    CFG_REE_FS_BLOCK_SHIFT == BLOCK_SHIFT) ?
+		   TEE_FS_HTREE_FORMAT_V1 : TEE_FS_HTREE_FORMAT_V2,
+	.fanout = CFG_REE_FS_HTREE_FANOUT,
+	.block_shift = CFG_REE_FS_BLOCK_SHIFT,
+};
+
 struct tee_fs_fd {
 	struct tee_fs_htree *ht;
+	struct tee_fs_htree_format fmt;
 	int fd;
 	struct tee_fs_dirfile_fileh dfh;
 	const TEE_UUID *uuid;
+	/* Set when updates of the file have been discarded, see ree_fs_fds */
+	bool discarded;
+	LIST_ENTRY(tee_fs_fd) link;
 };
 
 struct tee_fs_dir {
@@ -44,21 +74,33 @@ struct tee_fs_dir {
 	const TEE_UUID *uuid;
 };
 
-static int pos_to_block_num(int position)
+static size_t get_block_size(struct tee_fs_fd *fdp)
 {
-	return position >> BLOCK_SHIFT;
+	return BIT(fdp->fmt.block_shift);
+}
+
+static int pos_to_block_num(struct tee_fs_fd *fdp, int position)
+{
+	return position >> fdp->fmt.block_shift;
 }
 
 static struct mutex ree_fs_mutex = MUTEX_INITIALIZER;
 
-static void *get_tmp_block(void)
+static void *get_tmp_block(struct tee_fs_fd *fdp)
 {
+	/* Larger blocks would take too much of the default mempool */
+	if (get_block_size(fdp) > BLOCK_SIZE)
+		return malloc(get_block_size(fdp));
+
 	return mempool_alloc(mempool_default, BLOCK_SIZE);
 }
 
-static void put_tmp_block(void *tmp_block)
+static void put_tmp_block(struct tee_fs_fd *fdp, void *tmp_block)
 {
-	mempool_free(mempool_default, tmp_block);
+	if (get_block_size(fdp) > BLOCK_SIZE)
+		free(tmp_block);
+	else
+		mempool_free(mempool_default, tmp_block);
 }
 
 static TEE_Result out_of_place_write(struct tee_fs_fd *fdp, size_t pos,
@@ -66,8 +108,9 @@ static TEE_Result out_of_place_write(struct tee_fs_fd *fdp, size_t pos,
 				     const void *buf_user, size_t len)
 {
 	TEE_Result res;
-	size_t start_block_num = pos_to_block_num(pos);
-	size_t end_block_num = pos_to_block_num(pos + len - 1);
+	size_t start_block_num = pos_to_block_num(fdp, pos);
+	size_t end_block_num = pos_to_block_num(fdp, pos + len - 1);
+	size_t block_size = get_block_size(fdp);
 	size_t remain_bytes = len;
 	uint8_t *data_core_ptr = (uint8_t *)buf_core;
 	uint8_t *data_user_ptr = (uint8_t *)buf_user;
@@ -82,25 +125,25 @@ static TEE_Result out_of_place_write(struct tee_fs_fd *fdp, size_t pos,
 	if (!len)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	block = get_tmp_block();
+	block = get_tmp_block(fdp);
 	if (!block)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
 	while (start_block_num <= end_block_num) {
-		size_t offset = pos % BLOCK_SIZE;
-		size_t size_to_write = MIN(remain_bytes, (size_t)BLOCK_SIZE);
+		size_t offset = pos % block_size;
+		size_t size_to_write = MIN(remain_bytes, block_size);
 
-		if (size_to_write + offset > BLOCK_SIZE)
-			size_to_write = BLOCK_SIZE - offset;
+		if (size_to_write + offset > block_size)
+			size_to_write = block_size - offset;
 
-		if (start_block_num * BLOCK_SIZE <
-		    ROUNDUP(meta->length, BLOCK_SIZE)) {
+		if (start_block_num * block_size <
+		    ROUNDUP(meta->length, block_size)) {
 			res = tee_fs_htree_read_block(&fdp->ht,
 						      start_block_num, block);
 			if (res != TEE_SUCCESS)
 				goto exit;
 		} else {
-			memset(block, 0, BLOCK_SIZE);
+			memset(block, 0, block_size);
 		}
 
 		if (data_core_ptr) {
@@ -135,15 +178,19 @@ static TEE_Result out_of_place_write(struct tee_fs_fd *fdp, size_t pos,
 
 exit:
 	if (block)
-		put_tmp_block(block);
+		put_tmp_block(fdp, block);
 	return res;
 }
 
-static TEE_Result get_offs_size(enum tee_fs_htree_type type, size_t idx,
+static TEE_Result get_offs_size(struct tee_fs_fd *fdp,
+				enum tee_fs_htree_type type, size_t idx,
 				uint8_t vers, size_t *offs, size_t *size)
 {
 	const size_t node_size = sizeof(struct tee_fs_htree_node_image);
 	const size_t block_nodes = BLOCK_SIZE / (node_size * 2);
+	const size_t block_size = get_block_size(fdp);
+	size_t group_size;
+	size_t group_offs;
 	size_t pbn;
 	size_t bidx;
 
@@ -197,13 +244,57 @@ static TEE_Result get_offs_size(enum tee_fs_htree_type type, size_t idx,
 	 * phys block 66:
 	 * data block 31 vers 1
 	 * ...
+	 *
+	 * With format v2 the heads and node images are stored as above in
+	 * BLOCK_SIZE large areas, each area of node images is followed by
+	 * the data blocks of the same nodes in both versions:
+	 *
+	 * offs = 0:
+	 * tee_fs_htree_image vers 0 and 1
+	 *
+	 * offs = BLOCK_SIZE:
+	 * tee_fs_htree_node_image 0 .. 30 vers 0 and 1
+	 *
+	 * offs = BLOCK_SIZE * 2:
+	 * data block 0 vers 0, data block 0 vers 1, ...
+	 * data block 30 vers 0, data block 30 vers 1
+	 *
+	 * offs = BLOCK_SIZE * 2 + block_size * 62:
+	 * tee_fs_htree_node_image 31 .. 61 vers 0 and 1
+	 * ...
+	 *
+	 * The root node is at the same offset in both formats so it can
+	 * be read before the format of the file is known.
 	 */
 
-	switch (type) {
-	case TEE_FS_HTREE_TYPE_HEAD:
+	if (type == TEE_FS_HTREE_TYPE_HEAD) {
 		*offs = sizeof(struct tee_fs_htree_image) * vers;
 		*size = sizeof(struct tee_fs_htree_image);
 		return TEE_SUCCESS;
+	}
+
+	if (fdp->fmt.version != TEE_FS_HTREE_FORMAT_V1) {
+		group_size = BLOCK_SIZE + block_nodes * 2 * block_size;
+		group_offs = BLOCK_SIZE + (idx / block_nodes) * group_size;
+
+		switch (type) {
+		case TEE_FS_HTREE_TYPE_NODE:
+			*offs = group_offs +
+				2 * node_size * (idx % block_nodes) +
+				node_size * vers;
+			*size = node_size;
+			return TEE_SUCCESS;
+		case TEE_FS_HTREE_TYPE_BLOCK:
+			*offs = group_offs + BLOCK_SIZE +
+				(2 * (idx % block_nodes) + vers) * block_size;
+			*size = block_size;
+			return TEE_SUCCESS;
+		default:
+			return TEE_ERROR_GENERIC;
+		}
+	}
+
+	switch (type) {
 	case TEE_FS_HTREE_TYPE_NODE:
 		pbn = 1 + ((idx / block_nodes) * block_nodes * 2);
 		*offs = pbn * BLOCK_SIZE +
@@ -232,7 +323,7 @@ static TEE_Result ree_fs_rpc_read_init(void *aux,
 	size_t offs;
 	size_t size;
 
-	res = get_offs_size(type, idx, vers, &offs, &size);
+	res = get_offs_size(fdp, type, idx, vers, &offs, &size);
 	if (res != TEE_SUCCESS)
 		return res;
 
@@ -240,6 +331,46 @@ static TEE_Result ree_fs_rpc_read_init(void *aux,
 				    offs, size, data);
 }
 
+static TEE_Result ree_fs_rpc_read_span_init(void *aux,
+					    struct tee_fs_rpc_operation *op,
+					    enum tee_fs_htree_type type,
+					    size_t idx, size_t *count,
+					    void **data)
+{
+	struct tee_fs_fd *fdp = aux;
+	size_t max_count;
+	TEE_Result res;
+	size_t offs;
+	size_t size;
+	size_t o;
+	size_t s;
+	size_t n;
+	size_t v;
+
+	res = get_offs_size(fdp, type, idx, 0, &offs, &size);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	/* Extend the span as long as the elements are stored back to back */
+	max_count = MIN(*count, MAX(READ_SPAN_MAX_SIZE / (2 * size), 1U));
+	for (n = 0; n < max_count; n++) {
+		for (v = 0; v < 2; v++) {
+			res = get_offs_size(fdp, type, idx + n, v, &o, &s);
+			if (res != TEE_SUCCESS)
+				return res;
+			if (o != offs + (2 * n + v) * size)
+				goto out;
+		}
+	}
+out:
+	if (!n)
+		return TEE_ERROR_NOT_SUPPORTED;
+	*count = n;
+
+	return tee_fs_rpc_read_init(op, OPTEE_RPC_CMD_FS, fdp->fd,
+				    offs, 2 * n * size, data);
+}
+
 static TEE_Result ree_fs_rpc_write_init(void *aux,
 					struct tee_fs_rpc_operation *op,
 					enum tee_fs_htree_type type, size_t idx,
@@ -250,7 +381,7 @@ static TEE_Result ree_fs_rpc_write_init(void *aux,
 	size_t offs;
 	size_t size;
 
-	res = get_offs_size(type, idx, vers, &offs, &size);
+	res = get_offs_size(fdp, type, idx, vers, &offs, &size);
 	if (res != TEE_SUCCESS)
 		return res;
 
@@ -264,6 +395,7 @@ static const struct tee_fs_htree_storage ree_fs_storage_ops = {
 	.rpc_read_final = tee_fs_rpc_read_final,
 	.rpc_write_init = ree_fs_rpc_write_init,
 	.rpc_write_final = tee_fs_rpc_write_final,
+	.rpc_read_span_init = ree_fs_rpc_read_span_init,
 };
 
 static TEE_Result ree_fs_ftruncate_internal(struct tee_fs_fd *fdp,
@@ -283,14 +415,15 @@ static TEE_Result ree_fs_ftruncate_internal(struct tee_fs_fd *fdp,
 		size_t offs;
 		size_t sz;
 
-		res = get_offs_size(TEE_FS_HTREE_TYPE_BLOCK,
-				    ROUNDUP_DIV(new_file_len, BLOCK_SIZE), 1,
+		res = get_offs_size(fdp, TEE_FS_HTREE_TYPE_BLOCK,
+				    ROUNDUP_DIV(new_file_len,
+						get_block_size(fdp)), 1,
 				    &offs, &sz);
 		if (res != TEE_SUCCESS)
 			return res;
 
-		res = tee_fs_htree_truncate(&fdp->ht,
-					    new_file_len / BLOCK_SIZE);
+		res = tee_fs_htree_truncate(&fdp->ht, new_file_len /
+						      get_block_size(fdp));
 		if (res != TEE_SUCCESS)
 			return res;
 
@@ -306,6 +439,40 @@ static TEE_Result ree_fs_ftruncate_internal(struct tee_fs_fd *fdp,
 	return TEE_SUCCESS;
 }
 
+struct read_arg {
+	size_t offset;
+	size_t block_size;
+	size_t remain_bytes;
+	uint8_t *data_core_ptr;
+	uint8_t *data_user_ptr;
+};
+
+static TEE_Result read_block_cb(void *arg, const void *block)
+{
+	struct read_arg *ra = arg;
+	size_t size_to_read = MIN(ra->remain_bytes,
+				  ra->block_size - ra->offset);
+	TEE_Result res = TEE_SUCCESS;
+
+	if (ra->data_core_ptr) {
+		memcpy(ra->data_core_ptr, (uint8_t *)block + ra->offset,
+		       size_to_read);
+		ra->data_core_ptr += size_to_read;
+	} else if (ra->data_user_ptr) {
+		res = copy_to_user(ra->data_user_ptr,
+				   (uint8_t *)block + ra->offset,
+				   size_to_read);
+		if (res)
+			return res;
+		ra->data_user_ptr += size_to_read;
+	}
+
+	ra->remain_bytes -= size_to_read;
+	ra->offset = 0;
+
+	return TEE_SUCCESS;
+}
+
 static TEE_Result ree_fs_read_primitive(struct tee_file_handle *fh, size_t pos,
 					void *buf_core, void *buf_user,
 					size_t *len)
@@ -314,11 +481,10 @@ static TEE_Result ree_fs_read_primitive(struct tee_file_handle *fh, size_t pos,
 	int start_block_num;
 	int end_block_num;
 	size_t remain_bytes;
-	uint8_t *data_core_ptr = buf_core;
-	uint8_t *data_user_ptr = buf_user;
 	uint8_t *block = NULL;
 	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
 	struct tee_fs_htree_meta *meta = tee_fs_htree_get_meta(fdp->ht);
+	struct read_arg ra = { };
 
 	/* One of buf_core and buf_user must be NULL */
 	assert(!buf_core || !buf_user);
@@ -336,56 +502,42 @@ static TEE_Result ree_fs_read_primitive(struct tee_file_handle *fh, size_t pos,
 		goto exit;
 	}
 
-	start_block_num = pos_to_block_num(pos);
-	end_block_num = pos_to_block_num(pos + remain_bytes - 1);
+	start_block_num = pos_to_block_num(fdp, pos);
+	end_block_num = pos_to_block_num(fdp, pos + remain_bytes - 1);
 
-	block = get_tmp_block();
+	block = get_tmp_block(fdp);
 	if (!block) {
 		res = TEE_ERROR_OUT_OF_MEMORY;
 		goto exit;
 	}
 
-	while (start_block_num <= end_block_num) {
-		size_t offset = pos % BLOCK_SIZE;
-		size_t size_to_read = MIN(remain_bytes, (size_t)BLOCK_SIZE);
-
-		if (size_to_read + offset > BLOCK_SIZE)
-			size_to_read = BLOCK_SIZE - offset;
-
-		res = tee_fs_htree_read_block(&fdp->ht, start_block_num, block);
-		if (res != TEE_SUCCESS)
-			goto exit;
-
-		if (data_core_ptr) {
-			memcpy(data_core_ptr, block + offset, size_to_read);
-			data_core_ptr += size_to_read;
-		} else if (data_user_ptr) {
-			res = copy_to_user(data_user_ptr, block + offset,
-					   size_to_read);
-			if (res)
-				goto exit;
-			data_user_ptr += size_to_read;
-		}
-
-		remain_bytes -= size_to_read;
-		pos += size_to_read;
-
-		start_block_num++;
-	}
-	res = TEE_SUCCESS;
+	ra = (struct read_arg){
+		.block_size = get_block_size(fdp),
+		.offset = pos % get_block_size(fdp),
+		.remain_bytes = remain_bytes,
+		.data_core_ptr = buf_core,
+		.data_user_ptr = buf_user,
+	};
+	res = tee_fs_htree_read_blocks(&fdp->ht, start_block_num,
+				       end_block_num - start_block_num + 1,
+				       block, read_block_cb, &ra);
 exit:
 	if (block)
-		put_tmp_block(block);
+		put_tmp_block(fdp, block);
 	return res;
 }
 
 static TEE_Result ree_fs_read(struct tee_file_handle *fh, size_t pos,
 			      void *buf_core, void *buf_user, size_t *len)
 {
+	struct tee_fs_fd *fdp = (struct tee_fs_fd *)fh;
 	TEE_Result res;
 
 	mutex_lock(&ree_fs_mutex);
-	res = ree_fs_read_primitive(fh, pos, buf_core, buf_user, len);
+	if (fdp->discarded)
+		res = TEE_ERROR_BAD_STATE;
+	else
+		res = ree_fs_read_primitive(fh, pos, buf_core, buf_user, len);
 	mutex_unlock(&ree_fs_mutex);
 
 	return res;
@@ -433,6 +585,8 @@ static TEE_Result ree_fs_open_primitive(bool create, uint8_t *hash,
 		return TEE_ERROR_OUT_OF_MEMORY;
 	fdp->fd = -1;
 	fdp->uuid = uuid;
+	if (create)
+		fdp->fmt = ree_fs_format;
 
 	if (create)
 		res = tee_fs_rpc_create_dfh(OPTEE_RPC_CMD_FS,
@@ -444,7 +598,7 @@ static TEE_Result ree_fs_open_primitive(bool create, uint8_t *hash,
 		goto out;
 
 	res = tee_fs_htree_open(create, hash, min_counter, uuid,
-				&ree_fs_storage_ops, fdp, &fdp->ht);
+				&ree_fs_storage_ops, fdp, &fdp->fmt, &fdp->ht);
 out:
 	if (res == TEE_SUCCESS) {
 		if (dfh)
@@ -658,6 +812,373 @@ static void close_dirh(struct tee_fs_dirfile_dirh **dirh)
 }
 #endif /*!CFG_REE_FS_INTEGRITY_RPMB*/
 
+/*
+ * While a TA has a batch open the updates of dirf.db done by its
+ * operations aren't committed one by one, instead they're left pending
+ * until the batch ends. The hash in RPMB or the monotonic counter is then
+ * only updated once for the whole batch.
+ *
+ * Object files that must be left untouched until the pending updates are
+ * committed are tracked in ree_fs_pending[]:
+ * REE_FS_PENDING_SYNCED:  synced since the last commit, the committed
+ *			   dirf.db refers to the other version of the head
+ *			   and the blocks, so it can't be written again
+ * REE_FS_PENDING_CREATED: created since the last commit, not referenced
+ *			   by the committed dirf.db
+ * REE_FS_PENDING_REMOVE:  removed or replaced, to be deleted once the
+ *			   removal is committed
+ *
+ * The pending updates are committed ahead of time when this is needed to
+ * write a file again or when ree_fs_pending[] is full. Any operation
+ * committing dirf.db commits the pending updates of all batches and any
+ * failure closing dirf.db discards them.
+ */
+#define REE_FS_PENDING_MAX	32
+
+enum ree_fs_pending_state {
+	REE_FS_PENDING_SYNCED,
+	REE_FS_PENDING_CREATED,
+	REE_FS_PENDING_REMOVE,
+};
+
+struct ree_fs_pending_file {
+	uint32_t file_number;
+	enum ree_fs_pending_state state;
+};
+
+/*
+ * struct ree_fs_batch - batch opened by a TA
+ * @uuid:	UUID of the TA
+ * @refcount:	number of times the batch has been begun by the instances
+ *		or sessions of the TA
+ * @discarded:	pending updates have been discarded since the batch began,
+ *		reported by each end of the batch until the last one
+ * @link:	link in ree_fs_batches
+ */
+struct ree_fs_batch {
+	TEE_UUID uuid;
+	size_t refcount;
+	bool discarded;
+	SLIST_ENTRY(ree_fs_batch) link;
+};
+
+static SLIST_HEAD(, ree_fs_batch) ree_fs_batches =
+	SLIST_HEAD_INITIALIZER(ree_fs_batches);
+static struct ree_fs_pending_file ree_fs_pending[REE_FS_PENDING_MAX];
+static size_t ree_fs_pending_count;
+static bool ree_fs_pending_commit;
+/*
+ * Handles of object files opened by ree_fs_open() or ree_fs_create(). A
+ * handle of a file in ree_fs_pending[] doesn't match dirf.db any longer
+ * once the pending updates are discarded and can't be used after that.
+ */
+static LIST_HEAD(, tee_fs_fd) ree_fs_fds = LIST_HEAD_INITIALIZER(ree_fs_fds);
+
+static struct ree_fs_batch *find_batch(const TEE_UUID *uuid)
+{
+	struct ree_fs_batch *b = NULL;
+
+	SLIST_FOREACH(b, &ree_fs_batches, link)
+		if (!memcmp(&b->uuid, uuid, sizeof(*uuid)))
+			return b;
+
+	return NULL;
+}
+
+static struct ree_fs_pending_file *find_pending(uint32_t file_number)
+{
+	size_t n = 0;
+
+	for (n = 0; n < ree_fs_pending_count; n++)
+		if (ree_fs_pending[n].file_number == file_number)
+			return ree_fs_pending + n;
+
+	return NULL;
+}
+
+static void remove_pending_file(struct ree_fs_pending_file *p)
+{
+	struct tee_fs_dirfile_fileh dfh = { .file_number = p->file_number };
+
+	tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &dfh);
+}
+
+static TEE_Result commit_pending(struct tee_fs_dirfile_dirh *dirh)
+{
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	res = commit_dirh_writes(dirh);
+	if (res)
+		return res;
+
+	for (n = 0; n < ree_fs_pending_count; n++)
+		if (ree_fs_pending[n].state == REE_FS_PENDING_REMOVE)
+			remove_pending_file(ree_fs_pending + n);
+	ree_fs_pending_count = 0;
+	ree_fs_pending_commit = false;
+
+	return TEE_SUCCESS;
+}
+
+/* Called with uncommitted updates of dirf.db about to be thrown away */
+static void discard_pending(void)
+{
+	struct ree_fs_pending_file *p = NULL;
+	struct ree_fs_batch *b = NULL;
+	struct tee_fs_fd *fdp = NULL;
+	size_t n = 0;
+
+	LIST_FOREACH(fdp, &ree_fs_fds, link) {
+		p = find_pending(fdp->dfh.file_number);
+		if (p && p->state != REE_FS_PENDING_REMOVE)
+			fdp->discarded = true;
+	}
+
+	for (n = 0; n < ree_fs_pending_count; n++)
+		if (ree_fs_pending[n].state == REE_FS_PENDING_CREATED)
+			remove_pending_file(ree_fs_pending + n);
+
+	if (ree_fs_pending_commit) {
+		SLIST_FOREACH(b, &ree_fs_batches, link)
+			b->discarded = true;
+		/* Cached heads may come from the discarded updates */
+		tee_svc_storage_flush_heads(&ree_fs_ops);
+	}
+
+	ree_fs_pending_count = 0;
+	ree_fs_pending_commit = false;
+}
+
+static TEE_Result add_pending(struct tee_fs_dirfile_dirh *dirh,
+			      uint32_t file_number,
+			      enum ree_fs_pending_state state)
+{
+	struct ree_fs_pending_file *p = find_pending(file_number);
+	TEE_Result res = TEE_SUCCESS;
+
+	if (!p) {
+		if (ree_fs_pending_count == REE_FS_PENDING_MAX) {
+			res = commit_pending(dirh);
+			if (res)
+				return res;
+		}
+		p = ree_fs_pending + ree_fs_pending_count;
+		ree_fs_pending_count++;
+		p->file_number = file_number;
+	}
+	p->state = state;
+
+	return TEE_SUCCESS;
+}
+
+/* Ends an operation, the commit is deferred if @uuid has a batch open */
+static TEE_Result commit_or_defer(struct tee_fs_dirfile_dirh *dirh,
+				  const TEE_UUID *uuid)
+{
+	if (find_batch(uuid)) {
+		ree_fs_pending_commit = true;
+		return TEE_SUCCESS;
+	}
+
+	return commit_pending(dirh);
+}
+
+/* Removes a file once the removal of its entry in dirf.db is committed */
+static TEE_Result remove_file(struct tee_fs_dirfile_dirh *dirh,
+			      const struct tee_fs_dirfile_fileh *dfh)
+{
+	if (ree_fs_pending_commit)
+		return add_pending(dirh, dfh->file_number,
+				   REE_FS_PENDING_REMOVE);
+
+	tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, dfh);
+	return TEE_SUCCESS;
+}
+
+/*
+ * A file in another format than ree_fs_format is migrated when first
+ * written, unless it's also open through another handle which would be
+ * left referring to the removed file. It's then migrated by a later
+ * write.
+ */
+static bool need_migration(struct tee_fs_fd *fdp)
+{
+	struct tee_fs_fd *f = NULL;
+
+	if (fdp->fmt.version == ree_fs_format.version &&
+	    fdp->fmt.fanout == ree_fs_format.fanout &&
+	    fdp->fmt.block_shift == ree_fs_format.block_shift)
+		return false;
+
+	LIST_FOREACH(f, &ree_fs_fds, link)
+		if (f != fdp && f->dfh.file_number == fdp->dfh.file_number)
+			return false;
+
+	return true;
+}
+
+static TEE_Result copy_file(struct tee_fs_fd *src, struct tee_fs_fd *dst)
+{
+	size_t length = tee_fs_htree_get_meta(src->ht)->length;
+	/* Block sizes are powers of 2, only whole blocks are copied */
+	size_t chunk = MAX(get_block_size(src), get_block_size(dst));
+	TEE_Result res = TEE_SUCCESS;
+	uint8_t *buf = NULL;
+	size_t pos = 0;
+	size_t n = 0;
+
+	buf = malloc(chunk);
+	if (!buf)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	while (pos < length) {
+		n = MIN(chunk, length - pos);
+		res = ree_fs_read_primitive((struct tee_file_handle *)src, pos,
+					    buf, NULL, &n);
+		if (res)
+			break;
+		res = ree_fs_write_primitive((struct tee_file_handle *)dst,
+					     pos, buf, NULL, n);
+		if (res)
+			break;
+		pos += n;
+	}
+
+	free_wipe(buf);
+	return res;
+}
+
+/*
+ * Replaces the file of @fdp with a copy in ree_fs_format, the entry in
+ * dirf.db keeps its index and name. The whole content is copied, which
+ * is done once per file and costs about as much as recreating the
+ * object.
+ */
+static TEE_Result migrate_file(struct tee_fs_dirfile_dirh *dirh,
+			       struct tee_fs_fd *fdp)
+{
+	struct tee_fs_dirfile_fileh old_dfh = fdp->dfh;
+	struct tee_fs_dirfile_fileh dfh = { };
+	struct tee_fs_htree_format old_fmt = { };
+	struct tee_fs_htree_format fmt = { };
+	uint8_t oid[TEE_OBJECT_ID_MAX_LEN] = { };
+	size_t oidlen = sizeof(oid);
+	struct tee_file_handle *fh = NULL;
+	struct tee_fs_fd *new_fdp = NULL;
+	struct tee_fs_htree *ht = NULL;
+	int idx = old_dfh.idx - 1;
+	TEE_Result res = TEE_SUCCESS;
+	int old_fd = -1;
+	int fd = -1;
+
+	res = tee_fs_dirfile_get_next(dirh, fdp->uuid, &idx, oid, &oidlen);
+	if (res)
+		return res;
+	if (idx != old_dfh.idx)
+		return TEE_ERROR_BAD_STATE;
+
+	res = tee_fs_dirfile_get_tmp(dirh, &dfh);
+	if (res)
+		return res;
+
+	/* A file number freed in a batch may still be in use until commit */
+	if (find_pending(dfh.file_number)) {
+		res = commit_pending(dirh);
+		if (res)
+			return res;
+	}
+	if (find_batch(fdp->uuid)) {
+		res = add_pending(dirh, dfh.file_number,
+				  REE_FS_PENDING_CREATED);
+		if (res)
+			return res;
+	}
+
+	res = ree_fs_open_primitive(true, dfh.hash, 0, fdp->uuid, &dfh, &fh);
+	if (res)
+		return res;
+	new_fdp = (struct tee_fs_fd *)fh;
+	res = copy_file(fdp, new_fdp);
+	if (!res)
+		res = tee_fs_htree_sync_to_storage(&new_fdp->ht, dfh.hash,
+						   NULL);
+	ree_fs_close_primitive(fh);
+	if (res)
+		goto err_remove;
+
+	/*
+	 * The hash tree passes @fdp to the storage operations, so the new
+	 * file is opened with the file descriptor and format of @fdp
+	 * temporarily replaced by its own.
+	 */
+	res = tee_fs_rpc_open_dfh(OPTEE_RPC_CMD_FS, &dfh, &fd);
+	if (res)
+		goto err_remove;
+	old_fd = fdp->fd;
+	old_fmt = fdp->fmt;
+	fdp->fd = fd;
+	fdp->fmt = ree_fs_format;
+	res = tee_fs_htree_open(false, dfh.hash, 0, fdp->uuid,
+				&ree_fs_storage_ops, fdp, &fdp->fmt, &ht);
+	fmt = fdp->fmt;
+	fdp->fd = old_fd;
+	fdp->fmt = old_fmt;
+	if (res)
+		goto err_close;
+
+	dfh.idx = old_dfh.idx;
+	res = tee_fs_dirfile_rename(dirh, fdp->uuid, &dfh, oid, oidlen);
+	if (res)
+		goto err_close;
+	res = commit_or_defer(dirh, fdp->uuid);
+	if (res)
+		goto err_close;
+
+	tee_fs_htree_close(&fdp->ht);
+	tee_fs_rpc_close(OPTEE_RPC_CMD_FS, old_fd);
+	fdp->ht = ht;
+	fdp->fd = fd;
+	fdp->fmt = fmt;
+	fdp->dfh = dfh;
+
+	return remove_file(dirh, &old_dfh);
+
+err_close:
+	tee_fs_htree_close(&ht);
+	tee_fs_rpc_close(OPTEE_RPC_CMD_FS, fd);
+err_remove:
+	tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &dfh);
+	return res;
+}
+
+/* Must be called before anything of an existing object file is written */
+static TEE_Result prepare_file_write(struct tee_fs_dirfile_dirh *dirh,
+				     struct tee_fs_fd *fdp)
+{
+	struct ree_fs_pending_file *p = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	if (need_migration(fdp)) {
+		res = migrate_file(dirh, fdp);
+		if (res)
+			return res;
+	}
+
+	p = find_pending(fdp->dfh.file_number);
+	if (p && p->state == REE_FS_PENDING_SYNCED) {
+		res = commit_pending(dirh);
+		if (res)
+			return res;
+		p = NULL;
+	}
+
+	if (p || !find_batch(fdp->uuid))
+		return TEE_SUCCESS;
+
+	return add_pending(dirh, fdp->dfh.file_number, REE_FS_PENDING_SYNCED);
+}
+
 static TEE_Result get_dirh(struct tee_fs_dirfile_dirh **dirh)
 {
 	if (!ree_fs_dirh) {
@@ -692,8 +1213,10 @@ static void put_dirh_primitive(bool close)
 	 * ree_fs_dirh may actually be NULL.
 	 */
 	ree_fs_dirh_refcount--;
-	if (ree_fs_dirh && (!ree_fs_dirh_refcount || close))
+	if (ree_fs_dirh && (!ree_fs_dirh_refcount || close)) {
+		discard_pending();
 		close_dirh(&ree_fs_dirh);
+	}
 }
 
 static void put_dirh(struct tee_fs_dirfile_dirh *dirh, bool close)
@@ -729,15 +1252,21 @@ static TEE_Result ree_fs_open(struct tee_pobj *po, size_t *size,
 		 * treat it as corrupt.
 		 */
 		res = TEE_ERROR_CORRUPT_OBJECT;
-	} else if (!res && size) {
+	} else if (!res) {
 		struct tee_fs_fd *fdp = (struct tee_fs_fd *)*fh;
 
-		*size = tee_fs_htree_get_meta(fdp->ht)->length;
+		LIST_INSERT_HEAD(&ree_fs_fds, fdp, link);
+		if (size)
+			*size = tee_fs_htree_get_meta(fdp->ht)->length;
 	}
 
 out:
+	/*
+	 * A lookup finding nothing leaves dirf.db as it was, closing it
+	 * would only throw away the pending updates of batches.
+	 */
 	if (res)
-		put_dirh(dirh, true);
+		put_dirh(dirh, res != TEE_ERROR_ITEM_NOT_FOUND);
 	mutex_unlock(&ree_fs_mutex);
 
 	return res;
@@ -770,12 +1299,12 @@ static TEE_Result set_name(struct tee_fs_dirfile_dirh *dirh,
 	if (res)
 		return res;
 
-	res = commit_dirh_writes(dirh);
+	res = commit_or_defer(dirh, &po->uuid);
 	if (res)
 		return res;
 
 	if (have_old_dfh)
-		tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &old_dfh);
+		return remove_file(dirh, &old_dfh);
 
 	return TEE_SUCCESS;
 }
@@ -783,7 +1312,10 @@ static TEE_Result set_name(struct tee_fs_dirfile_dirh *dirh,
 static void ree_fs_close(struct tee_file_handle **fh)
 {
 	if (*fh) {
+		struct tee_fs_fd *fdp = (struct tee_fs_fd *)*fh;
+
 		mutex_lock(&ree_fs_mutex);
+		LIST_REMOVE(fdp, link);
 		put_dirh_primitive(false);
 		ree_fs_close_primitive(*fh);
 		*fh = NULL;
@@ -818,6 +1350,19 @@ static TEE_Result ree_fs_create(struct tee_pobj *po, bool overwrite,
 	if (res)
 		goto out;
 
+	/* A file number freed in a batch may still be in use until commit */
+	if (find_pending(dfh.file_number)) {
+		res = commit_pending(dirh);
+		if (res)
+			goto out;
+	}
+	if (find_batch(&po->uuid)) {
+		res = add_pending(dirh, dfh.file_number,
+				  REE_FS_PENDING_CREATED);
+		if (res)
+			goto out;
+	}
+
 	res = ree_fs_open_primitive(true, dfh.hash, 0, &po->uuid, &dfh, fh);
 	if (res)
 		goto out;
@@ -849,6 +1394,8 @@ static TEE_Result ree_fs_create(struct tee_pobj *po, bool overwrite,
 		goto out;
 
 	res = set_name(dirh, fdp, po, overwrite);
+	if (!res)
+		LIST_INSERT_HEAD(&ree_fs_fds, fdp, link);
 out:
 	if (res) {
 		put_dirh(dirh, true);
@@ -876,10 +1423,19 @@ static TEE_Result ree_fs_write(struct tee_file_handle *fh, size_t pos,
 
 	mutex_lock(&ree_fs_mutex);
 
+	if (fdp->discarded) {
+		res = TEE_ERROR_BAD_STATE;
+		goto out;
+	}
+
 	res = get_dirh(&dirh);
 	if (res)
 		goto out;
 
+	res = prepare_file_write(dirh, fdp);
+	if (res)
+		goto out;
+
 	res = ree_fs_write_primitive(fh, pos, buf_core, buf_user, len);
 	if (res)
 		goto out;
@@ -891,7 +1447,7 @@ static TEE_Result ree_fs_write(struct tee_file_handle *fh, size_t pos,
 	res = tee_fs_dirfile_update_hash(dirh, &fdp->dfh);
 	if (res)
 		goto out;
-	res = commit_dirh_writes(dirh);
+	res = commit_or_defer(dirh, fdp->uuid);
 out:
 	put_dirh(dirh, res);
 	mutex_unlock(&ree_fs_mutex);
@@ -938,12 +1494,12 @@ static TEE_Result ree_fs_rename(struct tee_pobj *old, struct tee_pobj *new,
 			goto out;
 	}
 
-	res = commit_dirh_writes(dirh);
+	res = commit_or_defer(dirh, &old->uuid);
 	if (res)
 		goto out;
 
 	if (remove_dfh.idx != -1)
-		tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &remove_dfh);
+		res = remove_file(dirh, &remove_dfh);
 
 out:
 	put_dirh(dirh, res);
@@ -973,11 +1529,13 @@ static TEE_Result ree_fs_remove(struct tee_pobj *po)
 	if (res)
 		goto out;
 
-	res = commit_dirh_writes(dirh);
+	res = commit_or_defer(dirh, &po->uuid);
 	if (res)
 		goto out;
 
-	tee_fs_rpc_remove_dfh(OPTEE_RPC_CMD_FS, &dfh);
+	res = remove_file(dirh, &dfh);
+	if (res)
+		goto out;
 
 	assert(tee_fs_dirfile_find(dirh, &po->uuid, po->obj_id, po->obj_id_len,
 				   &dfh));
@@ -996,10 +1554,19 @@ static TEE_Result ree_fs_truncate(struct tee_file_handle *fh, size_t len)
 
 	mutex_lock(&ree_fs_mutex);
 
+	if (fdp->discarded) {
+		res = TEE_ERROR_BAD_STATE;
+		goto out;
+	}
+
 	res = get_dirh(&dirh);
 	if (res)
 		goto out;
 
+	res = prepare_file_write(dirh, fdp);
+	if (res)
+		goto out;
+
 	res = ree_fs_ftruncate_internal(fdp, len);
 	if (res)
 		goto out;
@@ -1011,7 +1578,7 @@ static TEE_Result ree_fs_truncate(struct tee_file_handle *fh, size_t len)
 	res = tee_fs_dirfile_update_hash(dirh, &fdp->dfh);
 	if (res)
 		goto out;
-	res = commit_dirh_writes(dirh);
+	res = commit_or_defer(dirh, fdp->uuid);
 out:
 	put_dirh(dirh, res);
 	mutex_unlock(&ree_fs_mutex);
@@ -1088,7 +1655,80 @@ static TEE_Result ree_fs_readdir_rpc(struct tee_fs_dir *d,
 	if (res == TEE_SUCCESS)
 		*ent = &d->d;
 
-	put_dirh(dirh, res);
+	/* The end of the directory isn't an error in dirf.db */
+	put_dirh(dirh, res && res != TEE_ERROR_ITEM_NOT_FOUND);
+out:
+	mutex_unlock(&ree_fs_mutex);
+
+	return res;
+}
+
+static TEE_Result ree_fs_begin_batch(const TEE_UUID *uuid)
+{
+	struct tee_fs_dirfile_dirh *dirh = NULL;
+	struct ree_fs_batch *b = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	mutex_lock(&ree_fs_mutex);
+
+	b = find_batch(uuid);
+	if (b) {
+		b->refcount++;
+		goto out;
+	}
+
+	b = calloc(1, sizeof(*b));
+	if (!b) {
+		res = TEE_ERROR_OUT_OF_MEMORY;
+		goto out;
+	}
+
+	/* Keeps dirf.db and its pending updates until the batch ends */
+	res = get_dirh(&dirh);
+	if (res) {
+		free(b);
+		goto out;
+	}
+
+	b->uuid = *uuid;
+	b->refcount = 1;
+	SLIST_INSERT_HEAD(&ree_fs_batches, b, link);
+out:
+	mutex_unlock(&ree_fs_mutex);
+
+	return res;
+}
+
+static TEE_Result ree_fs_end_batch(const TEE_UUID *uuid)
+{
+	struct tee_fs_dirfile_dirh *dirh = NULL;
+	struct ree_fs_batch *b = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	mutex_lock(&ree_fs_mutex);
+
+	b = find_batch(uuid);
+	if (!b) {
+		res = TEE_ERROR_BAD_STATE;
+		goto out;
+	}
+
+	if (b->discarded) {
+		res = TEE_ERROR_BAD_STATE;
+	} else if (ree_fs_pending_commit) {
+		res = get_dirh(&dirh);
+		if (!res) {
+			res = commit_pending(dirh);
+			put_dirh(dirh, res);
+		}
+	}
+
+	b->refcount--;
+	if (!b->refcount) {
+		SLIST_REMOVE(&ree_fs_batches, b, ree_fs_batch, link);
+		free(b);
+		put_dirh_primitive(false);
+	}
 out:
 	mutex_unlock(&ree_fs_mutex);
 
@@ -1107,4 +1747,6 @@ const struct tee_file_operations ree_fs_ops = {
 	.opendir = ree_fs_opendir_rpc,
 	.closedir = ree_fs_closedir_rpc,
 	.readdir = ree_fs_readdir_rpc,
+	.begin_batch = ree_fs_begin_batch,
+	.end_batch = ree_fs_end_batch,
 };
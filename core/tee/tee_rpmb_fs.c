@@ -34,13 +34,17 @@
 #include <util.h>
 
 #define RPMB_STORAGE_START_ADDRESS      0
+#define RPMB_FS_WAL_ADDRESS             256
 #define RPMB_FS_FAT_START_ADDRESS       512
 #define RPMB_BLOCK_SIZE_SHIFT           8
 #define RPMB_CID_PRV_OFFSET             9
 #define RPMB_CID_CRC_OFFSET             15
 
 #define RPMB_FS_MAGIC                   0x52504D42
-#define FS_VERSION                      2
+#define RPMB_FS_WAL_MAGIC               0x5257414C
+#define FS_VERSION                      3
+/* Last version without the write-ahead log, upgraded in place */
+#define FS_VERSION_NO_WAL               2
 
 #define FILE_IS_ACTIVE                  (1u << 0)
 #define FILE_IS_LAST_ENTRY              (1u << 1)
@@ -103,6 +107,38 @@ struct rpmb_fat_entry_dir {
 	bool last_reached;
 };
 
+/**
+ * In-memory summary of a FAT entry, see struct rpmb_fat_index.
+ */
+struct rpmb_fat_index_entry {
+	/* Hash of the filename, only valid if FILE_IS_ACTIVE is set */
+	uint32_t hash;
+	/* Copy of the flags of the FAT entry */
+	uint32_t flags;
+	/* Data of the file in the pool, NULL if the file is empty */
+	tee_mm_entry_t *mm;
+};
+
+/**
+ * Index of the FAT built once when the FS is set up and updated each time
+ * a FAT entry is written. It allows finding a file or a free FAT entry
+ * and allocating space for file data without traversing the FAT in RPMB.
+ */
+struct rpmb_fat_index {
+	/* One entry per FAT entry including the last entry */
+	struct rpmb_fat_index_entry *entries;
+	uint32_t num_entries;
+	uint32_t max_entries;
+	/* RPMB layout: partition data, FAT and the data of all files */
+	tee_mm_pool_t pool;
+	/* Partition data and FAT in the pool */
+	tee_mm_entry_t *fat_mm;
+	/* New file data allocated by fat_index_alloc() not yet in the FAT */
+	tee_mm_entry_t *reserved_mm;
+	/* False if the FAT has overlapping entries, no space can be allocated */
+	bool pool_valid;
+};
+
 /**
  * FAT entry context with reference to a FAT entry and its
  * location in RPMB.
@@ -127,6 +163,19 @@ struct rpmb_fs_partition {
 	uint8_t reserved[112];
 };
 
+/**
+ * Write-ahead log header, stored in the block between the partition data
+ * and the FAT. When magic is RPMB_FS_WAL_MAGIC an update is committed but
+ * may not be completed: num_blocks blocks of already encrypted data at
+ * log_address are to be copied to dst_address.
+ */
+struct rpmb_fs_wal {
+	uint32_t magic;
+	uint32_t dst_address;
+	uint32_t log_address;
+	uint32_t num_blocks;
+};
+
 /**
  * A node in a list of directory entries.
  */
@@ -149,6 +198,12 @@ struct tee_fs_dir {
 
 static struct rpmb_fs_parameters *fs_par;
 static struct rpmb_fat_entry_dir *fat_entry_dir;
+static struct rpmb_fat_index *fat_index;
+
+/* A committed write-ahead log may be left, see wal_complete() */
+static bool wal_pending;
+/* Log blocks of the pending write-ahead log, freed once it's completed */
+static tee_mm_entry_t *wal_log_mm;
 
 /*
  * Lower interface to RPMB device
@@ -556,27 +611,28 @@ static bool is_zero(const uint8_t *buf, size_t size)
 	return true;
 }
 
-static TEE_Result encrypt_block(uint8_t *out, const uint8_t *in,
-				uint16_t blk_idx, const uint8_t *fek,
-				const TEE_UUID *uuid)
+static TEE_Result encrypt_block(struct tee_fs_crypt_ctx *c, uint8_t *out,
+				const uint8_t *in, uint16_t blk_idx)
 {
-	return tee_fs_crypt_block(uuid, out, in, RPMB_DATA_SIZE,
-				  blk_idx, fek, TEE_MODE_ENCRYPT);
+	return tee_fs_crypt_ctx_block(c, out, in, RPMB_DATA_SIZE, blk_idx,
+				      TEE_MODE_ENCRYPT);
 }
 
-static TEE_Result decrypt_block(uint8_t *out, const uint8_t *in,
-				uint16_t blk_idx, const uint8_t *fek,
-				const TEE_UUID *uuid)
+static TEE_Result decrypt_block(struct tee_fs_crypt_ctx *c, uint8_t *out,
+				const uint8_t *in, uint16_t blk_idx)
 {
-	return tee_fs_crypt_block(uuid, out, in, RPMB_DATA_SIZE,
-				  blk_idx, fek, TEE_MODE_DECRYPT);
+	return tee_fs_crypt_ctx_block(c, out, in, RPMB_DATA_SIZE, blk_idx,
+				      TEE_MODE_DECRYPT);
 }
 
-/* Decrypt/copy at most one block of data */
+/*
+ * Decrypt/copy at most one block of data, @c is NULL if the block is not
+ * encrypted
+ */
 static TEE_Result decrypt(uint8_t *out, const struct rpmb_data_frame *frm,
 			  size_t size, size_t offset,
-			  uint16_t blk_idx __maybe_unused, const uint8_t *fek,
-			  const TEE_UUID *uuid)
+			  uint16_t blk_idx __maybe_unused,
+			  struct tee_fs_crypt_ctx *c)
 {
 	uint8_t *tmp __maybe_unused;
 	TEE_Result res = TEE_SUCCESS;
@@ -585,12 +641,9 @@ static TEE_Result decrypt(uint8_t *out, const struct rpmb_data_frame *frm,
 	if ((size + offset < size) || (size + offset > RPMB_DATA_SIZE))
 		panic("invalid size or offset");
 
-	if (!fek) {
+	if (!c) {
 		/* Block is not encrypted (not a file data block) */
 		memcpy(out, frm->data + offset, size);
-	} else if (is_zero(fek, TEE_FS_KM_FEK_SIZE)) {
-		/* The file was created with encryption disabled */
-		return TEE_ERROR_SECURITY;
 	} else {
 		/* Block is encrypted */
 		if (size < RPMB_DATA_SIZE) {
@@ -601,12 +654,12 @@ static TEE_Result decrypt(uint8_t *out, const struct rpmb_data_frame *frm,
 			tmp = malloc(RPMB_DATA_SIZE);
 			if (!tmp)
 				return TEE_ERROR_OUT_OF_MEMORY;
-			res = decrypt_block(tmp, frm->data, blk_idx, fek, uuid);
+			res = decrypt_block(c, tmp, frm->data, blk_idx);
 			if (res == TEE_SUCCESS)
 				memcpy(out, tmp + offset, size);
 			free(tmp);
 		} else {
-			res = decrypt_block(out, frm->data, blk_idx, fek, uuid);
+			res = decrypt_block(c, out, frm->data, blk_idx);
 		}
 	}
 
@@ -622,6 +675,7 @@ static TEE_Result tee_rpmb_req_pack(struct rpmb_req *req_hdr,
 	TEE_Result res = TEE_ERROR_GENERIC;
 	int i;
 	struct rpmb_data_frame *datafrm;
+	struct tee_fs_crypt_ctx c = { };
 
 	if (!req_data || !rawdata || !nbr_frms)
 		return TEE_ERROR_BAD_PARAMETERS;
@@ -647,6 +701,14 @@ static TEE_Result tee_rpmb_req_pack(struct rpmb_req *req_hdr,
 	if (!datafrm)
 		return TEE_ERROR_OUT_OF_MEMORY;
 
+	if (rawdata->data && fek) {
+		res = tee_fs_crypt_ctx_init(&c, uuid, fek);
+		if (res != TEE_SUCCESS) {
+			free(datafrm);
+			return res;
+		}
+	}
+
 	for (i = 0; i < nbr_frms; i++) {
 		u16_to_bytes(rawdata->msg_type, datafrm[i].msg_type);
 
@@ -674,11 +736,10 @@ static TEE_Result tee_rpmb_req_pack(struct rpmb_req *req_hdr,
 
 		if (rawdata->data) {
 			if (fek) {
-				res = encrypt_block(datafrm[i].data,
+				res = encrypt_block(&c, datafrm[i].data,
 						    rawdata->data +
 						    (i * RPMB_DATA_SIZE),
-						    *rawdata->blk_idx + i,
-						    fek, uuid);
+						    *rawdata->blk_idx + i);
 				if (res != TEE_SUCCESS)
 					goto func_exit;
 			} else {
@@ -715,13 +776,15 @@ static TEE_Result tee_rpmb_req_pack(struct rpmb_req *req_hdr,
 
 	res = TEE_SUCCESS;
 func_exit:
+	if (rawdata->data && fek)
+		tee_fs_crypt_ctx_final(&c);
 	free(datafrm);
 	return res;
 }
 
 static TEE_Result data_cpy_mac_calc_1b(struct rpmb_raw_data *rawdata,
 				       struct rpmb_data_frame *frm,
-				       const uint8_t *fek, const TEE_UUID *uuid)
+				       struct tee_fs_crypt_ctx *c)
 {
 	TEE_Result res;
 	uint8_t *data;
@@ -738,8 +801,7 @@ static TEE_Result data_cpy_mac_calc_1b(struct rpmb_raw_data *rawdata,
 	data = rawdata->data;
 	bytes_to_u16(frm->address, &idx);
 
-	res = decrypt(data, frm, rawdata->len, rawdata->byte_offset, idx, fek,
-		      uuid);
+	res = decrypt(data, frm, rawdata->len, rawdata->byte_offset, idx, c);
 	return res;
 }
 
@@ -758,12 +820,28 @@ static TEE_Result tee_rpmb_data_cpy_mac_calc(struct rpmb_data_frame *datafrm,
 	uint8_t *data;
 	uint16_t start_idx;
 	struct rpmb_data_frame localfrm;
+	struct tee_fs_crypt_ctx crypt_ctx = { };
+	struct tee_fs_crypt_ctx *c = NULL;
 
 	if (!datafrm || !rawdata || !nbr_frms || !lastfrm)
 		return TEE_ERROR_BAD_PARAMETERS;
 
-	if (nbr_frms == 1)
-		return data_cpy_mac_calc_1b(rawdata, lastfrm, fek, uuid);
+	if (fek) {
+		/* The file was created with encryption disabled */
+		if (is_zero(fek, TEE_FS_KM_FEK_SIZE))
+			return TEE_ERROR_SECURITY;
+
+		/* Set up once for all the frames */
+		res = tee_fs_crypt_ctx_init(&crypt_ctx, uuid, fek);
+		if (res != TEE_SUCCESS)
+			return res;
+		c = &crypt_ctx;
+	}
+
+	if (nbr_frms == 1) {
+		res = data_cpy_mac_calc_1b(rawdata, lastfrm, c);
+		goto func_exit;
+	}
 
 	/* nbr_frms > 1 */
 
@@ -808,8 +886,7 @@ static TEE_Result tee_rpmb_data_cpy_mac_calc(struct rpmb_data_frame *datafrm,
 			offset = 0;
 		}
 
-		res = decrypt(data, &localfrm, size, offset, start_idx + i,
-			      fek, uuid);
+		res = decrypt(data, &localfrm, size, offset, start_idx + i, c);
 		if (res != TEE_SUCCESS)
 			goto func_exit;
 
@@ -820,8 +897,7 @@ static TEE_Result tee_rpmb_data_cpy_mac_calc(struct rpmb_data_frame *datafrm,
 	size = (rawdata->len + rawdata->byte_offset) % RPMB_DATA_SIZE;
 	if (size == 0)
 		size = RPMB_DATA_SIZE;
-	res = decrypt(data, lastfrm, size, 0, start_idx + nbr_frms - 1, fek,
-		      uuid);
+	res = decrypt(data, lastfrm, size, 0, start_idx + nbr_frms - 1, c);
 	if (res != TEE_SUCCESS)
 		goto func_exit;
 
@@ -838,6 +914,8 @@ static TEE_Result tee_rpmb_data_cpy_mac_calc(struct rpmb_data_frame *datafrm,
 
 func_exit:
 	crypto_mac_free_ctx(ctx);
+	if (c)
+		tee_fs_crypt_ctx_final(c);
 	return res;
 }
 
@@ -1573,11 +1651,35 @@ static TEE_Result tee_rpmb_write(uint32_t addr,
 			goto func_exit;
 		}
 
-		/* Read the complete blocks */
-		res = tee_rpmb_read(blk_idx * RPMB_DATA_SIZE, data_tmp,
-				    blkcnt * RPMB_DATA_SIZE, fek, uuid);
-		if (res != TEE_SUCCESS)
-			goto func_exit;
+		/*
+		 * Read the blocks which are only partially updated, that
+		 * is, the first and the last. If they're adjacent a single
+		 * request is used.
+		 */
+		if (blkcnt <= 2) {
+			res = tee_rpmb_read(blk_idx * RPMB_DATA_SIZE, data_tmp,
+					    blkcnt * RPMB_DATA_SIZE, fek,
+					    uuid);
+			if (res != TEE_SUCCESS)
+				goto func_exit;
+		} else {
+			if (byte_offset) {
+				res = tee_rpmb_read(blk_idx * RPMB_DATA_SIZE,
+						    data_tmp, RPMB_DATA_SIZE,
+						    fek, uuid);
+				if (res != TEE_SUCCESS)
+					goto func_exit;
+			}
+			if ((len + byte_offset) % RPMB_DATA_SIZE) {
+				res = tee_rpmb_read((blk_idx + blkcnt - 1) *
+						    RPMB_DATA_SIZE,
+						    data_tmp + (blkcnt - 1) *
+						    RPMB_DATA_SIZE,
+						    RPMB_DATA_SIZE, fek, uuid);
+				if (res != TEE_SUCCESS)
+					goto func_exit;
+			}
+		}
 
 		/* Partial update of the data blocks */
 		memcpy(data_tmp + byte_offset, data, len);
@@ -1921,6 +2023,231 @@ post_read_in:
 	return TEE_SUCCESS;
 }
 
+/* 32-bit FNV-1a hash of a filename */
+static uint32_t fat_index_hash(const char *filename)
+{
+	uint32_t hash = 0x811c9dc5;
+
+	while (*filename) {
+		hash ^= (uint8_t)*filename++;
+		hash *= 0x01000193;
+	}
+
+	return hash;
+}
+
+static uint32_t fat_index_address(size_t idx)
+{
+	return fs_par->fat_start_address + idx * sizeof(struct rpmb_fat_entry);
+}
+
+static void fat_index_free(void)
+{
+	if (fat_index) {
+		/* Freed with the pool */
+		wal_log_mm = NULL;
+		tee_mm_final(&fat_index->pool);
+		free(fat_index->entries);
+		free(fat_index);
+		fat_index = NULL;
+	}
+}
+
+static TEE_Result fat_index_resize(size_t num_entries)
+{
+	struct rpmb_fat_index_entry *e = NULL;
+	size_t max_entries = 0;
+
+	if (num_entries > fat_index->max_entries) {
+		max_entries = MAX(num_entries, 2 * fat_index->max_entries);
+		e = realloc(fat_index->entries, max_entries * sizeof(*e));
+		if (!e)
+			return TEE_ERROR_OUT_OF_MEMORY;
+		fat_index->entries = e;
+		fat_index->max_entries = max_entries;
+	}
+
+	if (num_entries > fat_index->num_entries)
+		memset(fat_index->entries + fat_index->num_entries, 0,
+		       (num_entries - fat_index->num_entries) *
+		       sizeof(*fat_index->entries));
+	fat_index->num_entries = num_entries;
+
+	return TEE_SUCCESS;
+}
+
+/**
+ * fat_index_update: Update the index with a FAT entry written to RPMB.
+ * File data reserved with fat_index_alloc() at the start address of the
+ * entry is taken over by the entry.
+ */
+static TEE_Result fat_index_update(uint32_t fat_address,
+				   const struct rpmb_fat_entry *fe)
+{
+	size_t idx = (fat_address - fs_par->fat_start_address) / sizeof(*fe);
+	tee_mm_entry_t *reserved_mm = fat_index->reserved_mm;
+	struct rpmb_fat_index_entry *e = NULL;
+	tee_mm_entry_t *old_mm = NULL;
+	TEE_Result res = TEE_ERROR_GENERIC;
+
+	if (idx >= fat_index->num_entries) {
+		res = fat_index_resize(idx + 1);
+		if (res)
+			return res;
+	}
+
+	e = fat_index->entries + idx;
+	old_mm = e->mm;
+	e->mm = NULL;
+	e->flags = fe->flags;
+	e->hash = 0;
+
+	if (fe->flags & FILE_IS_ACTIVE) {
+		e->hash = fat_index_hash(fe->filename);
+		if (!fe->data_size) {
+			/* No data */
+		} else if (reserved_mm &&
+			   tee_mm_get_smem(reserved_mm) == fe->start_address) {
+			e->mm = reserved_mm;
+			fat_index->reserved_mm = NULL;
+		} else if (old_mm &&
+			   tee_mm_get_smem(old_mm) == fe->start_address &&
+			   tee_mm_get_bytes(old_mm) ==
+			   ROUNDUP(fe->data_size, RPMB_DATA_SIZE)) {
+			e->mm = old_mm;
+			old_mm = NULL;
+		}
+	}
+
+	tee_mm_free(old_mm);
+
+	if (!e->mm && fe->data_size && (fe->flags & FILE_IS_ACTIVE)) {
+		e->mm = tee_mm_alloc2(&fat_index->pool, fe->start_address,
+				      fe->data_size);
+		if (!e->mm) {
+			EMSG("RPMB FAT entry %#"PRIx32" overlaps other data",
+			     fat_address);
+			fat_index->pool_valid = false;
+		}
+	}
+
+	return TEE_SUCCESS;
+}
+
+/**
+ * fat_index_alloc: Allocate space for file data. The space is owned by
+ * the FAT entry once written with write_fat_entry() or released by
+ * fat_index_release().
+ */
+static tee_mm_entry_t *fat_index_alloc(size_t size)
+{
+	assert(!fat_index->reserved_mm);
+	if (!fat_index->pool_valid)
+		return NULL;
+
+	fat_index->reserved_mm = tee_mm_alloc(&fat_index->pool, size);
+
+	return fat_index->reserved_mm;
+}
+
+/**
+ * fat_index_release: Release space allocated by fat_index_alloc() which
+ * didn't make it into the FAT.
+ */
+static void fat_index_release(void)
+{
+	if (fat_index && fat_index->reserved_mm) {
+		tee_mm_free(fat_index->reserved_mm);
+		fat_index->reserved_mm = NULL;
+	}
+}
+
+/**
+ * fat_index_expand_fat: Reserve room in the pool for one more FAT entry
+ */
+static TEE_Result fat_index_expand_fat(void)
+{
+	uint32_t end = fat_index_address(fat_index->num_entries);
+	tee_mm_entry_t *mm = NULL;
+
+	/* Check that the room isn't used by file data */
+	mm = tee_mm_alloc2(&fat_index->pool, end, sizeof(struct rpmb_fat_entry));
+	if (!mm)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	tee_mm_free(mm);
+
+	tee_mm_free(fat_index->fat_mm);
+	fat_index->fat_mm = tee_mm_alloc2(&fat_index->pool,
+					  RPMB_STORAGE_START_ADDRESS,
+					  end + sizeof(struct rpmb_fat_entry) -
+					  RPMB_STORAGE_START_ADDRESS);
+	if (!fat_index->fat_mm) {
+		fat_index_free();
+		return TEE_ERROR_OUT_OF_MEMORY;
+	}
+
+	return TEE_SUCCESS;
+}
+
+/**
+ * fat_index_init: Build the FAT index with a single traversal of the FAT.
+ */
+static TEE_Result fat_index_init(void)
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+	struct rpmb_fat_entry *fe = NULL;
+	uint32_t fat_address = 0;
+	size_t pool_sz = 0;
+
+	fat_index = calloc(1, sizeof(*fat_index));
+	if (!fat_index)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	/* Upper memory allocation must be used for RPMB_FS. */
+	pool_sz = fs_par->max_rpmb_address - RPMB_STORAGE_START_ADDRESS;
+	if (!tee_mm_init(&fat_index->pool, RPMB_STORAGE_START_ADDRESS, pool_sz,
+			 RPMB_BLOCK_SIZE_SHIFT, TEE_MM_POOL_HI_ALLOC)) {
+		free(fat_index);
+		fat_index = NULL;
+		return TEE_ERROR_OUT_OF_MEMORY;
+	}
+	fat_index->pool_valid = true;
+
+	res = fat_entry_dir_init();
+	if (res)
+		goto out;
+
+	while (true) {
+		res = fat_entry_dir_get_next(&fe, &fat_address);
+		if (res || !fe)
+			break;
+
+		res = fat_index_update(fat_address, fe);
+		if (res)
+			break;
+	}
+
+	fat_entry_dir_deinit();
+	if (res)
+		goto out;
+
+	fat_index->fat_mm = tee_mm_alloc2(&fat_index->pool,
+					  RPMB_STORAGE_START_ADDRESS,
+					  fat_index_address(fat_index->num_entries) -
+					  RPMB_STORAGE_START_ADDRESS);
+	if (!fat_index->fat_mm) {
+		EMSG("RPMB FAT overlaps file data");
+		fat_index->pool_valid = false;
+	}
+
+	DMSG("RPMB FAT index: %"PRIu32" entries", fat_index->num_entries);
+
+	return TEE_SUCCESS;
+out:
+	fat_index_free();
+	return res;
+}
+
 #if (TRACE_LEVEL >= TRACE_FLOW)
 static void dump_fat(void)
 {
@@ -2026,6 +2353,91 @@ static struct rpmb_file_handle *alloc_file_handle(struct tee_pobj *po,
 	return fh;
 }
 
+static TEE_Result wal_write_header(const struct rpmb_fs_wal *wal)
+{
+	uint8_t blk[RPMB_DATA_SIZE] = { };
+
+	/* A single block is always written atomically */
+	memcpy(blk, wal, sizeof(*wal));
+	return tee_rpmb_write(RPMB_FS_WAL_ADDRESS, blk, sizeof(blk), NULL, NULL);
+}
+
+/**
+ * wal_replay: Complete an update which was committed to the write-ahead
+ * log but possibly interrupted before being completed.
+ */
+static TEE_Result wal_replay(uint32_t max_rpmb_address)
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+	struct rpmb_fs_wal wal = { };
+	uint8_t *data = NULL;
+	size_t len = 0;
+
+	if (!CFG_RPMB_FS_WAL_BLOCKS)
+		return TEE_SUCCESS;
+
+	res = tee_rpmb_read(RPMB_FS_WAL_ADDRESS, (uint8_t *)&wal, sizeof(wal),
+			    NULL, NULL);
+	if (res || wal.magic != RPMB_FS_WAL_MAGIC)
+		return res;
+
+	len = wal.num_blocks * RPMB_DATA_SIZE;
+	if (!wal.num_blocks || wal.num_blocks > CFG_RPMB_FS_WAL_BLOCKS ||
+	    wal.dst_address % RPMB_DATA_SIZE ||
+	    wal.log_address % RPMB_DATA_SIZE ||
+	    wal.dst_address < RPMB_FS_FAT_START_ADDRESS ||
+	    wal.log_address < RPMB_FS_FAT_START_ADDRESS ||
+	    wal.dst_address > max_rpmb_address - len ||
+	    wal.log_address > max_rpmb_address - len) {
+		EMSG("Invalid RPMB write-ahead log");
+		return TEE_ERROR_CORRUPT_OBJECT;
+	}
+
+	DMSG("Replaying %"PRIu32" blocks at %#"PRIx32, wal.num_blocks,
+	     wal.dst_address);
+
+	data = malloc(len);
+	if (!data)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	res = tee_rpmb_read(wal.log_address, data, len, NULL, NULL);
+	if (res)
+		goto out;
+	res = tee_rpmb_write(wal.dst_address, data, len, NULL, NULL);
+	if (res)
+		goto out;
+
+	memset(&wal, 0, sizeof(wal));
+	res = wal_write_header(&wal);
+out:
+	free(data);
+	return res;
+}
+
+/**
+ * wal_complete: Replay the write-ahead log left committed by a failed
+ * wal_write(). Until this succeeds every operation fails, since the
+ * log would overwrite later updates when replayed on next boot.
+ */
+static TEE_Result wal_complete(void)
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+
+	if (!wal_pending)
+		return TEE_SUCCESS;
+
+	res = wal_replay(fs_par->max_rpmb_address);
+	if (res) {
+		EMSG("Pending RPMB write-ahead log: %#"PRIx32, res);
+		return res;
+	}
+
+	wal_pending = false;
+	tee_mm_free(wal_log_mm);
+	wal_log_mm = NULL;
+	return TEE_SUCCESS;
+}
+
 /**
  * write_fat_entry: Store info in a fat_entry to RPMB.
  */
@@ -2054,10 +2466,42 @@ static TEE_Result write_fat_entry(struct rpmb_file_handle *fh)
 		res = fat_entry_dir_update(&fh->fat_entry,
 					   fh->rpmb_fat_address);
 
+	/*
+	 * The entry is stored in RPMB, if the index can't be updated it's
+	 * rebuilt from the FAT on next use.
+	 */
+	if (!res && fat_index &&
+	    fat_index_update(fh->rpmb_fat_address, &fh->fat_entry))
+		fat_index_free();
+
 out:
 	return res;
 }
 
+/**
+ * upgrade_fs_version: Upgrade a partition without write-ahead log.
+ * The log header block is unused in older versions, it's emptied before
+ * the version is bumped so that an interrupted upgrade is simply redone.
+ * Older software refuses the new version instead of ignoring a pending
+ * log.
+ */
+static TEE_Result upgrade_fs_version(struct rpmb_fs_partition *partition)
+{
+	TEE_Result res = TEE_ERROR_GENERIC;
+	struct rpmb_fs_wal wal = { };
+
+	IMSG("Upgrading RPMB FS version %"PRIu32" to %d",
+	     partition->fs_version, FS_VERSION);
+
+	res = wal_write_header(&wal);
+	if (res)
+		return res;
+
+	partition->fs_version = FS_VERSION;
+	return tee_rpmb_write(RPMB_STORAGE_START_ADDRESS, (uint8_t *)partition,
+			      sizeof(*partition), NULL, NULL);
+}
+
 /**
  * rpmb_fs_setup: Setup RPMB FS.
  * Set initial partition and FS values and write to RPMB.
@@ -2068,6 +2512,7 @@ static TEE_Result rpmb_fs_setup(void)
 	TEE_Result res = TEE_ERROR_GENERIC;
 	struct rpmb_fs_partition *partition_data = NULL;
 	struct rpmb_file_handle *fh = NULL;
+	struct rpmb_fs_wal wal = { };
 	uint32_t max_rpmb_block = 0;
 
 	if (fs_par) {
@@ -2085,6 +2530,9 @@ static TEE_Result rpmb_fs_setup(void)
 	 */
 	COMPILE_TIME_ASSERT(sizeof(struct rpmb_fs_partition) <=
 			    RPMB_DATA_SIZE);
+	COMPILE_TIME_ASSERT(RPMB_FS_WAL_ADDRESS >= RPMB_DATA_SIZE &&
+			    RPMB_FS_WAL_ADDRESS + RPMB_DATA_SIZE <=
+			    RPMB_FS_FAT_START_ADDRESS);
 	partition_data = calloc(1, RPMB_DATA_SIZE);
 	if (!partition_data) {
 		res = TEE_ERROR_OUT_OF_MEMORY;
@@ -2121,7 +2569,14 @@ static TEE_Result rpmb_fs_setup(void)
 #ifndef CFG_RPMB_RESET_FAT
 	if (partition_data->rpmb_fs_magic == RPMB_FS_MAGIC) {
 		if (partition_data->fs_version == FS_VERSION) {
-			res = TEE_SUCCESS;
+			res = wal_replay(max_rpmb_block << RPMB_BLOCK_SIZE_SHIFT);
+			if (res != TEE_SUCCESS)
+				goto out;
+			goto store_fs_par;
+		} else if (partition_data->fs_version == FS_VERSION_NO_WAL) {
+			res = upgrade_fs_version(partition_data);
+			if (res != TEE_SUCCESS)
+				goto out;
 			goto store_fs_par;
 		} else {
 			EMSG("Wrong software is in use.");
@@ -2147,6 +2602,11 @@ static TEE_Result rpmb_fs_setup(void)
 	fh->fat_entry.flags = FILE_IS_LAST_ENTRY;
 	fh->rpmb_fat_address = partition_data->fat_start_address;
 
+	/* Empty write-ahead log */
+	res = wal_write_header(&wal);
+	if (res != TEE_SUCCESS)
+		goto out;
+
 	/* Write init FAT entry and partition data to RPMB. */
 	res = write_fat_entry(fh);
 	if (res != TEE_SUCCESS)
@@ -2172,6 +2632,10 @@ store_fs_par:
 
 	dump_fat();
 
+	/* Retried by read_fat() if it fails */
+	if (fat_index_init())
+		EMSG("Failed to build RPMB FAT index");
+
 out:
 	free(fh);
 	free(partition_data);
@@ -2193,131 +2657,95 @@ static TEE_Result get_fat_start_address(uint32_t *addr)
 }
 
 /**
- * read_fat: Read FAT entries
+ * read_fat: Look up a file in the FAT index
  * Return matching FAT entry for read, rm rename and stat.
- * Build up memory pool and return matching entry for write operation.
- * "Last FAT entry" can be returned during write.
+ * If alloc_entry is true and there's no match return an unused FAT entry
+ * for write, the FAT is expanded if needed. "Last FAT entry" can be
+ * returned during write.
+ * The FAT in RPMB is only accessed to read the entries with a matching
+ * filename hash.
  */
-static TEE_Result read_fat(struct rpmb_file_handle *fh, tee_mm_pool_t *p)
+static TEE_Result read_fat(struct rpmb_file_handle *fh, bool alloc_entry)
 {
 	TEE_Result res = TEE_ERROR_GENERIC;
-	tee_mm_entry_t *mm = NULL;
-	struct rpmb_fat_entry *fe = NULL;
-	uint32_t fat_address;
-	bool entry_found = false;
-	bool expand_fat = false;
-	struct rpmb_file_handle last_fh;
+	struct rpmb_fat_index_entry *e = NULL;
+	struct rpmb_file_handle last_fh = { };
+	struct rpmb_fat_entry fe = { };
+	size_t free_idx = SIZE_MAX;
+	uint32_t hash = 0;
+	size_t n = 0;
 
 	DMSG("fat_address %d", fh->rpmb_fat_address);
 
-	res = fat_entry_dir_init();
+	res = rpmb_fs_setup();
 	if (res)
-		goto out;
-
-	/*
-	 * The pool is used to represent the current RPMB layout. To find
-	 * a slot for the file tee_mm_alloc is called on the pool. Thus
-	 * if it is not NULL the entire FAT must be traversed to fill in
-	 * the pool.
-	 */
-	while (true) {
-		res = fat_entry_dir_get_next(&fe, &fat_address);
-		if (res || !fe)
-			break;
+		return res;
 
-		/*
-		 * Look for an entry, matching filenames. (read, rm,
-		 * rename and stat.). Only store first filename match.
-		 */
-		if ((!strcmp(fh->filename, fe->filename)) &&
-		    (fe->flags & FILE_IS_ACTIVE) && !entry_found) {
-			entry_found = true;
-			fh->rpmb_fat_address = fat_address;
-			memcpy(&fh->fat_entry, fe, sizeof(*fe));
-			if (!p)
-				break;
-		}
+	res = wal_complete();
+	if (res)
+		return res;
 
-		/* Add existing files to memory pool. (write) */
-		if (p) {
-			if ((fe->flags & FILE_IS_ACTIVE) && fe->data_size > 0) {
+	if (!fat_index) {
+		res = fat_index_init();
+		if (res)
+			return res;
+	}
 
-				mm = tee_mm_alloc2(p, fe->start_address,
-						   fe->data_size);
-				if (!mm) {
-					res = TEE_ERROR_OUT_OF_MEMORY;
-					goto out;
-				}
-			}
+	/* The pool represents the current RPMB layout, needed for write */
+	if (alloc_entry && !fat_index->pool_valid)
+		return TEE_ERROR_OUT_OF_MEMORY;
 
-			/* Unused FAT entries can be reused (write) */
-			if (((fe->flags & FILE_IS_ACTIVE) == 0) &&
-			    fh->rpmb_fat_address == 0) {
-				fh->rpmb_fat_address = fat_address;
-				memcpy(&fh->fat_entry, fe,
-				       sizeof(struct rpmb_fat_entry));
-			}
+	hash = fat_index_hash(fh->filename);
+	for (n = 0; n < fat_index->num_entries; n++) {
+		e = fat_index->entries + n;
+		if (!(e->flags & FILE_IS_ACTIVE)) {
+			if (free_idx == SIZE_MAX)
+				free_idx = n;
+			continue;
+		}
+		if (e->hash != hash)
+			continue;
 
-			if (((fe->flags & FILE_IS_LAST_ENTRY) != 0) &&
-			    fh->rpmb_fat_address == fat_address) {
-
-				/*
-				 * If the last entry was reached and was chosen
-				 * by the previous check, then the FAT needs to
-				 * be expanded.
-				 * fh->rpmb_fat_address is the address chosen
-				 * to store the files FAT entry and fat_address
-				 * is the current FAT entry address being
-				 * compared.
-				 */
-				expand_fat = true;
-			}
+		res = tee_rpmb_read(fat_index_address(n), (uint8_t *)&fe,
+				    sizeof(fe), NULL, NULL);
+		if (res)
+			return res;
+		if (!strcmp(fh->filename, fe.filename)) {
+			fh->rpmb_fat_address = fat_index_address(n);
+			fh->fat_entry = fe;
+			return TEE_SUCCESS;
 		}
 	}
 
-	if (res)
-		goto out;
-	/*
-	 * Represent the FAT table in the pool.
-	 */
-	if (p) {
-		/*
-		 * Since fat_address is the start of the last entry it needs to
-		 * be moved up by an entry.
-		 */
-		fat_address += sizeof(struct rpmb_fat_entry);
+	if (fh->rpmb_fat_address)
+		return TEE_SUCCESS;
+	if (!alloc_entry)
+		return TEE_ERROR_ITEM_NOT_FOUND;
 
-		/* Make room for yet a FAT entry and add to memory pool. */
-		if (expand_fat)
-			fat_address += sizeof(struct rpmb_fat_entry);
+	/* The last entry is never active */
+	assert(free_idx != SIZE_MAX);
+	e = fat_index->entries + free_idx;
+	memset(&fh->fat_entry, 0, sizeof(fh->fat_entry));
+	fh->fat_entry.flags = e->flags;
+	fh->rpmb_fat_address = fat_index_address(free_idx);
 
-		mm = tee_mm_alloc2(p, RPMB_STORAGE_START_ADDRESS, fat_address);
-		if (!mm) {
-			res = TEE_ERROR_OUT_OF_MEMORY;
-			goto out;
-		}
+	if (e->flags & FILE_IS_LAST_ENTRY) {
+		/* Make room for yet a FAT entry */
+		res = fat_index_expand_fat();
+		if (res)
+			return res;
 
-		if (expand_fat) {
-			/*
-			 * Point fat_address to the beginning of the new
-			 * entry.
-			 */
-			fat_address -= sizeof(struct rpmb_fat_entry);
-			memset(&last_fh, 0, sizeof(last_fh));
-			last_fh.fat_entry.flags = FILE_IS_LAST_ENTRY;
-			last_fh.rpmb_fat_address = fat_address;
-			res = write_fat_entry(&last_fh);
-			if (res != TEE_SUCCESS)
-				goto out;
-		}
+		last_fh.fat_entry.flags = FILE_IS_LAST_ENTRY;
+		last_fh.rpmb_fat_address =
+			fat_index_address(fat_index->num_entries);
+		res = write_fat_entry(&last_fh);
+		if (res)
+			return res;
+		if (!fat_index)
+			return TEE_ERROR_OUT_OF_MEMORY;
 	}
 
-	if (!fh->rpmb_fat_address)
-		res = TEE_ERROR_ITEM_NOT_FOUND;
-
-out:
-	fat_entry_dir_deinit();
-	return res;
+	return TEE_SUCCESS;
 }
 
 static TEE_Result generate_fek(struct rpmb_fat_entry *fe, const TEE_UUID *uuid)
@@ -2338,9 +2766,6 @@ again:
 static TEE_Result rpmb_fs_open_internal(struct rpmb_file_handle *fh,
 					const TEE_UUID *uuid, bool create)
 {
-	tee_mm_pool_t p;
-	bool pool_result;
-	paddr_size_t pool_sz = 0;
 	TEE_Result res = TEE_ERROR_GENERIC;
 
 	/* We need to do setup in order to make sure fs_par is filled in */
@@ -2349,29 +2774,9 @@ static TEE_Result rpmb_fs_open_internal(struct rpmb_file_handle *fh,
 		goto out;
 
 	fh->uuid = uuid;
-	if (create) {
-		/* Upper memory allocation must be used for RPMB_FS. */
-		pool_sz = fs_par->max_rpmb_address - RPMB_STORAGE_START_ADDRESS;
-		pool_result = tee_mm_init(&p,
-					  RPMB_STORAGE_START_ADDRESS,
-					  pool_sz,
-					  RPMB_BLOCK_SIZE_SHIFT,
-					  TEE_MM_POOL_HI_ALLOC);
-
-		if (!pool_result) {
-			res = TEE_ERROR_OUT_OF_MEMORY;
-			goto out;
-		}
-
-		res = read_fat(fh, &p);
-		tee_mm_final(&p);
-		if (res != TEE_SUCCESS)
-			goto out;
-	} else {
-		res = read_fat(fh, NULL);
-		if (res != TEE_SUCCESS)
-			goto out;
-	}
+	res = read_fat(fh, create);
+	if (res != TEE_SUCCESS)
+		goto out;
 
 	/*
 	 * If this is opened with create and the entry found was not active
@@ -2430,7 +2835,7 @@ static TEE_Result rpmb_fs_read(struct tee_file_handle *tfh, size_t pos,
 
 	dump_fh(fh);
 
-	res = read_fat(fh, NULL);
+	res = read_fat(fh, false);
 	if (res != TEE_SUCCESS)
 		goto out;
 
@@ -2469,6 +2874,173 @@ out:
 	return res;
 }
 
+/**
+ * wal_write: Write whole blocks of file data atomically through the
+ * write-ahead log
+ * @addr: block aligned destination address
+ * @data: plain text data
+ * @len: size of @data, a multiple of RPMB_DATA_SIZE
+ */
+static TEE_Result wal_write(struct rpmb_file_handle *fh, uint32_t addr,
+			    const uint8_t *data, size_t len)
+{
+	struct rpmb_fs_wal wal = {
+		.magic = RPMB_FS_WAL_MAGIC,
+		.dst_address = addr,
+		.num_blocks = len / RPMB_DATA_SIZE,
+	};
+	struct tee_fs_crypt_ctx c = { };
+	TEE_Result res = TEE_ERROR_GENERIC;
+	tee_mm_entry_t *mm = NULL;
+	uint8_t *enc = NULL;
+	size_t n = 0;
+
+	enc = malloc(len);
+	if (!enc)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	/* Encrypt for the destination so replay doesn't need the FEK */
+	res = tee_fs_crypt_ctx_init(&c, fh->uuid, fh->fat_entry.fek);
+	if (res)
+		goto out;
+	for (n = 0; n < wal.num_blocks && !res; n++)
+		res = encrypt_block(&c, enc + n * RPMB_DATA_SIZE,
+				    data + n * RPMB_DATA_SIZE,
+				    addr / RPMB_DATA_SIZE + n);
+	tee_fs_crypt_ctx_final(&c);
+	if (res)
+		goto out;
+
+	mm = tee_mm_alloc(&fat_index->pool, len);
+	if (!mm) {
+		res = TEE_ERROR_STORAGE_NO_SPACE;
+		goto out;
+	}
+	wal.log_address = tee_mm_get_smem(mm);
+
+	res = tee_rpmb_write(wal.log_address, enc, len, NULL, NULL);
+	if (res)
+		goto out;
+
+	/*
+	 * Commit. From here the log blocks are kept allocated on error
+	 * since they may be replayed, and the log must be completed before
+	 * anything else is written.
+	 */
+	res = wal_write_header(&wal);
+	if (res) {
+		/* The header may have been written anyway */
+		wal_log_mm = mm;
+		mm = NULL;
+		wal_pending = true;
+		goto out;
+	}
+
+	res = tee_rpmb_write(addr, enc, len, NULL, NULL);
+	if (!res) {
+		memset(&wal, 0, sizeof(wal));
+		res = wal_write_header(&wal);
+	}
+	if (res) {
+		/* The update is committed, try to complete it now */
+		wal_log_mm = mm;
+		mm = NULL;
+		wal_pending = true;
+		res = wal_complete();
+	}
+out:
+	tee_mm_free(mm);
+	free(enc);
+	return res;
+}
+
+/*
+ * Returns the block aligned range of file data updated by writing
+ * [pos, end) in place
+ */
+static void in_place_range(struct rpmb_file_handle *fh, size_t pos,
+			   size_t end, size_t *offs, size_t *len)
+{
+	*offs = ROUNDDOWN(MIN(pos, fh->fat_entry.data_size), RPMB_DATA_SIZE);
+	*len = ROUNDUP(end, RPMB_DATA_SIZE) - *offs;
+}
+
+/*
+ * Returns true if [pos, end) can be written without moving the file:
+ * the data fits in the blocks already allocated to the file and the
+ * blocks can be written atomically, possibly through the write-ahead log.
+ * The write must either stay within the file or only append to it, so
+ * that the data write or the FAT entry update alone commits it.
+ */
+static bool can_update_in_place(struct rpmb_file_handle *fh, size_t pos,
+				size_t end)
+{
+	size_t size = fh->fat_entry.data_size;
+	size_t offs = 0;
+	size_t len = 0;
+
+	if (!size || end > ROUNDUP(size, RPMB_DATA_SIZE) ||
+	    (pos < size && end > size))
+		return false;
+
+	in_place_range(fh, pos, end, &offs, &len);
+
+	return tee_rpmb_write_is_atomic(fh->fat_entry.start_address + offs,
+					len) ||
+	       len <= CFG_RPMB_FS_WAL_BLOCKS * RPMB_DATA_SIZE;
+}
+
+/**
+ * update_in_place: Write data without moving the file, see
+ * can_update_in_place(). Data appended to the file only becomes part of
+ * it once the FAT entry is updated, the blocks written until then only
+ * hold the unchanged end of the file.
+ */
+static TEE_Result update_in_place(struct rpmb_file_handle *fh, size_t pos,
+				  const void *buf, size_t size)
+{
+	uint32_t start = fh->fat_entry.start_address;
+	size_t old_size = fh->fat_entry.data_size;
+	TEE_Result res = TEE_ERROR_GENERIC;
+	size_t end = pos + size;
+	uint8_t *data = NULL;
+	size_t rd_size = 0;
+	size_t offs = 0;
+	size_t len = 0;
+
+	in_place_range(fh, pos, end, &offs, &len);
+	data = calloc(1, len);
+	if (!data)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	rd_size = MIN(len, ROUNDUP(old_size, RPMB_DATA_SIZE) - offs);
+	res = tee_rpmb_read(start + offs, data, rd_size, fh->fat_entry.fek,
+			    fh->uuid);
+	if (res)
+		goto out;
+
+	/* Stale data may follow the end of the file in the last block */
+	if (pos > old_size)
+		memset(data + old_size - offs, 0, pos - old_size);
+	memcpy(data + pos - offs, buf, size);
+
+	if (tee_rpmb_write_is_atomic(start + offs, len))
+		res = tee_rpmb_write(start + offs, data, len,
+				     fh->fat_entry.fek, fh->uuid);
+	else
+		res = wal_write(fh, start + offs, data, len);
+	if (res)
+		goto out;
+
+	if (end > old_size) {
+		fh->fat_entry.data_size = end;
+		res = write_fat_entry(fh);
+	}
+out:
+	free(data);
+	return res;
+}
+
 static TEE_Result update_write_helper(struct rpmb_file_handle *fh,
 				      size_t pos, const void *buf,
 				      size_t size, uintptr_t new_fat,
@@ -2546,11 +3118,8 @@ static TEE_Result rpmb_fs_write_primitive(struct rpmb_file_handle *fh,
 					  size_t size)
 {
 	TEE_Result res = TEE_ERROR_GENERIC;
-	tee_mm_pool_t p = { };
-	bool pool_result = false;
 	size_t end = 0;
 	uint32_t start_addr = 0;
-	paddr_size_t pool_sz = 0;
 
 	if (!size)
 		return TEE_SUCCESS;
@@ -2562,19 +3131,7 @@ static TEE_Result rpmb_fs_write_primitive(struct rpmb_file_handle *fh,
 
 	dump_fh(fh);
 
-	/* Upper memory allocation must be used for RPMB_FS. */
-	pool_sz = fs_par->max_rpmb_address - RPMB_STORAGE_START_ADDRESS;
-	pool_result = tee_mm_init(&p,
-				  RPMB_STORAGE_START_ADDRESS,
-				  pool_sz,
-				  RPMB_BLOCK_SIZE_SHIFT,
-				  TEE_MM_POOL_HI_ALLOC);
-	if (!pool_result) {
-		res = TEE_ERROR_OUT_OF_MEMORY;
-		goto out;
-	}
-
-	res = read_fat(fh, &p);
+	res = read_fat(fh, true);
 	if (res != TEE_SUCCESS)
 		goto out;
 
@@ -2596,13 +3153,16 @@ static TEE_Result rpmb_fs_write_primitive(struct rpmb_file_handle *fh,
 		DMSG("Updating data in-place");
 		res = tee_rpmb_write(start_addr, buf,
 				     size, fh->fat_entry.fek, fh->uuid);
+	} else if (can_update_in_place(fh, pos, end)) {
+		DMSG("Updating blocks in-place");
+		res = update_in_place(fh, pos, buf, size);
 	} else {
 		/*
 		 * File must be extended, or update cannot be atomic: allocate,
 		 * read, update, write.
 		 */
 		size_t new_size = MAX(end, fh->fat_entry.data_size);
-		tee_mm_entry_t *mm = tee_mm_alloc(&p, new_size);
+		tee_mm_entry_t *mm = fat_index_alloc(new_size);
 		uintptr_t new_fat_entry = 0;
 
 		DMSG("Need to re-allocate");
@@ -2622,12 +3182,10 @@ static TEE_Result rpmb_fs_write_primitive(struct rpmb_file_handle *fh,
 
 			res = write_fat_entry(fh);
 		}
+		fat_index_release();
 	}
 
 out:
-	if (pool_result)
-		tee_mm_final(&p);
-
 	return res;
 }
 
@@ -2668,7 +3226,7 @@ static TEE_Result rpmb_fs_remove_internal(struct rpmb_file_handle *fh)
 {
 	TEE_Result res;
 
-	res = read_fat(fh, NULL);
+	res = read_fat(fh, false);
 	if (res)
 		return res;
 
@@ -2726,11 +3284,11 @@ static  TEE_Result rpmb_fs_rename_internal(struct tee_pobj *old,
 		goto out;
 	}
 
-	res = read_fat(fh_old, NULL);
+	res = read_fat(fh_old, false);
 	if (res != TEE_SUCCESS)
 		goto out;
 
-	res = read_fat(fh_new, NULL);
+	res = read_fat(fh_new, false);
 	if (res == TEE_SUCCESS) {
 		if (!overwrite) {
 			res = TEE_ERROR_ACCESS_CONFLICT;
@@ -2772,14 +3330,11 @@ static  TEE_Result rpmb_fs_rename(struct tee_pobj *old, struct tee_pobj *new,
 static TEE_Result rpmb_fs_truncate(struct tee_file_handle *tfh, size_t length)
 {
 	struct rpmb_file_handle *fh = (struct rpmb_file_handle *)tfh;
-	tee_mm_pool_t p;
-	bool pool_result = false;
-	tee_mm_entry_t *mm;
+	tee_mm_entry_t *mm = NULL;
 	uint32_t newsize;
 	uint8_t *newbuf = NULL;
 	uintptr_t newaddr;
 	TEE_Result res = TEE_ERROR_GENERIC;
-	paddr_size_t pool_sz = 0;
 
 	mutex_lock(&rpmb_mutex);
 
@@ -2789,28 +3344,14 @@ static TEE_Result rpmb_fs_truncate(struct tee_file_handle *tfh, size_t length)
 	}
 	newsize = length;
 
-	res = read_fat(fh, NULL);
+	res = read_fat(fh, false);
 	if (res != TEE_SUCCESS)
 		goto out;
 
 	if (newsize > fh->fat_entry.data_size) {
 		/* Extend file */
 
-		pool_sz = fs_par->max_rpmb_address - RPMB_STORAGE_START_ADDRESS;
-		pool_result = tee_mm_init(&p,
-					  RPMB_STORAGE_START_ADDRESS,
-					  pool_sz,
-					  RPMB_BLOCK_SIZE_SHIFT,
-					  TEE_MM_POOL_HI_ALLOC);
-		if (!pool_result) {
-			res = TEE_ERROR_OUT_OF_MEMORY;
-			goto out;
-		}
-		res = read_fat(fh, &p);
-		if (res != TEE_SUCCESS)
-			goto out;
-
-		mm = tee_mm_alloc(&p, newsize);
+		mm = fat_index_alloc(newsize);
 		newbuf = calloc(1, newsize);
 		if (!mm || !newbuf) {
 			res = TEE_ERROR_OUT_OF_MEMORY;
@@ -2842,9 +3383,8 @@ static TEE_Result rpmb_fs_truncate(struct tee_file_handle *tfh, size_t length)
 	res = write_fat_entry(fh);
 
 out:
+	fat_index_release();
 	mutex_unlock(&rpmb_mutex);
-	if (pool_result)
-		tee_mm_final(&p);
 	if (newbuf)
 		free(newbuf);
 
@@ -59,6 +59,8 @@ struct tee_cryp_state {
 struct tee_cryp_obj_secret {
 	uint32_t key_size;
 	uint32_t alloc_size;
+	/* Expanded AES keys, freed each time the key is changed or cleared */
+	struct crypto_aes_key_cache *aes_cache;
 
 	/*
 	 * Pseudo code visualize layout of structure
@@ -526,6 +528,11 @@ static const struct tee_cryp_obj_type_props tee_cryp_obj_props[] = {
 	PROP(TEE_TYPE_SM4, 128, 128, 128,
 		128 / 8 + sizeof(struct tee_cryp_obj_secret),
 		tee_cryp_obj_secret_value_attrs),
+#if defined(CFG_CRYPTO_CHACHA20_POLY1305)
+	PROP(TEE_TYPE_CHACHA20, 128, 256, 256,
+		256 / 8 + sizeof(struct tee_cryp_obj_secret),
+		tee_cryp_obj_secret_value_attrs),
+#endif
 	PROP(TEE_TYPE_HMAC_MD5, 8, 64, 512,
 		512 / 8 + sizeof(struct tee_cryp_obj_secret),
 		tee_cryp_obj_secret_value_attrs),
@@ -726,6 +733,7 @@ static TEE_Result op_attr_secret_value_from_user(void *attr, const void *buffer,
 	/* Data size has to fit in allocated buffer */
 	if (size > key->alloc_size)
 		return TEE_ERROR_SECURITY;
+	crypto_aes_key_cache_free(&key->aes_cache);
 	res = copy_from_user(key + 1, buffer, size);
 	if (!res)
 		key->key_size = size;
@@ -793,6 +801,7 @@ static bool op_attr_secret_value_from_binary(void *attr, const void *data,
 	/* Data size has to fit in allocated buffer */
 	if (s > key->alloc_size)
 		return false;
+	crypto_aes_key_cache_free(&key->aes_cache);
 	key->key_size = s;
 	memcpy(key + 1, (const uint8_t *)data + *offs, s);
 	(*offs) += s;
@@ -807,6 +816,7 @@ static TEE_Result op_attr_secret_value_from_obj(void *attr, void *src_attr)
 
 	if (src_key->key_size > key->alloc_size)
 		return TEE_ERROR_BAD_STATE;
+	crypto_aes_key_cache_free(&key->aes_cache);
 	memcpy(key + 1, src_key + 1, src_key->key_size);
 	key->key_size = src_key->key_size;
 	return TEE_SUCCESS;
@@ -816,6 +826,7 @@ static void op_attr_secret_value_clear(void *attr)
 {
 	struct tee_cryp_obj_secret *key = attr;
 
+	crypto_aes_key_cache_free(&key->aes_cache);
 	key->key_size = 0;
 	memzero_explicit(key + 1, key->alloc_size);
 }
@@ -1343,6 +1354,9 @@ void tee_obj_attr_free(struct tee_obj *o)
 
 		attr_ops[ta->ops_index].free((uint8_t *)o->attr + ta->raw_offs);
 	}
+
+	if (o->info.objectType == TEE_TYPE_RSA_KEYPAIR)
+		crypto_acipher_free_rsa_precomp(o->attr);
 }
 
 void tee_obj_attr_clear(struct tee_obj *o)
@@ -1362,6 +1376,9 @@ void tee_obj_attr_clear(struct tee_obj *o)
 		attr_ops[ta->ops_index].clear((uint8_t *)o->attr +
 					      ta->raw_offs);
 	}
+
+	if (o->info.objectType == TEE_TYPE_RSA_KEYPAIR)
+		crypto_acipher_free_rsa_precomp(o->attr);
 }
 
 TEE_Result tee_obj_attr_to_binary(struct tee_obj *o, void *data,
@@ -2472,6 +2489,7 @@ TEE_Result syscall_obj_generate_key(unsigned long obj, unsigned long key_size,
 	case TEE_TYPE_DES:
 	case TEE_TYPE_DES3:
 	case TEE_TYPE_SM4:
+	case TEE_TYPE_CHACHA20:
 	case TEE_TYPE_HMAC_MD5:
 	case TEE_TYPE_HMAC_SHA1:
 	case TEE_TYPE_HMAC_SHA224:
@@ -2677,6 +2695,11 @@ static TEE_Result tee_svc_cryp_check_key_type(const struct tee_obj *o,
 	case TEE_MAIN_ALGO_SM4:
 		req_key_type = TEE_TYPE_SM4;
 		break;
+#if defined(CFG_CRYPTO_CHACHA20_POLY1305)
+	case TEE_MAIN_ALGO_CHACHA20:
+		req_key_type = TEE_TYPE_CHACHA20;
+		break;
+#endif
 	case TEE_MAIN_ALGO_RSA:
 		req_key_type = TEE_TYPE_RSA_KEYPAIR;
 		if (mode == TEE_MODE_ENCRYPT || mode == TEE_MODE_VERIFY)
@@ -2997,8 +3020,11 @@ TEE_Result syscall_hash_init(unsigned long state,
 				return TEE_ERROR_BAD_PARAMETERS;
 
 			key = (struct tee_cryp_obj_secret *)o->attr;
+			crypto_aes_key_cache_enter(&key->aes_cache, key + 1,
+						   key->key_size);
 			res = crypto_mac_init(cs->ctx, (void *)(key + 1),
 					      key->key_size);
+			crypto_aes_key_cache_exit();
 			if (res != TEE_SUCCESS)
 				return res;
 			break;
@@ -3228,15 +3254,21 @@ TEE_Result syscall_cipher_init(unsigned long state, const void *iv,
 		if ((o->info.handleFlags & TEE_HANDLE_FLAG_INITIALIZED) == 0)
 			return TEE_ERROR_BAD_PARAMETERS;
 
+		/* Only the first key is cached, the second one isn't ours */
+		crypto_aes_key_cache_enter(&key1->aes_cache, key1 + 1,
+					   key1->key_size);
 		res = crypto_cipher_init(cs->ctx, cs->mode,
 					 (uint8_t *)(key1 + 1), key1->key_size,
 					 (uint8_t *)(key2 + 1), key2->key_size,
 					 iv_bbuf, iv_len);
 	} else {
+		crypto_aes_key_cache_enter(&key1->aes_cache, key1 + 1,
+					   key1->key_size);
 		res = crypto_cipher_init(cs->ctx, cs->mode,
 					 (uint8_t *)(key1 + 1), key1->key_size,
 					 NULL, 0, iv_bbuf, iv_len);
 	}
+	crypto_aes_key_cache_exit();
 	if (res != TEE_SUCCESS)
 		return res;
 
@@ -4107,9 +4139,11 @@ TEE_Result syscall_authenc_init(unsigned long state, const void *nonce,
 	if (res)
 		return res;
 
+	crypto_aes_key_cache_enter(&key->aes_cache, key + 1, key->key_size);
 	res = crypto_authenc_init(cs->ctx, cs->mode, (uint8_t *)(key + 1),
 				  key->key_size, nonce_bbuf, nonce_len, tag_len,
 				  aad_len, payload_len);
+	crypto_aes_key_cache_exit();
 	if (res != TEE_SUCCESS)
 		return res;
 
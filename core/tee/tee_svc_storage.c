@@ -13,6 +13,7 @@
 #include <kernel/user_access.h>
 #include <memtag.h>
 #include <mm/vm.h>
+#include <stdlib_ext.h>
 #include <string.h>
 #include <tee_api_defines_extensions.h>
 #include <tee_api_defines.h>
@@ -39,6 +40,11 @@ struct tee_storage_enum {
 	const struct tee_file_operations *fops;
 };
 
+struct tee_storage_batch {
+	TAILQ_ENTRY(tee_storage_batch) link;
+	const struct tee_file_operations *fops;
+};
+
 static TEE_Result tee_svc_storage_get_enum(struct user_ta_ctx *utc,
 					   vaddr_t enum_id,
 					   struct tee_storage_enum **e_out)
@@ -73,9 +79,228 @@ static TEE_Result tee_svc_close_enum(struct user_ta_ctx *utc,
 	return TEE_SUCCESS;
 }
 
+/*
+ * struct head_cache_entry - cached head of a persistent object
+ * @fops:	storage of the object
+ * @uuid:	UUID of the TA owning the object
+ * @obj_id:	object ID
+ * @obj_id_len:	length of @obj_id
+ * @obj:	type, sizes and deserialized attributes of the object, the
+ *		object usage is in @obj->info.objectUsage and the offset of
+ *		the data stream in @obj->ds_pos
+ */
+struct head_cache_entry {
+	TAILQ_ENTRY(head_cache_entry) link;
+	const struct tee_file_operations *fops;
+	TEE_UUID uuid;
+	uint8_t obj_id[TEE_OBJECT_ID_MAX_LEN];
+	uint32_t obj_id_len;
+	struct tee_obj *obj;
+};
+
+/*
+ * Most recently used entry first. @head_cache_gen is increased each time
+ * an entry is invalidated so heads read from storage meanwhile aren't
+ * cached. An entry is only kept while its object has a handle open, it's
+ * dropped when the last one is closed.
+ */
+static TAILQ_HEAD(head_cache_head, head_cache_entry) head_cache =
+	TAILQ_HEAD_INITIALIZER(head_cache);
+static size_t head_cache_count;
+static unsigned int head_cache_gen;
+static struct mutex head_cache_mutex = MUTEX_INITIALIZER;
+
+static struct head_cache_entry *head_cache_find(struct tee_pobj *po)
+{
+	struct head_cache_entry *e = NULL;
+
+	TAILQ_FOREACH(e, &head_cache, link)
+		if (e->fops == po->fops && e->obj_id_len == po->obj_id_len &&
+		    !memcmp(&e->uuid, &po->uuid, sizeof(e->uuid)) &&
+		    !memcmp(e->obj_id, po->obj_id, po->obj_id_len))
+			return e;
+
+	return NULL;
+}
+
+static void head_cache_free_obj(struct tee_obj *o)
+{
+	if (o) {
+		tee_obj_attr_clear(o);
+		tee_obj_free(o);
+	}
+}
+
+static void head_cache_remove(struct head_cache_entry *e)
+{
+	TAILQ_REMOVE(&head_cache, e, link);
+	head_cache_count--;
+	head_cache_free_obj(e->obj);
+	free_wipe(e);
+}
+
+/* Returns the generation to pass to head_cache_put() */
+static unsigned int head_cache_get_gen(void)
+{
+	unsigned int gen = 0;
+
+	mutex_lock(&head_cache_mutex);
+	gen = head_cache_gen;
+	mutex_unlock(&head_cache_mutex);
+
+	return gen;
+}
+
+/*
+ * Fills in @o from the cache, @size is the size of the file of @o just
+ * opened. Returns TEE_ERROR_ITEM_NOT_FOUND if the object isn't cached or
+ * if the cached head doesn't match the file.
+ */
+static TEE_Result head_cache_get(struct tee_obj *o, size_t size)
+{
+	struct head_cache_entry *e = NULL;
+	TEE_Result res = TEE_ERROR_ITEM_NOT_FOUND;
+	size_t cached_size = 0;
+
+	if (!CFG_TEE_STORAGE_HEAD_CACHE_ENTRIES)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	mutex_lock(&head_cache_mutex);
+
+	e = head_cache_find(o->pobj);
+	if (!e)
+		goto out;
+	if (ADD_OVERFLOW(e->obj->ds_pos, e->obj->info.dataSize,
+			 &cached_size) || cached_size != size) {
+		head_cache_gen++;
+		head_cache_remove(e);
+		goto out;
+	}
+
+	res = tee_obj_set_type(o, e->obj->info.objectType,
+			       e->obj->info.maxObjectSize);
+	if (res)
+		goto out;
+	res = tee_obj_attr_copy_from(o, e->obj);
+	if (res)
+		goto out;
+
+	o->ds_pos = e->obj->ds_pos;
+	o->info.dataSize = e->obj->info.dataSize;
+	o->info.objectSize = e->obj->info.objectSize;
+	o->pobj->obj_info_usage = e->obj->info.objectUsage;
+	o->info.objectType = e->obj->info.objectType;
+	o->have_attrs = e->obj->have_attrs;
+
+	TAILQ_REMOVE(&head_cache, e, link);
+	TAILQ_INSERT_HEAD(&head_cache, e, link);
+out:
+	mutex_unlock(&head_cache_mutex);
+
+	return res;
+}
+
+/* Caches the head of @o read from storage while at generation @gen */
+static void head_cache_put(struct tee_obj *o, unsigned int gen)
+{
+	struct head_cache_entry *e = NULL;
+	struct head_cache_entry *old = NULL;
+	struct tee_pobj *po = o->pobj;
+
+	if (!CFG_TEE_STORAGE_HEAD_CACHE_ENTRIES)
+		return;
+
+	e = calloc(1, sizeof(*e));
+	if (!e)
+		return;
+	e->obj = tee_obj_alloc();
+	if (!e->obj)
+		goto err;
+	if (tee_obj_set_type(e->obj, o->info.objectType,
+			     o->info.maxObjectSize) ||
+	    tee_obj_attr_copy_from(e->obj, o))
+		goto err;
+
+	e->obj->ds_pos = o->ds_pos;
+	e->obj->info.dataSize = o->info.dataSize;
+	e->obj->info.objectSize = o->info.objectSize;
+	e->obj->info.objectUsage = po->obj_info_usage;
+	e->obj->have_attrs = o->have_attrs;
+	e->fops = po->fops;
+	e->uuid = po->uuid;
+	memcpy(e->obj_id, po->obj_id, po->obj_id_len);
+	e->obj_id_len = po->obj_id_len;
+
+	mutex_lock(&head_cache_mutex);
+
+	if (gen != head_cache_gen) {
+		mutex_unlock(&head_cache_mutex);
+		goto err;
+	}
+
+	old = head_cache_find(po);
+	if (old)
+		head_cache_remove(old);
+	else if (head_cache_count == CFG_TEE_STORAGE_HEAD_CACHE_ENTRIES)
+		head_cache_remove(TAILQ_LAST(&head_cache, head_cache_head));
+
+	TAILQ_INSERT_HEAD(&head_cache, e, link);
+	head_cache_count++;
+
+	mutex_unlock(&head_cache_mutex);
+	return;
+err:
+	head_cache_free_obj(e->obj);
+	free_wipe(e);
+}
+
+void tee_svc_storage_invalidate_head(struct tee_pobj *po)
+{
+	struct head_cache_entry *e = NULL;
+
+	if (!CFG_TEE_STORAGE_HEAD_CACHE_ENTRIES)
+		return;
+
+	mutex_lock(&head_cache_mutex);
+
+	head_cache_gen++;
+	e = head_cache_find(po);
+	if (e)
+		head_cache_remove(e);
+
+	mutex_unlock(&head_cache_mutex);
+}
+
+/* Drops all cached heads of objects in @fops of a TA or of all if !@uuid */
+static void head_cache_flush(const struct tee_file_operations *fops,
+			     const TEE_UUID *uuid)
+{
+	struct head_cache_entry *e = NULL;
+	struct head_cache_entry *next = NULL;
+
+	if (!CFG_TEE_STORAGE_HEAD_CACHE_ENTRIES)
+		return;
+
+	mutex_lock(&head_cache_mutex);
+
+	head_cache_gen++;
+	TAILQ_FOREACH_SAFE(e, &head_cache, link, next)
+		if (e->fops == fops &&
+		    (!uuid || !memcmp(&e->uuid, uuid, sizeof(*uuid))))
+			head_cache_remove(e);
+
+	mutex_unlock(&head_cache_mutex);
+}
+
+void tee_svc_storage_flush_heads(const struct tee_file_operations *fops)
+{
+	head_cache_flush(fops, NULL);
+}
+
 static void remove_corrupt_obj(struct user_ta_ctx *utc, struct tee_obj *o)
 {
 	o->pobj->fops->remove(o->pobj);
+	tee_svc_storage_invalidate_head(o->pobj);
 	if (!(utc->ta_ctx.flags & TA_FLAG_DONT_CLOSE_HANDLE_ON_CORRUPT_OBJECT))
 		tee_obj_close(utc, o);
 }
@@ -89,12 +314,21 @@ static TEE_Result tee_svc_storage_read_head(struct tee_obj *o)
 	void *attr = NULL;
 	size_t size;
 	size_t tmp = 0;
+	unsigned int gen = head_cache_get_gen();
 
+	/*
+	 * The file is opened even if the head is cached, opening verifies
+	 * it against the current state of the storage.
+	 */
 	assert(!o->fh);
 	res = fops->open(o->pobj, &size, &o->fh);
 	if (res != TEE_SUCCESS)
 		goto exit;
 
+	res = head_cache_get(o, size);
+	if (res != TEE_ERROR_ITEM_NOT_FOUND)
+		goto exit;
+
 	/* read head */
 	bytes = sizeof(struct tee_svc_storage_head);
 	res = fops->read(o->fh, 0, &head, NULL, &bytes);
@@ -153,6 +387,7 @@ static TEE_Result tee_svc_storage_read_head(struct tee_obj *o)
 	o->info.objectType = head.objectType;
 	o->have_attrs = head.have_attrs;
 
+	head_cache_put(o, gen);
 exit:
 	free(attr);
 
@@ -296,6 +531,7 @@ static TEE_Result tee_svc_storage_init_file(struct tee_obj *o, bool overwrite,
 
 	res = fops->create(o->pobj, overwrite, &head, sizeof(head), attr,
 			   attr_size, NULL, data, len, &o->fh);
+	tee_svc_storage_invalidate_head(o->pobj);
 
 	if (res)
 		o->ds_pos = 0;
@@ -430,8 +666,10 @@ oclose:
 err:
 	if (res == TEE_ERROR_NO_DATA || res == TEE_ERROR_BAD_FORMAT)
 		res = TEE_ERROR_CORRUPT_OBJECT;
-	if (res == TEE_ERROR_CORRUPT_OBJECT && po)
+	if (res == TEE_ERROR_CORRUPT_OBJECT && po) {
 		fops->remove(po);
+		tee_svc_storage_invalidate_head(po);
+	}
 	if (o) {
 		fops->close(&o->fh);
 		tee_obj_free(o);
@@ -467,6 +705,7 @@ TEE_Result syscall_storage_obj_del(unsigned long obj)
 	}
 
 	res = o->pobj->fops->remove(o->pobj);
+	tee_svc_storage_invalidate_head(o->pobj);
 	tee_obj_close(utc, o);
 
 	return res;
@@ -522,6 +761,8 @@ TEE_Result syscall_storage_obj_rename(unsigned long obj, void *object_id,
 
 	/* move */
 	res = fops->rename(o->pobj, po, false /* no overwrite */);
+	tee_svc_storage_invalidate_head(o->pobj);
+	tee_svc_storage_invalidate_head(po);
 	if (res)
 		goto exit;
 
@@ -711,6 +952,64 @@ exit:
 	return res;
 }
 
+TEE_Result syscall_storage_next_enum_ids(unsigned long obj_enum,
+					 struct utee_object_id *ids,
+					 unsigned long max_count,
+					 uint64_t *count)
+{
+	struct ts_session *sess = ts_get_current_session();
+	struct user_ta_ctx *utc = to_user_ta_ctx(sess->ctx);
+	struct tee_storage_enum *e = NULL;
+	struct tee_fs_dirent *d = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	struct utee_object_id id = { };
+	uint64_t n = 0;
+	size_t sz = 0;
+
+	res = tee_svc_storage_get_enum(utc, uref_to_vaddr(obj_enum), &e);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	ids = memtag_strip_tag(ids);
+
+	if (MUL_OVERFLOW(max_count, sizeof(*ids), &sz))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	res = vm_check_access_rights(&utc->uctx, TEE_MEMORY_ACCESS_WRITE,
+				     (uaddr_t)ids, sz);
+	if (res != TEE_SUCCESS)
+		return res;
+
+	if (!e->fops)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	/*
+	 * Unlike syscall_storage_next_enum() the objects aren't opened to
+	 * read their info, only the directory is read.
+	 */
+	while (n < max_count) {
+		res = e->fops->readdir(e->dir, &d);
+		if (res != TEE_SUCCESS)
+			break;
+
+		memset(&id, 0, sizeof(id));
+		id.len = d->oidlen;
+		memcpy(id.id, d->oid, d->oidlen);
+		res = copy_to_user(ids + n, &id, sizeof(id));
+		if (res)
+			return res;
+		n++;
+	}
+
+	/* The end of the enumeration is reported once all IDs are returned */
+	if (res == TEE_ERROR_ITEM_NOT_FOUND && n)
+		res = TEE_SUCCESS;
+	if (res != TEE_SUCCESS)
+		return res;
+
+	return copy_to_user_private(count, &n, sizeof(*count));
+}
+
 TEE_Result syscall_storage_obj_read(unsigned long obj, void *data, size_t len,
 				    uint64_t *count)
 {
@@ -801,6 +1100,7 @@ TEE_Result syscall_storage_obj_write(unsigned long obj, void *data, size_t len)
 		goto exit;
 	}
 	res = o->pobj->fops->write(o->fh, pos_tmp, NULL, data, len);
+	tee_svc_storage_invalidate_head(o->pobj);
 	if (res != TEE_SUCCESS) {
 		if (res == TEE_ERROR_CORRUPT_OBJECT) {
 			EMSG("Object corrupt");
@@ -820,8 +1120,12 @@ exit:
 TEE_Result tee_svc_storage_write_usage(struct tee_obj *o, uint32_t usage)
 {
 	const size_t pos = offsetof(struct tee_svc_storage_head, objectUsage);
+	TEE_Result res = TEE_SUCCESS;
+
+	res = o->pobj->fops->write(o->fh, pos, &usage, NULL, sizeof(usage));
+	tee_svc_storage_invalidate_head(o->pobj);
 
-	return o->pobj->fops->write(o->fh, pos, &usage, NULL, sizeof(usage));
+	return res;
 }
 
 TEE_Result syscall_storage_obj_trunc(unsigned long obj, size_t len)
@@ -860,6 +1164,7 @@ TEE_Result syscall_storage_obj_trunc(unsigned long obj, size_t len)
 		goto exit;
 	}
 	res = o->pobj->fops->truncate(o->fh, off);
+	tee_svc_storage_invalidate_head(o->pobj);
 	switch (res) {
 	case TEE_SUCCESS:
 		o->info.dataSize = len;
@@ -921,6 +1226,86 @@ TEE_Result syscall_storage_obj_seek(unsigned long obj, int32_t offset,
 	return TEE_SUCCESS;
 }
 
+static struct tee_storage_batch *
+tee_svc_storage_get_batch(struct user_ta_ctx *utc,
+			  const struct tee_file_operations *fops)
+{
+	struct tee_storage_batch *b = NULL;
+
+	TAILQ_FOREACH(b, &utc->storage_batches, link)
+		if (b->fops == fops)
+			return b;
+
+	return NULL;
+}
+
+static TEE_Result tee_svc_storage_end_batch(struct user_ta_ctx *utc,
+					    struct tee_storage_batch *b)
+{
+	TEE_Result res = b->fops->end_batch(&utc->ta_ctx.ts_ctx.uuid);
+
+	/* Heads of objects updated in a failed batch may be stale */
+	if (res)
+		head_cache_flush(b->fops, &utc->ta_ctx.ts_ctx.uuid);
+
+	TAILQ_REMOVE(&utc->storage_batches, b, link);
+	free(b);
+
+	return res;
+}
+
+TEE_Result syscall_storage_begin_batch(unsigned long storage_id)
+{
+	const struct tee_file_operations *fops =
+			tee_svc_storage_file_ops(storage_id);
+	struct ts_session *sess = ts_get_current_session();
+	struct user_ta_ctx *utc = to_user_ta_ctx(sess->ctx);
+	struct tee_storage_batch *b = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	if (!fops)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	if (!fops->begin_batch)
+		return TEE_ERROR_NOT_SUPPORTED;
+
+	if (tee_svc_storage_get_batch(utc, fops))
+		return TEE_ERROR_BAD_STATE;
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return TEE_ERROR_OUT_OF_MEMORY;
+
+	res = fops->begin_batch(&sess->ctx->uuid);
+	if (res) {
+		free(b);
+		return res;
+	}
+
+	b->fops = fops;
+	TAILQ_INSERT_TAIL(&utc->storage_batches, b, link);
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result syscall_storage_end_batch(unsigned long storage_id)
+{
+	const struct tee_file_operations *fops =
+			tee_svc_storage_file_ops(storage_id);
+	struct ts_session *sess = ts_get_current_session();
+	struct user_ta_ctx *utc = to_user_ta_ctx(sess->ctx);
+	struct tee_storage_batch *b = NULL;
+
+	if (!fops)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+
+	b = tee_svc_storage_get_batch(utc, fops);
+	if (!b)
+		return TEE_ERROR_BAD_STATE;
+
+	return tee_svc_storage_end_batch(utc, b);
+}
+
 void tee_svc_storage_close_all_enum(struct user_ta_ctx *utc)
 {
 	struct tee_storage_enum_head *eh = &utc->storage_enums;
@@ -929,3 +1314,12 @@ void tee_svc_storage_close_all_enum(struct user_ta_ctx *utc)
 	while (!TAILQ_EMPTY(eh))
 		tee_svc_close_enum(utc, TAILQ_FIRST(eh));
 }
+
+void tee_svc_storage_end_all_batches(struct user_ta_ctx *utc)
+{
+	struct tee_storage_batch_head *bh = &utc->storage_batches;
+
+	/* disregard return value */
+	while (!TAILQ_EMPTY(bh))
+		tee_svc_storage_end_batch(utc, TAILQ_FIRST(bh));
+}
@@ -179,19 +179,33 @@ TEE_Result crypto_sha512_alloc_ctx(struct crypto_hash_ctx **ctx)
 #endif
 
 #if defined(CFG_CRYPTO_SHA256)
-TEE_Result hash_sha256_check(const uint8_t *hash, const uint8_t *data,
-			     size_t data_size)
+TEE_Result hash_sha256_compute(uint8_t *digest, const uint8_t *data,
+			       size_t data_size)
 {
+	TEE_Result res = TEE_ERROR_BAD_STATE;
 	mbedtls_sha256_context hs;
-	uint8_t digest[TEE_SHA256_HASH_SIZE] = { 0 };
 
 	memset(&hs, 0, sizeof(hs));
 	mbedtls_sha256_init(&hs);
-	mbedtls_sha256_starts(&hs, 0);
-	mbedtls_sha256_update(&hs, data, data_size);
-	mbedtls_sha256_finish(&hs, digest);
+	if (!mbedtls_sha256_starts(&hs, 0) &&
+	    !mbedtls_sha256_update(&hs, data, data_size) &&
+	    !mbedtls_sha256_finish(&hs, digest))
+		res = TEE_SUCCESS;
 	mbedtls_sha256_free(&hs);
 
+	return res;
+}
+
+TEE_Result hash_sha256_check(const uint8_t *hash, const uint8_t *data,
+			     size_t data_size)
+{
+	uint8_t digest[TEE_SHA256_HASH_SIZE] = { 0 };
+	TEE_Result res = TEE_SUCCESS;
+
+	res = hash_sha256_compute(digest, data, data_size);
+	if (res)
+		return res;
+
 	if (consttime_memcmp(digest, hash, sizeof(digest)))
 		return TEE_ERROR_SECURITY;
 	return TEE_SUCCESS;
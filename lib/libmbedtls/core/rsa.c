@@ -14,6 +14,7 @@
 #include <string.h>
 #include <tee/tee_cryp_utl.h>
 #include <utee_defines.h>
+#include <util.h>
 #include <fault_mitigation.h>
 
 #include "mbed_helpers.h"
@@ -97,19 +98,99 @@ static uint32_t tee_algo_to_mbedtls_hash_algo(uint32_t algo)
 	}
 }
 
+/*
+ * The R^2 mod m Montgomery parameters of a key are computed by the first
+ * private operation and kept in key->precomp. They're shared by all users
+ * of @key and only read by mbedtls_mpi_exp_mod() as long as they have as
+ * many limbs as their modulus.
+ */
+static void rsa_use_precomp(mbedtls_mpi *rr, const mbedtls_mpi *m,
+			    struct bignum *prec)
+{
+	const mbedtls_mpi *p = (const mbedtls_mpi *)prec;
+
+	if (p && p->n >= m->n)
+		*rr = *p;
+}
+
+static bool rsa_is_precomp(const mbedtls_mpi *rr, struct bignum *prec)
+{
+	return prec && rr->p == ((const mbedtls_mpi *)prec)->p;
+}
+
+static struct bignum *rsa_save_rr(const mbedtls_mpi *rr, const mbedtls_mpi *m)
+{
+	struct bignum *bn = NULL;
+
+	if (!rr->p)
+		return NULL;
+
+	bn = crypto_bignum_allocate(m->n * sizeof(mbedtls_mpi_uint) * 8);
+	if (!bn)
+		return NULL;
+	if (mbedtls_mpi_copy((mbedtls_mpi *)bn, rr) ||
+	    mbedtls_mpi_grow((mbedtls_mpi *)bn, m->n)) {
+		crypto_bignum_free(&bn);
+		return NULL;
+	}
+
+	return bn;
+}
+
+static void rsa_save_precomp(mbedtls_rsa_context *rsa, struct rsa_keypair *key)
+{
+	struct rsa_precomp *pc = NULL;
+
+	if (__atomic_load_n(&key->precomp, __ATOMIC_ACQUIRE) || !rsa->RN.p)
+		return;
+
+	pc = calloc(1, sizeof(*pc));
+	if (!pc)
+		return;
+
+	pc->rr_n = rsa_save_rr(&rsa->RN, &rsa->N);
+	pc->rr_p = rsa_save_rr(&rsa->RP, &rsa->P);
+	pc->rr_q = rsa_save_rr(&rsa->RQ, &rsa->Q);
+	if (!pc->rr_n || (rsa->RP.p && !pc->rr_p) ||
+	    (rsa->RQ.p && !pc->rr_q)) {
+		crypto_bignum_free(&pc->rr_n);
+		crypto_bignum_free(&pc->rr_p);
+		crypto_bignum_free(&pc->rr_q);
+		free(pc);
+		return;
+	}
+
+	crypto_acipher_publish_rsa_precomp(key, pc);
+}
+
+/*
+ * Bignums of keys are allocated for the largest size of the object, or of
+ * the key for the primes, while the Montgomery multiplications run over
+ * all limbs of the modulus. Leading zero limbs are dropped from the copies
+ * in the context since the number of limbs isn't secret.
+ */
+static void mpi_trim(mbedtls_mpi *m)
+{
+	m->n = ROUNDUP_DIV(mbedtls_mpi_size(m), sizeof(mbedtls_mpi_uint));
+}
+
 static TEE_Result rsa_complete_from_key_pair(mbedtls_rsa_context *rsa,
 						      struct rsa_keypair *key)
 {
+	struct rsa_precomp *pc = NULL;
 	int lmd_res = 0;
 
 	rsa->E = *(mbedtls_mpi *)key->e;
 	rsa->N = *(mbedtls_mpi *)key->n;
 	rsa->D = *(mbedtls_mpi *)key->d;
 	rsa->len = mbedtls_mpi_size(&rsa->N);
+	mpi_trim(&rsa->N);
 
 	if (key->p && crypto_bignum_num_bytes(key->p)) {
 		rsa->P = *(mbedtls_mpi *)key->p;
 		rsa->Q = *(mbedtls_mpi *)key->q;
+		mpi_trim(&rsa->P);
+		mpi_trim(&rsa->Q);
 		rsa->QP = *(mbedtls_mpi *)key->qp;
 		rsa->DP = *(mbedtls_mpi *)key->dp;
 		rsa->DQ = *(mbedtls_mpi *)key->dq;
@@ -137,6 +218,13 @@ static TEE_Result rsa_complete_from_key_pair(mbedtls_rsa_context *rsa,
 		}
 	}
 
+	pc = __atomic_load_n(&key->precomp, __ATOMIC_ACQUIRE);
+	if (pc) {
+		rsa_use_precomp(&rsa->RN, &rsa->N, pc->rr_n);
+		rsa_use_precomp(&rsa->RP, &rsa->P, pc->rr_p);
+		rsa_use_precomp(&rsa->RQ, &rsa->Q, pc->rr_q);
+	}
+
 	return TEE_SUCCESS;
 err:
 	mbedtls_mpi_free(&rsa->P);
@@ -162,8 +250,23 @@ static void mbd_rsa_free(mbedtls_rsa_context *rsa, struct rsa_keypair *key)
 	 * The mpi's in @rsa are initialized from @key, but the primes and
 	 * CRT part are generated if @key doesn't have them. When freeing
 	 * we should only free the generated mpi's, the ones copied are
-	 * reset instead.
+	 * reset instead. The same goes for the Montgomery parameters which
+	 * are computed by the operation unless cached in @key.
 	 */
+	struct rsa_precomp *pc = __atomic_load_n(&key->precomp,
+						 __ATOMIC_ACQUIRE);
+
+	if (pc) {
+		if (rsa_is_precomp(&rsa->RN, pc->rr_n))
+			mbedtls_mpi_init(&rsa->RN);
+		if (rsa_is_precomp(&rsa->RP, pc->rr_p))
+			mbedtls_mpi_init(&rsa->RP);
+		if (rsa_is_precomp(&rsa->RQ, pc->rr_q))
+			mbedtls_mpi_init(&rsa->RQ);
+	} else {
+		rsa_save_precomp(rsa, key);
+	}
+
 	mbedtls_mpi_init(&rsa->E);
 	mbedtls_mpi_init(&rsa->N);
 	mbedtls_mpi_init(&rsa->D);
@@ -266,6 +369,7 @@ void sw_crypto_acipher_free_rsa_keypair(struct rsa_keypair *s)
 {
 	if (!s)
 		return;
+	crypto_acipher_free_rsa_precomp(s);
 	crypto_bignum_free(&s->e);
 	crypto_bignum_free(&s->d);
 	crypto_bignum_free(&s->n);
@@ -310,6 +414,7 @@ TEE_Result sw_crypto_acipher_gen_rsa_key(struct rsa_keypair *key,
 		res = TEE_ERROR_BAD_PARAMETERS;
 	} else {
 		/* Copy the key */
+		crypto_acipher_free_rsa_precomp(key);
 		crypto_bignum_copy(key->e, (void *)&rsa.E);
 		crypto_bignum_copy(key->d, (void *)&rsa.D);
 		crypto_bignum_copy(key->n, (void *)&rsa.N);
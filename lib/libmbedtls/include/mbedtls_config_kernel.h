@@ -11,6 +11,12 @@
 #endif
 #define MBEDTLS_BIGNUM_C
 #define MBEDTLS_GENPRIME
+/*
+ * Window of the constant time modular exponentiation: one multiplication
+ * per 4 exponent bits instead of per 3 with the default, while the table
+ * of 16 powers scanned for each window stays small.
+ */
+#define MBEDTLS_MPI_WINDOW_SIZE	4
 
 /* Test if Mbedtls is the primary crypto lib */
 #ifdef CFG_CRYPTOLIB_NAME_mbedtls
@@ -121,6 +127,12 @@
 #define MBEDTLS_ECP_DP_BP512R1_ENABLED
 #define MBEDTLS_ECP_DP_CURVE25519_ENABLED
 #define MBEDTLS_ECP_C
+/*
+ * Reduce modulo the NIST primes with their dedicated word-level routines
+ * instead of a generic division. k*G already uses the const comb tables of
+ * ecp_curves.c (MBEDTLS_ECP_FIXED_POINT_OPTIM).
+ */
+#define MBEDTLS_ECP_NIST_OPTIM
 #define MBEDTLS_ECDSA_C
 #define MBEDTLS_ECDH_C
 #define MBEDTLS_ECDH_LEGACY_CONTEXT
@@ -6,6 +6,8 @@
 #ifndef __PTA_INVOKE_TESTS_H
 #define __PTA_INVOKE_TESTS_H
 
+#include <stdint.h>
+
 #define PTA_INVOKE_TESTS_UUID \
 		{ 0xd96a5b40, 0xc3e5, 0x21e3, \
 			{ 0x87, 0x94, 0x10, 0x02, 0xa5, 0xd5, 0xc6, 0x1b } }
@@ -52,7 +54,8 @@
 #define PTA_INVOKE_TESTS_CMD_COPY_SEC_TO_NSEC	5
 
 /*
- * Tests FS hash-tree corner cases in error handling
+ * Tests FS hash-tree corner cases in error handling and the discard of
+ * the pending updates of a REE FS batch
  */
 #define PTA_INVOKE_TESTS_CMD_FS_HTREE		6
 
@@ -108,5 +111,112 @@
  */
 #define PTA_INVOKE_TESTS_CMD_DT_DRIVER_TESTS	11
 
+/*
+ * RSA signature performance test, the client times the invocation. Run
+ * from several client threads at once to see how RSA operations scale
+ * with the number of cores, see CFG_CORE_MEMPOOL_LEASES. The key is
+ * generated by the first invocation with a certain key size, exclude it
+ * from the measurements.
+ *
+ * Signing with value[1].b set drops the Montgomery parameters cached with
+ * the key after each signature, compare with value[1].b cleared to see
+ * what the cache saves.
+ *
+ * [in]     value[0].a	RSA key size in bits: 1024, 2048, 3072 or 4096
+ * [in]     value[0].b	number of RSASSA PKCS#1 v1.5 SHA-256 operations
+ * [in]     value[1].a	Optional, PTA_INVOKE_TESTS_RSA_PERF_SIGN (default)
+ *			or PTA_INVOKE_TESTS_RSA_PERF_VERIFY
+ * [in]     value[1].b	Optional, non-zero to not cache Montgomery parameters
+ */
+#define PTA_INVOKE_TESTS_CMD_RSA_PERF		12
+
+#define PTA_INVOKE_TESTS_RSA_PERF_SIGN		0
+#define PTA_INVOKE_TESTS_RSA_PERF_VERIFY	1
+
+/*
+ * ECC performance test, the client times the invocation. Signing uses a
+ * key generated by the first signing invocation with a certain curve,
+ * exclude it from the measurements. Key generation and signing both
+ * compute a multiple of the curve generator, compare the timings of
+ * builds with and without CFG_CRYPTO_ECC_COMB.
+ *
+ * [in]     value[0].a	TEE_ECC_CURVE_NIST_P256 or TEE_ECC_CURVE_NIST_P384
+ * [in]     value[0].b	number of operations
+ * [in]     value[1].a	Optional, PTA_INVOKE_TESTS_ECC_PERF_SIGN (default),
+ *			ECDSA with SHA-256 or SHA-384 respectively, or
+ *			PTA_INVOKE_TESTS_ECC_PERF_KEYGEN
+ */
+#define PTA_INVOKE_TESTS_CMD_ECC_PERF		13
+
+#define PTA_INVOKE_TESTS_ECC_PERF_SIGN		0
+#define PTA_INVOKE_TESTS_ECC_PERF_KEYGEN	1
+
+/*
+ * AES small message performance test, the client times the invocation.
+ * Each operation initializes the key, processes 64 bytes and finalizes.
+ * Unless disabled the key schedules are cached as done for TA key objects
+ * with CFG_CRYPTO_AES_KEY_CACHE.
+ *
+ * [in]     value[0].a	Top 16 bits Decrypt, low 16 bits key size in bits
+ * [in]     value[0].b	AES mode, one of
+ *			PTA_INVOKE_TESTS_AES_{ECB_NOPAD,CBC_NOPAD,CTR,XTS,GCM}
+ * [in]     value[1].a	number of operations
+ * [in]     value[1].b	non-zero to not cache the key schedules
+ */
+#define PTA_INVOKE_TESTS_CMD_AES_INIT_PERF	14
+
+/*
+ * Multi-buffer hash performance test, the client times the invocation.
+ * Each operation hashes a batch of messages with crypto_hash_mb(), a
+ * batch of one message gives the time of hashing them one by one.
+ *
+ * [in]     value[0].a	TEE_ALG_SHA256 or TEE_ALG_SHA512
+ * [in]     value[0].b	number of messages in a batch, 1 to 16
+ * [in]     value[1].a	number of operations
+ * [in]     value[1].b	size of each message, 4096 for pages
+ */
+#define PTA_INVOKE_TESTS_CMD_HASH_MB_PERF	15
+
+/*
+ * Crypto operation benchmark, requires CFG_CORE_HAS_GENERIC_TIMER=y. Each
+ * operation is timed with the counter of the generic timer, the results
+ * allow comparing builds with different crypto libraries or drivers. The
+ * operation is one hash, MAC, cipher or authenticated encryption of the
+ * message, one signature or verification, one shared secret computation
+ * or one key derivation. RSA, ECDSA and SM2 sign a digest of the size of
+ * the hash of the algorithm whatever the message size, EdDSA signs the
+ * message. Asymmetric keys are generated by the first invocation with a
+ * certain algorithm and key size, exclude it from the measurements.
+ *
+ * [in]     value[0].a	TEE_ALG_* identifier
+ * [in]     value[0].b	message size, output size for HKDF or iteration
+ *			count for PBKDF2
+ * [in]     value[1].a	number of operations
+ * [in]     value[1].b	Top 16 bits PTA_INVOKE_TESTS_CRYPTO_PERF_* flags,
+ *			low 16 bits key size in bits, 0 for the default
+ * [out]    memref[2]	struct pta_invoke_tests_crypto_perf
+ */
+#define PTA_INVOKE_TESTS_CMD_CRYPTO_PERF	16
+
+/* Decrypt or verify instead of encrypt or sign */
+#define PTA_INVOKE_TESTS_CRYPTO_PERF_DECRYPT	0x1
+/* Bypass the crypto drivers, digests and ciphers only */
+#define PTA_INVOKE_TESTS_CRYPTO_PERF_SW		0x2
+
+/* Implementation of the operations, bits of the impl field */
+#define PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_TOMCRYPT	0x1
+#define PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_MBEDTLS	0x2
+/* Digest or cipher handled by a drvcrypt driver */
+#define PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_DRIVER	0x4
+
+struct pta_invoke_tests_crypto_perf {
+	uint32_t impl;		/* PTA_INVOKE_TESTS_CRYPTO_PERF_IMPL_* bits */
+	uint32_t count;		/* Number of operations */
+	uint64_t freq;		/* Counter frequency in Hz */
+	uint64_t total;		/* Sum of latencies in counter ticks */
+	uint64_t min;		/* Smallest latency in counter ticks */
+	uint64_t max;		/* Largest latency in counter ticks */
+};
+
 #endif /*__PTA_INVOKE_TESTS_H*/
 
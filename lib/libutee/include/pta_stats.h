@@ -92,4 +92,102 @@ struct pta_stats_ta {
 #define STATS_DRIVER_TYPE_CLOCK		0
 #define STATS_DRIVER_TYPE_REGULATOR	1
 
+/*
+ * STATS_CMD_RPC_SHM_CACHE_STATS - Get statistics on the per thread cache
+ * of RPC shared memory buffers
+ *
+ * [out]    value[0].a        Allocations served from the cache, that is
+ *                            OPTEE_RPC_CMD_SHM_ALLOC requests avoided
+ * [out]    value[0].b        OPTEE_RPC_CMD_SHM_ALLOC requests issued
+ * [out]    value[1].a        OPTEE_RPC_CMD_SHM_FREE requests issued
+ * [out]    value[1].b        Bytes of shared memory currently cached
+ */
+#define STATS_CMD_RPC_SHM_CACHE_STATS	6
+
+/*
+ * STATS_CMD_LOCK_STATS - Get lock contention statistics, requires
+ * CFG_LOCK_STAT=y
+ *
+ * [in]     value[0].a        STATS_LOCK_RESET to clear the statistics once
+ *                            retrieved, else 0
+ * [out]    value[0].a        Number of lock sites
+ * [out]    value[0].b        Frequency in Hz of the counter used for the
+ *                            wait times
+ * [out]    memref[1]         Array of struct pta_stats_lock sorted on
+ *                            descending total wait time
+ * [out]    value[2].a        Acquisitions not recorded due to lack of room
+ */
+#define STATS_CMD_LOCK_STATS		7
+
+#define STATS_LOCK_RESET		1
+
+#define STATS_LOCK_TYPE_MUTEX		0
+#define STATS_LOCK_TYPE_CONDVAR		1
+#define STATS_LOCK_TYPE_SPINLOCK	2
+
+struct pta_stats_lock {
+	uint64_t lock;		/* Address of the lock */
+	uint64_t site;		/* Address of the code acquiring the lock */
+	uint32_t type;		/* STATS_LOCK_TYPE_* */
+	uint32_t reserved;
+	uint64_t acquired;	/* Number of acquisitions */
+	uint64_t contended;	/* Acquisitions which had to wait */
+	uint64_t max_wait;	/* Longest wait in counter ticks */
+	uint64_t total_wait;	/* Sum of all waits in counter ticks */
+};
+
+/*
+ * STATS_CMD_LATENCY_STATS - Get latency histograms, requires
+ * CFG_LATENCY_STATS=y
+ *
+ * [in]     value[0].a        STATS_LATENCY_RESET to clear the histograms
+ *                            once retrieved, else 0
+ * [out]    value[0].a        Number of histograms
+ * [out]    value[0].b        Frequency in Hz of the counter used for the
+ *                            latencies
+ * [out]    memref[1]         Array of struct pta_stats_latency, only
+ *                            histograms with at least one sample
+ */
+#define STATS_CMD_LATENCY_STATS		8
+
+#define STATS_LATENCY_RESET		1
+
+#define STATS_LATENCY_TYPE_STD_CALL	0	/* id is OPTEE_MSG_CMD_* */
+#define STATS_LATENCY_TYPE_RPC		1	/* id is OPTEE_RPC_CMD_* */
+#define STATS_LATENCY_TYPE_TA_INVOKE	2	/* Invoke command of uuid */
+#define STATS_LATENCY_TYPE_TA_ENTER	3	/* User mode of TA uuid */
+
+/*
+ * Bucket n counts the latencies in the range [2^n, 2^(n + 1)) counter
+ * ticks, bucket 0 also counts 0 and the last bucket everything above.
+ */
+#define STATS_LATENCY_NUM_BUCKETS	32
+
+struct pta_stats_latency {
+	uint32_t type;		/* STATS_LATENCY_TYPE_* */
+	uint32_t id;		/* Command ID, 0 for TA types */
+	TEE_UUID uuid;		/* TA UUID, nil for other types */
+	uint64_t count;		/* Number of samples */
+	uint64_t total;		/* Sum of latencies in counter ticks */
+	uint64_t max;		/* Largest latency in counter ticks */
+	uint32_t buckets[STATS_LATENCY_NUM_BUCKETS];
+};
+
+/*
+ * STATS_CMD_CRYPTO_DISPATCH_STATS - Get the dispatch of crypto operations
+ * between the crypto driver and the software implementation, requires
+ * CFG_CRYPTO_DRV_DISPATCH=y
+ *
+ * [out]    value[0].a        Number of algorithms dispatched on message size
+ * [out]    memref[1]         Array of struct pta_stats_crypto_dispatch
+ */
+#define STATS_CMD_CRYPTO_DISPATCH_STATS	9
+
+struct pta_stats_crypto_dispatch {
+	uint32_t algo;		/* TEE_ALG_* identifier */
+	uint32_t threshold;	/* Shorter messages are handled in software */
+	uint32_t sw_count;	/* Operations handled in software */
+	uint32_t drv_count;	/* Operations handled by the crypto driver */
+};
+
 #endif /*__PTA_STATS_H*/
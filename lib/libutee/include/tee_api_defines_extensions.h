@@ -103,6 +103,15 @@
  */
 #define TEE_ALG_SM4_XTS 0xF0000414
 
+/*
+ * ChaCha20-Poly1305 AEAD (RFC 8439)
+ * Used with a 256-bit TEE_TYPE_CHACHA20 key, a 96-bit nonce and a 128-bit
+ * tag.
+ */
+#define TEE_ALG_CHACHA20_POLY1305	0xF00000C5
+
+#define TEE_TYPE_CHACHA20		0xA00000C5
+
 /*
  * Implementation-specific object storage constants
  */
@@ -78,4 +78,69 @@ TEE_Result tee_invoke_supp_plugin(const TEE_UUID *uuid, uint32_t cmd,
 				  uint32_t sub_cmd, void *buf, size_t len,
 				  size_t *outlen);
 
+/*
+ * struct tee_object_id - ID of a persistent object
+ * @len:	length of the ID in bytes
+ * @id:		the ID
+ */
+struct tee_object_id {
+	uint32_t len;
+	uint8_t id[TEE_OBJECT_ID_MAX_LEN];
+};
+
+/*
+ * tee_get_next_persistent_object_ids() - get the IDs of the next objects
+ * of an enumeration
+ * @objectEnumerator:	enumerator started with
+ *			TEE_StartPersistentObjectEnumerator()
+ * @ids:		array of IDs to fill in
+ * @count:		in: number of elements of @ids, out: number of
+ *			elements filled in
+ *
+ * Unlike TEE_GetNextPersistentObject() the objects aren't opened to read
+ * their TEE_ObjectInfo, and many IDs are returned with each call, which
+ * makes listing many objects considerably faster.
+ *
+ * Returns TEE_ERROR_ITEM_NOT_FOUND when there are no more objects,
+ * TEE_ERROR_NOT_SUPPORTED if the TEE core is too old to provide this
+ * function, else the same as TEE_GetNextPersistentObject().
+ */
+TEE_Result
+tee_get_next_persistent_object_ids(TEE_ObjectEnumHandle objectEnumerator,
+				   struct tee_object_id *ids, size_t *count);
+
+/*
+ * tee_begin_persistent_object_batch() - begin a batch of updates
+ * @storageID:	storage identifier, e.g. TEE_STORAGE_PRIVATE
+ *
+ * Until tee_end_persistent_object_batch() the persistent objects of
+ * @storageID created, written, truncated, renamed or deleted by the TA
+ * may be committed together instead of one by one. This saves an update
+ * of the directory of the storage and of its rollback protection for each
+ * operation, which makes creating or updating many objects considerably
+ * faster. Data written in a batch can be lost in a power failure until
+ * the batch has ended.
+ *
+ * Returns TEE_SUCCESS, TEE_ERROR_ITEM_NOT_FOUND if @storageID is unknown,
+ * TEE_ERROR_BAD_STATE if a batch already is begun, TEE_ERROR_NOT_SUPPORTED
+ * if the storage commits each operation anyway, TEE_ERROR_OUT_OF_MEMORY,
+ * TEE_ERROR_CORRUPT_OBJECT or TEE_ERROR_STORAGE_NOT_AVAILABLE.
+ */
+TEE_Result tee_begin_persistent_object_batch(uint32_t storageID);
+
+/*
+ * tee_end_persistent_object_batch() - commit and end a batch of updates
+ * @storageID:	storage identifier as passed to
+ *		tee_begin_persistent_object_batch()
+ *
+ * A batch left open is ended when the TA instance is destroyed.
+ *
+ * Returns TEE_SUCCESS, TEE_ERROR_ITEM_NOT_FOUND if @storageID is unknown,
+ * TEE_ERROR_BAD_STATE if no batch is begun or if the updates done in the
+ * batch were lost due to a failing operation, TEE_ERROR_OUT_OF_MEMORY,
+ * TEE_ERROR_CORRUPT_OBJECT or TEE_ERROR_STORAGE_NOT_AVAILABLE. The batch is
+ * ended in all cases.
+ */
+TEE_Result tee_end_persistent_object_batch(uint32_t storageID);
+
 #endif
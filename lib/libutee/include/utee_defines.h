@@ -46,6 +46,7 @@
 #define TEE_MAIN_ALGO_X25519     0x44 /* Not in v1.2 spec */
 #define TEE_MAIN_ALGO_SHAKE128   0xC3 /* OP-TEE extension */
 #define TEE_MAIN_ALGO_SHAKE256   0xC4 /* OP-TEE extension */
+#define TEE_MAIN_ALGO_CHACHA20   0xC5 /* OP-TEE extension */
 #define TEE_MAIN_ALGO_X448	 0x49
 
 
@@ -73,6 +74,8 @@ static inline uint32_t __tee_alg_get_class(uint32_t algo)
 		return TEE_OPERATION_MAC;
 	if (algo == TEE_ALG_SM4_XTS)
 		return TEE_OPERATION_CIPHER;
+	if (algo == TEE_ALG_CHACHA20_POLY1305)
+		return TEE_OPERATION_AE;
 	if (algo == TEE_ALG_RSASSA_PKCS1_PSS_MGF1_MD5)
 		return TEE_OPERATION_ASYMMETRIC_SIGNATURE;
 	if (algo == TEE_ALG_RSAES_PKCS1_OAEP_MGF1_MD5)
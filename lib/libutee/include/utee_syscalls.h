@@ -203,6 +203,19 @@ TEE_Result _utee_storage_next_enum(unsigned long obj_enum,
 				   struct utee_object_info *info,
 				   void *obj_id, uint64_t *len);
 
+/*
+ * obj_enum is of type TEE_ObjectEnumHandle, fills in up to max_count
+ * elements of ids and returns the number filled in in count
+ */
+TEE_Result _utee_storage_next_enum_ids(unsigned long obj_enum,
+				       struct utee_object_id *ids,
+				       unsigned long max_count,
+				       uint64_t *count);
+
+/* Begins or ends a batch of updates of the storage storage_id */
+TEE_Result _utee_storage_begin_batch(unsigned long storage_id);
+TEE_Result _utee_storage_end_batch(unsigned long storage_id);
+
 /* Data Stream Access Functions */
 /* obj is of type TEE_ObjectHandle */
 TEE_Result _utee_storage_obj_read(unsigned long obj, void *data, size_t len,
@@ -67,4 +67,9 @@ struct utee_object_info {
 	uint32_t handle_flags;
 };
 
+struct utee_object_id {
+	uint32_t len;
+	uint8_t id[TEE_OBJECT_ID_MAX_LEN];
+};
+
 #endif /* UTEE_TYPES_H */
@@ -2,11 +2,14 @@
 /*
  * Copyright (c) 2014, STMicroelectronics International N.V.
  */
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <tee_api.h>
+#include <tee_internal_api_extensions.h>
 #include <utee_syscalls.h>
+#include <util.h>
 #include "tee_api_private.h"
 
 #define TEE_USAGE_DEFAULT   0xffffffff
@@ -889,6 +892,72 @@ out:
 	return res;
 }
 
+TEE_Result
+tee_get_next_persistent_object_ids(TEE_ObjectEnumHandle objectEnumerator,
+				   struct tee_object_id *ids, size_t *count)
+{
+	TEE_Result res = TEE_SUCCESS;
+	uint64_t cnt = 0;
+	size_t sz = 0;
+
+	static_assert(sizeof(struct tee_object_id) ==
+		      sizeof(struct utee_object_id));
+
+	__utee_check_inout_annotation(count, sizeof(*count));
+	if (MUL_OVERFLOW(*count, sizeof(*ids), &sz)) {
+		res = TEE_ERROR_BAD_PARAMETERS;
+		goto out;
+	}
+	__utee_check_out_annotation(ids, sz);
+
+	res = _utee_storage_next_enum_ids((unsigned long)objectEnumerator,
+					  (struct utee_object_id *)ids, *count,
+					  &cnt);
+	if (res == TEE_SUCCESS)
+		*count = cnt;
+
+out:
+	if (res != TEE_SUCCESS &&
+	    res != TEE_ERROR_NOT_SUPPORTED &&
+	    res != TEE_ERROR_ITEM_NOT_FOUND &&
+	    res != TEE_ERROR_CORRUPT_OBJECT &&
+	    res != TEE_ERROR_STORAGE_NOT_AVAILABLE)
+		TEE_Panic(res);
+
+	return res;
+}
+
+TEE_Result tee_begin_persistent_object_batch(uint32_t storageID)
+{
+	TEE_Result res = _utee_storage_begin_batch(storageID);
+
+	if (res != TEE_SUCCESS &&
+	    res != TEE_ERROR_ITEM_NOT_FOUND &&
+	    res != TEE_ERROR_BAD_STATE &&
+	    res != TEE_ERROR_NOT_SUPPORTED &&
+	    res != TEE_ERROR_OUT_OF_MEMORY &&
+	    res != TEE_ERROR_CORRUPT_OBJECT &&
+	    res != TEE_ERROR_STORAGE_NOT_AVAILABLE)
+		TEE_Panic(res);
+
+	return res;
+}
+
+TEE_Result tee_end_persistent_object_batch(uint32_t storageID)
+{
+	TEE_Result res = _utee_storage_end_batch(storageID);
+
+	if (res != TEE_SUCCESS &&
+	    res != TEE_ERROR_ITEM_NOT_FOUND &&
+	    res != TEE_ERROR_BAD_STATE &&
+	    res != TEE_ERROR_OUT_OF_MEMORY &&
+	    res != TEE_ERROR_CORRUPT_OBJECT &&
+	    res != TEE_ERROR_STORAGE_NOT_AVAILABLE)
+		TEE_Panic(res);
+
+	return res;
+}
+
 /* Data and Key Storage API  - Data Stream Access Functions */
 
 TEE_Result TEE_ReadObjectData(TEE_ObjectHandle object, void *buffer,
@@ -125,6 +125,7 @@ TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
 
 	case TEE_ALG_ED25519:
 	case TEE_ALG_X25519:
+	case TEE_ALG_CHACHA20_POLY1305:
 		if (maxKeySize != 256)
 			return TEE_ERROR_NOT_SUPPORTED;
 		break;
@@ -158,6 +159,7 @@ TEE_Result TEE_AllocateOperation(TEE_OperationHandle *operation,
 		fallthrough;
 	case TEE_ALG_AES_CTR:
 	case TEE_ALG_AES_GCM:
+	case TEE_ALG_CHACHA20_POLY1305:
 		if (mode == TEE_MODE_ENCRYPT)
 			req_key_usage = TEE_USAGE_ENCRYPT;
 		else if (mode == TEE_MODE_DECRYPT)
@@ -1605,6 +1607,13 @@ TEE_Result TEE_AEInit(TEE_OperationHandle operation, const void *nonce,
 		}
 	}
 
+	/* ChaCha20-Poly1305 only has a 128-bit tag */
+	if (operation->info.algorithm == TEE_ALG_CHACHA20_POLY1305 &&
+	    tagLen != 128) {
+		res = TEE_ERROR_NOT_SUPPORTED;
+		goto out;
+	}
+
 	res = _utee_authenc_init(operation->state, nonce, nonceLen, tagLen / 8,
 				 AADLen, payloadLen);
 	if (res != TEE_SUCCESS)
@@ -2481,6 +2490,10 @@ TEE_Result TEE_IsAlgorithmSupported(uint32_t alg, uint32_t element)
 				goto check_element_none;
 		}
 	}
+	if (IS_ENABLED(CFG_CRYPTO_CHACHA20_POLY1305)) {
+		if (alg == TEE_ALG_CHACHA20_POLY1305)
+			goto check_element_none;
+	}
 	if (IS_ENABLED(CFG_CRYPTO_MD5)) {
 		if (alg == TEE_ALG_MD5)
 			goto check_element_none;
@@ -15,6 +15,10 @@
  * freed again. In order to avoid dead-lock and ease code review it is good
  * practise to free everything allocated by a certain function before
  * returning.
+ *
+ * In the kernel a pool can be split into several leases, each reserved by
+ * a thread in the same way, so that as many threads can allocate from the
+ * pool in parallel.
  */
 
 /*
@@ -49,6 +53,23 @@ extern struct mempool *mempool_default;
 struct mempool *mempool_alloc_pool(void *data, size_t size,
 				   void (*release_mem)(void *ptr, size_t size));
 
+#if defined(__KERNEL__)
+/*
+ * mempool_alloc_leased_pool() - Allocate a new memory pool split in leases
+ * @data:		a block of memory to carve out items from, must
+ *			have an alignment of MEMPOOL_ALIGN.
+ * @size:		size fo the block of memory, split evenly between
+ *			the leases
+ * @count:		number of leases
+ * @release_mem:	function to call with the memory of a lease when
+ *			the lease has been emptied, ignored if NULL.
+ * returns a pointer to a valid pool on success or NULL on failure.
+ */
+struct mempool *
+mempool_alloc_leased_pool(void *data, size_t size, size_t count,
+			  void (*release_mem)(void *ptr, size_t size));
+#endif
+
 /*
  * mempool_alloc() - Allocate an item from a memory pool
  * @pool:		A memory pool created with mempool_alloc_pool()
@@ -14,8 +14,10 @@
 #include <util.h>
 
 #if defined(__KERNEL__)
+#include <atomic.h>
 #include <kernel/mutex.h>
 #include <kernel/panic.h>
+#include <kernel/thread.h>
 #endif
 
 /*
@@ -53,27 +55,48 @@
  */
 
 
-struct mempool {
-	size_t size;  /* size of the memory pool, in bytes */
+/*
+ * struct mempool_lease - memory of a pool used by one thread at a time
+ * @data:		start of the memory of the lease
+ * @mctx:		allocator of the memory, in the kernel NULL until used
+ * @max_allocated:	highest number of bytes allocated
+ * @owner:		thread using the lease or THREAD_ID_INVALID
+ * @depth:		number of items allocated by @owner
+ *
+ * Only @owner updates the fields while the lease is in use, @owner is
+ * assigned and cleared with the mutex of the pool held.
+ */
+struct mempool_lease {
 	vaddr_t data;
 	struct malloc_ctx *mctx;
 #ifdef CFG_MEMPOOL_REPORT_LAST_OFFSET
 	size_t max_allocated;
 #endif
+#if defined(__KERNEL__)
+	short int owner;
+	unsigned int depth;
+#endif
+};
+
+struct mempool {
+	size_t size;  /* size of the memory of each lease, in bytes */
 #if defined(__KERNEL__)
 	void (*release_mem)(void *ptr, size_t size);
-	struct recursive_mutex mu;
+	struct mutex mu;
+	struct condvar cv;
 #endif
+	size_t lease_count;
+	struct mempool_lease leases[];
 };
 
 #if defined(__KERNEL__)
 struct mempool *mempool_default;
 #endif
 
-static void init_mpool(struct mempool *pool)
+static void init_mpool(struct mempool *pool, struct mempool_lease *l)
 {
 	size_t sz = pool->size - raw_malloc_get_ctx_size();
-	vaddr_t v = ROUNDDOWN(pool->data + sz, sizeof(long) * 2);
+	vaddr_t v = ROUNDDOWN(l->data + sz, sizeof(long) * 2);
 
 	/*
 	 * v is the placed as close to the end of the data pool as possible
@@ -82,85 +105,158 @@ static void init_mpool(struct mempool *pool)
 	 * locality since raw_malloc() starts to allocate from the end of
 	 * the supplied data pool.
 	 */
-	assert(v > pool->data);
-	pool->mctx = (struct malloc_ctx *)v;
-	raw_malloc_init_ctx(pool->mctx);
-	raw_malloc_add_pool(pool->mctx, (void *)pool->data, v - pool->data);
+	assert(v > l->data);
+	l->mctx = (struct malloc_ctx *)v;
+	raw_malloc_init_ctx(l->mctx);
+	raw_malloc_add_pool(l->mctx, (void *)l->data, v - l->data);
 }
 
-static void get_pool(struct mempool *pool __maybe_unused)
+#if defined(__KERNEL__)
+static struct mempool_lease *find_lease(struct mempool *pool, short int owner)
+{
+	size_t n = 0;
+
+	for (n = 0; n < pool->lease_count; n++)
+		if (atomic_load_short(&pool->leases[n].owner) == owner)
+			return pool->leases + n;
+
+	return NULL;
+}
+#endif
+
+static struct mempool_lease *get_pool(struct mempool *pool)
 {
 #if defined(__KERNEL__)
-	mutex_lock_recursive(&pool->mu);
-	if (!pool->mctx)
-		init_mpool(pool);
+	short int ct = thread_get_id();
+	struct mempool_lease *l = NULL;
 
+	/* Only this thread can have made itself the owner */
+	l = find_lease(pool, ct);
+	if (!l) {
+		mutex_lock(&pool->mu);
+		while (true) {
+			l = find_lease(pool, THREAD_ID_INVALID);
+			if (l)
+				break;
+			condvar_wait(&pool->cv, &pool->mu);
+		}
+		atomic_store_short(&l->owner, ct);
+		mutex_unlock(&pool->mu);
+
+		assert(!l->depth);
+		if (!l->mctx)
+			init_mpool(pool, l);
+	}
+	l->depth++;
+
+	return l;
+#else
+	return pool->leases;
 #endif
 }
 
-static void put_pool(struct mempool *pool __maybe_unused)
+static void put_pool(struct mempool *pool __maybe_unused,
+		     struct mempool_lease *l __maybe_unused)
 {
 #if defined(__KERNEL__)
-	if (mutex_get_recursive_lock_depth(&pool->mu) == 1) {
-		/*
-		 * As the refcount is about to become 0 there should be no items
-		 * left
-		 */
-		if (pool->release_mem) {
-			pool->mctx = NULL;
-			pool->release_mem((void *)pool->data, pool->size);
-		}
+	assert(l->owner == thread_get_id() && l->depth);
+
+	l->depth--;
+	if (l->depth)
+		return;
+
+	/* As the depth is 0 there should be no items left */
+	if (pool->release_mem) {
+		l->mctx = NULL;
+		pool->release_mem((void *)l->data, pool->size);
 	}
-	mutex_unlock_recursive(&pool->mu);
+
+	mutex_lock(&pool->mu);
+	atomic_store_short(&l->owner, THREAD_ID_INVALID);
+	condvar_signal(&pool->cv);
+	mutex_unlock(&pool->mu);
 #endif
 }
 
-struct mempool *
-mempool_alloc_pool(void *data, size_t size,
-		   void (*release_mem)(void *ptr, size_t size) __maybe_unused)
+static struct mempool_lease *get_item_lease(struct mempool *pool, void *ptr)
 {
-	struct mempool *pool = calloc(1, sizeof(*pool));
+	size_t n = ((vaddr_t)ptr - pool->leases[0].data) / pool->size;
+
+	assert(n < pool->lease_count);
+	return pool->leases + n;
+}
+
+static struct mempool *
+alloc_pool(void *data, size_t size, size_t count,
+	   void (*release_mem)(void *ptr, size_t size) __maybe_unused)
+{
+	struct mempool *pool = NULL;
+	size_t n = 0;
 
 	COMPILE_TIME_ASSERT(MEMPOOL_ALIGN >= __alignof__(struct mempool_item));
 	assert(!((vaddr_t)data & (MEMPOOL_ALIGN - 1)));
+	assert(count);
 
+	pool = calloc(1, sizeof(*pool) + count * sizeof(pool->leases[0]));
 	if (pool) {
-		pool->size = size;
-		pool->data = (vaddr_t)data;
+		pool->size = ROUNDDOWN(size / count, MEMPOOL_ALIGN);
+		pool->lease_count = count;
+		for (n = 0; n < count; n++)
+			pool->leases[n].data = (vaddr_t)data + n * pool->size;
 #if defined(__KERNEL__)
 		pool->release_mem = release_mem;
-		mutex_init_recursive(&pool->mu);
+		mutex_init(&pool->mu);
+		condvar_init(&pool->cv);
+		for (n = 0; n < count; n++)
+			pool->leases[n].owner = THREAD_ID_INVALID;
 #else
-		init_mpool(pool);
+		init_mpool(pool, pool->leases);
 #endif
 	}
 
 	return pool;
 }
 
+struct mempool *
+mempool_alloc_pool(void *data, size_t size,
+		   void (*release_mem)(void *ptr, size_t size) __maybe_unused)
+{
+	return alloc_pool(data, size, 1, release_mem);
+}
+
+#if defined(__KERNEL__)
+struct mempool *
+mempool_alloc_leased_pool(void *data, size_t size, size_t count,
+			  void (*release_mem)(void *ptr, size_t size))
+{
+	return alloc_pool(data, size, count, release_mem);
+}
+#endif
+
 void *mempool_alloc(struct mempool *pool, size_t size)
 {
+	struct mempool_lease *l = NULL;
 	void *p = NULL;
 
-	get_pool(pool);
+	l = get_pool(pool);
 
-	p = raw_malloc(0, 0, size, pool->mctx);
+	p = raw_malloc(0, 0, size, l->mctx);
 	if (p) {
 #ifdef CFG_MEMPOOL_REPORT_LAST_OFFSET
 		struct pta_stats_alloc stats = { };
 
-		raw_malloc_get_stats(pool->mctx, &stats);
-		if (stats.max_allocated > pool->max_allocated) {
-			pool->max_allocated = stats.max_allocated;
+		raw_malloc_get_stats(l->mctx, &stats);
+		if (stats.max_allocated > l->max_allocated) {
+			l->max_allocated = stats.max_allocated;
 			DMSG("Max memory usage increased to %zu",
-			     pool->max_allocated);
+			     l->max_allocated);
 		}
 #endif
 		return p;
 	}
 
 	EMSG("Failed to allocate %zu bytes, please tune the pool size", size);
-	put_pool(pool);
+	put_pool(pool, l);
 	return NULL;
 }
 
@@ -181,8 +277,11 @@ void *mempool_calloc(struct mempool *pool, size_t nmemb, size_t size)
 
 void mempool_free(struct mempool *pool, void *ptr)
 {
+	struct mempool_lease *l = NULL;
+
 	if (ptr) {
-		raw_free(ptr, pool->mctx, false /*!wipe*/);
-		put_pool(pool);
+		l = get_item_lease(pool, ptr);
+		raw_free(ptr, l->mctx, false /*!wipe*/);
+		put_pool(pool, l);
 	}
 }
@@ -112,6 +112,13 @@ CFG_MSG_LONG_PREFIX_MASK ?= 0x1a
 # Number of threads
 CFG_NUM_THREADS ?= 2
 
+# Number of threads which can use the scratch memory pool of big number
+# and other large temporary allocations in the core at the same time. Each
+# lease of the pool takes 50 KiB. With a single lease RSA, DH, DSA and ECC
+# operations of different threads are serialized, set this up to
+# CFG_TEE_CORE_NB_CORE to let them run in parallel.
+CFG_CORE_MEMPOOL_LEASES ?= 1
+
 # API implementation version
 CFG_TEE_API_VERSION ?= GPD-1.1-dev
 
@@ -149,6 +156,32 @@ CFG_TEE_FW_MANUFACTURER ?= FW_MAN_UNDEF
 # TEE_STORAGE_PRIVATE is passed to the trusted storage API)
 CFG_REE_FS ?= y
 
+# Format of files created by the REE file system. Each data block of
+# 2^CFG_REE_FS_BLOCK_SHIFT bytes (4 KiB to 64 KiB) is a node in a hash tree
+# where each node has CFG_REE_FS_HTREE_FANOUT children (2 to 8). A larger
+# fan-out makes the tree of large files shallower and larger blocks means
+# fewer nodes to read and verify. Files created with other values are still
+# read in place and are converted to the configured format when first
+# written, which copies the whole file once. The defaults give the original
+# format which can be read by older versions of OP-TEE, other values can't
+# be downgraded.
+CFG_REE_FS_HTREE_FANOUT ?= 2
+CFG_REE_FS_BLOCK_SHIFT ?= 12
+
+# Authenticated encryption of the REE file system, AES-GCM when n or
+# ChaCha20-Poly1305 when y. The latter is faster on CPUs without AES
+# instructions. The algorithm isn't recorded in the files so changing it
+# makes existing secure storage unreadable.
+CFG_REE_FS_HTREE_CHACHA20_POLY1305 ?= n
+
+# Number of persistent objects of which the head and deserialized
+# attributes are kept in secure memory while they're open, regardless of
+# storage. Opening such an object again still opens and verifies its file
+# but doesn't read and deserialize its head. Entries are dropped when the
+# object is written, renamed, removed or closed by its last handle. Set to
+# 0 to disable the cache.
+CFG_TEE_STORAGE_HEAD_CACHE_ENTRIES ?= 8
+
 # RPMB file system support
 CFG_RPMB_FS ?= n
 
@@ -195,6 +228,17 @@ CFG_RPMB_FS_RD_ENTRIES ?= 8
 # in case the cache is too small to hold all elements when traversing.
 CFG_RPMB_FS_CACHE_ENTRIES ?= 0
 
+# Maximum number of 256 byte blocks of a write-ahead log transaction.
+# Updates of file data which can't be written atomically by the RPMB
+# device (see the reliable write sector count of the device) are first
+# written to a temporary area of the RPMB partition and committed with a
+# single block write, instead of rewriting the whole file to a new
+# location. Updates larger than this, and all updates when set to 0, still
+# rewrite the file. Requires twice this amount of temporary heap memory.
+# An existing RPMB FS is upgraded to a version which older OP-TEE versions
+# refuse to mount.
+CFG_RPMB_FS_WAL_BLOCKS ?= 16
+
 # Print RPMB data frames sent to and received from the RPMB device
 CFG_RPMB_FS_DEBUG_DATA ?= n
 
@@ -892,6 +936,16 @@ CFG_PREALLOC_RPC_CACHE ?= n
 endif
 CFG_PREALLOC_RPC_CACHE ?= y
 
+# CFG_THREAD_SHM_CACHE_BUDGET is the maximum number of bytes of RPC
+# payload shared memory each secure thread keeps cached, see
+# thread_rpc_shm_cache_alloc(). With CFG_PREALLOC_RPC_CACHE=y kernel
+# private buffers are also kept between yielding calls. Buffers unused for
+# two periods of CFG_THREAD_SHM_CACHE_IDLE_MS milliseconds (requires
+# CFG_CALLOUT=y) are freed at the end of the next yielding call, whichever
+# thread it runs on.
+CFG_THREAD_SHM_CACHE_BUDGET ?= 65536
+CFG_THREAD_SHM_CACHE_IDLE_MS ?= 1000
+
 # When enabled, CFG_DRIVERS_CLK embeds a clock framework in OP-TEE core.
 # This clock framework allows to describe clock tree and provides functions to
 # get and configure the clocks.
@@ -1103,6 +1157,26 @@ CFG_WDT_SM_HANDLER_ID ?= 0x82003D06
 # the platform code
 CFG_CORE_HAS_GENERIC_TIMER ?= y
 
+# Lock contention profiler: records per lock site the number of
+# acquisitions, how many had to wait and the maximum and total time spent
+# waiting for mutexes, condvars and spinlocks. The statistics are
+# retrieved with the stats pseudo TA, see STATS_CMD_LOCK_STATS and
+# scripts/lock_stat.py. CFG_LOCK_STAT_ENTRIES is the number of lock sites
+# recorded per CPU and must be a power of two.
+# Expect a significant performance impact when enabling this.
+CFG_LOCK_STAT ?= n
+CFG_LOCK_STAT_ENTRIES ?= 64
+$(eval $(call cfg-depends-all,CFG_LOCK_STAT,CFG_CORE_HAS_GENERIC_TIMER))
+
+# Latency histograms: records log2 scale histograms of the time spent in
+# yielding calls per command, in RPCs to normal world per command, and in
+# invoke commands and user mode per TA. The histograms are retrieved with
+# the stats pseudo TA, see STATS_CMD_LATENCY_STATS.
+# CFG_LATENCY_STATS_TA_SLOTS is the number of different TAs tracked.
+CFG_LATENCY_STATS ?= n
+CFG_LATENCY_STATS_TA_SLOTS ?= 8
+$(eval $(call cfg-depends-all,CFG_LATENCY_STATS,CFG_CORE_HAS_GENERIC_TIMER))
+
 # Enable RTC API
 CFG_DRIVERS_RTC ?= n
 
@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Generates the fixed-base comb tables used by core/lib/libtomcrypt/ecc_comb.c
+# to compute k*G for the generators of the NIST P-256 and P-384 curves.
+#
+# With t teeth and a spacing of d = ceil(bits / t) columns the scalar k is
+# read as t rows of d bits and each column selects one of the 2^t entries:
+#   T[i] = sum of 2^(j * d) * G for each bit j set in i
+# All entries are stored offset by a point D derived from the curve name so
+# that no entry is the point at infinity. Starting from D, every column
+# computes R = 2 * R + (T[i] + D) which leaves
+#   R = k * G + (2^(d + 1) - 1) * D
+# once all columns are processed, the fixup point removes the offset.
+#
+# Points are stored affine, with the coordinates in the Montgomery domain
+# R = 2^bits used by the LibTomCrypt projective point functions.
+
+import argparse
+import hashlib
+
+TEETH = 5
+
+CURVES = [
+    {
+        'name': 'p256',
+        'bits': 256,
+        'p': 0xffffffff00000001000000000000000000000000ffffffffffffffffffffffff,
+        'a': -3,
+        'n': 0xffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551,
+        'gx': 0x6b17d1f2e12c4247f8bce6e563a440f277037d812deb33a0f4a13945d898c296,
+        'gy': 0x4fe342e2fe1a7f9b8ee7eb4a7c0f9e162bce33576b315ececbb6406837bf51f5,
+    },
+    {
+        'name': 'p384',
+        'bits': 384,
+        'p': int('fffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffe'
+                 'ffffffff0000000000000000ffffffff', 16),
+        'a': -3,
+        'n': int('ffffffffffffffffffffffffffffffffffffffffffffffffc7634d81f4372ddf'
+                 '581a0db248b0a77aecec196accc52973', 16),
+        'gx': int('aa87ca22be8b05378eb1c71ef320ad746e1d3b628ba79b9859f741e082542a38'
+                  '5502f25dbf55296c3a545e3872760ab7', 16),
+        'gy': int('3617de4a96262c6f5d9e98bf9292dc29f8f41dbd289a147ce9da3113b5f0b8c0'
+                  '0a60b1ce1d7e819d7a431d7c90ea0e5f', 16),
+    },
+]
+
+
+def point_add(c, P, Q):
+    p = c['p']
+
+    if P is None:
+        return Q
+    if Q is None:
+        return P
+    if P[0] == Q[0]:
+        if (P[1] + Q[1]) % p == 0:
+            return None
+        lam = (3 * P[0] * P[0] + c['a']) * pow(2 * P[1], -1, p)
+    else:
+        lam = (Q[1] - P[1]) * pow(Q[0] - P[0], -1, p)
+    lam %= p
+    x = (lam * lam - P[0] - Q[0]) % p
+    y = (lam * (P[0] - x) - P[1]) % p
+
+    return (x, y)
+
+
+def point_mul(c, k, P):
+    R = None
+
+    while k:
+        if k & 1:
+            R = point_add(c, R, P)
+        P = point_add(c, P, P)
+        k >>= 1
+
+    return R
+
+
+def point_neg(c, P):
+    return (P[0], (c['p'] - P[1]) % c['p'])
+
+
+def to_bytes(c, v):
+    return v.to_bytes(c['bits'] // 8, 'big')
+
+
+def mont_point(c, P):
+    r = 1 << c['bits']
+
+    return (to_bytes(c, P[0] * r % c['p']) +
+            to_bytes(c, P[1] * r % c['p']))
+
+
+def gen_curve(c):
+    d = (c['bits'] + TEETH - 1) // TEETH
+    G = (c['gx'], c['gy'])
+    seed = hashlib.sha256(b'OP-TEE ECC comb ' + c['name'].encode()).digest()
+    D = point_mul(c, int.from_bytes(seed, 'big') % c['n'], G)
+    rows = [point_mul(c, 1 << (j * d), G) for j in range(TEETH)]
+    points = b''
+
+    for i in range(1 << TEETH):
+        T = D
+        for j in range(TEETH):
+            if i & (1 << j):
+                T = point_add(c, T, rows[j])
+        points += mont_point(c, T)
+
+    fixup = point_neg(c, point_mul(c, (1 << (d + 1)) - 1, D))
+
+    return {
+        'spacing': d,
+        'prime': to_bytes(c, c['p']),
+        'gx': to_bytes(c, c['gx']),
+        'gy': to_bytes(c, c['gy']),
+        'r': to_bytes(c, (1 << c['bits']) % c['p']),
+        'init': mont_point(c, D),
+        'fixup': mont_point(c, fixup),
+        'points': points,
+    }
+
+
+def emit_array(f, name, data):
+    f.write('static const uint8_t {}[] = {{'.format(name))
+    for i, b in enumerate(data):
+        if i % 12 == 0:
+            f.write('\n\t')
+        else:
+            f.write(' ')
+        f.write('0x{:02x},'.format(b))
+    f.write('\n};\n\n')
+
+
+def get_args():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--out', required=True,
+                        help='Name of the generated C file')
+
+    return parser.parse_args()
+
+
+def main():
+    args = get_args()
+    fields = ['prime', 'gx', 'gy', 'r', 'init', 'fixup', 'points']
+
+    with open(args.out, 'w') as f:
+        f.write('/* Generated by scripts/gen_ecc_comb_tables.py */\n\n')
+        f.write('#include <assert.h>\n')
+        f.write('#include <ecc_comb.h>\n\n')
+        f.write('static_assert(ECC_COMB_TEETH == {});\n\n'.format(TEETH))
+
+        tables = [(c, gen_curve(c)) for c in CURVES]
+        for c, t in tables:
+            for field in fields:
+                emit_array(f, '{}_{}'.format(c['name'], field), t[field])
+
+        f.write('const struct ecc_comb_table ecc_comb_tables[] = {\n')
+        for c, t in tables:
+            f.write('\t{\n')
+            f.write('\t\t.size = {},\n'.format(c['bits'] // 8))
+            f.write('\t\t.spacing = {},\n'.format(t['spacing']))
+            for field in fields:
+                f.write('\t\t.{} = {}_{},\n'.format(field, c['name'], field))
+            f.write('\t},\n')
+        f.write('};\n\n')
+        f.write('const size_t ecc_comb_table_count = {};\n'.format(
+            len(tables)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# Formats the lock contention statistics returned by the stats pseudo TA
+# command STATS_CMD_LOCK_STATS (CFG_LOCK_STAT=y). The input file is the raw
+# content of the output memref, that is, an array of struct pta_stats_lock:
+#
+#  uint64_t lock, uint64_t site, uint32_t type, uint32_t reserved,
+#  uint64_t acquired, uint64_t contended, uint64_t max_wait,
+#  uint64_t total_wait
+#
+# all little endian. Wait times are in ticks of the counter whose frequency
+# is returned in value[0].b.
+
+import argparse
+import bisect
+import os
+import struct
+import subprocess
+import sys
+
+
+RECORD = struct.Struct('<QQIIQQQQ')
+LOCK_TYPES = ['mutex', 'condvar', 'spinlock']
+
+
+def get_args():
+    parser = argparse.ArgumentParser(description='Formats the lock '
+                                     'contention statistics of OP-TEE core '
+                                     'as a table sorted on total wait time')
+    parser.add_argument('stats', help='binary array of struct '
+                        'pta_stats_lock')
+    parser.add_argument('-f', '--freq', type=int, required=True,
+                        help='counter frequency in Hz (value[0].b)')
+    parser.add_argument('-e', '--elf', help='tee.elf, used to translate '
+                        'addresses into symbols with $(CROSS_COMPILE)nm '
+                        'and addr2line')
+    parser.add_argument('-o', '--offset', type=lambda x: int(x, 0), default=0,
+                        help='load offset of the core to subtract from the '
+                        'addresses before translation (CFG_CORE_ASLR=y)')
+    parser.add_argument('-n', '--count', type=int, default=0,
+                        help='show only the first COUNT lock sites')
+    return parser.parse_args()
+
+
+class Symbolizer:
+    def __init__(self, elf, offset):
+        self._offset = offset
+        self._cache = {}
+        self._proc = None
+        self._syms = []
+        self._addrs = []
+        if not elf:
+            return
+        prefix = os.getenv('CROSS_COMPILE', '')
+        self._proc = subprocess.Popen([prefix + 'addr2line', '-f', '-s',
+                                       '-e', elf],
+                                      stdin=subprocess.PIPE,
+                                      stdout=subprocess.PIPE,
+                                      universal_newlines=True,
+                                      bufsize=1)
+        # Locks are usually variables which addr2line can't resolve
+        out = subprocess.check_output([prefix + 'nm', '-n', '-S',
+                                       '--defined-only', elf],
+                                      universal_newlines=True)
+        for line in out.splitlines():
+            f = line.split()
+            if len(f) == 4:
+                self._syms.append((int(f[0], 16), int(f[1], 16), f[3]))
+        self._addrs = [sym[0] for sym in self._syms]
+
+    def data(self, addr):
+        a = addr - self._offset
+        i = bisect.bisect_right(self._addrs, a) - 1
+        if i >= 0:
+            start, size, name = self._syms[i]
+            if a < start + size:
+                return f'{name}+0x{a - start:x}' if a > start else name
+        return f'0x{addr:x}'
+
+    def code(self, addr):
+        if not self._proc:
+            return f'0x{addr:x}'
+        if addr not in self._cache:
+            print(f'0x{addr - self._offset:x}', file=self._proc.stdin)
+            func = self._proc.stdout.readline().strip()
+            line = self._proc.stdout.readline().strip()
+            if func == '??':
+                self._cache[addr] = f'0x{addr:x}'
+            else:
+                self._cache[addr] = f'{func} ({line})'
+        return self._cache[addr]
+
+
+def format_time(ticks, freq):
+    us = ticks * 1000000 / freq
+    if us < 1000:
+        return f'{us:9.3f} us'
+    elif us < 1000000:
+        return f'{us / 1000:9.3f} ms'
+    else:
+        return f'{us / 1000000:9.3f} s '
+
+
+def main():
+    args = get_args()
+    if args.freq <= 0:
+        print('Invalid counter frequency', file=sys.stderr)
+        sys.exit(1)
+
+    with open(args.stats, 'rb') as f:
+        data = f.read()
+    if len(data) % RECORD.size:
+        print(f'{args.stats}: size not a multiple of {RECORD.size}',
+              file=sys.stderr)
+        sys.exit(1)
+
+    recs = [RECORD.unpack_from(data, i)
+            for i in range(0, len(data), RECORD.size)]
+    # The core already sorts the records, sort again in case the file was
+    # assembled from several retrievals
+    recs.sort(key=lambda r: (r[7], r[5]), reverse=True)
+    if args.count:
+        recs = recs[:args.count]
+
+    sym = Symbolizer(args.elf, args.offset)
+    print(f'{"type":8} {"acquired":>10} {"contended":>10} '
+          f'{"total wait":>12} {"max wait":>12} {"avg wait":>12}  lock / site')
+    for lock, site, typ, _, acq, cont, max_wait, total_wait in recs:
+        name = LOCK_TYPES[typ] if typ < len(LOCK_TYPES) else str(typ)
+        avg = total_wait // cont if cont else 0
+        print(f'{name:8} {acq:10} {cont:10} '
+              f'{format_time(total_wait, args.freq)} '
+              f'{format_time(max_wait, args.freq)} '
+              f'{format_time(avg, args.freq)}  '
+              f'{sym.data(lock)}')
+        print(f'{"":71}{sym.code(site)}')
+
+
+if __name__ == "__main__":
+    main()
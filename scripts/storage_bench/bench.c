@@ -0,0 +1,428 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+/*
+ * Runs secure storage workloads against the RPMB and REE FS backends,
+ * as tee_svc_storage.c would drive them, and reports per operation the
+ * number of RPCs, the bytes moved to and from normal world and the wall
+ * clock time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee/tee_fs.h>
+#include <tee/tee_pobj.h>
+#include <tee_api_defines.h>
+#include <util.h>
+
+#include "bench.h"
+
+struct bench_args {
+	const char *fs;
+	size_t num_objs;
+	size_t obj_size;
+	size_t write_size;
+	size_t batch_size;
+	unsigned int rpmb_size_mult;
+	unsigned int rpmb_rel_wr_sec_c;
+};
+
+struct bench_op {
+	const char *name;
+	TEE_Result (*func)(const struct tee_file_operations *fops,
+			   const struct bench_args *args, size_t idx);
+	bool batch;
+};
+
+static const TEE_UUID bench_uuid = {
+	0x8aaaf200, 0x2450, 0x11e4,
+	{ 0xab, 0xe2, 0x00, 0x02, 0xa5, 0xd5, 0xc5, 0x1b },
+};
+
+static uint8_t *obj_data;
+static uint8_t *read_buf;
+static size_t enum_count;
+
+/*
+ * The file handles keep a reference to the UUID of the object so, as with
+ * tee_svc_storage.c, the object must outlive the handle.
+ */
+struct bench_obj {
+	struct tee_pobj po;
+	char id[TEE_OBJECT_ID_MAX_LEN];
+};
+
+static void init_obj(struct bench_obj *o, const char *prefix, size_t idx,
+		     const struct tee_file_operations *fops)
+{
+	o->po = (struct tee_pobj){
+		.uuid = bench_uuid,
+		.obj_id = o->id,
+		.obj_id_len = snprintf(o->id, sizeof(o->id), "%s-%05zu",
+				       prefix, idx),
+		.flags = TEE_DATA_FLAG_ACCESS_READ |
+			 TEE_DATA_FLAG_ACCESS_WRITE,
+		.fops = fops,
+	};
+}
+
+static TEE_Result op_create(const struct tee_file_operations *fops,
+			    const struct bench_args *args, size_t idx)
+{
+	struct tee_file_handle *fh = NULL;
+	struct bench_obj o = { };
+	TEE_Result res = TEE_SUCCESS;
+
+	init_obj(&o, "obj", idx, fops);
+	res = fops->create(&o.po, false, NULL, 0, NULL, 0, obj_data, NULL,
+			   args->obj_size, &fh);
+	if (!res)
+		fops->close(&fh);
+
+	return res;
+}
+
+static TEE_Result op_open(const struct tee_file_operations *fops,
+			  const struct bench_args *args __unused, size_t idx)
+{
+	struct tee_file_handle *fh = NULL;
+	struct bench_obj o = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t size = 0;
+
+	init_obj(&o, "obj", idx, fops);
+	res = fops->open(&o.po, &size, &fh);
+	if (!res)
+		fops->close(&fh);
+
+	return res;
+}
+
+static TEE_Result op_read(const struct tee_file_operations *fops,
+			  const struct bench_args *args, size_t idx)
+{
+	struct tee_file_handle *fh = NULL;
+	struct bench_obj o = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t size = 0;
+	size_t len = 0;
+
+	init_obj(&o, "obj", idx, fops);
+	res = fops->open(&o.po, &size, &fh);
+	if (res)
+		return res;
+
+	len = size;
+	res = fops->read(fh, 0, read_buf, NULL, &len);
+	fops->close(&fh);
+	if (res)
+		return res;
+
+	/* The write workloads leave the contents of obj_data unchanged */
+	if (len != size || size < args->obj_size ||
+	    memcmp(read_buf, obj_data, args->obj_size)) {
+		bench_err("obj-%05zu: unexpected content\n", idx);
+		return TEE_ERROR_CORRUPT_OBJECT;
+	}
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result write_at(const struct tee_file_operations *fops,
+			   size_t idx, size_t pos, size_t len)
+{
+	struct tee_file_handle *fh = NULL;
+	struct bench_obj o = { };
+	TEE_Result res = TEE_SUCCESS;
+	size_t size = 0;
+
+	init_obj(&o, "obj", idx, fops);
+	res = fops->open(&o.po, &size, &fh);
+	if (res)
+		return res;
+
+	res = fops->write(fh, pos, obj_data + pos, NULL, len);
+	fops->close(&fh);
+
+	return res;
+}
+
+static TEE_Result op_write(const struct tee_file_operations *fops,
+			   const struct bench_args *args, size_t idx)
+{
+	size_t len = MIN(args->write_size, args->obj_size);
+
+	return write_at(fops, idx, (args->obj_size - len) / 2, len);
+}
+
+static TEE_Result op_append(const struct tee_file_operations *fops,
+			    const struct bench_args *args, size_t idx)
+{
+	return write_at(fops, idx, args->obj_size, args->write_size);
+}
+
+static TEE_Result rename_obj(const struct tee_file_operations *fops,
+			     const char *from, const char *to, size_t idx)
+{
+	struct bench_obj old_obj = { };
+	struct bench_obj new_obj = { };
+
+	init_obj(&old_obj, from, idx, fops);
+	init_obj(&new_obj, to, idx, fops);
+
+	return fops->rename(&old_obj.po, &new_obj.po, false);
+}
+
+static TEE_Result op_rename(const struct tee_file_operations *fops,
+			    const struct bench_args *args __unused,
+			    size_t idx)
+{
+	TEE_Result res = rename_obj(fops, "obj", "tmp", idx);
+
+	if (res)
+		return res;
+
+	return rename_obj(fops, "tmp", "obj", idx);
+}
+
+static TEE_Result op_enum(const struct tee_file_operations *fops,
+			  const struct bench_args *args __unused,
+			  size_t idx __unused)
+{
+	struct tee_fs_dirent *ent = NULL;
+	struct tee_fs_dir *d = NULL;
+	TEE_Result res = TEE_SUCCESS;
+
+	res = fops->opendir(&bench_uuid, &d);
+	if (res)
+		return res;
+
+	enum_count = 0;
+	while (!fops->readdir(d, &ent))
+		enum_count++;
+	fops->closedir(d);
+
+	return TEE_SUCCESS;
+}
+
+static TEE_Result op_remove(const struct tee_file_operations *fops,
+			    const struct bench_args *args __unused,
+			    size_t idx)
+{
+	struct bench_obj o = { };
+
+	init_obj(&o, "obj", idx, fops);
+
+	return fops->remove(&o.po);
+}
+
+static const struct bench_op bench_ops[] = {
+	{ "create", op_create, true },
+	{ "open", op_open },
+	{ "read", op_read },
+	{ "write", op_write, true },
+	{ "append", op_append, true },
+	{ "rename", op_rename, true },
+	{ "enum", op_enum },
+	{ "remove", op_remove, true },
+};
+
+static void print_result(const char *fs, const char *op, size_t num_ops,
+			 uint64_t ns, const struct bench_counters *c)
+{
+	printf("%-5s %-7s %6zu %10.3f %10.1f %8.1f %10.1f %10.1f %8.1f %8.1f\n",
+	       fs, op, num_ops, ns / 1e6, ns / 1e3 / num_ops,
+	       (double)c->rpc / num_ops,
+	       (double)c->bytes_to_nw / 1024 / num_ops,
+	       (double)c->bytes_from_nw / 1024 / num_ops,
+	       (double)c->rpmb_writes / num_ops,
+	       (double)c->rpmb_blocks / num_ops);
+}
+
+/* Runs a workload, in batches of args->batch_size operations if set */
+static TEE_Result run_op(const struct tee_file_operations *fops,
+			 const struct bench_args *args,
+			 const struct bench_op *op, size_t idx, size_t num_ops)
+{
+	bool batch = args->batch_size && fops->begin_batch && op->batch;
+	TEE_Result res = TEE_SUCCESS;
+	TEE_Result res2 = TEE_SUCCESS;
+
+	if (batch && !(idx % args->batch_size)) {
+		res = fops->begin_batch(&bench_uuid);
+		if (res)
+			return res;
+	}
+
+	res = op->func(fops, args, idx);
+
+	if (batch && (res || idx + 1 == num_ops ||
+		      !((idx + 1) % args->batch_size))) {
+		res2 = fops->end_batch(&bench_uuid);
+		if (!res)
+			res = res2;
+	}
+
+	return res;
+}
+
+static int run_fs(const char *fs, const struct tee_file_operations *fops,
+		  const struct bench_args *args)
+{
+	struct bench_counters c = { };
+	const struct bench_op *op = NULL;
+	TEE_Result res = TEE_SUCCESS;
+	size_t num_ops = 0;
+	uint64_t start = 0;
+	size_t n = 0;
+	size_t m = 0;
+
+	for (n = 0; n < ARRAY_SIZE(bench_ops); n++) {
+		op = bench_ops + n;
+		/* One directory listing, the other workloads per object */
+		num_ops = op->func == op_enum ? 1 : args->num_objs;
+
+		bench_counters = (struct bench_counters){ };
+		start = bench_now_ns();
+		for (m = 0; m < num_ops; m++) {
+			res = run_op(fops, args, op, m, num_ops);
+			if (res) {
+				bench_err("%s: %s %zu failed: %#"PRIx32
+					"\n", fs, op->name, m, res);
+				return -1;
+			}
+		}
+		c = bench_counters;
+		print_result(fs, op->name, num_ops, bench_now_ns() - start,
+			     &c);
+
+		if (op->func == op_enum && enum_count != args->num_objs) {
+			bench_err("%s: enumerated %zu objects, expected %zu\n",
+				fs, enum_count, args->num_objs);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	bench_err(
+		"usage: %s [options]\n"
+		" -f rpmb|ree|all  backend to benchmark (all)\n"
+		" -n count         number of objects (32)\n"
+		" -s size          object size in bytes (4096)\n"
+		" -w size          size of the write and append updates (16)\n"
+		" -B count         operations committed together in a batch,\n"
+		"                  0 to commit each operation (0)\n"
+		" -l ns            latency of each RPC (0)\n"
+		" -b ns            latency per KiB passed to normal world (0)\n"
+		" -W ns            latency of each RPMB data write (0)\n"
+		" -m mult          RPMB size in units of 128 KiB (32)\n"
+		" -r count         RPMB reliable write sector count (1)\n",
+		prog);
+}
+
+static int parse_args(int argc, char *argv[], struct bench_args *args)
+{
+	unsigned long val = 0;
+	char *end = NULL;
+	int n = 0;
+
+	for (n = 1; n < argc; n++) {
+		if (argv[n][0] != '-' || !argv[n][1] || argv[n][2] ||
+		    n + 1 == argc)
+			return -1;
+
+		if (argv[n][1] == 'f') {
+			args->fs = argv[++n];
+			continue;
+		}
+
+		val = strtoul(argv[++n], &end, 0);
+		if (*end)
+			return -1;
+
+		switch (argv[n - 1][1]) {
+		case 'n':
+			args->num_objs = val;
+			break;
+		case 's':
+			args->obj_size = val;
+			break;
+		case 'w':
+			args->write_size = val;
+			break;
+		case 'B':
+			args->batch_size = val;
+			break;
+		case 'l':
+			bench_latency.rpc_ns = val;
+			break;
+		case 'b':
+			bench_latency.byte_ns = val;
+			break;
+		case 'W':
+			bench_latency.rpmb_write_ns = val;
+			break;
+		case 'm':
+			args->rpmb_size_mult = val;
+			break;
+		case 'r':
+			args->rpmb_rel_wr_sec_c = val;
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	if (strcmp(args->fs, "rpmb") && strcmp(args->fs, "ree") &&
+	    strcmp(args->fs, "all"))
+		return -1;
+	if (!args->num_objs || !args->obj_size)
+		return -1;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_args args = {
+		.fs = "all",
+		.num_objs = 32,
+		.obj_size = 4096,
+		.write_size = 16,
+		.rpmb_size_mult = 32,
+		.rpmb_rel_wr_sec_c = 1,
+	};
+	size_t n = 0;
+
+	if (parse_args(argc, argv, &args)) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (rpmb_dev_init(args.rpmb_size_mult, args.rpmb_rel_wr_sec_c)) {
+		bench_err("invalid RPMB device parameters\n");
+		return 1;
+	}
+
+	obj_data = malloc(args.obj_size + args.write_size);
+	read_buf = malloc(args.obj_size + args.write_size);
+	if (!obj_data || !read_buf)
+		return 1;
+	for (n = 0; n < args.obj_size + args.write_size; n++)
+		obj_data[n] = n * 7 + 1;
+
+	printf("%-5s %-7s %6s %10s %10s %8s %10s %10s %8s %8s\n",
+	       "fs", "op", "ops", "total ms", "us/op", "rpc/op",
+	       "KiB>nw/op", "KiB<nw/op", "wr/op", "blk/op");
+
+	if (strcmp(args.fs, "ree") && run_fs("rpmb", &rpmb_fs_ops, &args))
+		return 1;
+	if (strcmp(args.fs, "rpmb") && run_fs("ree", &ree_fs_ops, &args))
+		return 1;
+
+	return 0;
+}
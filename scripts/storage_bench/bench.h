@@ -0,0 +1,66 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Shared by the translation units built with the OP-TEE core headers and
+ * those built with the host headers, so only plain C types are used here.
+ */
+
+/*
+ * struct bench_counters - traffic between the storage code and the
+ * emulated normal world
+ * @rpc:		number of RPCs
+ * @bytes_to_nw:	bytes passed in input memrefs
+ * @bytes_from_nw:	bytes returned in output memrefs
+ * @rpmb_reads:		RPMB authenticated data read requests
+ * @rpmb_writes:	RPMB authenticated data write requests, that is,
+ *			increments of the write counter
+ * @rpmb_blocks:	RPMB blocks read or written
+ */
+struct bench_counters {
+	uint64_t rpc;
+	uint64_t bytes_to_nw;
+	uint64_t bytes_from_nw;
+	uint64_t rpmb_reads;
+	uint64_t rpmb_writes;
+	uint64_t rpmb_blocks;
+};
+
+/*
+ * struct bench_latency - emulated normal world cost
+ * @rpc_ns:		added to each RPC
+ * @byte_ns:		added per 1024 bytes passed in memrefs
+ * @rpmb_write_ns:	added to each RPMB write request
+ */
+struct bench_latency {
+	uint64_t rpc_ns;
+	uint64_t byte_ns;
+	uint64_t rpmb_write_ns;
+};
+
+extern struct bench_counters bench_counters;
+extern struct bench_latency bench_latency;
+
+/* host.c */
+uint64_t bench_now_ns(void);
+void bench_delay_ns(uint64_t ns);
+/* Prints to stderr, the libc headers of the core have no stdio streams */
+void bench_err(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/* rpmb_dev.c, built with the OP-TEE core headers */
+int rpmb_dev_init(unsigned int size_mult, unsigned int rel_wr_sec_c);
+uint32_t rpmb_dev_handle(const void *req, size_t req_size, void *resp,
+			 size_t resp_size);
+
+/* ree_fs_dev.c, built with the OP-TEE core headers */
+struct thread_param;
+uint32_t ree_fs_dev_handle(size_t num_params, struct thread_param *params);
+size_t ree_fs_dev_bytes_stored(void);
+
+#endif /*__BENCH_H*/
@@ -0,0 +1,61 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Configuration of the host build, replaces the generated conf.h of the
+ * core. The storage options follow the defaults of mk/config.mk with
+ * CFG_RPMB_FS=y, except CFG_RPMB_WRITE_KEY=y which is needed to program
+ * the key of the emulated RPMB device. Edit to benchmark other options.
+ */
+
+#ifndef __BENCH_CONF_H
+#define __BENCH_CONF_H
+
+#define ARM64 1
+#define CFG_ARM64_core 1
+#define CFG_TEE_CORE_NB_CORE 1
+#define CFG_NUM_THREADS 1
+#define CFG_TEE_CORE_LOG_LEVEL 1
+#define TRACE_LEVEL 1
+#define CFG_MSG_LONG_PREFIX_MASK 0x1a
+#define CFG_TEE_CORE_MALLOC_DEBUG 0
+#define CFG_TEE_CORE_DEBUG 0
+#define CFG_CORE_BGET_BESTFIT 0
+#define CFG_CORE_HEAP_SIZE 65536
+#define CFG_CORE_NEX_HEAP_SIZE 16384
+#define CFG_TEE_RAM_VA_SIZE 0x200000
+#define CFG_TZDRAM_START 0x0e100000
+#define CFG_TZDRAM_SIZE 0x00f00000
+#define CFG_SHMEM_START 0x42000000
+#define CFG_SHMEM_SIZE 0x00200000
+#define CFG_LPAE_ADDR_SPACE_BITS 32
+#define CFG_CORE_ARM64_PA_BITS 40
+#define CFG_MMAP_REGIONS 13
+#define CFG_RESERVED_VASPACE_SIZE 0x100000
+#define CFG_STACK_THREAD_EXTRA 0
+#define CFG_STACK_TMP_EXTRA 0
+#define CFG_CORE_MAX_SYSCALL_RECURSION 4
+#define CFG_CORE_THREAD_SHIFT 0
+#define CFG_MAX_CACHE_LINE_SHIFT 6
+#define CFG_WITH_USER_TA 1
+#define CFG_CRYPTO 1
+#define CFG_TEE_MANUFACTURER "LINARO"
+#define CFG_TEE_FW_IMPL_VERSION "x"
+#define CFG_TEE_FW_MANUFACTURER "x"
+#define CFG_TEE_IMPL_DESCR "x"
+#define CFG_OPTEE_REVISION_MAJOR 4
+#define CFG_OPTEE_REVISION_MINOR 0
+#define TEE_IMPL_GIT_SHA1 0
+
+#define CFG_CORE_HUK_SUBKEY_COMPAT 1
+#define CFG_REE_FS 1
+#define CFG_RPMB_FS 1
+#define CFG_REE_FS_INTEGRITY_RPMB 1
+#define CFG_REE_FS_HTREE_FANOUT 2
+#define CFG_REE_FS_BLOCK_SHIFT 12
+#define CFG_RPMB_FS_DEV_ID 0
+#define CFG_RPMB_FS_RD_ENTRIES 8
+#define CFG_RPMB_FS_CACHE_ENTRIES 0
+#define CFG_RPMB_FS_WAL_BLOCKS 16
+#define CFG_RPMB_WRITE_KEY 1
+
+#endif /*__BENCH_CONF_H*/
@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+/*
+ * The crypto_*() functions used by the storage code, implemented with the
+ * OpenSSL library of the host. Built with the host headers, only the
+ * TEE_* constants are taken from the OP-TEE headers.
+ */
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee_api_defines.h>
+
+typedef uint32_t TEE_Result;
+
+struct cipher_ctx {
+	uint32_t algo;
+	EVP_CIPHER_CTX *ctx;
+	/* AES-GCM: tag length, AAD is passed straight to @ctx */
+	size_t tag_len;
+};
+
+static const EVP_CIPHER *aes_cipher(uint32_t algo, size_t key_len)
+{
+	switch (algo) {
+	case TEE_ALG_AES_ECB_NOPAD:
+		if (key_len == 16)
+			return EVP_aes_128_ecb();
+		if (key_len == 24)
+			return EVP_aes_192_ecb();
+		if (key_len == 32)
+			return EVP_aes_256_ecb();
+		return NULL;
+	case TEE_ALG_AES_CBC_NOPAD:
+		if (key_len == 16)
+			return EVP_aes_128_cbc();
+		if (key_len == 24)
+			return EVP_aes_192_cbc();
+		if (key_len == 32)
+			return EVP_aes_256_cbc();
+		return NULL;
+	case TEE_ALG_AES_GCM:
+		if (key_len == 16)
+			return EVP_aes_128_gcm();
+		if (key_len == 24)
+			return EVP_aes_192_gcm();
+		if (key_len == 32)
+			return EVP_aes_256_gcm();
+		return NULL;
+	default:
+		return NULL;
+	}
+}
+
+TEE_Result crypto_hash_alloc_ctx(void **ctx, uint32_t algo)
+{
+	EVP_MD_CTX *c = NULL;
+
+	if (algo != TEE_ALG_SHA256)
+		return TEE_ERROR_NOT_IMPLEMENTED;
+
+	c = EVP_MD_CTX_new();
+	if (!c)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	*ctx = c;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_hash_init(void *ctx)
+{
+	if (!EVP_DigestInit_ex(ctx, EVP_sha256(), NULL))
+		return TEE_ERROR_GENERIC;
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_hash_update(void *ctx, const uint8_t *data, size_t len)
+{
+	if (!EVP_DigestUpdate(ctx, data, len))
+		return TEE_ERROR_GENERIC;
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_hash_final(void *ctx, uint8_t *digest, size_t len)
+{
+	uint8_t d[EVP_MAX_MD_SIZE] = { };
+	unsigned int dl = 0;
+
+	if (!EVP_DigestFinal_ex(ctx, d, &dl))
+		return TEE_ERROR_GENERIC;
+	memcpy(digest, d, len < dl ? len : dl);
+
+	return TEE_SUCCESS;
+}
+
+void crypto_hash_free_ctx(void *ctx)
+{
+	EVP_MD_CTX_free(ctx);
+}
+
+TEE_Result crypto_mac_alloc_ctx(void **ctx, uint32_t algo)
+{
+	EVP_MAC *mac = NULL;
+	EVP_MAC_CTX *c = NULL;
+
+	if (algo != TEE_ALG_HMAC_SHA256)
+		return TEE_ERROR_NOT_IMPLEMENTED;
+
+	mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+	if (!mac)
+		return TEE_ERROR_NOT_IMPLEMENTED;
+	c = EVP_MAC_CTX_new(mac);
+	EVP_MAC_free(mac);
+	if (!c)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	*ctx = c;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_mac_init(void *ctx, const uint8_t *key, size_t len)
+{
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_utf8_string("digest", (char *)"SHA256", 0),
+		OSSL_PARAM_construct_end(),
+	};
+
+	if (!EVP_MAC_init(ctx, key, len, params))
+		return TEE_ERROR_GENERIC;
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_mac_update(void *ctx, const uint8_t *data, size_t len)
+{
+	if (!EVP_MAC_update(ctx, data, len))
+		return TEE_ERROR_GENERIC;
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_mac_final(void *ctx, uint8_t *digest, size_t digest_len)
+{
+	uint8_t d[EVP_MAX_MD_SIZE] = { };
+	size_t dl = 0;
+
+	if (!EVP_MAC_final(ctx, d, &dl, sizeof(d)))
+		return TEE_ERROR_GENERIC;
+	memcpy(digest, d, digest_len < dl ? digest_len : dl);
+
+	return TEE_SUCCESS;
+}
+
+void crypto_mac_free_ctx(void *ctx)
+{
+	EVP_MAC_CTX_free(ctx);
+}
+
+static TEE_Result cipher_alloc(void **ctx, uint32_t algo)
+{
+	struct cipher_ctx *c = calloc(1, sizeof(*c));
+
+	if (!c)
+		return TEE_ERROR_OUT_OF_MEMORY;
+	c->algo = algo;
+	c->ctx = EVP_CIPHER_CTX_new();
+	if (!c->ctx) {
+		free(c);
+		return TEE_ERROR_OUT_OF_MEMORY;
+	}
+	*ctx = c;
+
+	return TEE_SUCCESS;
+}
+
+static void cipher_free(void *ctx)
+{
+	struct cipher_ctx *c = ctx;
+
+	if (c) {
+		EVP_CIPHER_CTX_free(c->ctx);
+		free(c);
+	}
+}
+
+TEE_Result crypto_cipher_alloc_ctx(void **ctx, uint32_t algo)
+{
+	if (algo != TEE_ALG_AES_ECB_NOPAD && algo != TEE_ALG_AES_CBC_NOPAD)
+		return TEE_ERROR_NOT_IMPLEMENTED;
+	return cipher_alloc(ctx, algo);
+}
+
+TEE_Result crypto_cipher_init(void *ctx, uint32_t mode,
+			      const uint8_t *key1, size_t key1_len,
+			      const uint8_t *key2 __attribute__((unused)),
+			      size_t key2_len __attribute__((unused)),
+			      const uint8_t *iv, size_t iv_len)
+{
+	struct cipher_ctx *c = ctx;
+	const EVP_CIPHER *cipher = aes_cipher(c->algo, key1_len);
+
+	if (!cipher)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (iv_len && iv_len != (size_t)EVP_CIPHER_iv_length(cipher))
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!EVP_CipherInit_ex(c->ctx, cipher, NULL, key1, iv,
+			       mode == TEE_MODE_ENCRYPT))
+		return TEE_ERROR_GENERIC;
+	EVP_CIPHER_CTX_set_padding(c->ctx, 0);
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_cipher_update(void *ctx,
+				uint32_t mode __attribute__((unused)),
+				bool last_block __attribute__((unused)),
+				const uint8_t *data, size_t len, uint8_t *dst)
+{
+	struct cipher_ctx *c = ctx;
+	int outl = 0;
+
+	if (!EVP_CipherUpdate(c->ctx, dst, &outl, data, len) ||
+	    (size_t)outl != len)
+		return TEE_ERROR_GENERIC;
+
+	return TEE_SUCCESS;
+}
+
+void crypto_cipher_final(void *ctx __attribute__((unused)))
+{
+}
+
+void crypto_cipher_free_ctx(void *ctx)
+{
+	cipher_free(ctx);
+}
+
+TEE_Result crypto_authenc_alloc_ctx(void **ctx, uint32_t algo)
+{
+	if (algo != TEE_ALG_AES_GCM)
+		return TEE_ERROR_NOT_IMPLEMENTED;
+	return cipher_alloc(ctx, algo);
+}
+
+TEE_Result crypto_authenc_init(void *ctx, uint32_t mode,
+			       const uint8_t *key, size_t key_len,
+			       const uint8_t *nonce, size_t nonce_len,
+			       size_t tag_len,
+			       size_t aad_len __attribute__((unused)),
+			       size_t payload_len __attribute__((unused)))
+{
+	struct cipher_ctx *c = ctx;
+	const EVP_CIPHER *cipher = aes_cipher(c->algo, key_len);
+	int enc = mode == TEE_MODE_ENCRYPT;
+
+	if (!cipher)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!EVP_CipherInit_ex(c->ctx, cipher, NULL, NULL, NULL, enc) ||
+	    !EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_GCM_SET_IVLEN, nonce_len,
+				 NULL) ||
+	    !EVP_CipherInit_ex(c->ctx, NULL, NULL, key, nonce, enc))
+		return TEE_ERROR_GENERIC;
+	c->tag_len = tag_len;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_authenc_update_aad(void *ctx,
+				     uint32_t mode __attribute__((unused)),
+				     const uint8_t *data, size_t len)
+{
+	struct cipher_ctx *c = ctx;
+	int outl = 0;
+
+	if (!EVP_CipherUpdate(c->ctx, NULL, &outl, data, len))
+		return TEE_ERROR_GENERIC;
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_authenc_update_payload(void *ctx,
+					 uint32_t mode __attribute__((unused)),
+					 const uint8_t *src_data,
+					 size_t src_len, uint8_t *dst_data,
+					 size_t *dst_len)
+{
+	struct cipher_ctx *c = ctx;
+	int outl = 0;
+
+	if (*dst_len < src_len)
+		return TEE_ERROR_SHORT_BUFFER;
+	if (!EVP_CipherUpdate(c->ctx, dst_data, &outl, src_data, src_len))
+		return TEE_ERROR_GENERIC;
+	*dst_len = outl;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_authenc_enc_final(void *ctx, const uint8_t *src_data,
+				    size_t src_len, uint8_t *dst_data,
+				    size_t *dst_len, uint8_t *dst_tag,
+				    size_t *dst_tag_len)
+{
+	struct cipher_ctx *c = ctx;
+	TEE_Result res = TEE_SUCCESS;
+	int outl = 0;
+
+	if (*dst_tag_len < c->tag_len)
+		return TEE_ERROR_SHORT_BUFFER;
+	res = crypto_authenc_update_payload(ctx, TEE_MODE_ENCRYPT, src_data,
+					    src_len, dst_data, dst_len);
+	if (res)
+		return res;
+	if (!EVP_EncryptFinal_ex(c->ctx, NULL, &outl) ||
+	    !EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_GCM_GET_TAG, c->tag_len,
+				 dst_tag))
+		return TEE_ERROR_GENERIC;
+	*dst_tag_len = c->tag_len;
+
+	return TEE_SUCCESS;
+}
+
+TEE_Result crypto_authenc_dec_final(void *ctx, const uint8_t *src_data,
+				    size_t src_len, uint8_t *dst_data,
+				    size_t *dst_len, const uint8_t *tag,
+				    size_t tag_len)
+{
+	struct cipher_ctx *c = ctx;
+	TEE_Result res = TEE_SUCCESS;
+	int outl = 0;
+
+	res = crypto_authenc_update_payload(ctx, TEE_MODE_DECRYPT, src_data,
+					    src_len, dst_data, dst_len);
+	if (res)
+		return res;
+	if (!EVP_CIPHER_CTX_ctrl(c->ctx, EVP_CTRL_GCM_SET_TAG, tag_len,
+				 (void *)tag))
+		return TEE_ERROR_GENERIC;
+	if (EVP_DecryptFinal_ex(c->ctx, NULL, &outl) <= 0)
+		return TEE_ERROR_MAC_INVALID;
+
+	return TEE_SUCCESS;
+}
+
+void crypto_authenc_final(void *ctx __attribute__((unused)))
+{
+}
+
+void crypto_authenc_free_ctx(void *ctx)
+{
+	cipher_free(ctx);
+}
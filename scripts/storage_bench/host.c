@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+
+uint64_t bench_now_ns(void)
+{
+	struct timespec ts = { };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Busy waits rather than sleeps, emulated latencies are typically a few
+ * microseconds which is well below the timer slack of the host.
+ */
+void bench_delay_ns(uint64_t ns)
+{
+	uint64_t end = 0;
+
+	if (!ns)
+		return;
+
+	end = bench_now_ns() + ns;
+	while (bench_now_ns() < end)
+		;
+}
+
+void bench_err(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+}
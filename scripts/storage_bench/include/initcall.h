@@ -0,0 +1,24 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Replaces <initcall.h> of the core for the host build, there's no boot
+ * sequence walking the initcall sections so initcalls are run as
+ * constructors before main().
+ */
+
+#ifndef __INITCALL_H
+#define __INITCALL_H
+
+#include <tee_api_types.h>
+
+#define __define_initcall(fn) \
+	static void __attribute__((constructor)) __initcall_##fn(void) \
+	{ \
+		(void)fn(); \
+	}
+
+/* Only the levels used by the storage code are provided */
+#define service_init(fn)		__define_initcall(fn)
+#define service_init_late(fn)		__define_initcall(fn)
+
+#endif /*__INITCALL_H*/
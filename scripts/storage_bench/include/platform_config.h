@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef PLATFORM_CONFIG_H
+#define PLATFORM_CONFIG_H
+
+/* Host build, nothing is mapped by the core */
+#define STACK_ALIGNMENT		64
+
+#endif /*PLATFORM_CONFIG_H*/
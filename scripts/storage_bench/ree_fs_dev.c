@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+/*
+ * In-memory backing store for the OPTEE_RPC_CMD_FS protocol used by the
+ * REE FS, a flat namespace of files kept in memory the way tee-supplicant
+ * keeps them in /data/tee.
+ */
+
+#include <kernel/thread.h>
+#include <mm/mobj.h>
+#include <optee_rpc_cmd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee/tee_fs.h>
+#include <tee_api_types.h>
+#include <util.h>
+
+#include "bench.h"
+
+#define MAX_FILES	1024
+#define MAX_FDS		64
+
+struct ree_file {
+	char name[TEE_FS_NAME_MAX];
+	uint8_t *data;
+	size_t size;
+	size_t alloc_size;
+	bool used;
+};
+
+static struct ree_file files[MAX_FILES];
+/* File descriptors map to an index in @files plus one, 0 is a free fd */
+static size_t fds[MAX_FDS];
+
+static struct ree_file *find_file(const char *name)
+{
+	size_t n = 0;
+
+	for (n = 0; n < MAX_FILES; n++)
+		if (files[n].used && !strcmp(files[n].name, name))
+			return files + n;
+
+	return NULL;
+}
+
+static struct ree_file *new_file(const char *name)
+{
+	size_t n = 0;
+
+	for (n = 0; n < MAX_FILES; n++) {
+		if (!files[n].used) {
+			files[n].used = true;
+			strlcpy(files[n].name, name, sizeof(files[n].name));
+			return files + n;
+		}
+	}
+
+	return NULL;
+}
+
+static void truncate_file(struct ree_file *f, size_t size)
+{
+	if (size > f->size)
+		memset(f->data + f->size, 0, size - f->size);
+	f->size = size;
+}
+
+static bool grow_file(struct ree_file *f, size_t size)
+{
+	size_t new_size = MAX(f->alloc_size * 2, size);
+	uint8_t *p = NULL;
+
+	if (size <= f->alloc_size)
+		return true;
+
+	p = realloc(f->data, new_size);
+	if (!p)
+		return false;
+	f->data = p;
+	f->alloc_size = new_size;
+
+	return true;
+}
+
+static struct ree_file *fd_to_file(uint64_t fd)
+{
+	if (fd >= MAX_FDS || !fds[fd])
+		return NULL;
+	return files + fds[fd] - 1;
+}
+
+static uint32_t alloc_fd(struct ree_file *f, uint64_t *fd)
+{
+	size_t n = 0;
+
+	for (n = 0; n < MAX_FDS; n++) {
+		if (!fds[n]) {
+			fds[n] = f - files + 1;
+			*fd = n;
+			return TEE_SUCCESS;
+		}
+	}
+
+	return TEE_ERROR_OUT_OF_MEMORY;
+}
+
+static const char *param_name(struct thread_param *p)
+{
+	char *name = mobj_get_va(p->u.memref.mobj, p->u.memref.offs,
+				 p->u.memref.size);
+
+	if (!name || !p->u.memref.size ||
+	    !memchr(name, 0, p->u.memref.size))
+		return NULL;
+
+	return name;
+}
+
+static void *param_buf(struct thread_param *p)
+{
+	return mobj_get_va(p->u.memref.mobj, p->u.memref.offs,
+			   p->u.memref.size);
+}
+
+static uint32_t fs_open(struct thread_param *params, bool create)
+{
+	const char *name = param_name(params + 1);
+	struct ree_file *f = NULL;
+
+	if (!name)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	f = find_file(name);
+	if (create) {
+		if (!f)
+			f = new_file(name);
+		if (!f)
+			return TEE_ERROR_STORAGE_NO_SPACE;
+		truncate_file(f, 0);
+	} else if (!f) {
+		return TEE_ERROR_ITEM_NOT_FOUND;
+	}
+
+	return alloc_fd(f, &params[2].u.value.a);
+}
+
+static uint32_t fs_read(struct thread_param *params)
+{
+	struct ree_file *f = fd_to_file(params[0].u.value.b);
+	size_t offs = params[0].u.value.c;
+	void *buf = param_buf(params + 1);
+	size_t len = 0;
+
+	if (!f || !buf)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (offs < f->size)
+		len = MIN(f->size - offs, params[1].u.memref.size);
+	memcpy(buf, f->data + offs, len);
+	params[1].u.memref.size = len;
+
+	return TEE_SUCCESS;
+}
+
+static uint32_t fs_write(struct thread_param *params)
+{
+	struct ree_file *f = fd_to_file(params[0].u.value.b);
+	size_t offs = params[0].u.value.c;
+	size_t len = params[1].u.memref.size;
+	void *buf = param_buf(params + 1);
+
+	if (!f || !buf)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	if (!grow_file(f, offs + len))
+		return TEE_ERROR_STORAGE_NO_SPACE;
+	if (offs > f->size)
+		truncate_file(f, offs);
+	memcpy(f->data + offs, buf, len);
+	f->size = MAX(f->size, offs + len);
+
+	return TEE_SUCCESS;
+}
+
+static uint32_t fs_truncate(struct thread_param *params)
+{
+	struct ree_file *f = fd_to_file(params[0].u.value.b);
+	size_t size = params[0].u.value.c;
+
+	if (!f)
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (!grow_file(f, size))
+		return TEE_ERROR_STORAGE_NO_SPACE;
+	truncate_file(f, size);
+
+	return TEE_SUCCESS;
+}
+
+static void remove_file(struct ree_file *f)
+{
+	free(f->data);
+	memset(f, 0, sizeof(*f));
+}
+
+static uint32_t fs_remove(struct thread_param *params)
+{
+	const char *name = param_name(params + 1);
+	struct ree_file *f = NULL;
+
+	if (!name)
+		return TEE_ERROR_BAD_PARAMETERS;
+	f = find_file(name);
+	if (!f)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+	remove_file(f);
+
+	return TEE_SUCCESS;
+}
+
+static uint32_t fs_rename(struct thread_param *params)
+{
+	const char *old_name = param_name(params + 1);
+	const char *new_name = param_name(params + 2);
+	struct ree_file *f = NULL;
+	struct ree_file *t = NULL;
+
+	if (!old_name || !new_name)
+		return TEE_ERROR_BAD_PARAMETERS;
+	f = find_file(old_name);
+	if (!f)
+		return TEE_ERROR_ITEM_NOT_FOUND;
+	t = find_file(new_name);
+	if (t) {
+		if (!params[0].u.value.b)
+			return TEE_ERROR_ACCESS_CONFLICT;
+		remove_file(t);
+	}
+	strlcpy(f->name, new_name, sizeof(f->name));
+
+	return TEE_SUCCESS;
+}
+
+uint32_t ree_fs_dev_handle(size_t num_params, struct thread_param *params)
+{
+	if (!num_params || params[0].attr != THREAD_PARAM_ATTR_VALUE_IN)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	switch (params[0].u.value.a) {
+	case OPTEE_RPC_FS_OPEN:
+	case OPTEE_RPC_FS_CREATE:
+		if (num_params != 3)
+			return TEE_ERROR_BAD_PARAMETERS;
+		return fs_open(params,
+			       params[0].u.value.a == OPTEE_RPC_FS_CREATE);
+	case OPTEE_RPC_FS_CLOSE:
+		if (!fd_to_file(params[0].u.value.b))
+			return TEE_ERROR_BAD_PARAMETERS;
+		fds[params[0].u.value.b] = 0;
+		return TEE_SUCCESS;
+	case OPTEE_RPC_FS_READ:
+		if (num_params != 2)
+			return TEE_ERROR_BAD_PARAMETERS;
+		return fs_read(params);
+	case OPTEE_RPC_FS_WRITE:
+		if (num_params != 2)
+			return TEE_ERROR_BAD_PARAMETERS;
+		return fs_write(params);
+	case OPTEE_RPC_FS_TRUNCATE:
+		return fs_truncate(params);
+	case OPTEE_RPC_FS_REMOVE:
+		if (num_params != 2)
+			return TEE_ERROR_BAD_PARAMETERS;
+		return fs_remove(params);
+	case OPTEE_RPC_FS_RENAME:
+		if (num_params != 3)
+			return TEE_ERROR_BAD_PARAMETERS;
+		return fs_rename(params);
+	default:
+		return TEE_ERROR_NOT_IMPLEMENTED;
+	}
+}
+
+size_t ree_fs_dev_bytes_stored(void)
+{
+	size_t bytes = 0;
+	size_t n = 0;
+
+	for (n = 0; n < MAX_FILES; n++)
+		if (files[n].used)
+			bytes += files[n].size;
+
+	return bytes;
+}
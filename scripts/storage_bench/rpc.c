@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+/*
+ * Emulated normal world: the RPCs issued by the storage code are
+ * dispatched to the in-memory RPMB device and REE FS backing store, and
+ * counted and delayed according to bench_latency.
+ */
+
+#include <kernel/thread.h>
+#include <mm/mobj.h>
+#include <optee_rpc_cmd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee_api_types.h>
+#include <util.h>
+
+#include "bench.h"
+
+#define NUM_SHM_USERS	(THREAD_SHM_CACHE_USER_RPMB + 1)
+
+struct bench_counters bench_counters;
+struct bench_latency bench_latency;
+
+struct shm_cache {
+	struct mobj mobj;
+	void *va;
+};
+
+static struct shm_cache shm_cache[NUM_SHM_USERS];
+
+static void *shm_get_va(struct mobj *mobj, size_t offs, size_t len)
+{
+	struct shm_cache *sc = container_of(mobj, struct shm_cache, mobj);
+
+	if (offs + len > mobj->size)
+		return NULL;
+	return (uint8_t *)sc->va + offs;
+}
+
+static const struct mobj_ops shm_ops = {
+	.get_va = shm_get_va,
+};
+
+void *thread_rpc_shm_cache_alloc(enum thread_shm_cache_user user,
+				 enum thread_shm_type shm_type __unused,
+				 size_t size, struct mobj **mobj)
+{
+	struct shm_cache *sc = shm_cache + user;
+	void *va = NULL;
+
+	if (user >= NUM_SHM_USERS)
+		return NULL;
+
+	if (size > sc->mobj.size) {
+		va = realloc(sc->va, size);
+		if (!va)
+			return NULL;
+		sc->va = va;
+		sc->mobj.size = size;
+		sc->mobj.ops = &shm_ops;
+	}
+	*mobj = &sc->mobj;
+
+	return sc->va;
+}
+
+static void *memref_va(struct thread_param *p)
+{
+	return mobj_get_va(p->u.memref.mobj, p->u.memref.offs,
+			   p->u.memref.size);
+}
+
+static uint32_t rpmb_cmd(size_t num_params, struct thread_param *params)
+{
+	void *req = NULL;
+	void *resp = NULL;
+
+	if (num_params != 2 ||
+	    params[0].attr != THREAD_PARAM_ATTR_MEMREF_IN ||
+	    params[1].attr != THREAD_PARAM_ATTR_MEMREF_OUT)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	req = memref_va(params);
+	resp = memref_va(params + 1);
+	if (!req || !resp)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	return rpmb_dev_handle(req, params[0].u.memref.size, resp,
+			       params[1].u.memref.size);
+}
+
+static size_t memref_bytes(size_t num_params, struct thread_param *params,
+			   bool to_nw)
+{
+	size_t bytes = 0;
+	size_t n = 0;
+
+	for (n = 0; n < num_params; n++) {
+		switch (params[n].attr) {
+		case THREAD_PARAM_ATTR_MEMREF_IN:
+			if (to_nw)
+				bytes += params[n].u.memref.size;
+			break;
+		case THREAD_PARAM_ATTR_MEMREF_OUT:
+			if (!to_nw)
+				bytes += params[n].u.memref.size;
+			break;
+		case THREAD_PARAM_ATTR_MEMREF_INOUT:
+			bytes += params[n].u.memref.size;
+			break;
+		default:
+			break;
+		}
+	}
+
+	return bytes;
+}
+
+uint32_t thread_rpc_cmd(uint32_t cmd, size_t num_params,
+			struct thread_param *params)
+{
+	size_t to_nw = memref_bytes(num_params, params, true);
+	size_t from_nw = 0;
+	uint32_t res = TEE_SUCCESS;
+
+	switch (cmd) {
+	case OPTEE_RPC_CMD_RPMB:
+		res = rpmb_cmd(num_params, params);
+		break;
+	case OPTEE_RPC_CMD_FS:
+		res = ree_fs_dev_handle(num_params, params);
+		break;
+	default:
+		/* Makes the RPMB driver fall back to the legacy protocol */
+		res = TEE_ERROR_NOT_SUPPORTED;
+		break;
+	}
+
+	from_nw = memref_bytes(num_params, params, false);
+	bench_counters.rpc++;
+	bench_counters.bytes_to_nw += to_nw;
+	bench_counters.bytes_from_nw += from_nw;
+	bench_delay_ns(bench_latency.rpc_ns +
+		       bench_latency.byte_ns * (to_nw + from_nw) / 1024);
+
+	return res;
+}
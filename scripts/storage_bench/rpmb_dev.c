@@ -0,0 +1,310 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+/*
+ * In-memory eMMC RPMB partition speaking the legacy OPTEE_RPC_CMD_RPMB
+ * protocol, as tee-supplicant does with its RPMB emulation: the
+ * authentication key is programmed once, data writes are authenticated
+ * with HMAC-SHA256 and the write counter, and data reads and counter
+ * reads are signed with the key.
+ */
+
+#include <crypto/crypto.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tee_api_types.h>
+#include <trace.h>
+#include <utee_defines.h>
+
+#include "bench.h"
+
+#define RPMB_CMD_DATA_REQ		0x00
+#define RPMB_CMD_GET_DEV_INFO		0x01
+
+#define RPMB_MSG_TYPE_REQ_AUTH_KEY_PROGRAM		0x0001
+#define RPMB_MSG_TYPE_REQ_WRITE_COUNTER_VAL_READ	0x0002
+#define RPMB_MSG_TYPE_REQ_AUTH_DATA_WRITE		0x0003
+#define RPMB_MSG_TYPE_REQ_AUTH_DATA_READ		0x0004
+
+#define RPMB_RESULT_OK				0x00
+#define RPMB_RESULT_GENERAL_FAILURE		0x01
+#define RPMB_RESULT_AUTH_FAILURE		0x02
+#define RPMB_RESULT_COUNTER_FAILURE		0x03
+#define RPMB_RESULT_ADDRESS_FAILURE		0x04
+#define RPMB_RESULT_AUTH_KEY_NOT_PROGRAMMED	0x07
+
+#define RPMB_KEY_MAC_SIZE	32
+#define RPMB_DATA_SIZE		256
+#define RPMB_FRAME_SIZE		512
+#define RPMB_SIZE_SINGLE	(128 * 1024)
+#define RPMB_CID_SIZE		16
+
+struct rpmb_req {
+	uint16_t cmd;
+	uint16_t dev_id;
+	uint16_t block_count;
+};
+
+struct rpmb_frame {
+	uint8_t stuff_bytes[196];
+	uint8_t key_mac[RPMB_KEY_MAC_SIZE];
+	uint8_t data[RPMB_DATA_SIZE];
+	uint8_t nonce[16];
+	uint8_t write_counter[4];
+	uint8_t address[2];
+	uint8_t block_count[2];
+	uint8_t op_result[2];
+	uint8_t msg_type[2];
+};
+
+#define RPMB_MAC_OFFSET		offsetof(struct rpmb_frame, data)
+#define RPMB_MAC_SIZE		(RPMB_FRAME_SIZE - RPMB_MAC_OFFSET)
+
+struct rpmb_dev_info {
+	uint8_t cid[RPMB_CID_SIZE];
+	uint8_t rpmb_size_mult;
+	uint8_t rel_wr_sec_c;
+	uint8_t ret_code;
+};
+
+static struct {
+	uint8_t key[RPMB_KEY_MAC_SIZE];
+	bool key_programmed;
+	uint32_t write_counter;
+	uint8_t *data;
+	size_t num_blocks;
+	uint8_t size_mult;
+	uint8_t rel_wr_sec_c;
+} rpmb_dev;
+
+static const uint8_t rpmb_cid[RPMB_CID_SIZE] = {
+	'B', 'E', 'N', 'C', 'H', 0x01, 0x02, 0x03,
+	0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b,
+};
+
+static uint16_t get_be16(const uint8_t *b)
+{
+	return (b[0] << 8) | b[1];
+}
+
+static void put_be16(uint8_t *b, uint16_t v)
+{
+	b[0] = v >> 8;
+	b[1] = v;
+}
+
+static void put_be32(uint8_t *b, uint32_t v)
+{
+	b[0] = v >> 24;
+	b[1] = v >> 16;
+	b[2] = v >> 8;
+	b[3] = v;
+}
+
+static uint32_t get_be32(const uint8_t *b)
+{
+	return ((uint32_t)b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+}
+
+int rpmb_dev_init(unsigned int size_mult, unsigned int rel_wr_sec_c)
+{
+	if (!size_mult || size_mult > UINT8_MAX || !rel_wr_sec_c ||
+	    rel_wr_sec_c > UINT8_MAX)
+		return -1;
+
+	free(rpmb_dev.data);
+	memset(&rpmb_dev, 0, sizeof(rpmb_dev));
+	rpmb_dev.num_blocks = size_mult * RPMB_SIZE_SINGLE / RPMB_DATA_SIZE;
+	rpmb_dev.data = calloc(rpmb_dev.num_blocks, RPMB_DATA_SIZE);
+	if (!rpmb_dev.data)
+		return -1;
+	rpmb_dev.size_mult = size_mult;
+	rpmb_dev.rel_wr_sec_c = rel_wr_sec_c;
+
+	return 0;
+}
+
+static TEE_Result compute_mac(const struct rpmb_frame *frm, size_t num_frm,
+			      uint8_t *mac)
+{
+	TEE_Result res = TEE_SUCCESS;
+	void *ctx = NULL;
+	size_t n = 0;
+
+	res = crypto_mac_alloc_ctx(&ctx, TEE_ALG_HMAC_SHA256);
+	if (res)
+		return res;
+	res = crypto_mac_init(ctx, rpmb_dev.key, sizeof(rpmb_dev.key));
+	for (n = 0; !res && n < num_frm; n++)
+		res = crypto_mac_update(ctx, frm[n].data, RPMB_MAC_SIZE);
+	if (!res)
+		res = crypto_mac_final(ctx, mac, RPMB_KEY_MAC_SIZE);
+	crypto_mac_free_ctx(ctx);
+
+	return res;
+}
+
+static uint32_t key_program(const struct rpmb_frame *req,
+			    struct rpmb_frame *resp)
+{
+	put_be16(resp->msg_type, RPMB_MSG_TYPE_REQ_AUTH_KEY_PROGRAM << 8);
+	if (rpmb_dev.key_programmed) {
+		put_be16(resp->op_result, RPMB_RESULT_GENERAL_FAILURE);
+		return TEE_SUCCESS;
+	}
+
+	memcpy(rpmb_dev.key, req->key_mac, sizeof(rpmb_dev.key));
+	rpmb_dev.key_programmed = true;
+	put_be16(resp->op_result, RPMB_RESULT_OK);
+
+	return TEE_SUCCESS;
+}
+
+static uint32_t counter_read(const struct rpmb_frame *req,
+			     struct rpmb_frame *resp)
+{
+	put_be16(resp->msg_type,
+		 RPMB_MSG_TYPE_REQ_WRITE_COUNTER_VAL_READ << 8);
+	memcpy(resp->nonce, req->nonce, sizeof(resp->nonce));
+	if (!rpmb_dev.key_programmed) {
+		put_be16(resp->op_result, RPMB_RESULT_AUTH_KEY_NOT_PROGRAMMED);
+		return TEE_SUCCESS;
+	}
+
+	put_be32(resp->write_counter, rpmb_dev.write_counter);
+	put_be16(resp->op_result, RPMB_RESULT_OK);
+
+	return compute_mac(resp, 1, resp->key_mac);
+}
+
+static uint32_t data_write(const struct rpmb_frame *req, size_t num_frm,
+			   struct rpmb_frame *resp)
+{
+	uint8_t mac[RPMB_KEY_MAC_SIZE] = { };
+	uint16_t addr = get_be16(req->address);
+	uint16_t result = RPMB_RESULT_OK;
+	TEE_Result res = TEE_SUCCESS;
+	size_t n = 0;
+
+	bench_counters.rpmb_writes++;
+	bench_delay_ns(bench_latency.rpmb_write_ns);
+
+	if (!rpmb_dev.key_programmed) {
+		result = RPMB_RESULT_AUTH_KEY_NOT_PROGRAMMED;
+		goto out;
+	}
+
+	res = compute_mac(req, num_frm, mac);
+	if (res)
+		return res;
+
+	if (num_frm > rpmb_dev.rel_wr_sec_c * 2U ||
+	    addr + num_frm > rpmb_dev.num_blocks) {
+		result = RPMB_RESULT_ADDRESS_FAILURE;
+	} else if (memcmp(mac, req[num_frm - 1].key_mac, sizeof(mac))) {
+		result = RPMB_RESULT_AUTH_FAILURE;
+	} else if (get_be32(req->write_counter) != rpmb_dev.write_counter) {
+		result = RPMB_RESULT_COUNTER_FAILURE;
+	} else {
+		for (n = 0; n < num_frm; n++)
+			memcpy(rpmb_dev.data + (addr + n) * RPMB_DATA_SIZE,
+			       req[n].data, RPMB_DATA_SIZE);
+		rpmb_dev.write_counter++;
+		bench_counters.rpmb_blocks += num_frm;
+	}
+
+out:
+	put_be16(resp->msg_type, RPMB_MSG_TYPE_REQ_AUTH_DATA_WRITE << 8);
+	put_be16(resp->op_result, result);
+	put_be16(resp->address, addr);
+	put_be32(resp->write_counter, rpmb_dev.write_counter);
+	if (!rpmb_dev.key_programmed)
+		return TEE_SUCCESS;
+
+	return compute_mac(resp, 1, resp->key_mac);
+}
+
+static uint32_t data_read(const struct rpmb_frame *req,
+			  struct rpmb_frame *resp, size_t num_frm)
+{
+	uint16_t addr = get_be16(req->address);
+	uint16_t result = RPMB_RESULT_OK;
+	size_t n = 0;
+
+	bench_counters.rpmb_reads++;
+
+	if (!rpmb_dev.key_programmed)
+		result = RPMB_RESULT_AUTH_KEY_NOT_PROGRAMMED;
+	else if (addr + num_frm > rpmb_dev.num_blocks)
+		result = RPMB_RESULT_ADDRESS_FAILURE;
+	else
+		bench_counters.rpmb_blocks += num_frm;
+
+	for (n = 0; n < num_frm; n++) {
+		if (result == RPMB_RESULT_OK)
+			memcpy(resp[n].data,
+			       rpmb_dev.data + (addr + n) * RPMB_DATA_SIZE,
+			       RPMB_DATA_SIZE);
+		memcpy(resp[n].nonce, req->nonce, sizeof(resp[n].nonce));
+		put_be16(resp[n].address, addr);
+		put_be16(resp[n].block_count, num_frm);
+		put_be16(resp[n].op_result, result);
+		put_be16(resp[n].msg_type,
+			 RPMB_MSG_TYPE_REQ_AUTH_DATA_READ << 8);
+	}
+	if (result != RPMB_RESULT_OK)
+		return TEE_SUCCESS;
+
+	return compute_mac(resp, num_frm, resp[num_frm - 1].key_mac);
+}
+
+static uint32_t get_dev_info(void *resp, size_t resp_size)
+{
+	struct rpmb_dev_info *di = resp;
+
+	if (resp_size < sizeof(*di))
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	memcpy(di->cid, rpmb_cid, sizeof(di->cid));
+	di->rpmb_size_mult = rpmb_dev.size_mult;
+	di->rel_wr_sec_c = rpmb_dev.rel_wr_sec_c;
+	di->ret_code = 0;
+
+	return TEE_SUCCESS;
+}
+
+uint32_t rpmb_dev_handle(const void *req, size_t req_size, void *resp,
+			 size_t resp_size)
+{
+	const struct rpmb_req *hdr = req;
+	const struct rpmb_frame *req_frm = (const void *)(hdr + 1);
+	struct rpmb_frame *resp_frm = resp;
+	size_t num_req = 0;
+	size_t num_resp = resp_size / RPMB_FRAME_SIZE;
+
+	if (req_size < sizeof(*hdr))
+		return TEE_ERROR_BAD_PARAMETERS;
+	if (hdr->cmd == RPMB_CMD_GET_DEV_INFO)
+		return get_dev_info(resp, resp_size);
+	if (hdr->cmd != RPMB_CMD_DATA_REQ)
+		return TEE_ERROR_BAD_PARAMETERS;
+
+	num_req = (req_size - sizeof(*hdr)) / RPMB_FRAME_SIZE;
+	if (!num_req || !num_resp)
+		return TEE_ERROR_BAD_PARAMETERS;
+	memset(resp, 0, num_resp * RPMB_FRAME_SIZE);
+
+	switch (get_be16(req_frm->msg_type)) {
+	case RPMB_MSG_TYPE_REQ_AUTH_KEY_PROGRAM:
+		return key_program(req_frm, resp_frm);
+	case RPMB_MSG_TYPE_REQ_WRITE_COUNTER_VAL_READ:
+		return counter_read(req_frm, resp_frm);
+	case RPMB_MSG_TYPE_REQ_AUTH_DATA_WRITE:
+		return data_write(req_frm, num_req, resp_frm);
+	case RPMB_MSG_TYPE_REQ_AUTH_DATA_READ:
+		return data_read(req_frm, resp_frm, num_resp);
+	default:
+		EMSG("Unsupported RPMB request %#x",
+		     get_be16(req_frm->msg_type));
+		return TEE_ERROR_BAD_PARAMETERS;
+	}
+}
@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: BSD-2-Clause
+
+/*
+ * Core services the storage code depends on, reduced to what a single
+ * threaded host process needs.
+ */
+
+#include <assert.h>
+#include <crypto/crypto.h>
+#include <kernel/mutex.h>
+#include <kernel/panic.h>
+#include <kernel/spinlock.h>
+#include <kernel/tee_common_otp.h>
+#include <kernel/thread.h>
+#include <kernel/user_access.h>
+#include <mempool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdlib_ext.h>
+#include <string.h>
+#include <tee/tee_cryp_utl.h>
+#include <tee/tee_fs.h>
+#include <tee/tee_svc_storage.h>
+#include <trace.h>
+
+#include "bench.h"
+
+struct mempool *mempool_default;
+
+void abort(void) __noreturn;
+
+void __do_panic(const char *file, const int line, const char *func,
+		const char *msg)
+{
+	bench_err("Panic '%s' at %s:%d <%s>\n", msg ? msg : "",
+		file ? file : "?", line, func ? func : "?");
+	abort();
+}
+
+void _assert_log(const char *expr, const char *file, const int line,
+		 const char *func)
+{
+	bench_err("assertion '%s' failed at %s:%d in %s()\n", expr,
+		file, line, func);
+}
+
+void _assert_break(void)
+{
+	abort();
+}
+
+void trace_printf(const char *func, int line, int level, bool level_ok,
+		  const char *fmt, ...)
+{
+	static const char lvl[] = { '?', 'E', 'I', 'D', 'F' };
+	char buf[256] = { };
+	va_list ap;
+
+	if (!level_ok)
+		return;
+
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	bench_err("%c/TC: %s:%d %s\n",
+		level < (int)sizeof(lvl) ? lvl[level] : '?',
+		func ? func : "", line, buf);
+}
+
+unsigned int __cpu_spin_trylock(unsigned int *lock)
+{
+	if (*lock)
+		return 1;
+	*lock = 1;
+	return 0;
+}
+
+void __cpu_spin_unlock(unsigned int *lock)
+{
+	*lock = 0;
+}
+
+void spinlock_count_incr(void)
+{
+}
+
+void spinlock_count_decr(void)
+{
+}
+
+/* There are no interrupts, report them as masked */
+uint32_t thread_get_exceptions(void)
+{
+	return THREAD_EXCP_ALL;
+}
+
+uint32_t thread_mask_exceptions(uint32_t exceptions __unused)
+{
+	return THREAD_EXCP_ALL;
+}
+
+void thread_unmask_exceptions(uint32_t state __unused)
+{
+}
+
+void mutex_lock(struct mutex *m __unused)
+{
+}
+
+void mutex_unlock(struct mutex *m __unused)
+{
+}
+
+/* Storage code called from the benchmark only passes kernel buffers */
+TEE_Result check_user_access(uint32_t flags __unused,
+			     const void *uaddr __unused, size_t len __unused)
+{
+	return TEE_SUCCESS;
+}
+
+TEE_Result copy_from_user(void *kaddr, const void *uaddr, size_t len)
+{
+	memcpy(kaddr, uaddr, len);
+	return TEE_SUCCESS;
+}
+
+TEE_Result copy_to_user(void *uaddr, const void *kaddr, size_t len)
+{
+	memcpy(uaddr, kaddr, len);
+	return TEE_SUCCESS;
+}
+
+void *mempool_alloc(struct mempool *pool __unused, size_t size)
+{
+	return malloc(size);
+}
+
+void mempool_free(struct mempool *pool __unused, void *ptr)
+{
+	free(ptr);
+}
+
+void free_wipe(void *ptr)
+{
+	free(ptr);
+}
+
+TEE_Result tee_otp_get_hw_unique_key(struct tee_hw_unique_key *hwkey)
+{
+	memset(hwkey->data, 0x5a, sizeof(hwkey->data));
+	return TEE_SUCCESS;
+}
+
+int tee_otp_get_die_id(uint8_t *buffer, size_t len)
+{
+	memset(buffer, 0xa5, len);
+	return 0;
+}
+
+bool plat_rpmb_key_is_ready(void)
+{
+	return true;
+}
+
+TEE_Result tee_hash_createdigest(uint32_t algo, const uint8_t *data,
+				 size_t datalen, uint8_t *digest,
+				 size_t digestlen)
+{
+	TEE_Result res = TEE_SUCCESS;
+	void *ctx = NULL;
+
+	res = crypto_hash_alloc_ctx(&ctx, algo);
+	if (res)
+		return res;
+	res = crypto_hash_init(ctx);
+	if (!res)
+		res = crypto_hash_update(ctx, data, datalen);
+	if (!res)
+		res = crypto_hash_final(ctx, digest, digestlen);
+	crypto_hash_free_ctx(ctx);
+
+	return res;
+}
+
+/* Deterministic so that runs are comparable */
+TEE_Result crypto_rng_read(void *buf, size_t len)
+{
+	static uint64_t state = 0x9e3779b97f4a7c15ULL;
+	uint8_t *b = buf;
+	size_t n = 0;
+
+	for (n = 0; n < len; n++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		b[n] = state;
+	}
+
+	return TEE_SUCCESS;
+}
+
+/* There's no cache of object heads in the benchmark */
+void tee_svc_storage_flush_heads(const struct tee_file_operations *fops
+				 __unused)
+{
+}